@@ -0,0 +1,39 @@
+#include <memory_resource>
+#include <vector>
+
+#include "FrameArena.hpp"
+#include "bench.hpp"
+
+namespace {
+
+// roughly what the render graph declares per frame: a few small lists
+constexpr int LISTS = 8;
+constexpr int ELEMENTS = 6;
+
+}  // namespace
+
+BENCHMARK(arena_frame_lists_heap) {
+    for (auto _ : state) {
+        for (int list = 0; list < LISTS; list++) {
+            std::vector<uint64_t> values;
+            for (int i = 0; i < ELEMENTS; i++) {
+                values.push_back(i);
+            }
+            bench::doNotOptimize(values.data());
+        }
+    }
+}
+
+BENCHMARK(arena_frame_lists_arena) {
+    FrameArena arena;
+    for (auto _ : state) {
+        arena.reset();
+        for (int list = 0; list < LISTS; list++) {
+            std::pmr::vector<uint64_t> values(&arena);
+            for (int i = 0; i < ELEMENTS; i++) {
+                values.push_back(i);
+            }
+            bench::doNotOptimize(values.data());
+        }
+    }
+}
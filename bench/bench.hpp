@@ -0,0 +1,143 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+// c++ std libs
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * Minimal benchmark harness. Register a case with
+ *
+ *   BENCHMARK(myCase) {
+ *       setup...
+ *       for (auto _ : state) { work... }
+ *   }
+ *
+ * The runner grows the iteration count until a run takes long enough to be
+ * stable and reports the time per iteration. A case that can't run here (no
+ * Vulkan device, say) calls state.skip(reason) and returns.
+ */
+namespace bench {
+
+class State {
+private:
+    using clock = std::chrono::steady_clock;
+    uint64_t iterations;
+    clock::time_point start;
+    double elapsedNs = 0;
+    bool paused = false;
+    std::vector<std::pair<std::string, double>> counters;
+    std::string skipReason;
+
+public:
+    explicit State(uint64_t iterations) : iterations(iterations) {}
+
+    // non-trivial so `for (auto _ : state)` doesn't trigger unused-variable warnings
+    struct Token {
+        ~Token() {}
+    };
+    struct Iterator {
+        State* state;
+        uint64_t left;
+        bool operator!=(const Iterator&) {
+            if (left == 0) {
+                state->pauseTiming();
+                return false;
+            }
+            return true;
+        }
+        void operator++() {
+            --left;
+        }
+        Token operator*() const {
+            return {};
+        }
+    };
+    Iterator begin() {
+        resumeTiming();
+        return {this, iterations};
+    }
+    Iterator end() {
+        return {this, 0};
+    }
+
+    // Exclude per-iteration setup from the measurement.
+    void pauseTiming() {
+        if (!paused) {
+            elapsedNs += std::chrono::duration<double, std::nano>(clock::now() - start).count();
+            paused = true;
+        }
+    }
+    void resumeTiming() {
+        paused = false;
+        start = clock::now();
+    }
+
+    uint64_t getIterations() const {
+        return iterations;
+    }
+    double getElapsedNs() const {
+        return elapsedNs;
+    }
+    // Extra metric shown next to the timing, e.g. items processed per iteration.
+    void setCounter(std::string name, double value) {
+        counters.emplace_back(std::move(name), value);
+    }
+    const std::vector<std::pair<std::string, double>>& getCounters() const {
+        return counters;
+    }
+
+    void skip(std::string reason) {
+        skipReason = std::move(reason);
+    }
+    bool skipped() const {
+        return !skipReason.empty();
+    }
+    const std::string& getSkipReason() const {
+        return skipReason;
+    }
+};
+
+using BenchFn = void (*)(State&);
+
+struct Case {
+    const char* name;
+    BenchFn fn;
+};
+
+std::vector<Case>& registry();
+
+struct Registrar {
+    Registrar(const char* name, BenchFn fn) {
+        registry().push_back({name, fn});
+    }
+};
+
+// Keep the compiler from optimizing `value` away.
+template <class T>
+inline void doNotOptimize(T&& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "g"(value) : "memory");
+#else
+    static volatile auto sink = value;
+    sink = value;
+#endif
+}
+
+inline void clobberMemory() {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : : "memory");
+#endif
+}
+
+}  // namespace bench
+
+#define BENCHMARK(name)                                             \
+    static void bench_##name(::bench::State& state);                \
+    static ::bench::Registrar benchRegistrar_##name(#name, &bench_##name); \
+    static void bench_##name(::bench::State& state)
+
+#endif  // BENCH_HPP
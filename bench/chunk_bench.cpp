@@ -0,0 +1,85 @@
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "ChunkCache.hpp"
+#include "bench.hpp"
+
+namespace {
+
+constexpr uint32_t WORLD = 256;  // chunks per side
+constexpr float CHUNK_SIZE = 64.f;
+constexpr uint32_t FRAMES = 600;
+constexpr uint32_t FRAMES_IN_FLIGHT = 2;
+constexpr uint32_t LOADS_PER_FRAME = 16;
+
+struct Run {
+    uint64_t evictions = 0;
+    double hitRate = 0;
+};
+
+/*
+ * A camera crossing the world diagonally at 600 units/s, 10 s at 60 fps.
+ * Loads land two frames after they're issued, the GPU is done with a frame
+ * two frames after its submit, and every chunk within 192 units is drawn.
+ */
+Run flyOver(ChunkCache& cache, float lookaheadSeconds) {
+    cache.settings.lookaheadSeconds = lookaheadSeconds;
+    cache.setCapacity(256);
+    std::vector<uint32_t> landing[3];
+    for (auto& loads : landing) {
+        loads.reserve(LOADS_PER_FRAME);
+    }
+    for (uint32_t frame = 1; frame <= FRAMES; frame++) {
+        cache.beginFrame();
+        for (uint32_t chunk : landing[frame % 3]) {
+            cache.loaded(chunk);
+        }
+        landing[frame % 3].clear();
+
+        float t = frame / 60.f;
+        ChunkCache::Camera camera{.x = 1000.f + 424.f * t, .z = 1000.f + 424.f * t, .vx = 424.f, .vz = 424.f};
+        cache.prioritize(camera);
+        uint64_t completed = frame > FRAMES_IN_FLIGHT ? frame - FRAMES_IN_FLIGHT : 0;
+        ChunkCache::Load load;
+        while (landing[(frame + 2) % 3].size() < LOADS_PER_FRAME && cache.nextLoad(completed, load)) {
+            landing[(frame + 2) % 3].push_back(load.chunk);
+        }
+
+        auto cx = static_cast<int32_t>(camera.x / CHUNK_SIZE);
+        auto cz = static_cast<int32_t>(camera.z / CHUNK_SIZE);
+        for (int32_t z = cz - 3; z <= cz + 3; z++) {
+            for (int32_t x = cx - 3; x <= cx + 3; x++) {
+                if (x >= 0 && z >= 0 && x < int32_t(WORLD) && z < int32_t(WORLD)) {
+                    bench::doNotOptimize(cache.use(cache.chunkIndex(x, z)));
+                }
+            }
+        }
+        cache.submitted(frame);
+    }
+    return {cache.getStats().evictions, cache.getStats().hitRate()};
+}
+
+void chunkStreaming(bench::State& state, float lookaheadSeconds) {
+    ChunkCache cache;
+    cache.init(WORLD, WORLD, CHUNK_SIZE);
+    cache.settings.loadRadius = 256.f;
+    Run run;
+    for (auto _ : state) {
+        run = flyOver(cache, lookaheadSeconds);
+    }
+    state.setCounter("us/frame", state.getElapsedNs() / state.getIterations() / FRAMES / 1e3);
+    state.setCounter("hit%", run.hitRate * 100.0);
+    state.setCounter("evictions", static_cast<double>(run.evictions) / state.getIterations());
+}
+
+}  // namespace
+
+// bookkeeping cost per frame, and how much looking ahead helps the hit rate
+BENCHMARK(chunk_cache_flyover) {
+    chunkStreaming(state, 0.5f);
+}
+
+BENCHMARK(chunk_cache_flyover_no_lookahead) {
+    chunkStreaming(state, 0.f);
+}
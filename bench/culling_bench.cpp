@@ -0,0 +1,125 @@
+#include <array>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "FrustumCulling.hpp"
+#include "bench.hpp"
+
+namespace {
+
+constexpr uint32_t MILLION = 1'000'000;
+
+// objects scattered in a 400^3 box around a camera looking down -z
+template <class Bounds>
+const Bounds& scene(uint32_t count) {
+    static std::vector<std::pair<uint32_t, std::unique_ptr<Bounds>>> cache;
+    for (const auto& [size, bounds] : cache) {
+        if (size == count) {
+            return *bounds;
+        }
+    }
+    auto bounds = std::make_unique<Bounds>();
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> position(-200.f, 200.f);
+    std::uniform_real_distribution<float> size(0.1f, 4.f);
+    for (uint32_t i = 0; i < count; i++) {
+        float x = position(rng), y = position(rng), z = position(rng), r = size(rng);
+        if constexpr (std::is_same_v<Bounds, SphereBounds>) {
+            bounds->push_back(x, y, z, r);
+        }
+        else {
+            bounds->push_back(x, y, z, r, r * 0.5f, r);
+        }
+    }
+    return *cache.emplace_back(count, std::move(bounds)).second;
+}
+
+// 60 degree vertical fov, 16:9, Vulkan depth, 500 far plane
+Frustum cameraFrustum() {
+    float f = 1.f / std::tan(0.5f);
+    float aspect = 16.f / 9.f, near = 0.1f, far = 500.f;
+    std::array<float, 16> projection = {
+        f / aspect, 0, 0, 0,
+        0, -f, 0, 0,
+        0, 0, far / (near - far), -1,
+        0, 0, far * near / (near - far), 0,
+    };
+    return Frustum::fromMatrix(projection);
+}
+
+template <class Bounds>
+void cullKernel(bench::State& state, FrustumCuller::Isa isa, uint32_t count) {
+    if (!FrustumCuller::supports(isa)) {
+        state.setCounter("unsupported", 1);
+        return;
+    }
+    const Bounds& bounds = scene<Bounds>(count);
+    Frustum frustum = cameraFrustum();
+    std::vector<uint32_t> visible(count);
+    uint32_t n = 0;
+    for (auto _ : state) {
+        if constexpr (std::is_same_v<Bounds, SphereBounds>) {
+            n = FrustumCuller::cullSpheres(isa, frustum, bounds, 0, count, visible.data());
+        }
+        else {
+            n = FrustumCuller::cullBoxes(isa, frustum, bounds, 0, count, visible.data());
+        }
+        bench::doNotOptimize(n);
+    }
+    state.setCounter("ns/object", state.getElapsedNs() / state.getIterations() / count);
+    state.setCounter("visible%", 100.0 * n / count);
+}
+
+void cullThreaded(bench::State& state, uint32_t count) {
+    const auto& bounds = scene<SphereBounds>(count);
+    Frustum frustum = cameraFrustum();
+    static FrustumCuller culler;
+    size_t n = 0;
+    for (auto _ : state) {
+        n = culler.cull(frustum, bounds).size();
+        bench::doNotOptimize(n);
+    }
+    state.setCounter("ns/object", state.getElapsedNs() / state.getIterations() / count);
+    state.setCounter("threads", culler.threadCount());
+    state.setCounter("visible%", 100.0 * n / count);
+}
+
+}  // namespace
+
+BENCHMARK(cull_spheres_1m_scalar) {
+    cullKernel<SphereBounds>(state, FrustumCuller::Isa::eScalar, MILLION);
+}
+
+BENCHMARK(cull_spheres_1m_sse2) {
+    cullKernel<SphereBounds>(state, FrustumCuller::Isa::eSse2, MILLION);
+}
+
+BENCHMARK(cull_spheres_1m_avx2) {
+    cullKernel<SphereBounds>(state, FrustumCuller::Isa::eAvx2, MILLION);
+}
+
+BENCHMARK(cull_spheres_1m_neon) {
+    cullKernel<SphereBounds>(state, FrustumCuller::Isa::eNeon, MILLION);
+}
+
+BENCHMARK(cull_boxes_1m_scalar) {
+    cullKernel<BoxBounds>(state, FrustumCuller::Isa::eScalar, MILLION);
+}
+
+BENCHMARK(cull_boxes_1m_best) {
+    cullKernel<BoxBounds>(state, FrustumCuller::bestIsa(), MILLION);
+}
+
+BENCHMARK(cull_threaded_100k) {
+    cullThreaded(state, MILLION / 10);
+}
+
+BENCHMARK(cull_threaded_1m) {
+    cullThreaded(state, MILLION);
+}
+
+BENCHMARK(cull_threaded_10m) {
+    cullThreaded(state, 10 * MILLION);
+}
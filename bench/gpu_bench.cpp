@@ -0,0 +1,397 @@
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "CommandCache.hpp"
+#include "DeviceProfile.hpp"
+#include "SceneShaders.hpp"
+#include "bench.hpp"
+#include "utils.hpp"
+#include "vertex.hpp"
+
+namespace {
+
+constexpr vk::Format TARGET_FORMAT = vk::Format::eR8G8B8A8Unorm;
+constexpr vk::Extent2D TARGET_EXTENT{1280, 720};
+constexpr vk::DeviceSize UPLOAD_BYTES = 4 << 20;
+// lavapipe, so numbers are comparable between machines
+constexpr std::string_view DEFAULT_DEVICE = "llvmpipe";
+
+/*
+ * One device shared by every GPU case, created on first use. The surface
+ * comes from VK_EXT_headless_surface: DeviceProfile checks present support
+ * and the swapchain case needs one. Set LEARN_VULKAN_DEVICE to measure
+ * something other than lavapipe.
+ */
+struct Gpu {
+    vk::raii::Context context;
+    vk::raii::Instance instance = nullptr;
+    vk::raii::SurfaceKHR surface = nullptr;
+    DeviceProfile profile;
+    vk::raii::Device device = nullptr;
+    vk::raii::Queue queue = nullptr;
+    vk::raii::CommandPool pool = nullptr;
+    vk::raii::CommandBuffer cmd = nullptr;
+    vk::raii::Fence fence = nullptr;
+    // the device is created without optional features
+    DeviceProfile::Features shaderFeatures;
+    // empty when shaders/shader.spv isn't found
+    std::vector<char> sceneSpv;
+};
+
+struct Buffer {
+    vk::raii::DeviceMemory memory = nullptr;
+    vk::raii::Buffer buffer = nullptr;
+    void* mapped = nullptr;
+};
+
+struct Target {
+    vk::raii::DeviceMemory memory = nullptr;
+    vk::raii::Image image = nullptr;
+    vk::raii::ImageView view = nullptr;
+};
+
+std::unique_ptr<Gpu> createGpu() {
+    auto gpu = std::make_unique<Gpu>();
+    auto available = gpu->context.enumerateInstanceExtensionProperties();
+    bool headless = std::ranges::any_of(available, [](const vk::ExtensionProperties& e) {
+        return std::string_view(e.extensionName.data()) == vk::EXTHeadlessSurfaceExtensionName;
+    });
+    if (!headless) {
+        throw std::runtime_error("no VK_EXT_headless_surface");
+    }
+    vk::ApplicationInfo appInfo{.pApplicationName = "learn_vulkan_bench", .apiVersion = vk::ApiVersion13};
+    std::array instanceExtensions{vk::KHRSurfaceExtensionName, vk::EXTHeadlessSurfaceExtensionName};
+    gpu->instance = vk::raii::Instance(gpu->context, vk::InstanceCreateInfo{
+        .pApplicationInfo = &appInfo,
+        .enabledExtensionCount = static_cast<uint32_t>(instanceExtensions.size()),
+        .ppEnabledExtensionNames = instanceExtensions.data()
+    });
+    gpu->surface = gpu->instance.createHeadlessSurfaceEXT({});
+
+    std::array deviceExtensions{vk::KHRSwapchainExtensionName};
+    const char* env = std::getenv("LEARN_VULKAN_DEVICE");
+    gpu->profile = selectDeviceProfile(
+        enumerateDeviceProfiles(gpu->instance, gpu->surface, deviceExtensions),
+        env != nullptr ? "" : DEFAULT_DEVICE
+    );
+
+    // the features the app requires, see createLogicalDeviceAndQueueIndex()
+    vk::StructureChain features{
+        vk::PhysicalDeviceFeatures2{},
+        vk::PhysicalDeviceVulkan11Features{.shaderDrawParameters = true},
+        vk::PhysicalDeviceVulkan12Features{.hostQueryReset = true, .timelineSemaphore = true},
+        vk::PhysicalDeviceVulkan13Features{.synchronization2 = true, .dynamicRendering = true},
+        vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT{.extendedDynamicState = true}
+    };
+    uint32_t family = gpu->profile.graphicsPresentFamily;
+    float priority = 1.f;
+    vk::DeviceQueueCreateInfo queueInfo{
+        .queueFamilyIndex = family, .queueCount = 1, .pQueuePriorities = &priority
+    };
+    gpu->device = vk::raii::Device(gpu->profile.device, vk::DeviceCreateInfo{
+        .pNext = &features.get<vk::PhysicalDeviceFeatures2>(),
+        .queueCreateInfoCount = 1,
+        .pQueueCreateInfos = &queueInfo,
+        .enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size()),
+        .ppEnabledExtensionNames = deviceExtensions.data()
+    });
+    gpu->queue = gpu->device.getQueue(family, 0);
+    gpu->pool = vk::raii::CommandPool(gpu->device, vk::CommandPoolCreateInfo{
+        .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer, .queueFamilyIndex = family
+    });
+    gpu->cmd = std::move(vk::raii::CommandBuffers(gpu->device, vk::CommandBufferAllocateInfo{
+        .commandPool = *gpu->pool, .level = vk::CommandBufferLevel::ePrimary, .commandBufferCount = 1
+    }).front());
+    gpu->fence = vk::raii::Fence(gpu->device, vk::FenceCreateInfo{});
+
+    try {
+        gpu->sceneSpv = readFile("shaders/shader.spv");
+    }
+    catch (const std::runtime_error&) {
+    }
+    return gpu;
+}
+
+// nullptr, with the case skipped, when there is no usable device
+Gpu* sharedGpu(bench::State& state) {
+    static std::string error;
+    static std::unique_ptr<Gpu> gpu = []() -> std::unique_ptr<Gpu> {
+        try {
+            return createGpu();
+        }
+        catch (const std::exception& e) {
+            error = e.what();
+            return nullptr;
+        }
+    }();
+    if (gpu == nullptr) {
+        state.skip(error);
+    }
+    return gpu.get();
+}
+
+Gpu* gpuWithShaders(bench::State& state) {
+    Gpu* gpu = sharedGpu(state);
+    if (gpu != nullptr && gpu->sceneSpv.empty()) {
+        state.skip("shaders/shader.spv not found, run from the repository root");
+        return nullptr;
+    }
+    return gpu;
+}
+
+void submitAndWait(Gpu& gpu) {
+    vk::CommandBufferSubmitInfo cmdInfo{.commandBuffer = *gpu.cmd};
+    gpu.queue.submit2(vk::SubmitInfo2{.commandBufferInfoCount = 1, .pCommandBufferInfos = &cmdInfo}, *gpu.fence);
+    if (gpu.device.waitForFences(*gpu.fence, vk::True, UINT64_MAX) != vk::Result::eSuccess) {
+        throw std::runtime_error("failed to wait for fence!");
+    }
+    gpu.device.resetFences(*gpu.fence);
+}
+
+Buffer createBuffer(
+    const Gpu& gpu, vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties
+) {
+    Buffer result;
+    result.buffer = vk::raii::Buffer(gpu.device, vk::BufferCreateInfo{
+        .size = size, .usage = usage, .sharingMode = vk::SharingMode::eExclusive
+    });
+    auto requirements = result.buffer.getMemoryRequirements();
+    result.memory = vk::raii::DeviceMemory(gpu.device, vk::MemoryAllocateInfo{
+        .allocationSize = requirements.size,
+        .memoryTypeIndex = findMemoryType(gpu.profile.memory, requirements.memoryTypeBits, properties)
+    });
+    result.buffer.bindMemory(*result.memory, 0);
+    if (properties & vk::MemoryPropertyFlagBits::eHostVisible) {
+        result.mapped = result.memory.mapMemory(0, size);
+    }
+    return result;
+}
+
+// what a resize recreates for the scene color target
+Target createTarget(const Gpu& gpu, vk::Extent2D extent) {
+    Target result;
+    result.image = vk::raii::Image(gpu.device, vk::ImageCreateInfo{
+        .imageType = vk::ImageType::e2D,
+        .format = TARGET_FORMAT,
+        .extent = {extent.width, extent.height, 1},
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = vk::SampleCountFlagBits::e1,
+        .tiling = vk::ImageTiling::eOptimal,
+        .usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc,
+        .sharingMode = vk::SharingMode::eExclusive,
+        .initialLayout = vk::ImageLayout::eUndefined
+    });
+    auto requirements = result.image.getMemoryRequirements();
+    result.memory = vk::raii::DeviceMemory(gpu.device, vk::MemoryAllocateInfo{
+        .allocationSize = requirements.size,
+        .memoryTypeIndex = findMemoryType(
+            gpu.profile.memory, requirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal
+        )
+    });
+    result.image.bindMemory(*result.memory, 0);
+    result.view = vk::raii::ImageView(gpu.device, vk::ImageViewCreateInfo{
+        .image = *result.image,
+        .viewType = vk::ImageViewType::e2D,
+        .format = TARGET_FORMAT,
+        .subresourceRange = {vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1}
+    });
+    return result;
+}
+
+// With `cached` the draws are recorded once into a secondary command buffer
+// and only executed from the per-frame primary.
+void frameRecordSubmit(bench::State& state, uint32_t draws, bool cached = false) {
+    Gpu* gpu = gpuWithShaders(state);
+    if (gpu == nullptr) {
+        return;
+    }
+    SceneShaders shaders;
+    shaders.init(gpu->device, gpu->shaderFeatures, gpu->sceneSpv, TARGET_FORMAT);
+    Target target = createTarget(*gpu, TARGET_EXTENT);
+    Buffer vertices = createBuffer(
+        *gpu,
+        getVectorSize(TRAINGLE),
+        vk::BufferUsageFlagBits::eVertexBuffer,
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+    );
+    std::memcpy(vertices.mapped, TRAINGLE.data(), getVectorSize(TRAINGLE));
+    CommandCache cache;
+    cache.init(gpu->device, gpu->profile.graphicsPresentFamily, 1);
+    auto recordDraws = [&](const vk::raii::CommandBuffer& cmd) {
+        shaders.bind(cmd, RasterState{}, TARGET_EXTENT);
+        cmd.bindVertexBuffers(0, *vertices.buffer, {0});
+        for (uint32_t i = 0; i < draws; i++) {
+            cmd.draw(3, 1, 0, 0);
+        }
+    };
+
+    const auto& cmd = gpu->cmd;
+    for (auto _ : state) {
+        cmd.reset();
+        cmd.begin({.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+        vk::ImageMemoryBarrier2 toAttachment{
+            .srcStageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+            .dstStageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+            .dstAccessMask = vk::AccessFlagBits2::eColorAttachmentWrite,
+            .oldLayout = vk::ImageLayout::eUndefined,
+            .newLayout = vk::ImageLayout::eColorAttachmentOptimal,
+            .image = *target.image,
+            .subresourceRange = {vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1}
+        };
+        cmd.pipelineBarrier2({.imageMemoryBarrierCount = 1, .pImageMemoryBarriers = &toAttachment});
+        vk::RenderingAttachmentInfo color{
+            .imageView = *target.view,
+            .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
+            .loadOp = vk::AttachmentLoadOp::eClear,
+            .storeOp = vk::AttachmentStoreOp::eStore,
+            .clearValue = {.color = {.float32 = std::array{0.1f, 0.1f, 0.1f, 1.f}}}
+        };
+        cmd.beginRendering({
+            .flags = cached ? vk::RenderingFlagBits::eContentsSecondaryCommandBuffers : vk::RenderingFlags{},
+            .renderArea = {{0, 0}, TARGET_EXTENT},
+            .layerCount = 1,
+            .colorAttachmentCount = 1,
+            .pColorAttachments = &color
+        });
+        if (cached) {
+            cmd.executeCommands(cache.get(0, TARGET_FORMAT, recordDraws));
+        }
+        else {
+            recordDraws(cmd);
+        }
+        cmd.endRendering();
+        cmd.end();
+        submitAndWait(*gpu);
+    }
+    state.setCounter("draws", draws);
+}
+
+}  // namespace
+
+// Everything SceneShaders::init() does: module, layout and the first
+// pipeline. Driver-side shader caches apply, as they would for the app.
+BENCHMARK(gpu_pipeline_create) {
+    Gpu* gpu = gpuWithShaders(state);
+    if (gpu == nullptr) {
+        return;
+    }
+    for (auto _ : state) {
+        auto shaders = std::make_unique<SceneShaders>();
+        shaders->init(gpu->device, gpu->shaderFeatures, gpu->sceneSpv, TARGET_FORMAT);
+        state.pauseTiming();
+        shaders.reset();
+        state.resumeTiming();
+    }
+}
+
+BENCHMARK(gpu_offscreen_target_recreate) {
+    Gpu* gpu = sharedGpu(state);
+    if (gpu == nullptr) {
+        return;
+    }
+    for (auto _ : state) {
+        Target target = createTarget(*gpu, TARGET_EXTENT);
+        bench::doNotOptimize(*target.view);
+    }
+}
+
+BENCHMARK(gpu_swapchain_recreate) {
+    Gpu* gpu = sharedGpu(state);
+    if (gpu == nullptr) {
+        return;
+    }
+    auto capabilities = gpu->profile.device.getSurfaceCapabilitiesKHR(*gpu->surface);
+    auto format = gpu->profile.device.getSurfaceFormatsKHR(*gpu->surface).front();
+    vk::Extent2D extent = capabilities.currentExtent.width != UINT32_MAX ? capabilities.currentExtent : TARGET_EXTENT;
+    uint32_t imageCount = std::max(3u, capabilities.minImageCount);
+    if (capabilities.maxImageCount > 0) {
+        imageCount = std::min(imageCount, capabilities.maxImageCount);
+    }
+    // lowest supported bit, usually opaque
+    auto alphaBits = static_cast<uint32_t>(capabilities.supportedCompositeAlpha);
+    auto compositeAlpha = static_cast<vk::CompositeAlphaFlagBitsKHR>(alphaBits & (~alphaBits + 1));
+
+    vk::raii::SwapchainKHR swapchain = nullptr;
+    std::vector<vk::raii::ImageView> views;
+    for (auto _ : state) {
+        views.clear();
+        swapchain = vk::raii::SwapchainKHR(gpu->device, vk::SwapchainCreateInfoKHR{
+            .surface = *gpu->surface,
+            .minImageCount = imageCount,
+            .imageFormat = format.format,
+            .imageColorSpace = format.colorSpace,
+            .imageExtent = extent,
+            .imageArrayLayers = 1,
+            .imageUsage = vk::ImageUsageFlagBits::eColorAttachment,
+            .imageSharingMode = vk::SharingMode::eExclusive,
+            .preTransform = capabilities.currentTransform,
+            .compositeAlpha = compositeAlpha,
+            .presentMode = vk::PresentModeKHR::eFifo,
+            .clipped = vk::True,
+            .oldSwapchain = *swapchain
+        });
+        for (vk::Image image : swapchain.getImages()) {
+            views.emplace_back(gpu->device, vk::ImageViewCreateInfo{
+                .image = image,
+                .viewType = vk::ImageViewType::e2D,
+                .format = format.format,
+                .subresourceRange = {vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1}
+            });
+        }
+    }
+    state.setCounter("images", static_cast<double>(views.size()));
+}
+
+BENCHMARK(gpu_frame_record_submit_1_draw) {
+    frameRecordSubmit(state, 1);
+}
+
+BENCHMARK(gpu_frame_record_submit_1k_draws) {
+    frameRecordSubmit(state, 1000);
+}
+
+BENCHMARK(gpu_frame_record_submit_1k_draws_cached) {
+    frameRecordSubmit(state, 1000, true);
+}
+
+// host write into a staging buffer, copy to device local, wait
+BENCHMARK(gpu_buffer_upload_4m) {
+    Gpu* gpu = sharedGpu(state);
+    if (gpu == nullptr) {
+        return;
+    }
+    Buffer staging = createBuffer(
+        *gpu,
+        UPLOAD_BYTES,
+        vk::BufferUsageFlagBits::eTransferSrc,
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+    );
+    Buffer destination = createBuffer(
+        *gpu,
+        UPLOAD_BYTES,
+        vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer,
+        vk::MemoryPropertyFlagBits::eDeviceLocal
+    );
+    std::vector<std::byte> source(UPLOAD_BYTES, std::byte{0x5a});
+    const auto& cmd = gpu->cmd;
+    for (auto _ : state) {
+        std::memcpy(staging.mapped, source.data(), source.size());
+        cmd.reset();
+        cmd.begin({.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+        cmd.copyBuffer(*staging.buffer, *destination.buffer, vk::BufferCopy{.size = UPLOAD_BYTES});
+        cmd.end();
+        submitAndWait(*gpu);
+    }
+    state.setCounter("MiB", static_cast<double>(UPLOAD_BYTES >> 20));
+}
@@ -0,0 +1,130 @@
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "DeviceProfile.hpp"
+#include "bench.hpp"
+#include "utils.hpp"
+#include "vertex.hpp"
+
+namespace {
+
+// a typical discrete GPU: device local, host visible variants and a BAR window
+vk::PhysicalDeviceMemoryProperties desktopMemory() {
+    using enum vk::MemoryPropertyFlagBits;
+    const std::array<vk::MemoryPropertyFlags, 8> types = {
+        {},
+        eDeviceLocal,
+        eDeviceLocal,
+        eHostVisible | eHostCoherent,
+        eHostVisible | eHostCoherent | eHostCached,
+        eDeviceLocal | eHostVisible | eHostCoherent,
+        eHostVisible | eHostCached,
+        eDeviceLocal | eLazilyAllocated,
+    };
+    vk::PhysicalDeviceMemoryProperties memory;
+    memory.memoryTypeCount = static_cast<uint32_t>(types.size());
+    for (uint32_t i = 0; i < types.size(); i++) {
+        memory.memoryTypes[i] = {.propertyFlags = types[i], .heapIndex = i == 1 || i == 2 ? 0u : 1u};
+    }
+    memory.memoryHeapCount = 2;
+    return memory;
+}
+
+// a scratch file of `size` bytes, removed at exit
+const std::string& scratchFile(size_t size) {
+    struct Scratch {
+        std::string path;
+        ~Scratch() {
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+        }
+    };
+    static std::vector<std::pair<size_t, Scratch>> files;
+    for (const auto& [fileSize, file] : files) {
+        if (fileSize == size) {
+            return file.path;
+        }
+    }
+    auto path = std::filesystem::temp_directory_path() / std::format("learn_vulkan_bench_{}.bin", size);
+    std::vector<char> data(size, 'x');
+    std::ofstream(path, std::ios::binary).write(data.data(), data.size());
+    return files.emplace_back(size, Scratch{path.string()}).second.path;
+}
+
+void readFileBench(bench::State& state, size_t size) {
+    const std::string& path = scratchFile(size);
+    for (auto _ : state) {
+        auto data = readFile(path);
+        bench::doNotOptimize(data.data());
+    }
+}
+
+}  // namespace
+
+BENCHMARK(find_memory_type) {
+    auto memory = desktopMemory();
+    using enum vk::MemoryPropertyFlagBits;
+    // what buffer and image creation ask for: staging, device local, readback
+    const std::array<std::pair<uint32_t, vk::MemoryPropertyFlags>, 3> queries = {{
+        {0xffu, eHostVisible | eHostCoherent},
+        {0xfeu, eDeviceLocal},
+        {0xf0u, eHostVisible | eHostCached},
+    }};
+    size_t i = 0;
+    for (auto _ : state) {
+        const auto& [filter, flags] = queries[i++ % queries.size()];
+        bench::doNotOptimize(findMemoryType(memory, filter, flags));
+    }
+}
+
+BENCHMARK(read_file_64k) {
+    readFileBench(state, 64 << 10);
+}
+
+BENCHMARK(read_file_1m) {
+    readFileBench(state, 1 << 20);
+}
+
+BENCHMARK(srgb_to_linear_4k) {
+    constexpr size_t COUNT = 4096;
+    std::vector<RGBAColor> colors(COUNT);
+    for (size_t i = 0; i < COUNT; i++) {
+        float v = static_cast<float>(i) / COUNT;
+        colors[i] = {v, 1.f - v, v * 0.5f, 1.f};
+    }
+    for (auto _ : state) {
+        for (auto& color : colors) {
+            auto linear = color.srgbToLinear();
+            bench::doNotOptimize(linear.data());
+        }
+    }
+    state.setCounter("colors", COUNT);
+}
+
+// separate position and color streams interleaved into SimpleVertex and
+// copied into a (here host) staging allocation, as for a vertex upload
+BENCHMARK(vertex_pack_64k) {
+    constexpr size_t COUNT = 64 << 10;
+    std::vector<glm::fvec3> positions(COUNT), colors(COUNT);
+    for (size_t i = 0; i < COUNT; i++) {
+        float v = static_cast<float>(i);
+        positions[i] = {v, v * 0.5f, 0.f};
+        colors[i] = {1.f, v / COUNT, 0.f};
+    }
+    std::vector<SimpleVertex> vertices(COUNT);
+    std::vector<std::byte> staging(COUNT * sizeof(SimpleVertex));
+    for (auto _ : state) {
+        for (size_t i = 0; i < COUNT; i++) {
+            vertices[i] = {positions[i], colors[i]};
+        }
+        std::memcpy(staging.data(), vertices.data(), getVectorSize(vertices));
+        bench::doNotOptimize(staging.data());
+    }
+    state.setCounter("vertices", COUNT);
+}
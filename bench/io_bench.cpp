@@ -0,0 +1,145 @@
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <future>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "AsyncIO.hpp"
+#include "bench.hpp"
+#include "utils.hpp"
+
+namespace {
+
+constexpr uint32_t SMALL_FILES = 2000;
+constexpr size_t SMALL_SIZE = 4 << 10;
+constexpr uint32_t LARGE_FILES = 4;
+constexpr size_t LARGE_SIZE = 8 << 20;
+
+// `count` files of `size` bytes in a temporary directory, removed at exit
+const std::vector<std::string>& scratchFiles(uint32_t count, size_t size) {
+    struct Scratch {
+        std::filesystem::path dir;
+        std::vector<std::string> paths;
+        ~Scratch() {
+            std::error_code ec;
+            std::filesystem::remove_all(dir, ec);
+        }
+    };
+    static std::vector<Scratch> sets;
+    for (const auto& set : sets) {
+        if (set.paths.size() == count && std::filesystem::file_size(set.paths.front()) == size) {
+            return set.paths;
+        }
+    }
+    auto& set = sets.emplace_back();
+    set.dir = std::filesystem::temp_directory_path() / std::format("learn_vulkan_io_{}x{}", count, size);
+    std::filesystem::create_directories(set.dir);
+    std::vector<char> data(size, 'x');
+    for (uint32_t i = 0; i < count; i++) {
+        auto path = (set.dir / std::format("{}.bin", i)).string();
+        std::ofstream(path, std::ios::binary).write(data.data(), data.size());
+        set.paths.push_back(std::move(path));
+    }
+    return set.paths;
+}
+
+void setCounters(bench::State& state, uint32_t count, size_t size, uint64_t syscalls) {
+    double seconds = state.getElapsedNs() / state.getIterations() / 1e9;
+    state.setCounter("MiB/s", count * size / double(1 << 20) / seconds);
+    state.setCounter("syscalls", double(syscalls) / state.getIterations());
+}
+
+// the synchronous path everything uses today
+void readFileSync(bench::State& state, uint32_t count, size_t size) {
+    const auto& paths = scratchFiles(count, size);
+    for (auto _ : state) {
+        for (const auto& path : paths) {
+            auto data = readFile(path);
+            bench::doNotOptimize(data.data());
+        }
+    }
+    // open, stat, read, close
+    setCounters(state, count, size, 4ull * count * state.getIterations());
+}
+
+void readFileAsync(bench::State& state, AsyncIO::Backend backend, uint32_t count, size_t size) {
+    const auto& paths = scratchFiles(count, size);
+    AsyncIO io;
+    io.init(backend);
+    if (io.getBackend() != backend) {
+        state.skip("io_uring unavailable");
+        return;
+    }
+    std::vector<std::future<std::vector<char>>> files(count);
+    for (auto _ : state) {
+        for (uint32_t i = 0; i < count; i++) {
+            files[i] = io.readFile(paths[i]);
+        }
+        for (auto& file : files) {
+            bench::doNotOptimize(file.get().data());
+        }
+    }
+    setCounters(state, count, size, io.getStats().syscalls);
+}
+
+// reads straight into one registered buffer, the way staging memory would be filled
+void readFixed(bench::State& state, uint32_t count, size_t size) {
+    const auto& paths = scratchFiles(count, size);
+    AsyncIO io;
+    io.init(AsyncIO::Backend::eIoUring);
+    if (io.getBackend() != AsyncIO::Backend::eIoUring) {
+        state.skip("io_uring unavailable");
+        return;
+    }
+    std::vector<uint8_t> staging(count * size);
+    std::span<uint8_t> buffer = staging;
+    if (!io.registerBuffers({&buffer, 1})) {
+        state.skip("registering the buffer failed (RLIMIT_MEMLOCK?)");
+        return;
+    }
+    for (auto _ : state) {
+        for (uint32_t i = 0; i < count; i++) {
+            io.read(paths[i], 0, buffer.subspan(i * size, size), nullptr);
+        }
+        io.wait();
+    }
+    bench::doNotOptimize(staging.data());
+    setCounters(state, count, size, io.getStats().syscalls);
+    state.setCounter("fixed%", 100.0 * io.getStats().fixedReads / io.getStats().requests);
+}
+
+}  // namespace
+
+BENCHMARK(io_small_files_readfile) {
+    readFileSync(state, SMALL_FILES, SMALL_SIZE);
+}
+
+BENCHMARK(io_small_files_threads) {
+    readFileAsync(state, AsyncIO::Backend::eThreadPool, SMALL_FILES, SMALL_SIZE);
+}
+
+BENCHMARK(io_small_files_uring) {
+    readFileAsync(state, AsyncIO::Backend::eIoUring, SMALL_FILES, SMALL_SIZE);
+}
+
+BENCHMARK(io_small_files_uring_fixed) {
+    readFixed(state, SMALL_FILES, SMALL_SIZE);
+}
+
+BENCHMARK(io_large_files_readfile) {
+    readFileSync(state, LARGE_FILES, LARGE_SIZE);
+}
+
+BENCHMARK(io_large_files_threads) {
+    readFileAsync(state, AsyncIO::Backend::eThreadPool, LARGE_FILES, LARGE_SIZE);
+}
+
+BENCHMARK(io_large_files_uring) {
+    readFileAsync(state, AsyncIO::Backend::eIoUring, LARGE_FILES, LARGE_SIZE);
+}
+
+BENCHMARK(io_large_files_uring_fixed) {
+    readFixed(state, LARGE_FILES, LARGE_SIZE);
+}
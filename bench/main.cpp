@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <print>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bench.hpp"
+
+namespace bench {
+
+std::vector<Case>& registry() {
+    static std::vector<Case> cases;
+    return cases;
+}
+
+}  // namespace bench
+
+namespace {
+
+constexpr double MIN_TIME_NS = 2e8;  // aim for 200ms per case
+
+struct Options {
+    std::string_view filter;
+    std::string jsonPath;     // --json=results.json
+    std::string baselinePath; // --compare=baseline.json
+    double threshold = 0.10;  // --threshold=10, in percent
+};
+
+struct Result {
+    std::string name;
+    double nsPerIteration = 0;
+    uint64_t iterations = 0;
+    std::vector<std::pair<std::string, double>> counters;
+    std::string skipped;
+};
+
+bench::State runCase(const bench::Case& c) {
+    uint64_t iterations = 1;
+    while (true) {
+        bench::State state(iterations);
+        c.fn(state);
+        double elapsed = state.getElapsedNs();
+        if (state.skipped() || elapsed >= MIN_TIME_NS || iterations >= (1ull << 40)) {
+            return state;
+        }
+        // grow toward the target, at most 10x per step
+        double scale = elapsed > 0 ? MIN_TIME_NS * 1.2 / elapsed : 10.0;
+        iterations = static_cast<uint64_t>(iterations * std::clamp(scale, 2.0, 10.0));
+    }
+}
+
+Options parseOptions(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg.starts_with("--json=")) {
+            options.jsonPath = arg.substr(std::string_view("--json=").size());
+        }
+        else if (arg.starts_with("--compare=")) {
+            options.baselinePath = arg.substr(std::string_view("--compare=").size());
+        }
+        else if (arg.starts_with("--threshold=")) {
+            options.threshold = std::atof(argv[i] + std::string_view("--threshold=").size()) / 100.0;
+        }
+        else if (arg.starts_with("--")) {
+            std::println(stderr, "Unknown argument: {}", arg);
+        }
+        else {
+            options.filter = arg;
+        }
+    }
+    return options;
+}
+
+std::string escapeJson(std::string_view text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += static_cast<unsigned char>(c) < 0x20 ? ' ' : c;
+    }
+    return escaped;
+}
+
+void writeJson(const std::string& path, const std::vector<Result>& results) {
+    std::string json = "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto& r = results[i];
+        json += std::format("    {{\"name\": \"{}\"", r.name);
+        if (!r.skipped.empty()) {
+            json += std::format(", \"skipped\": \"{}\"", escapeJson(r.skipped));
+        }
+        else {
+            json += std::format(", \"ns_per_iter\": {:.6g}, \"iterations\": {}", r.nsPerIteration, r.iterations);
+            json += ", \"counters\": {";
+            for (size_t c = 0; c < r.counters.size(); c++) {
+                json += std::format("{}\"{}\": {:.6g}", c > 0 ? ", " : "", r.counters[c].first, r.counters[c].second);
+            }
+            json += "}";
+        }
+        json += i + 1 < results.size() ? "},\n" : "}\n";
+    }
+    json += "  ]\n}\n";
+    std::ofstream(path) << json;
+}
+
+/*
+ * Reads back what writeJson() wrote: for every "name", the "ns_per_iter"
+ * that follows it before the next name. Not a general JSON parser.
+ */
+std::vector<Result> readJson(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("failed to open " + path);
+    }
+    std::string text(std::istreambuf_iterator<char>(in), {});
+    constexpr std::string_view NAME = "\"name\": \"";
+    constexpr std::string_view TIME = "\"ns_per_iter\": ";
+
+    std::vector<Result> results;
+    size_t pos = text.find(NAME);
+    while (pos != std::string::npos) {
+        size_t begin = pos + NAME.size();
+        size_t end = text.find('"', begin);
+        size_t next = text.find(NAME, end);
+        Result& result = results.emplace_back();
+        result.name = text.substr(begin, end - begin);
+        size_t time = text.find(TIME, end);
+        if (time != std::string::npos && time < next) {
+            const char* first = text.data() + time + TIME.size();
+            std::from_chars(first, text.data() + text.size(), result.nsPerIteration);
+        }
+        pos = next;
+    }
+    return results;
+}
+
+// Returns the number of regressions.
+int compare(const std::vector<Result>& results, const std::vector<Result>& baseline, double threshold) {
+    std::println(
+        "\n{:<40} {:>14} {:>14} {:>9}  (threshold {:.0f}%)",
+        "benchmark",
+        "baseline",
+        "current",
+        "change",
+        threshold * 100.0
+    );
+    int regressions = 0;
+    for (const auto& r : results) {
+        if (!r.skipped.empty()) {
+            continue;
+        }
+        auto base = std::ranges::find(baseline, r.name, &Result::name);
+        if (base == baseline.end() || base->nsPerIteration <= 0) {
+            std::println("{:<40} {:>14} {:>11.2f} ns {:>9}", r.name, "-", r.nsPerIteration, "new");
+            continue;
+        }
+        double change = r.nsPerIteration / base->nsPerIteration - 1.0;
+        const char* verdict = "";
+        if (change > threshold) {
+            verdict = "  REGRESSION";
+            regressions++;
+        }
+        else if (change < -threshold) {
+            verdict = "  faster";
+        }
+        std::println(
+            "{:<40} {:>11.2f} ns {:>11.2f} ns {:>+8.1f}%{}",
+            r.name,
+            base->nsPerIteration,
+            r.nsPerIteration,
+            change * 100.0,
+            verdict
+        );
+    }
+    return regressions;
+}
+
+}  // namespace
+
+/*
+ *   learn_vulkan_bench [filter] [--json=out.json] [--compare=baseline.json] [--threshold=10]
+ *
+ * With --compare the exit code is 1 when any case got slower than the
+ * baseline by more than the threshold.
+ */
+int main(int argc, char** argv) {
+    Options options = parseOptions(argc, argv);
+    std::vector<Result> results;
+    std::println("{:<40} {:>14} {:>12}", "benchmark", "time/iter", "iterations");
+    for (const auto& c : bench::registry()) {
+        if (!std::string_view(c.name).contains(options.filter)) {
+            continue;
+        }
+        auto state = runCase(c);
+        Result& result = results.emplace_back();
+        result.name = c.name;
+        if (state.skipped()) {
+            result.skipped = state.getSkipReason();
+            std::println("{:<40} skipped: {}", c.name, result.skipped);
+            continue;
+        }
+        result.iterations = state.getIterations();
+        result.nsPerIteration = state.getElapsedNs() / result.iterations;
+        result.counters = state.getCounters();
+        std::print("{:<40} {:>11.2f} ns {:>12}", c.name, result.nsPerIteration, result.iterations);
+        for (const auto& [name, value] : result.counters) {
+            std::print("  {}={:.4g}", name, value);
+        }
+        std::println("");
+    }
+
+    if (!options.jsonPath.empty()) {
+        writeJson(options.jsonPath, results);
+        std::println("Results written to {}", options.jsonPath);
+    }
+    if (!options.baselinePath.empty()) {
+        try {
+            int regressions = compare(results, readJson(options.baselinePath), options.threshold);
+            if (regressions > 0) {
+                std::println("{} regression(s)", regressions);
+                return 1;
+            }
+        }
+        catch (const std::exception& e) {
+            std::println(stderr, "Error: {}", e.what());
+            return 1;
+        }
+    }
+    return 0;
+}
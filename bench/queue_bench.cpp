@@ -0,0 +1,108 @@
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "PipelineThread.hpp"
+#include "SpscQueue.hpp"
+#include "bench.hpp"
+
+namespace {
+
+constexpr uint32_t MESSAGES = 100'000;
+
+// what the window thread sends, roughly
+struct Message {
+    uint32_t type;
+    int32_t a, b, c;
+    double x, y;
+};
+
+// the mutex + condition variable queue the SPSC one replaces
+class LockedQueue {
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<Message> messages;
+
+public:
+    void push(const Message& message) {
+        {
+            std::lock_guard lock(mutex);
+            messages.push_back(message);
+        }
+        ready.notify_one();
+    }
+    Message pop() {
+        std::unique_lock lock(mutex);
+        ready.wait(lock, [&] { return !messages.empty(); });
+        Message message = messages.front();
+        messages.pop_front();
+        return message;
+    }
+};
+
+void setCounters(bench::State& state) {
+    double seconds = state.getElapsedNs() / state.getIterations() / 1e9;
+    state.setCounter("Mmsg/s", MESSAGES / seconds / 1e6);
+}
+
+}  // namespace
+
+// producer and consumer on two threads, MESSAGES per iteration
+BENCHMARK(queue_spsc) {
+    SpscQueue<Message, 1024> queue;
+    for (auto _ : state) {
+        std::thread producer([&] {
+            for (uint32_t i = 0; i < MESSAGES; i++) {
+                while (!queue.tryPush({.type = i})) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        uint64_t sum = 0;
+        Message message;
+        // drain whatever is there after each wake, like the render thread does
+        for (uint32_t i = 0; i < MESSAGES;) {
+            queue.wait();
+            while (queue.tryPop(message)) {
+                sum += message.type;
+                i++;
+            }
+        }
+        producer.join();
+        bench::doNotOptimize(&sum);
+    }
+    setCounters(state);
+}
+
+BENCHMARK(queue_locked) {
+    LockedQueue queue;
+    for (auto _ : state) {
+        std::thread producer([&] {
+            for (uint32_t i = 0; i < MESSAGES; i++) {
+                queue.push({.type = i});
+            }
+        });
+        uint64_t sum = 0;
+        for (uint32_t i = 0; i < MESSAGES; i++) {
+            sum += queue.pop().type;
+        }
+        producer.join();
+        bench::doNotOptimize(&sum);
+    }
+    setCounters(state);
+}
+
+// submit / collect round trip of an empty step, the fixed cost of pipelining a frame stage
+BENCHMARK(pipeline_thread_round_trip) {
+    PipelineThread<uint32_t, uint32_t> worker;
+    worker.start("bench worker", [](const uint32_t& in) { return in + 1; });
+    uint32_t value = 0;
+    for (auto _ : state) {
+        worker.submit(value);
+        value = worker.collect();
+    }
+    bench::doNotOptimize(&value);
+    state.setCounter("us/trip", state.getElapsedNs() / state.getIterations() / 1e3);
+}
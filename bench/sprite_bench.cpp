@@ -0,0 +1,65 @@
+#include <random>
+#include <vector>
+
+#include "SpriteBatch.hpp"
+#include "bench.hpp"
+
+namespace {
+
+constexpr uint32_t SPRITES = 100'000;
+
+// a 1080p screen of sprites over 4 layers and 3 textures, submitted unsorted
+void fillScene(SpriteBatch& batch, uint32_t count) {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> x(0.f, 1920.f), y(0.f, 1080.f);
+    std::uniform_real_distribution<float> size(6.f, 32.f), angle(0.f, 6.2831853f);
+    batch.clear();
+    for (auto& sprite : batch.append(count)) {
+        float side = size(rng);
+        sprite = {
+            .x = x(rng),
+            .y = y(rng),
+            .width = side,
+            .height = side,
+            .rotation = angle(rng),
+            .u0 = 0.f,
+            .v0 = 0.f,
+            .u1 = 1.f,
+            .v1 = 1.f,
+            .color = static_cast<uint32_t>(rng()),
+            .texture = static_cast<uint16_t>(rng() % 3),
+            .layer = static_cast<uint16_t>(rng() % 4)
+        };
+    }
+}
+
+void buildBatch(bench::State& state, bool simd) {
+    if (simd && !SpriteBatch::simdAvailable()) {
+        state.skip("no SSE2 or NEON");
+        return;
+    }
+    SpriteBatch batch;
+    batch.simd = simd;
+    fillScene(batch, SPRITES);
+    std::vector<SpriteVertex> vertices(SPRITES * 4);
+    double sortUs = 0, vertexUs = 0;
+    for (auto _ : state) {
+        bench::doNotOptimize(batch.build(vertices.data()).data());
+        sortUs += batch.getStats().sortUs;
+        vertexUs += batch.getStats().vertexUs;
+    }
+    state.setCounter("ns/sprite", state.getElapsedNs() / state.getIterations() / SPRITES);
+    state.setCounter("sort_us", sortUs / state.getIterations());
+    state.setCounter("vertex_us", vertexUs / state.getIterations());
+    state.setCounter("draws", batch.getStats().runCount);
+}
+
+}  // namespace
+
+BENCHMARK(sprite_build_100k_scalar) {
+    buildBatch(state, false);
+}
+
+BENCHMARK(sprite_build_100k_simd) {
+    buildBatch(state, true);
+}
@@ -0,0 +1,72 @@
+#include "Trace.hpp"
+#include "bench.hpp"
+
+#ifndef LEARN_VULKAN_TRACE
+#error "the benchmark target must be built with LEARN_VULKAN_TRACE"
+#endif
+
+namespace {
+
+// zones per collect(), well below the per-thread ring capacity
+constexpr uint64_t BATCH = 4096;
+
+}  // namespace
+
+// Baseline: the loop body without instrumentation.
+BENCHMARK(trace_empty_scope) {
+    uint64_t sum = 0;
+    for (auto _ : state) {
+        sum++;
+        bench::doNotOptimize(sum);
+    }
+}
+
+BENCHMARK(trace_timestamp) {
+    for (auto _ : state) {
+        bench::doNotOptimize(trace::now());
+    }
+}
+
+// One complete zone: two timestamps plus a ring buffer push.
+BENCHMARK(trace_zone) {
+    trace::clear();
+    uint64_t n = 0;
+    for (auto _ : state) {
+        {
+            TRACE_ZONE("bench zone");
+            bench::clobberMemory();
+        }
+        if (++n % BATCH == 0) {
+            state.pauseTiming();
+            trace::clear();
+            state.resumeTiming();
+        }
+    }
+    trace::clear();
+}
+
+BENCHMARK(trace_counter) {
+    trace::clear();
+    uint64_t n = 0;
+    for (auto _ : state) {
+        TRACE_COUNTER("bench counter", n);
+        if (++n % BATCH == 0) {
+            state.pauseTiming();
+            trace::clear();
+            state.resumeTiming();
+        }
+    }
+    trace::clear();
+}
+
+// Ring full and nobody collecting: the cost of the drop path.
+BENCHMARK(trace_zone_dropped) {
+    for (uint64_t i = 0; i < (1 << 17); i++) {
+        TRACE_ZONE("fill");
+    }
+    for (auto _ : state) {
+        TRACE_ZONE("bench dropped");
+        bench::clobberMemory();
+    }
+    trace::clear();
+}
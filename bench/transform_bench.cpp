@@ -0,0 +1,84 @@
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include "TransformHierarchy.hpp"
+#include "bench.hpp"
+
+namespace {
+
+constexpr uint32_t MILLION = 1'000'000;
+constexpr uint32_t BRANCHING = 8;
+
+// complete 8-ary tree, 7 levels for a million nodes, mostly leaves
+void buildTree(TransformHierarchy& hierarchy, uint32_t count) {
+    hierarchy.reserve(count);
+    hierarchy.add(TransformHierarchy::NO_PARENT);
+    for (uint32_t i = 1; i < count; i++) {
+        float angle = 0.01f * i;
+        hierarchy.add((i - 1) / BRANCHING, glm::vec3(std::cos(angle), 0.5f, std::sin(angle)));
+    }
+}
+
+glm::quat yaw(float angle) {
+    return glm::quat(std::cos(0.5f * angle), 0.f, std::sin(0.5f * angle), 0.f);
+}
+
+// odd stride, coprime with a million so picks don't repeat early
+constexpr uint32_t SCATTER = 7'368'787;
+
+// Two targets updated alternately like the per-frame instance buffers. Before
+// every update `changed` nodes are rotated, starting at `first` and stepping
+// by `stride`.
+void transformUpdate(
+    bench::State& state, uint32_t count, uint32_t changed, uint32_t first, uint32_t stride, bool incremental
+) {
+    TransformHierarchy hierarchy;
+    buildTree(hierarchy, count);
+    std::array<std::vector<InstanceTransform>, 2> buffers;
+    std::array<TransformHierarchy::Target, 2> targets;
+    for (size_t i = 0; i < targets.size(); i++) {
+        buffers[i].resize(count);
+        targets[i].instances = buffers[i].data();
+        hierarchy.update(targets[i]);
+    }
+
+    uint32_t next = first;
+    uint64_t frame = 0;
+    TransformHierarchy::UpdateStats stats;
+    for (auto _ : state) {
+        for (uint32_t i = 0; i < changed; i++) {
+            hierarchy.setRotation(next, yaw(0.001f * frame));
+            next = static_cast<uint32_t>((next + uint64_t(stride)) % count);
+        }
+        auto& target = targets[frame++ % targets.size()];
+        stats = incremental ? hierarchy.update(target) : hierarchy.updateAll(target);
+        bench::doNotOptimize(target.instances);
+    }
+    state.setCounter("ms/update", state.getElapsedNs() / state.getIterations() / 1e6);
+    state.setCounter("recomputed", stats.recomputed);
+    state.setCounter("written", stats.written);
+}
+
+}  // namespace
+
+BENCHMARK(transform_full_1m) {
+    transformUpdate(state, MILLION, MILLION / 100, 1, SCATTER, false);
+}
+
+BENCHMARK(transform_incremental_1m_0_1pct) {
+    transformUpdate(state, MILLION, MILLION / 1000, 1, SCATTER, true);
+}
+
+BENCHMARK(transform_incremental_1m_1pct) {
+    transformUpdate(state, MILLION, MILLION / 100, 1, SCATTER, true);
+}
+
+BENCHMARK(transform_incremental_1m_10pct) {
+    transformUpdate(state, MILLION, MILLION / 10, 1, SCATTER, true);
+}
+
+// node 9 is on the second level below the root, its subtree is 1/64th of the tree
+BENCHMARK(transform_incremental_1m_subtree) {
+    transformUpdate(state, MILLION, 1, 9, 0, true);
+}
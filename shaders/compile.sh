@@ -1,2 +1,7 @@
 #!/usr/bin/sh
-dxc  shader.hlsl -T lib_6_7  -spirv -Fo shader.spv -O3
\ No newline at end of file
+dxc  shader.hlsl -T lib_6_7  -spirv -Fo shader.spv -O3
+dxc  particles.hlsl -T lib_6_7  -spirv -Fo particles.spv -O3
+dxc  particle_draw.hlsl -T lib_6_7  -spirv -Fo particle_draw.spv -O3
+dxc  sprite.hlsl -T lib_6_7  -spirv -Fo sprite.spv -O3
+dxc  world.hlsl -T lib_6_7  -spirv -Fo world.spv -O3
+dxc  postprocess.hlsl -T lib_6_7  -spirv -fspv-target-env=vulkan1.3 -Fo postprocess.spv -O3
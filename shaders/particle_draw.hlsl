@@ -0,0 +1,56 @@
+// Draws the particles simulated by particles.hlsl as camera-facing quads,
+// vertex pulling from the same structure-of-arrays buffers (read-only here).
+
+struct Params {
+    float dt;
+    float time;
+    uint emitRequest;
+    uint capacity;
+    uint parity;
+    float lifetime;
+    float2 pointExtent;  // quad half size in clip space
+};
+[[vk::push_constant]] Params params;
+
+[[vk::binding(0)]] StructuredBuffer<float4> positions;
+[[vk::binding(1)]] StructuredBuffer<float4> velocities;
+[[vk::binding(2)]] StructuredBuffer<uint> colors;
+[[vk::binding(4)]] StructuredBuffer<uint> aliveLists;
+
+static const float2 CORNERS[6] = {
+    float2(-1, -1), float2(1, -1), float2(1, 1),
+    float2(-1, -1), float2(1, 1), float2(-1, 1),
+};
+
+struct VertexOutput {
+    float4 sv_position : SV_Position;
+    float4 color : COLOR0;
+    float2 corner : TEXCOORD0;
+};
+
+[shader("vertex")]
+VertexOutput vertMain(uint vertexId : SV_VertexID) {
+    // simulate compacted the survivors into the list it wrote
+    uint index = aliveLists[(1 - params.parity) * params.capacity + vertexId / 6];
+    float2 corner = CORNERS[vertexId % 6];
+    float4 position = positions[index];
+    float timeLeft = velocities[index].w;
+    uint packed = colors[index];
+
+    VertexOutput vOut;
+    vOut.sv_position = float4(position.xy + corner * params.pointExtent, position.z, 1.0);
+    vOut.color = float4(
+        float(packed & 0xff) / 255.0,
+        float((packed >> 8) & 0xff) / 255.0,
+        float((packed >> 16) & 0xff) / 255.0,
+        saturate(timeLeft / position.w)
+    );
+    vOut.corner = corner;
+    return vOut;
+}
+
+[shader("pixel")]
+float4 fragMain(VertexOutput fIn) : SV_Target {
+    float falloff = saturate(1.0 - dot(fIn.corner, fIn.corner));
+    return float4(fIn.color.rgb, fIn.color.a * falloff);
+}
@@ -0,0 +1,155 @@
+// Compute side of src/ParticleSystem: emission, integration and compaction.
+// Particle state is structure-of-arrays, one storage buffer per attribute.
+
+struct Params {
+    float dt;
+    float time;
+    uint emitRequest;
+    uint capacity;
+    uint parity;      // alive list read this frame, the other one is written
+    float lifetime;
+    float2 pointExtent;
+};
+[[vk::push_constant]] Params params;
+
+[[vk::binding(0)]] RWStructuredBuffer<float4> positions;   // xyz, w = lifetime at emission
+[[vk::binding(1)]] RWStructuredBuffer<float4> velocities;  // xyz, w = time left
+[[vk::binding(2)]] RWStructuredBuffer<uint> colors;        // RGBA8
+[[vk::binding(3)]] RWStructuredBuffer<uint> deadList;
+[[vk::binding(4)]] RWStructuredBuffer<uint> aliveLists;    // two lists of `capacity` indices
+[[vk::binding(5)]] RWStructuredBuffer<int> counters;
+[[vk::binding(6)]] RWStructuredBuffer<uint> args;
+
+static const uint DEAD_COUNT = 0;
+static const uint ALIVE_COUNT = 1;  // + list
+static const uint EMIT_COUNT = 3;
+
+// uint offsets into `args`, see ParticleSystem.cpp
+static const uint DRAW_ARGS = 0;
+static const uint EMIT_ARGS = 4;
+static const uint SIMULATE_ARGS = 8;
+
+static const uint GROUP_SIZE = 256;
+static const float GRAVITY = 1.5;
+static const float DRAG = 0.2;
+
+uint pcgHash(uint v) {
+    uint state = v * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+float random01(inout uint seed) {
+    seed = pcgHash(seed);
+    return seed / 4294967296.0;
+}
+
+uint packColor(float3 rgb) {
+    uint3 c = uint3(saturate(rgb) * 255.0 + 0.5);
+    return c.r | (c.g << 8) | (c.b << 16) | (255u << 24);
+}
+
+void setDispatch(uint offset, uint threads) {
+    args[offset + 0] = (threads + GROUP_SIZE - 1) / GROUP_SIZE;
+    args[offset + 1] = 1;
+    args[offset + 2] = 1;
+}
+
+// Every particle dead, run once after the buffers are (re)created.
+[shader("compute")]
+[numthreads(GROUP_SIZE, 1, 1)]
+void resetMain(uint3 id : SV_DispatchThreadID) {
+    if (id.x < params.capacity) {
+        deadList[id.x] = params.capacity - 1 - id.x;
+    }
+    if (id.x == 0) {
+        counters[DEAD_COUNT] = int(params.capacity);
+        counters[ALIVE_COUNT + 0] = 0;
+        counters[ALIVE_COUNT + 1] = 0;
+        counters[EMIT_COUNT] = 0;
+    }
+}
+
+// Clamp emission to the free slots and size this frame's indirect dispatches.
+[shader("compute")]
+[numthreads(1, 1, 1)]
+void kickoffMain() {
+    int emit = min(int(params.emitRequest), counters[DEAD_COUNT]);
+    counters[EMIT_COUNT] = emit;
+    counters[ALIVE_COUNT + (1 - params.parity)] = 0;
+    setDispatch(EMIT_ARGS, uint(emit));
+    setDispatch(SIMULATE_ARGS, uint(counters[ALIVE_COUNT + params.parity] + emit));
+}
+
+[shader("compute")]
+[numthreads(GROUP_SIZE, 1, 1)]
+void emitMain(uint3 id : SV_DispatchThreadID) {
+    if (id.x >= uint(counters[EMIT_COUNT])) {
+        return;
+    }
+    // kickoff made sure there are at least EMIT_COUNT dead particles
+    int dead;
+    InterlockedAdd(counters[DEAD_COUNT], -1, dead);
+    uint index = deadList[dead - 1];
+
+    uint seed = pcgHash(id.x ^ pcgHash(asuint(params.time)));
+    float life = params.lifetime * (0.5 + 0.5 * random01(seed));
+    // a fountain at the bottom of the screen, +y is down in Vulkan clip space
+    float3 position = float3((random01(seed) - 0.5) * 0.05, 0.95, 0.5);
+    float3 velocity = float3((random01(seed) - 0.5) * 0.8, -(1.4 + random01(seed) * 0.6), 0.0);
+    float hue = frac(params.time * 0.1 + random01(seed) * 0.15) * 6.0;
+    float3 rgb = saturate(float3(abs(hue - 3.0) - 1.0, 2.0 - abs(hue - 2.0), 2.0 - abs(hue - 4.0)));
+
+    positions[index] = float4(position, life);
+    velocities[index] = float4(velocity, life);
+    colors[index] = packColor(rgb);
+
+    int slot;
+    InterlockedAdd(counters[ALIVE_COUNT + params.parity], 1, slot);
+    aliveLists[params.parity * params.capacity + slot] = index;
+}
+
+// Integrate the alive list and compact the survivors into the other one.
+[shader("compute")]
+[numthreads(GROUP_SIZE, 1, 1)]
+void simulateMain(uint3 id : SV_DispatchThreadID) {
+    uint inList = params.parity;
+    uint outList = 1 - params.parity;
+    if (id.x >= uint(counters[ALIVE_COUNT + inList])) {
+        return;
+    }
+    uint index = aliveLists[inList * params.capacity + id.x];
+    float4 position = positions[index];
+    float4 velocity = velocities[index];
+
+    velocity.w -= params.dt;
+    if (velocity.w <= 0.0) {
+        int slot;
+        InterlockedAdd(counters[DEAD_COUNT], 1, slot);
+        deadList[slot] = index;
+        return;
+    }
+    velocity.y += GRAVITY * params.dt;
+    velocity.xyz *= 1.0 - DRAG * params.dt;
+    position.xyz += velocity.xyz * params.dt;
+    if (position.y > 1.0) {
+        position.y = 1.0;
+        velocity.y *= -0.5;
+    }
+    positions[index] = position;
+    velocities[index] = velocity;
+
+    int slot;
+    InterlockedAdd(counters[ALIVE_COUNT + outList], 1, slot);
+    aliveLists[outList * params.capacity + slot] = index;
+}
+
+// One quad (6 vertices) per survivor.
+[shader("compute")]
+[numthreads(1, 1, 1)]
+void finishMain() {
+    args[DRAW_ARGS + 0] = uint(counters[ALIVE_COUNT + (1 - params.parity)]) * 6;
+    args[DRAW_ARGS + 1] = 1;
+    args[DRAW_ARGS + 2] = 0;
+    args[DRAW_ARGS + 3] = 0;
+}
@@ -0,0 +1,222 @@
+// Compute side of src/PostProcess: separable blur, auto exposure, the bloom
+// pyramid and tonemapping, all on RGBA16F images. Every kernel processes the
+// top-left `region` of its output (dynamic resolution renders into a corner)
+// and clamps its reads to the valid part of the input.
+
+struct Params {
+    int2 region;        // output texels to write
+    int2 srcRegion;     // valid texels of `input`
+    float2 srcInvSize;  // 1 / size of `secondary` (or `input`) for sampling
+    float a;            // kernel specific, see PostProcess.cpp
+    float b;
+    float c;
+    float d;
+};
+[[vk::push_constant]] Params params;
+
+[[vk::combinedImageSampler]] [[vk::binding(0)]] Texture2D<float4> input;
+[[vk::combinedImageSampler]] [[vk::binding(0)]] SamplerState inputSampler;
+[[vk::combinedImageSampler]] [[vk::binding(1)]] Texture2D<float4> secondary;
+[[vk::combinedImageSampler]] [[vk::binding(1)]] SamplerState secondarySampler;
+[[vk::image_format("rgba16f")]] [[vk::binding(2)]] RWTexture2D<float4> output;
+// [0] summed log2 luminance * 4 of the last luminance pass, [1] exposure
+[[vk::binding(3)]] RWStructuredBuffer<uint> exposure;
+
+static const float3 LUMA = float3(0.2126, 0.7152, 0.0722);
+
+float3 loadInput(int2 p) {
+    return input.Load(int3(clamp(p, int2(0, 0), params.srcRegion - 1), 0)).rgb;
+}
+
+bool outside(uint2 p) {
+    return any(int2(p) >= params.region);
+}
+
+// --- separable gaussian blur ---------------------------------------------
+// A group filters 128 texels of a row (or column) from a shared-memory tile
+// holding them plus MAX_RADIUS texels on each side, so every input texel is
+// fetched once per group instead of once per tap.
+// a = sigma in texels, b = radius in texels (<= MAX_RADIUS)
+
+static const int BLUR_GROUP = 128;
+static const int MAX_RADIUS = 32;
+groupshared float3 blurTile[BLUR_GROUP + 2 * MAX_RADIUS];
+
+void blur(int2 origin, int2 axis, uint local) {
+    for (int i = int(local); i < BLUR_GROUP + 2 * MAX_RADIUS; i += BLUR_GROUP) {
+        blurTile[i] = loadInput(origin + axis * (i - MAX_RADIUS));
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    int2 p = origin + axis * int(local);
+    if (any(p >= params.region)) {
+        return;
+    }
+    int radius = int(params.b);
+    float scale = -0.5 / (params.a * params.a);
+    float3 sum = blurTile[local + MAX_RADIUS];
+    float weights = 1.0;
+    for (int t = 1; t <= radius; t++) {
+        float w = exp(t * t * scale);
+        sum += w * (blurTile[local + MAX_RADIUS - t] + blurTile[local + MAX_RADIUS + t]);
+        weights += 2.0 * w;
+    }
+    output[p] = float4(sum / weights, 1.0);
+}
+
+[shader("compute")]
+[numthreads(BLUR_GROUP, 1, 1)]
+void blurHorizontal(uint3 group : SV_GroupID, uint local : SV_GroupIndex) {
+    blur(int2(group.x * BLUR_GROUP, group.y), int2(1, 0), local);
+}
+
+[shader("compute")]
+[numthreads(1, BLUR_GROUP, 1)]
+void blurVertical(uint3 group : SV_GroupID, uint local : SV_GroupIndex) {
+    blur(int2(group.x, group.y * BLUR_GROUP), int2(0, 1), local);
+}
+
+// --- auto exposure -------------------------------------------------------
+// Average log luminance: each subgroup reduces its texels with WaveActiveSum
+// and its first lane claims the next free groupshared slot, since Vulkan does
+// not say which invocations of a 2D group share a subgroup. The first thread
+// adds the slots and issues the group's only atomic. Subgroup sizes from 1 to
+// 128 work.
+
+static const uint LUMINANCE_GROUP = 16;
+groupshared float waveSums[LUMINANCE_GROUP * LUMINANCE_GROUP];
+groupshared uint waveCount;
+
+[shader("compute")]
+[numthreads(LUMINANCE_GROUP, LUMINANCE_GROUP, 1)]
+void luminance(uint3 id : SV_DispatchThreadID, uint local : SV_GroupIndex) {
+    if (local == 0) {
+        waveCount = 0;
+    }
+    GroupMemoryBarrierWithGroupSync();
+    float logLuminance = 0.0;
+    if (!outside(id.xy)) {
+        float y = dot(input.Load(int3(id.xy, 0)).rgb, LUMA);
+        logLuminance = clamp(log2(max(y, 1e-5)), -16.0, 16.0);
+    }
+    float waveSum = WaveActiveSum(logLuminance);
+    if (WaveIsFirstLane()) {
+        uint slot;
+        InterlockedAdd(waveCount, 1, slot);
+        waveSums[slot] = waveSum;
+    }
+    GroupMemoryBarrierWithGroupSync();
+    if (local == 0) {
+        float sum = 0.0;
+        for (uint i = 0; i < waveCount; i++) {
+            sum += waveSums[i];
+        }
+        // fixed point, 4K at +-16 stays well inside an int
+        InterlockedAdd(exposure[0], uint(int(round(sum * 4.0))));
+    }
+}
+
+// a = seconds since last frame, b = adaptation rate, c = exposure at average
+// luminance 1 (key / compensation), d = texels summed
+[shader("compute")]
+[numthreads(1, 1, 1)]
+void adapt() {
+    float averageLog = float(int(exposure[0])) / (4.0 * max(params.d, 1.0));
+    float target = clamp(params.c / exp2(averageLog), 1.0 / 16.0, 16.0);
+    float previous = asfloat(exposure[1]);
+    float adapted = previous > 0.0 ? lerp(previous, target, 1.0 - exp(-params.a * params.b)) : target;
+    exposure[0] = 0;
+    exposure[1] = asuint(adapted);
+}
+
+// --- bloom pyramid -------------------------------------------------------
+// Downsampling filters each output texel over the 4x4 input texels around it
+// with (1 3 3 1)/8 weights per axis; a group's 8x8 outputs read an 18x18
+// input tile, loaded once into shared memory.
+// a = threshold, b = soft knee; a < 0 skips the threshold (levels after the first)
+
+static const int BLOOM_GROUP = 8;
+static const int BLOOM_TILE = 2 * BLOOM_GROUP + 2;
+groupshared float3 bloomTile[BLOOM_TILE * BLOOM_TILE];
+
+float3 threshold(float3 color) {
+    float brightness = max(color.r, max(color.g, color.b));
+    float knee = params.b;
+    float soft = clamp(brightness - params.a + knee, 0.0, 2.0 * knee);
+    soft = soft * soft / (4.0 * knee + 1e-5);
+    return color * max(soft, brightness - params.a) / max(brightness, 1e-5);
+}
+
+[shader("compute")]
+[numthreads(BLOOM_GROUP, BLOOM_GROUP, 1)]
+void bloomDownsample(uint3 group : SV_GroupID, uint3 id : SV_DispatchThreadID, uint local : SV_GroupIndex) {
+    int2 tileOrigin = int2(group.xy) * 2 * BLOOM_GROUP - 1;
+    for (int i = int(local); i < BLOOM_TILE * BLOOM_TILE; i += BLOOM_GROUP * BLOOM_GROUP) {
+        float3 color = loadInput(tileOrigin + int2(i % BLOOM_TILE, i / BLOOM_TILE));
+        bloomTile[i] = params.a >= 0.0 ? threshold(color) : color;
+    }
+    GroupMemoryBarrierWithGroupSync();
+    if (outside(id.xy)) {
+        return;
+    }
+    static const float WEIGHTS[4] = {1.0 / 8.0, 3.0 / 8.0, 3.0 / 8.0, 1.0 / 8.0};
+    int2 base = int2(id.xy - group.xy * BLOOM_GROUP) * 2;
+    float3 sum = 0.0;
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            sum += WEIGHTS[x] * WEIGHTS[y] * bloomTile[(base.y + y) * BLOOM_TILE + base.x + x];
+        }
+    }
+    output[id.xy] = float4(sum, 1.0);
+}
+
+// Adds the next smaller level, upsampled with a bilinear 3x3 tent, to this one.
+// srcInvSize = 1 / size of the smaller level, srcRegion its valid texels,
+// a = tent radius in texels of the smaller level
+[shader("compute")]
+[numthreads(BLOOM_GROUP, BLOOM_GROUP, 1)]
+void bloomUpsample(uint3 id : SV_DispatchThreadID) {
+    if (outside(id.xy)) {
+        return;
+    }
+    float2 center = (float2(id.xy) + 0.5) * 0.5;
+    float2 lo = 0.5;
+    float2 hi = float2(params.srcRegion) - 0.5;
+    float3 sum = 0.0;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            float w = (2 - abs(x)) * (2 - abs(y)) / 16.0;
+            float2 uv = clamp(center + float2(x, y) * params.a, lo, hi) * params.srcInvSize;
+            sum += w * secondary.SampleLevel(secondarySampler, uv, 0).rgb;
+        }
+    }
+    output[id.xy] = float4(output[id.xy].rgb + sum, 1.0);
+}
+
+// --- tonemapping ---------------------------------------------------------
+// a = bloom intensity (0: no bloom), b = 1 to tonemap, c = manual exposure,
+// d = 1 to use the adapted exposure; srcInvSize is 1 / size of the bloom level
+
+float3 acesFilm(float3 x) {
+    return saturate((x * (2.51 * x + 0.03)) / (x * (2.43 * x + 0.59) + 0.14));
+}
+
+[shader("compute")]
+[numthreads(BLOOM_GROUP, BLOOM_GROUP, 1)]
+void tonemap(uint3 id : SV_DispatchThreadID) {
+    if (outside(id.xy)) {
+        return;
+    }
+    float3 color = input.Load(int3(id.xy, 0)).rgb;
+    if (params.a > 0.0) {
+        // the first bloom level is half the size of the scene
+        float2 hi = float2(max(params.srcRegion / 2, int2(1, 1))) - 0.5;
+        float2 uv = clamp((float2(id.xy) + 0.5) * 0.5, 0.5, hi) * params.srcInvSize;
+        color += params.a * secondary.SampleLevel(secondarySampler, uv, 0).rgb;
+    }
+    if (params.b > 0.0) {
+        float scale = params.c * (params.d > 0.0 ? asfloat(exposure[1]) : 1.0);
+        color = acesFilm(color * scale);
+    }
+    output[id.xy] = float4(saturate(color), 1.0);
+}
@@ -0,0 +1,36 @@
+// Sprites batched by SpriteBatch: pixel-space quads, one texture per draw.
+
+struct Params {
+    float2 scale;  // pixels to clip space
+    float2 offset;
+};
+[[vk::push_constant]] Params params;
+
+[[vk::combinedImageSampler]] [[vk::binding(0)]] Texture2D<float4> spriteTexture;
+[[vk::combinedImageSampler]] [[vk::binding(0)]] SamplerState spriteSampler;
+
+struct VertexInput {
+    float2 pos : POSITION0;
+    float2 uv : TEXCOORD0;
+    float4 color : COLOR0;
+};
+
+struct VertexOutput {
+    float4 sv_position : SV_Position;
+    float2 uv : TEXCOORD0;
+    float4 color : COLOR0;
+};
+
+[shader("vertex")]
+VertexOutput vertMain(VertexInput vIn) {
+    VertexOutput vOut;
+    vOut.sv_position = float4(vIn.pos * params.scale + params.offset, 0.0, 1.0);
+    vOut.uv = vIn.uv;
+    vOut.color = vIn.color;
+    return vOut;
+}
+
+[shader("pixel")]
+float4 fragMain(VertexOutput fIn) : SV_Target {
+    return spriteTexture.Sample(spriteSampler, fIn.uv) * fIn.color;
+}
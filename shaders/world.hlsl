@@ -0,0 +1,30 @@
+// Streamed terrain chunks seen from above: world xz straight to clip space.
+
+struct Params {
+    float2 scale;  // world xz to clip space
+    float2 offset;
+};
+[[vk::push_constant]] Params params;
+
+struct VertexInput {
+    float3 pos : POSITION0;
+    float4 color : COLOR0;
+};
+
+struct VertexOutput {
+    float4 sv_position : SV_Position;
+    float4 color : COLOR0;
+};
+
+[shader("vertex")]
+VertexOutput vertMain(VertexInput vIn) {
+    VertexOutput vOut;
+    vOut.sv_position = float4(vIn.pos.xz * params.scale + params.offset, 0.0, 1.0);
+    vOut.color = vIn.color;
+    return vOut;
+}
+
+[shader("pixel")]
+float4 fragMain(VertexOutput fIn) : SV_Target {
+    return fIn.color;
+}
@@ -0,0 +1,91 @@
+#include "AllocationCounter.hpp"
+
+// std c++
+#include <cstdlib>
+#include <new>
+
+namespace {
+// constant-initialized, so safe to touch from operator new on any thread
+thread_local alloc_counter::Counts counts;
+thread_local uint32_t exemptDepth = 0;
+}  // namespace
+
+alloc_counter::Counts alloc_counter::threadCounts() {
+    return counts;
+}
+
+alloc_counter::Exempt::Exempt() {
+    exemptDepth++;
+}
+
+alloc_counter::Exempt::~Exempt() {
+    exemptDepth--;
+}
+
+#ifdef LEARN_VULKAN_COUNT_ALLOCATIONS
+
+// The array and nothrow forms of the standard library forward to these.
+namespace {
+
+void* allocate(size_t size, size_t alignment) {
+    if (exemptDepth == 0) {
+        counts.allocations++;
+        counts.bytes += size;
+    }
+    size = size == 0 ? 1 : size;
+    void* memory = nullptr;
+    if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+        memory = std::malloc(size);
+    }
+    else {
+#ifdef _WIN32
+        memory = _aligned_malloc(size, alignment);
+#else
+        // aligned_alloc wants the size to be a multiple of the alignment
+        memory = std::aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+#endif
+    }
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void release(void* memory, size_t alignment) {
+#ifdef _WIN32
+    if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+        _aligned_free(memory);
+        return;
+    }
+#endif
+    (void)alignment;
+    std::free(memory);
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+    return allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    return allocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* memory) noexcept {
+    release(memory, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void operator delete(void* memory, std::align_val_t alignment) noexcept {
+    release(memory, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    release(memory, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void operator delete(void* memory, size_t, std::align_val_t alignment) noexcept {
+    release(memory, static_cast<size_t>(alignment));
+}
+
+#endif  // LEARN_VULKAN_COUNT_ALLOCATIONS
@@ -0,0 +1,51 @@
+#ifndef ALLOCATIONCOUNTER_HPP
+#define ALLOCATIONCOUNTER_HPP
+
+// c++ std libs
+#include <cstdint>
+
+/*
+ * Per-thread count of global operator new calls, for catching heap
+ * allocations on the frame path. The operators are only replaced when
+ * LEARN_VULKAN_COUNT_ALLOCATIONS is defined (debug builds); otherwise
+ * ENABLED is false and threadCounts() always returns zero. Memory from
+ * malloc directly (ImGui, the Vulkan driver) is not seen.
+ *
+ *     auto before = alloc_counter::threadCounts();
+ *     drawFrame();
+ *     auto frame = alloc_counter::threadCounts() - before;
+ */
+namespace alloc_counter {
+
+#ifdef LEARN_VULKAN_COUNT_ALLOCATIONS
+constexpr bool ENABLED = true;
+#else
+constexpr bool ENABLED = false;
+#endif
+
+struct Counts {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+
+    Counts operator-(const Counts& other) const {
+        return {allocations - other.allocations, bytes - other.bytes};
+    }
+};
+
+// Totals for the calling thread since it started.
+Counts threadCounts();
+
+// While one is alive the calling thread's allocations are not counted. For
+// work that allocates by design but never runs on a steady frame, such as
+// rebuilding the swap chain.
+class Exempt {
+public:
+    Exempt();
+    ~Exempt();
+    Exempt(const Exempt&) = delete;
+    Exempt& operator=(const Exempt&) = delete;
+};
+
+}  // namespace alloc_counter
+
+#endif  // ALLOCATIONCOUNTER_HPP
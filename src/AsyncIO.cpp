@@ -0,0 +1,721 @@
+#include "AsyncIO.hpp"
+
+// std c++
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <fstream>
+#include <print>
+#include <system_error>
+#include <unordered_set>
+#include <utility>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#elif !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// project
+#include "Trace.hpp"
+
+namespace {
+
+// a single read is at most this long, longer ones are split
+constexpr uint64_t MAX_READ = 1ull << 30;
+
+std::span<uint8_t> asBytes(std::vector<char>& data) {
+    return {reinterpret_cast<uint8_t*>(data.data()), data.size()};
+}
+
+}  // namespace
+
+#ifdef __linux__
+
+/*
+ * The raw ring, without liburing: the submission and completion queues are
+ * shared with the kernel through mmap, we own the SQ tail and the CQ head.
+ * Only ever touched by the I/O thread, except registerBuffers().
+ */
+struct AsyncIO::Ring {
+    int fd = -1;
+    uint32_t entries = 0;
+    uint32_t cqEntries = 0;
+    void* sqMap = MAP_FAILED;
+    size_t sqMapSize = 0;
+    void* cqMap = MAP_FAILED;
+    size_t cqMapSize = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqesSize = 0;
+    uint32_t* sqHead = nullptr;
+    uint32_t* sqTail = nullptr;
+    uint32_t sqMask = 0;
+    uint32_t* sqArray = nullptr;
+    uint32_t* cqHead = nullptr;
+    uint32_t* cqTail = nullptr;
+    uint32_t cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+    uint32_t localTail = 0;  // SQ tail including entries not yet published
+    uint32_t toSubmit = 0;   // prepared, not yet passed to io_uring_enter
+    uint32_t inFlight = 0;  // submitted, completion not reaped
+    bool buffersRegistered = false;
+
+    Ring() = default;
+    ~Ring();
+    DISABLE_COPY(Ring)
+
+    bool create(uint32_t depth);
+    bool supports(std::initializer_list<uint8_t> opcodes) const;
+    // Null when the SQ is full or the CQ could overflow. The entry stays
+    // invisible to the kernel until flush().
+    io_uring_sqe* nextSqe();
+    // Publishes the entries filled in since the last flush.
+    void flush();
+    // Takes back the entries the kernel has not consumed yet, which is all
+    // of them between two enters without SQPOLL.
+    void withdraw();
+    // Submits the prepared entries and waits for `minComplete` completions.
+    int enter(uint32_t minComplete);
+};
+
+AsyncIO::Ring::~Ring() {
+    if (sqes != MAP_FAILED) {
+        munmap(sqes, sqesSize);
+    }
+    if (cqMap != MAP_FAILED && cqMap != sqMap) {
+        munmap(cqMap, cqMapSize);
+    }
+    if (sqMap != MAP_FAILED) {
+        munmap(sqMap, sqMapSize);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+bool AsyncIO::Ring::create(uint32_t depth) {
+    io_uring_params params{};
+    fd = static_cast<int>(syscall(__NR_io_uring_setup, depth, &params));
+    if (fd < 0) {
+        return false;
+    }
+    entries = params.sq_entries;
+    cqEntries = params.cq_entries;
+    sqMapSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMap) {
+        sqMapSize = cqMapSize = std::max(sqMapSize, cqMapSize);
+    }
+    sqMap = mmap(nullptr, sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sqMap == MAP_FAILED) {
+        return false;
+    }
+    cqMap = singleMap ? sqMap
+                      : mmap(nullptr, cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    if (cqMap == MAP_FAILED) {
+        return false;
+    }
+    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = static_cast<io_uring_sqe*>(
+        mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES)
+    );
+    if (sqes == MAP_FAILED) {
+        return false;
+    }
+    auto* sq = static_cast<uint8_t*>(sqMap);
+    auto* cq = static_cast<uint8_t*>(cqMap);
+    sqHead = reinterpret_cast<uint32_t*>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+    sqMask = *reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+    cqHead = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+    cqMask = *reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    localTail = *sqTail;
+    return supports({IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_READ_FIXED, IORING_OP_CLOSE});
+}
+
+bool AsyncIO::Ring::supports(std::initializer_list<uint8_t> opcodes) const {
+    constexpr uint32_t PROBE_OPS = 256;
+    std::vector<uint8_t> storage(sizeof(io_uring_probe) + PROBE_OPS * sizeof(io_uring_probe_op));
+    auto* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+    if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, PROBE_OPS) < 0) {
+        return false;
+    }
+    return std::ranges::all_of(opcodes, [&](uint8_t op) {
+        return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+    });
+}
+
+io_uring_sqe* AsyncIO::Ring::nextSqe() {
+    uint32_t head = std::atomic_ref(*sqHead).load(std::memory_order_acquire);
+    if (localTail - head >= entries || inFlight + toSubmit >= cqEntries) {
+        return nullptr;
+    }
+    uint32_t index = localTail & sqMask;
+    io_uring_sqe* sqe = &sqes[index];
+    *sqe = {};
+    sqArray[index] = index;
+    localTail++;
+    toSubmit++;
+    return sqe;
+}
+
+void AsyncIO::Ring::flush() {
+    // the kernel reads an entry as soon as it sees the new tail (right away
+    // with SQPOLL), so the caller must have filled every entry before this
+    std::atomic_ref(*sqTail).store(localTail, std::memory_order_release);
+}
+
+void AsyncIO::Ring::withdraw() {
+    localTail = std::atomic_ref(*sqHead).load(std::memory_order_acquire);
+    toSubmit = 0;
+    flush();
+}
+
+int AsyncIO::Ring::enter(uint32_t minComplete) {
+    flush();
+    while (true) {
+        int submitted = static_cast<int>(syscall(
+            __NR_io_uring_enter, fd, toSubmit, minComplete, minComplete > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0
+        ));
+        if (submitted >= 0) {
+            toSubmit -= submitted;
+            inFlight += submitted;
+            return 0;
+        }
+        if (errno == EAGAIN || errno == EBUSY) {
+            // out of kernel resources for now; reap what completed and retry
+            return 0;
+        }
+        if (errno != EINTR) {
+            return errno;
+        }
+    }
+}
+
+#else
+
+struct AsyncIO::Ring {};
+
+#endif
+
+const char* toString(AsyncIO::Backend backend) {
+    switch (backend) {
+        case AsyncIO::Backend::eIoUring:
+            return "io_uring";
+        case AsyncIO::Backend::eThreadPool:
+            return "thread pool";
+    }
+    return "unknown";
+}
+
+// out of line, Ring is incomplete in the header
+AsyncIO::AsyncIO() = default;
+
+AsyncIO::~AsyncIO() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    // the loops drain everything queued before they exit
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    // only the I/O thread adds these, and it has exited now
+    for (auto& worker : fallbackWorkers) {
+        worker.join();
+    }
+}
+
+void AsyncIO::init(Backend preferred, uint32_t queueDepth, uint32_t threadCount) {
+    backend = Backend::eThreadPool;
+    this->threadCount = std::max(1u, threadCount);
+#ifdef __linux__
+    if (preferred == Backend::eIoUring) {
+        auto created = std::make_unique<Ring>();
+        if (created->create(queueDepth)) {
+            ring = std::move(created);
+            backend = Backend::eIoUring;
+        }
+    }
+#endif
+    if (backend == Backend::eIoUring) {
+        workers.emplace_back([this]() { ringLoop(); });
+    }
+    else {
+        for (uint32_t i = 0; i < this->threadCount; i++) {
+            workers.emplace_back([this]() { poolLoop(); });
+        }
+    }
+}
+
+bool AsyncIO::registerBuffers(std::span<const std::span<uint8_t>> buffers) {
+    std::lock_guard lock(mutex);
+    registered.clear();
+#ifdef __linux__
+    if (backend != Backend::eIoUring) {
+        return false;
+    }
+    if (ring->buffersRegistered) {
+        syscall(__NR_io_uring_register, ring->fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+        ring->buffersRegistered = false;
+    }
+    if (buffers.empty()) {
+        return true;
+    }
+    std::vector<iovec> iovecs;
+    for (auto buffer : buffers) {
+        iovecs.push_back({.iov_base = buffer.data(), .iov_len = buffer.size()});
+    }
+    if (syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS, iovecs.data(), iovecs.size()) < 0) {
+        return false;
+    }
+    ring->buffersRegistered = true;
+    registered.assign(buffers.begin(), buffers.end());
+    return true;
+#else
+    return false;
+#endif
+}
+
+void AsyncIO::read(std::string path, uint64_t offset, std::span<uint8_t> dst, Callback callback) {
+    enqueue({.path = std::move(path), .offset = offset, .dst = dst, .callback = std::move(callback)});
+}
+
+void AsyncIO::readFile(std::string path, Callback callback) {
+    enqueue({.path = std::move(path), .wholeFile = true, .callback = std::move(callback)});
+}
+
+std::future<std::vector<char>> AsyncIO::readFile(std::string path) {
+    auto promise = std::make_shared<std::promise<std::vector<char>>>();
+    auto future = promise->get_future();
+    readFile(std::move(path), [promise](Completion& completion) {
+        if (completion.error != 0) {
+            promise->set_exception(std::make_exception_ptr(
+                std::system_error(completion.error, std::generic_category(), completion.path)
+            ));
+        }
+        else {
+            promise->set_value(std::move(completion.data));
+        }
+    });
+    return future;
+}
+
+void AsyncIO::enqueue(Request&& request) {
+    {
+        std::lock_guard lock(mutex);
+        pending.push_back(std::move(request));
+        outstanding++;
+    }
+    wake.notify_one();
+}
+
+void AsyncIO::finish(Request& request, Completion& completion, uint64_t syscalls, bool fixed) {
+    if (request.callback) {
+        request.callback(completion);
+    }
+    std::lock_guard lock(mutex);
+    stats.requests++;
+    stats.failed += completion.error != 0 ? 1 : 0;
+    stats.bytes += completion.bytes.size();
+    stats.syscalls += syscalls;
+    stats.fixedReads += fixed ? 1 : 0;
+    if (--outstanding == 0) {
+        idle.notify_all();
+    }
+}
+
+void AsyncIO::wait() {
+    std::unique_lock lock(mutex);
+    idle.wait(lock, [&]() { return outstanding == 0; });
+}
+
+AsyncIO::Stats AsyncIO::getStats() {
+    std::lock_guard lock(mutex);
+    return stats;
+}
+
+/*
+ * One request at a time per thread: open, size (whole files only), pread
+ * until done or end of file, close.
+ */
+void AsyncIO::readBlocking(Request& request, Completion& completion, uint64_t& syscalls) {
+#ifdef _WIN32
+    std::ifstream in(request.path, std::ios::binary | std::ios::ate);
+    syscalls++;
+    if (!in.is_open()) {
+        completion.error = ENOENT;
+        return;
+    }
+    uint64_t fileSize = static_cast<uint64_t>(in.tellg());
+    uint64_t available = fileSize > request.offset ? fileSize - request.offset : 0;
+    if (request.wholeFile) {
+        completion.data.resize(available);
+        request.dst = asBytes(completion.data);
+    }
+    uint64_t size = std::min<uint64_t>(request.dst.size(), available);
+    in.seekg(static_cast<std::streamoff>(request.offset));
+    in.read(reinterpret_cast<char*>(request.dst.data()), static_cast<std::streamsize>(size));
+    syscalls++;
+    completion.bytes = request.dst.first(static_cast<size_t>(in.gcount()));
+#else
+    int fd = ::open(request.path.c_str(), O_RDONLY | O_CLOEXEC);
+    syscalls++;
+    if (fd < 0) {
+        completion.error = errno;
+        return;
+    }
+    if (request.wholeFile) {
+        struct stat st {};
+        syscalls++;
+        if (fstat(fd, &st) != 0) {
+            completion.error = errno;
+            ::close(fd);
+            return;
+        }
+        completion.data.resize(static_cast<uint64_t>(st.st_size) > request.offset ? st.st_size - request.offset : 0);
+        request.dst = asBytes(completion.data);
+    }
+    size_t done = 0;
+    while (done < request.dst.size()) {
+        ssize_t n = pread(
+            fd,
+            request.dst.data() + done,
+            std::min<uint64_t>(request.dst.size() - done, MAX_READ),
+            static_cast<off_t>(request.offset + done)
+        );
+        syscalls++;
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            completion.error = errno;
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+        done += static_cast<size_t>(n);
+    }
+    ::close(fd);
+    syscalls++;
+    completion.bytes = request.dst.first(done);
+#endif
+    if (request.wholeFile) {
+        completion.data.resize(completion.bytes.size());
+    }
+}
+
+void AsyncIO::poolLoop() {
+    while (true) {
+        Request request;
+        {
+            std::unique_lock lock(mutex);
+            wake.wait(lock, [&]() { return stopping || !pending.empty(); });
+            if (pending.empty()) {
+                return;
+            }
+            request = std::move(pending.front());
+            pending.pop_front();
+        }
+        TRACE_ZONE("blocking read");
+        Completion completion{.path = request.path};
+        uint64_t syscalls = 0;
+        readBlocking(request, completion, syscalls);
+        finish(request, completion, syscalls, false);
+    }
+}
+
+/*
+ * Runs on the I/O thread once the ring is unusable. It keeps serving as one
+ * of the pool threads afterwards, so the pool has `threadCount` in total.
+ */
+void AsyncIO::fallBackToPool(int error) {
+    {
+        std::lock_guard lock(mutex);
+        backend = Backend::eThreadPool;
+        // the ring's fixed buffers are of no use to pread
+        registered.clear();
+        for (uint32_t i = 1; i < threadCount; i++) {
+            fallbackWorkers.emplace_back([this]() { poolLoop(); });
+        }
+    }
+    std::println(
+        "AsyncIO: io_uring_enter failed ({}), falling back to the thread pool",
+        std::generic_category().message(error)
+    );
+    poolLoop();
+}
+
+#ifdef __linux__
+
+/*
+ * Every request is a small state machine advanced by its completions:
+ * openat -> statx (whole files) -> read, repeated for short reads -> done.
+ * The close is submitted when the request completes and not waited for.
+ * All requests in flight share each io_uring_enter, which submits what the
+ * last batch of completions prepared and waits for the next completion.
+ *
+ * Requests queued while the thread waits in io_uring_enter start with the
+ * next completion; the thread only sleeps on `wake` once the ring is empty.
+ */
+void AsyncIO::ringLoop() {
+    enum class Step {
+        eOpen,
+        eStat,
+        eRead,
+    };
+    struct Op {
+        Request request;
+        Step step = Step::eOpen;
+        int fd = -1;
+        int fixedIndex = -1;  // registered buffer holding request.dst
+        uint64_t done = 0;
+        struct statx stx {};
+        std::vector<char> data;
+    };
+
+    Ring& ring = *this->ring;
+    // every op the ring holds, the kernel only knows the in-flight ones by user_data
+    std::unordered_set<Op*> live;
+    // ops waiting for a submission entry, and fds to close
+    std::deque<Op*> ready;
+    std::vector<int> closing;
+    uint32_t active = 0;
+    uint64_t enters = 0;
+    int failed = 0;  // set once the ring is unusable; completions only finish ops
+
+    auto complete = [&](Op* op, int error) {
+        if (op->fd >= 0) {
+            closing.push_back(op->fd);
+        }
+        Completion completion{.path = op->request.path, .error = error};
+        completion.bytes = op->request.dst.first(op->done);
+        if (op->request.wholeFile) {
+            op->data.resize(op->done);
+            completion.data = std::move(op->data);
+            completion.bytes = asBytes(completion.data);
+        }
+        finish(op->request, completion, 0, op->fixedIndex >= 0);
+        live.erase(op);
+        delete op;
+        active--;
+    };
+    auto startRead = [&](Op* op) {
+        if (op->done == op->request.dst.size()) {
+            complete(op, 0);
+        }
+        else {
+            op->step = Step::eRead;
+            ready.push_back(op);
+        }
+    };
+    auto prepare = [&](Op* op, io_uring_sqe* sqe) {
+        sqe->user_data = reinterpret_cast<uint64_t>(op);
+        switch (op->step) {
+            case Step::eOpen:
+                sqe->opcode = IORING_OP_OPENAT;
+                sqe->fd = AT_FDCWD;
+                sqe->addr = reinterpret_cast<uint64_t>(op->request.path.c_str());
+                sqe->open_flags = O_RDONLY | O_CLOEXEC;
+                break;
+            case Step::eStat:
+                sqe->opcode = IORING_OP_STATX;
+                sqe->fd = op->fd;
+                sqe->addr = reinterpret_cast<uint64_t>("");
+                sqe->len = STATX_SIZE;
+                sqe->off = reinterpret_cast<uint64_t>(&op->stx);
+                sqe->statx_flags = AT_EMPTY_PATH;
+                break;
+            case Step::eRead:
+                sqe->opcode = op->fixedIndex >= 0 ? IORING_OP_READ_FIXED : IORING_OP_READ;
+                sqe->fd = op->fd;
+                sqe->addr = reinterpret_cast<uint64_t>(op->request.dst.data() + op->done);
+                sqe->len = static_cast<uint32_t>(std::min<uint64_t>(op->request.dst.size() - op->done, MAX_READ));
+                sqe->off = op->request.offset + op->done;
+                sqe->buf_index = static_cast<uint16_t>(std::max(op->fixedIndex, 0));
+                break;
+        }
+    };
+    auto advance = [&](Op* op, int result) {
+        if (failed != 0) {
+            if (op->step == Step::eOpen && result >= 0) {
+                op->fd = result;
+            }
+            complete(op, result < 0 && result != -ECANCELED ? -result : failed);
+            return;
+        }
+        if (result < 0) {
+            if ((result == -EINTR || result == -EAGAIN) && op->step == Step::eRead) {
+                ready.push_back(op);
+            }
+            else {
+                complete(op, -result);
+            }
+            return;
+        }
+        switch (op->step) {
+            case Step::eOpen:
+                op->fd = result;
+                if (op->request.wholeFile) {
+                    op->step = Step::eStat;
+                    ready.push_back(op);
+                }
+                else {
+                    startRead(op);
+                }
+                break;
+            case Step::eStat:
+                op->data.resize(op->stx.stx_size > op->request.offset ? op->stx.stx_size - op->request.offset : 0);
+                op->request.dst = asBytes(op->data);
+                startRead(op);
+                break;
+            case Step::eRead:
+                if (result == 0) {
+                    complete(op, 0);  // end of file
+                }
+                else {
+                    op->done += static_cast<uint64_t>(result);
+                    startRead(op);
+                }
+                break;
+        }
+    };
+    auto reap = [&]() {
+        uint32_t head = *ring.cqHead;
+        uint32_t tail = std::atomic_ref(*ring.cqTail).load(std::memory_order_acquire);
+        for (; head != tail; head++) {
+            const io_uring_cqe& cqe = ring.cqes[head & ring.cqMask];
+            ring.inFlight--;
+            if (cqe.user_data != 0) {
+                advance(reinterpret_cast<Op*>(cqe.user_data), cqe.res);
+            }
+        }
+        std::atomic_ref(*ring.cqHead).store(head, std::memory_order_release);
+    };
+
+    while (true) {
+        {
+            std::unique_lock lock(mutex);
+            stats.syscalls += std::exchange(enters, 0);
+            if (active == 0 && closing.empty() && ring.inFlight == 0) {
+                wake.wait(lock, [&]() { return stopping || !pending.empty(); });
+                if (pending.empty()) {
+                    return;
+                }
+            }
+            // bounded so every active op can get its next entry right away
+            while (!pending.empty() && active < ring.entries / 2) {
+                auto* op = new Op{.request = std::move(pending.front())};
+                pending.pop_front();
+                for (size_t i = 0; i < registered.size() && !op->request.wholeFile; i++) {
+                    const auto& buffer = registered[i];
+                    if (op->request.dst.data() >= buffer.data() &&
+                        op->request.dst.data() + op->request.dst.size() <= buffer.data() + buffer.size()) {
+                        op->fixedIndex = static_cast<int>(i);
+                        break;
+                    }
+                }
+                ready.push_back(op);
+                live.insert(op);
+                active++;
+            }
+        }
+
+        TRACE_ZONE("io_uring batch");
+        while (!closing.empty()) {
+            io_uring_sqe* sqe = ring.nextSqe();
+            if (sqe == nullptr) {
+                break;
+            }
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->fd = closing.back();
+            sqe->user_data = 0;
+            closing.pop_back();
+        }
+        while (!ready.empty()) {
+            io_uring_sqe* sqe = ring.nextSqe();
+            if (sqe == nullptr) {
+                break;
+            }
+            prepare(ready.front(), sqe);
+            ready.pop_front();
+        }
+        int error = ring.enter(ring.inFlight + ring.toSubmit > 0 ? 1 : 0);
+        enters++;
+        if (error != 0) {
+            // an exception here would terminate the program: finish what
+            // already completed and fail the ops the kernel never saw
+            failed = error;
+            reap();
+            std::unordered_set<Op*> unsubmitted(ready.begin(), ready.end());
+            ready.clear();
+            for (uint32_t head = std::atomic_ref(*ring.sqHead).load(std::memory_order_acquire); head != ring.localTail; head++) {
+                const io_uring_sqe& sqe = ring.sqes[head & ring.sqMask];
+                if (sqe.user_data != 0) {
+                    unsubmitted.insert(reinterpret_cast<Op*>(sqe.user_data));
+                }
+                else {
+                    closing.push_back(sqe.fd);
+                }
+            }
+            ring.withdraw();
+            for (Op* op : unsubmitted) {
+                complete(op, error);
+            }
+            // the kernel still reads into the rest and owns their fds until
+            // their completions arrive; ask it to cancel them and wait
+            for (Op* op : live) {
+                io_uring_sqe* sqe = ring.nextSqe();
+                if (sqe == nullptr) {
+                    break;
+                }
+                sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                sqe->addr = reinterpret_cast<uint64_t>(op);
+                sqe->user_data = 0;
+            }
+            while (ring.inFlight + ring.toSubmit > 0) {
+                int drainError = ring.enter(1);
+                enters++;
+                if (drainError != 0) {
+                    // leak what is left rather than free memory the kernel may still write
+                    std::println(
+                        "AsyncIO: cannot wait for {} io_uring requests ({})", ring.inFlight,
+                        std::generic_category().message(drainError)
+                    );
+                    break;
+                }
+                reap();
+            }
+            for (int fd : closing) {
+                ::close(fd);
+            }
+            {
+                std::lock_guard lock(mutex);
+                stats.syscalls += enters + closing.size();
+            }
+            fallBackToPool(error);
+            return;
+        }
+        reap();
+    }
+}
+
+#else
+
+void AsyncIO::ringLoop() {}
+
+#endif
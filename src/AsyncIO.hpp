@@ -0,0 +1,133 @@
+#ifndef ASYNCIO_HPP
+#define ASYNCIO_HPP
+
+// c++ std libs
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils.hpp"
+
+/*
+ * Asynchronous file reads. On Linux a dedicated thread drives an io_uring:
+ * every request is an openat, a statx (when the file size is needed), one or
+ * more reads and a close, all submitted as ring operations, so loading a
+ * thousand small files costs a few dozen io_uring_enter calls instead of
+ * four blocking syscalls each on the caller's thread. Where io_uring isn't
+ * available (other platforms, old kernels, seccomp filters in containers) a
+ * small pool of threads does plain open / pread instead.
+ *
+ * Reads that land entirely inside a range given to registerBuffers() use the
+ * ring's fixed buffers, which skips pinning the pages per read; register the
+ * mapped staging memory to read assets straight into it.
+ *
+ * Callbacks run on the I/O thread (or a pool thread): keep them short and
+ * don't call wait() from them.
+ *
+ *     AsyncIO io;
+ *     io.init();
+ *     auto spv = io.readFile("shaders/shader.spv");  // std::future
+ *     io.read("level.bin", 0, staging, [](AsyncIO::Completion& c) { ... });
+ *     io.wait();
+ *     useShader(spv.get());
+ */
+class AsyncIO {
+public:
+    enum class Backend {
+        eIoUring,
+        eThreadPool,
+    };
+
+    struct Completion {
+        const std::string& path;
+        std::span<uint8_t> bytes;  // what was read, at the start of the destination
+        std::vector<char> data;    // readFile(): the whole file, may be moved out
+        int error = 0;             // errno of the step that failed, 0 on success
+    };
+    using Callback = std::function<void(Completion&)>;
+
+    struct Stats {
+        uint64_t requests = 0;  // completed, including failed ones
+        uint64_t failed = 0;
+        uint64_t bytes = 0;
+        uint64_t syscalls = 0;    // io_uring_enter, or open/stat/read/close calls of the pool
+        uint64_t fixedReads = 0;  // reads into registered buffers
+    };
+
+private:
+    struct Ring;  // the io_uring and its mappings, Linux only
+
+    struct Request {
+        std::string path;
+        uint64_t offset = 0;
+        std::span<uint8_t> dst;  // empty: read the whole file into Completion::data
+        bool wholeFile = false;
+        Callback callback;
+    };
+
+    // switches to eThreadPool on the I/O thread if the ring fails
+    std::atomic<Backend> backend = Backend::eThreadPool;
+    std::unique_ptr<Ring> ring;
+    uint32_t threadCount = 0;
+    std::vector<std::thread> workers;
+    // started by the I/O thread when the ring fails, joined after `workers`
+    std::vector<std::thread> fallbackWorkers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    // guarded by `mutex`
+    std::deque<Request> pending;
+    uint64_t outstanding = 0;  // queued or in flight
+    bool stopping = false;
+    std::vector<std::span<uint8_t>> registered;
+    Stats stats;
+
+    void enqueue(Request&& request);
+    void finish(Request& request, Completion& completion, uint64_t syscalls, bool fixed);
+    void ringLoop();
+    void fallBackToPool(int error);
+    void poolLoop();
+    static void readBlocking(Request& request, Completion& completion, uint64_t& syscalls);
+
+public:
+    AsyncIO();
+    ~AsyncIO();
+    DISABLE_COPY(AsyncIO)
+
+    // Falls back to the thread pool when `preferred` is eIoUring but the ring
+    // can't be created or lacks the operations used here, or later when
+    // io_uring_enter fails: the requests the ring held then complete with
+    // that error, queued ones go to the pool.
+    void init(Backend preferred = Backend::eIoUring, uint32_t queueDepth = 256, uint32_t threadCount = 4);
+    Backend getBackend() const {
+        return backend;
+    }
+
+    // Replaces the registered buffers; call while no read into the previous
+    // ones is in flight. False when the backend has no fixed buffers or the
+    // kernel refused them (e.g. RLIMIT_MEMLOCK), reads then work as usual.
+    bool registerBuffers(std::span<const std::span<uint8_t>> buffers);
+
+    // Up to dst.size() bytes from `offset`; fewer at the end of the file.
+    void read(std::string path, uint64_t offset, std::span<uint8_t> dst, Callback callback);
+    void readFile(std::string path, Callback callback);
+    // Throws std::system_error from get() when the read failed.
+    std::future<std::vector<char>> readFile(std::string path);
+
+    // Blocks until every request made so far has run its callback.
+    void wait();
+    Stats getStats();
+};
+
+const char* toString(AsyncIO::Backend backend);
+
+#endif  // ASYNCIO_HPP
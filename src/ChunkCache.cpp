@@ -0,0 +1,266 @@
+#include "ChunkCache.hpp"
+
+// std c++
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <utility>
+
+// project
+#include "Trace.hpp"
+
+void ChunkCache::init(uint32_t width, uint32_t depth, float chunkSize) {
+    this->width = width;
+    this->depth = depth;
+    this->chunkSize = chunkSize;
+    chunks.assign(size_t{width} * depth, {});
+    // every chunk can be wanted at once, prioritize() never grows these
+    wanted.reserve(chunks.size());
+    drawn.reserve(chunks.size());
+    setCapacity(0);
+}
+
+void ChunkCache::setCapacity(uint32_t capacity) {
+    for (auto& chunk : chunks) {
+        chunk = {};
+    }
+    freeSlots.resize(capacity);
+    // popped from the back: slot 0 first
+    for (uint32_t i = 0; i < capacity; i++) {
+        freeSlots[i] = capacity - 1 - i;
+    }
+    lruHead = lruTail = NONE;
+    wanted.clear();
+    loadCursor = evictCursor = 0;
+    drawn.clear();
+    stats.capacity = capacity;
+    stats.resident = 0;
+    stats.loading = 0;
+}
+
+uint32_t ChunkCache::shrink(uint32_t capacity, uint64_t completedValue, std::vector<Move>& moves) {
+    assert(stats.loading == 0);
+    moves.clear();
+    for (uint32_t index = lruTail; index != NONE && stats.resident > capacity;) {
+        uint32_t prev = chunks[index].prev;
+        if (evictable(chunks[index], completedValue)) {
+            evict(index);
+        }
+        index = prev;
+    }
+    capacity = std::max(capacity, stats.resident);
+    if (capacity >= stats.capacity) {
+        return stats.capacity;
+    }
+
+    std::vector<bool> used(capacity, false);
+    for (const Chunk& chunk : chunks) {
+        if (chunk.state == State::eResident && chunk.slot < capacity) {
+            used[chunk.slot] = true;
+        }
+    }
+    // popped from the back: lowest slot first
+    freeSlots.clear();
+    for (uint32_t slot = capacity; slot-- > 0;) {
+        if (!used[slot]) {
+            freeSlots.push_back(slot);
+        }
+    }
+    for (Chunk& chunk : chunks) {
+        if (chunk.state == State::eResident && chunk.slot >= capacity) {
+            uint32_t slot = freeSlots.back();
+            freeSlots.pop_back();
+            moves.push_back({.from = chunk.slot, .to = slot});
+            chunk.slot = slot;
+        }
+    }
+    // the ranking may point at evicted chunks, the next prioritize() redoes it
+    wanted.clear();
+    loadCursor = evictCursor = 0;
+    stats.capacity = capacity;
+    return capacity;
+}
+
+void ChunkCache::unlink(uint32_t index) {
+    Chunk& chunk = chunks[index];
+    (chunk.prev != NONE ? chunks[chunk.prev].next : lruHead) = chunk.next;
+    (chunk.next != NONE ? chunks[chunk.next].prev : lruTail) = chunk.prev;
+    chunk.prev = chunk.next = NONE;
+}
+
+void ChunkCache::pushFront(uint32_t index) {
+    Chunk& chunk = chunks[index];
+    chunk.prev = NONE;
+    chunk.next = lruHead;
+    if (lruHead != NONE) {
+        chunks[lruHead].prev = index;
+    }
+    lruHead = index;
+    if (lruTail == NONE) {
+        lruTail = index;
+    }
+}
+
+void ChunkCache::prioritize(const Camera& camera) {
+    TRACE_FUNCTION();
+    frame++;
+    wanted.clear();
+    const Settings& s = settings;
+    // the widest a key under loadRadius can reach from the camera
+    float speed = std::sqrt(camera.vx * camera.vx + camera.vz * camera.vz);
+    float reach = s.loadRadius + s.lookaheadSeconds * speed;
+    auto range = [&](float center, uint32_t count) {
+        float first = std::floor((center - reach) / chunkSize);
+        float last = std::floor((center + reach) / chunkSize);
+        return std::pair{
+            static_cast<uint32_t>(std::clamp(first, 0.f, static_cast<float>(count))),
+            static_cast<uint32_t>(std::clamp(last + 1.f, 0.f, static_cast<float>(count)))
+        };
+    };
+    auto [x0, x1] = range(camera.x, width);
+    auto [z0, z1] = range(camera.z, depth);
+    for (uint32_t z = z0; z < z1; z++) {
+        for (uint32_t x = x0; x < x1; x++) {
+            float dx = (x + 0.5f) * chunkSize - camera.x;
+            float dz = (z + 0.5f) * chunkSize - camera.z;
+            float distance = std::sqrt(dx * dx + dz * dz);
+            // velocity towards the chunk
+            float closing = distance > 0 ? (dx * camera.vx + dz * camera.vz) / distance : 0.f;
+            float key = distance - s.lookaheadSeconds * std::max(closing, 0.f);
+            if (key > s.loadRadius) {
+                continue;
+            }
+            uint32_t index = chunkIndex(x, z);
+            Chunk& chunk = chunks[index];
+            chunk.key = key;
+            chunk.touched = frame;
+            if (chunk.state == State::eResident) {
+                unlink(index);
+                pushFront(index);
+            }
+            wanted.push_back({key, index});
+        }
+    }
+    std::sort(wanted.begin(), wanted.end(), [](const Ranked& a, const Ranked& b) { return a.key < b.key; });
+    loadCursor = 0;
+    evictCursor = wanted.size();
+    stats.wanted = static_cast<uint32_t>(wanted.size());
+}
+
+bool ChunkCache::evictable(const Chunk& chunk, uint64_t completedValue) const {
+    return chunk.state == State::eResident && chunk.lastUse <= completedValue;
+}
+
+void ChunkCache::evict(uint32_t index) {
+    Chunk& chunk = chunks[index];
+    unlink(index);
+    chunk.state = State::eAbsent;
+    chunk.slot = NONE;
+    stats.resident--;
+    stats.evictions++;
+}
+
+uint32_t ChunkCache::takeSlot(float key, uint64_t completedValue) {
+    if (!freeSlots.empty()) {
+        uint32_t slot = freeSlots.back();
+        freeSlots.pop_back();
+        return slot;
+    }
+    auto take = [&](uint32_t index) {
+        uint32_t slot = chunks[index].slot;
+        evict(index);
+        return slot;
+    };
+    // least recently used chunk nobody wants; prioritize() moved the wanted
+    // ones to the front, so the walk ends at the first of them
+    for (uint32_t index = lruTail; index != NONE && chunks[index].touched != frame; index = chunks[index].prev) {
+        if (evictable(chunks[index], completedValue)) {
+            return take(index);
+        }
+    }
+    // the least important wanted chunk, if it's clearly less important
+    while (evictCursor > loadCursor) {
+        const Ranked& candidate = wanted[evictCursor - 1];
+        if (candidate.key < key + settings.evictionMargin) {
+            break;
+        }
+        evictCursor--;
+        if (evictable(chunks[candidate.chunk], completedValue)) {
+            return take(candidate.chunk);
+        }
+    }
+    return NONE;
+}
+
+bool ChunkCache::nextLoad(uint64_t completedValue, Load& load) {
+    while (loadCursor < evictCursor) {
+        const Ranked& next = wanted[loadCursor];
+        Chunk& chunk = chunks[next.chunk];
+        if (chunk.state != State::eAbsent) {
+            loadCursor++;
+            continue;
+        }
+        uint32_t slot = takeSlot(next.key, completedValue);
+        if (slot == NONE) {
+            // everything nearer is resident or loading, or still drawn by frames in flight
+            return false;
+        }
+        loadCursor++;
+        chunk.state = State::eLoading;
+        chunk.slot = slot;
+        stats.loading++;
+        stats.loads++;
+        load = {.chunk = next.chunk, .slot = slot};
+        return true;
+    }
+    return false;
+}
+
+void ChunkCache::loaded(uint32_t index) {
+    Chunk& chunk = chunks[index];
+    assert(chunk.state == State::eLoading);
+    chunk.state = State::eResident;
+    chunk.lastUse = 0;
+    pushFront(index);
+    stats.loading--;
+    stats.resident++;
+}
+
+void ChunkCache::cancel(uint32_t index) {
+    Chunk& chunk = chunks[index];
+    assert(chunk.state == State::eLoading);
+    freeSlots.push_back(chunk.slot);
+    chunk.state = State::eAbsent;
+    chunk.slot = NONE;
+    stats.loading--;
+}
+
+uint32_t ChunkCache::use(uint32_t index) {
+    Chunk& chunk = chunks[index];
+    if (chunk.state != State::eResident) {
+        stats.misses++;
+        stats.frameMisses++;
+        return NONE;
+    }
+    stats.hits++;
+    stats.frameHits++;
+    if (chunk.lastUse != PENDING) {
+        chunk.lastUse = PENDING;
+        drawn.push_back(index);
+    }
+    unlink(index);
+    pushFront(index);
+    return chunk.slot;
+}
+
+void ChunkCache::submitted(uint64_t value) {
+    for (uint32_t index : drawn) {
+        chunks[index].lastUse = value;
+    }
+    drawn.clear();
+}
+
+void ChunkCache::beginFrame() {
+    stats.frameHits = 0;
+    stats.frameMisses = 0;
+}
@@ -0,0 +1,169 @@
+#ifndef CHUNKCACHE_HPP
+#define CHUNKCACHE_HPP
+
+// c++ std libs
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "utils.hpp"
+
+/*
+ * Residency bookkeeping for a world split into a grid of square chunks, with
+ * room for `capacity` of them on the GPU (the slots of a pool). No Vulkan
+ * here: the owner moves the data, this decides what goes where.
+ *
+ * prioritize() ranks the chunks around the camera: the key is the distance
+ * to the camera, shortened for chunks the camera is moving towards by up to
+ * `lookaheadSeconds` of its velocity, and chunks with a key under
+ * `loadRadius` are wanted. nextLoad() hands out the wanted chunks that
+ * aren't resident, nearest first, each with a slot. Free slots go first,
+ * then the least recently used resident chunk that isn't wanted, then the
+ * least important wanted one if it is clearly further than the load. A chunk
+ * is never evicted while a frame that drew it may still be in flight: use()
+ * marks it busy and submitted() records the timeline value of the frame's
+ * submit, which the owner compares against what has completed.
+ *
+ *     cache.prioritize(camera);           // once per frame
+ *     while (cache.nextLoad(completed, load)) { read + upload load.chunk into load.slot }
+ *     cache.loaded(chunk);                // the upload landed
+ *     uint32_t slot = cache.use(chunk);   // for each visible chunk, NONE when not resident
+ *     cache.submitted(submitValue);       // the frame that drew them
+ */
+class ChunkCache {
+public:
+    static constexpr uint32_t NONE = ~0u;
+
+    enum class State : uint8_t {
+        eAbsent,
+        eLoading,  // has a slot, data on the way
+        eResident,
+    };
+
+    struct Camera {
+        float x = 0, z = 0;    // world position
+        float vx = 0, vz = 0;  // units per second
+    };
+
+    struct Settings {
+        float loadRadius = 256.f;
+        float lookaheadSeconds = 0.5f;
+        // a wanted chunk is only evicted for one at least this much nearer
+        float evictionMargin = 32.f;
+    };
+
+    struct Load {
+        uint32_t chunk = NONE;
+        uint32_t slot = NONE;
+    };
+
+    // a resident chunk that shrink() moved to a lower slot
+    struct Move {
+        uint32_t from;
+        uint32_t to;
+    };
+
+    struct Stats {
+        uint32_t capacity = 0;
+        uint32_t resident = 0;
+        uint32_t loading = 0;
+        uint32_t wanted = 0;
+        uint64_t hits = 0;  // use() of resident chunks
+        uint64_t misses = 0;
+        uint64_t loads = 0;
+        uint64_t evictions = 0;
+        uint32_t frameHits = 0;
+        uint32_t frameMisses = 0;
+
+        double hitRate() const {
+            return hits + misses > 0 ? static_cast<double>(hits) / (hits + misses) : 0.0;
+        }
+    };
+
+private:
+    // not submitted yet: busy until submitted() says otherwise
+    static constexpr uint64_t PENDING = std::numeric_limits<uint64_t>::max();
+
+    struct Chunk {
+        State state = State::eAbsent;
+        uint32_t slot = NONE;
+        uint64_t lastUse = 0;
+        uint32_t touched = 0;  // frame of the last prioritize() that wanted it
+        float key = 0;
+        // LRU list of resident chunks, most recent at `lruHead`
+        uint32_t prev = NONE;
+        uint32_t next = NONE;
+    };
+    struct Ranked {
+        float key;
+        uint32_t chunk;
+    };
+
+    uint32_t width = 0;
+    uint32_t depth = 0;
+    float chunkSize = 1.f;
+    std::vector<Chunk> chunks;
+    std::vector<uint32_t> freeSlots;
+    uint32_t lruHead = NONE;
+    uint32_t lruTail = NONE;
+    // this frame's wanted chunks, by key
+    std::vector<Ranked> wanted;
+    size_t loadCursor = 0;
+    size_t evictCursor = 0;  // wanted chunks at or past it have been considered for eviction
+    std::vector<uint32_t> drawn;  // used since the last submitted()
+    uint32_t frame = 0;
+    Stats stats;
+
+    void unlink(uint32_t chunk);
+    void pushFront(uint32_t chunk);
+    bool evictable(const Chunk& chunk, uint64_t completedValue) const;
+    void evict(uint32_t chunk);
+    uint32_t takeSlot(float key, uint64_t completedValue);
+
+public:
+    Settings settings;
+
+    ChunkCache() = default;
+    DISABLE_COPY(ChunkCache)
+
+    // A `width` x `depth` grid of `chunkSize` squares from the origin.
+    void init(uint32_t width, uint32_t depth, float chunkSize);
+    // Forgets everything, slots [0, capacity) are free again.
+    void setCapacity(uint32_t capacity);
+    // Lowers the capacity to `capacity` while keeping what fits: least
+    // recently used chunks that no frame after `completedValue` drew are
+    // evicted until the rest fit, then those in slots past the new capacity
+    // are moved below it. Nothing may be loading. Returns the new capacity,
+    // higher than asked when too many chunks are still in flight.
+    uint32_t shrink(uint32_t capacity, uint64_t completedValue, std::vector<Move>& moves);
+
+    uint32_t chunkCount() const {
+        return static_cast<uint32_t>(chunks.size());
+    }
+    uint32_t chunkIndex(uint32_t x, uint32_t z) const {
+        return z * width + x;
+    }
+    State state(uint32_t chunk) const {
+        return chunks[chunk].state;
+    }
+
+    void prioritize(const Camera& camera);
+    // `completedValue`: the last completed frame, slots drawn by later ones
+    // stay. False when nothing wanted is missing or no slot can be freed.
+    bool nextLoad(uint64_t completedValue, Load& load);
+    void loaded(uint32_t chunk);
+    // The load failed, its slot is free again.
+    void cancel(uint32_t chunk);
+
+    // The slot of a resident chunk, which the current frame then draws.
+    uint32_t use(uint32_t chunk);
+    void submitted(uint64_t value);
+    // Starts the per-frame hit / miss counts.
+    void beginFrame();
+
+    const Stats& getStats() const {
+        return stats;
+    }
+};
+
+#endif  // CHUNKCACHE_HPP
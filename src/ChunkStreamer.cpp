@@ -0,0 +1,660 @@
+#include "ChunkStreamer.hpp"
+
+// std c++
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <format>
+#include <fstream>
+#include <print>
+#include <stdexcept>
+#include <utility>
+
+// vulkan
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+// project
+#include "Trace.hpp"
+
+namespace {
+
+constexpr uint32_t CHUNK_VERTEX_COUNT = ChunkStreamer::CHUNK_VERTICES * ChunkStreamer::CHUNK_VERTICES;
+constexpr uint32_t INDEX_COUNT = (ChunkStreamer::CHUNK_VERTICES - 1) * (ChunkStreamer::CHUNK_VERTICES - 1) * 6;
+// the pool never takes more than this share of the device local budget
+constexpr double MAX_BUDGET_SHARE = 0.25;
+
+// push constants of shaders/world.hlsl
+struct Params {
+    float scale[2];  // world xz to clip space
+    float offset[2];
+};
+
+// Rolling hills, ridges and a few lakes; smooth, so the chunk edges match.
+float terrainHeight(float x, float z) {
+    return 48.f * std::sin(x * 0.0041f) * std::cos(z * 0.0053f) +
+           22.f * std::sin(x * 0.013f + z * 0.0071f) +
+           9.f * std::sin(x * 0.043f) * std::sin(z * 0.037f) +
+           3.f * std::sin((x - z) * 0.11f);
+}
+
+uint32_t packColor(float r, float g, float b) {
+    auto channel = [](float value) {
+        return static_cast<uint32_t>(std::clamp(value, 0.f, 1.f) * 255.f + 0.5f);
+    };
+    return channel(r) | channel(g) << 8 | channel(b) << 16 | 0xffu << 24;
+}
+
+// Water, sand, grass, rock and snow by height, lit from the north west.
+uint32_t terrainColor(float x, float z) {
+    constexpr float STEP = 1.f;
+    float h = terrainHeight(x, z);
+    float dx = terrainHeight(x + STEP, z) - terrainHeight(x - STEP, z);
+    float dz = terrainHeight(x, z + STEP) - terrainHeight(x, z - STEP);
+    // normal of the heightfield, dotted with a light direction of (-1, 2, -1) / sqrt(6)
+    float nx = -dx, ny = 2.f * STEP, nz = -dz;
+    float light = (-nx + 2.f * ny - nz) / (std::sqrt(nx * nx + ny * ny + nz * nz) * std::sqrt(6.f));
+    light = 0.35f + 0.65f * std::max(light, 0.f);
+    float r, g, b;
+    if (h < -30.f) {
+        r = 0.02f, g = 0.08f, b = 0.3f;
+        light = 1.f;
+    }
+    else if (h < -24.f) {
+        r = 0.6f, g = 0.5f, b = 0.25f;
+    }
+    else if (h < 30.f) {
+        r = 0.08f, g = 0.3f, b = 0.04f;
+    }
+    else if (h < 55.f) {
+        r = 0.2f, g = 0.17f, b = 0.14f;
+    }
+    else {
+        r = g = b = 0.9f;
+    }
+    return packColor(r * light, g * light, b * light);
+}
+
+DeviceAllocation allocateBuffer(
+    const DeviceProfile& profile,
+    const vk::raii::Device& device,
+    MemoryBudget& budget,
+    vk::raii::Buffer& buffer,
+    vk::DeviceSize size,
+    vk::BufferUsageFlags usage,
+    vk::MemoryPropertyFlags properties,
+    MemoryCategory category
+) {
+    buffer = vk::raii::Buffer(device, vk::BufferCreateInfo{
+        .size = size,
+        .usage = usage,
+        .sharingMode = vk::SharingMode::eExclusive
+    });
+    vk::MemoryRequirements requirements = buffer.getMemoryRequirements();
+    auto memory = budget.allocate(
+        device,
+        vk::MemoryAllocateInfo{
+            .allocationSize = requirements.size,
+            .memoryTypeIndex = findMemoryType(profile.memory, requirements.memoryTypeBits, properties)
+        },
+        category
+    );
+    buffer.bindMemory(*memory, 0);
+    return memory;
+}
+
+// Opaque triangles from ChunkStreamer::Vertex, world xz mapped by Params.
+vk::raii::Pipeline createPipeline(
+    const vk::raii::Device& device,
+    const vk::raii::ShaderModule& module,
+    const vk::raii::PipelineLayout& layout,
+    vk::Format colorFormat
+) {
+    using Vertex = ChunkStreamer::Vertex;
+    vk::PipelineShaderStageCreateInfo shaderStages[] = {
+        {.stage = vk::ShaderStageFlagBits::eVertex, .module = module, .pName = "vertMain"},
+        {.stage = vk::ShaderStageFlagBits::eFragment, .module = module, .pName = "fragMain"},
+    };
+    vk::VertexInputBindingDescription binding{0, sizeof(Vertex), vk::VertexInputRate::eVertex};
+    std::array attributes{
+        vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, x)),
+        vk::VertexInputAttributeDescription(1, 0, vk::Format::eR8G8B8A8Unorm, offsetof(Vertex, color)),
+    };
+    vk::PipelineVertexInputStateCreateInfo vertexInputInfo{
+        .vertexBindingDescriptionCount = 1,
+        .pVertexBindingDescriptions = &binding,
+        .vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size()),
+        .pVertexAttributeDescriptions = attributes.data()
+    };
+    vk::PipelineInputAssemblyStateCreateInfo inputAssembly{
+        .topology = vk::PrimitiveTopology::eTriangleList
+    };
+    vk::PipelineViewportStateCreateInfo viewportState{
+        .viewportCount = 1, .scissorCount = 1
+    };
+    vk::PipelineRasterizationStateCreateInfo rasterizer{
+        .depthClampEnable = vk::False,
+        .rasterizerDiscardEnable = vk::False,
+        .polygonMode = vk::PolygonMode::eFill,
+        .cullMode = vk::CullModeFlagBits::eNone,
+        .frontFace = vk::FrontFace::eClockwise,
+        .depthBiasEnable = vk::False,
+        .lineWidth = 1.0f
+    };
+    vk::PipelineMultisampleStateCreateInfo multisampling{
+        .rasterizationSamples = vk::SampleCountFlagBits::e1,
+        .sampleShadingEnable = vk::False
+    };
+    vk::PipelineColorBlendAttachmentState colorBlendAttachment{
+        .blendEnable = vk::False,
+        .colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+                          vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA
+    };
+    vk::PipelineColorBlendStateCreateInfo colorBlending{
+        .logicOpEnable = vk::False,
+        .attachmentCount = 1,
+        .pAttachments = &colorBlendAttachment
+    };
+    std::array dynamicStates = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+    vk::PipelineDynamicStateCreateInfo dynamicState{
+        .dynamicStateCount = static_cast<uint32_t>(dynamicStates.size()),
+        .pDynamicStates = dynamicStates.data()
+    };
+
+    vk::StructureChain pipelineCreateInfoChain{
+        vk::GraphicsPipelineCreateInfo{
+            .stageCount = 2,
+            .pStages = shaderStages,
+            .pVertexInputState = &vertexInputInfo,
+            .pInputAssemblyState = &inputAssembly,
+            .pViewportState = &viewportState,
+            .pRasterizationState = &rasterizer,
+            .pMultisampleState = &multisampling,
+            .pColorBlendState = &colorBlending,
+            .pDynamicState = &dynamicState,
+            .layout = layout,
+            .renderPass = nullptr
+        },
+        vk::PipelineRenderingCreateInfo{
+            .colorAttachmentCount = 1,
+            .pColorAttachmentFormats = &colorFormat
+        }
+    };
+    return {device, nullptr, pipelineCreateInfoChain.get<vk::GraphicsPipelineCreateInfo>()};
+}
+
+// Half the world size covered by the view, keeping the target's aspect ratio.
+std::pair<float, float> viewHalfExtent(float radius, vk::Extent2D extent) {
+    float aspect = extent.height > 0 ? static_cast<float>(extent.width) / extent.height : 1.f;
+    return {radius * aspect, radius};
+}
+
+}  // namespace
+
+/*
+ * Chunks in row-major order, each CHUNK_VERTICES x CHUNK_VERTICES vertices
+ * row by row, so chunk i is CHUNK_BYTES at i * CHUNK_BYTES and goes into a
+ * pool slot with a single copy.
+ */
+void ChunkStreamer::generate(const std::filesystem::path& path) {
+    TRACE_FUNCTION();
+    constexpr vk::DeviceSize FILE_BYTES = vk::DeviceSize{WORLD_CHUNKS} * WORLD_CHUNKS * CHUNK_BYTES;
+    std::error_code error;
+    if (std::filesystem::file_size(path, error) == FILE_BYTES) {
+        return;
+    }
+    std::filesystem::create_directories(path.parent_path());
+    // written aside and renamed, an interrupted run doesn't leave half a world
+    auto partial = path;
+    partial += ".partial";
+    {
+        std::ofstream out(partial, std::ios::binary | std::ios::trunc);
+        std::vector<Vertex> chunk(CHUNK_VERTEX_COUNT);
+        constexpr float SPACING = CHUNK_SIZE / (CHUNK_VERTICES - 1);
+        for (uint32_t cz = 0; cz < WORLD_CHUNKS && out; cz++) {
+            for (uint32_t cx = 0; cx < WORLD_CHUNKS; cx++) {
+                for (uint32_t z = 0; z < CHUNK_VERTICES; z++) {
+                    for (uint32_t x = 0; x < CHUNK_VERTICES; x++) {
+                        float wx = cx * CHUNK_SIZE + x * SPACING;
+                        float wz = cz * CHUNK_SIZE + z * SPACING;
+                        chunk[z * CHUNK_VERTICES + x] = {
+                            .x = wx, .y = terrainHeight(wx, wz), .z = wz, .color = terrainColor(wx, wz)
+                        };
+                    }
+                }
+                out.write(reinterpret_cast<const char*>(chunk.data()), CHUNK_BYTES);
+            }
+        }
+        if (!out) {
+            throw std::runtime_error(std::format("failed to write {}", partial.string()));
+        }
+    }
+    std::filesystem::rename(partial, path);
+}
+
+void ChunkStreamer::init(
+    const DeviceProfile& profile,
+    const vk::raii::Device& device,
+    MemoryBudget& budget,
+    QueueScheduler& scheduler,
+    uint32_t framesInFlight,
+    std::span<const char> spv,
+    vk::Format colorFormat,
+    const std::filesystem::path& path
+) {
+    this->profile = &profile;
+    this->device = &device;
+    this->budget = &budget;
+    this->scheduler = &scheduler;
+    this->path = path.string();
+
+    vk::PushConstantRange pushConstants{
+        .stageFlags = vk::ShaderStageFlagBits::eVertex, .offset = 0, .size = sizeof(Params)
+    };
+    layout = vk::raii::PipelineLayout(device, vk::PipelineLayoutCreateInfo{
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstants
+    });
+    vk::raii::ShaderModule module(device, vk::ShaderModuleCreateInfo{
+        .codeSize = spv.size(),
+        .pCode = reinterpret_cast<const uint32_t*>(spv.data())
+    });
+    pipeline = createPipeline(device, module, layout, colorFormat);
+
+    // the same grid for every chunk, each draw offsets it to the chunk's slot
+    constexpr vk::MemoryPropertyFlags HOST =
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+    vk::DeviceSize indexBytes = INDEX_COUNT * sizeof(uint16_t);
+    indexMemory = allocateBuffer(
+        profile, device, budget, indices, indexBytes, vk::BufferUsageFlagBits::eIndexBuffer, HOST, MemoryCategory::eBuffer
+    );
+    auto* index = static_cast<uint16_t*>(indexMemory.get().mapMemory(0, indexBytes));
+    for (uint32_t z = 0; z + 1 < CHUNK_VERTICES; z++) {
+        for (uint32_t x = 0; x + 1 < CHUNK_VERTICES; x++) {
+            auto corner = static_cast<uint16_t>(z * CHUNK_VERTICES + x);
+            const uint16_t quad[6] = {
+                corner,
+                static_cast<uint16_t>(corner + 1),
+                static_cast<uint16_t>(corner + CHUNK_VERTICES + 1),
+                static_cast<uint16_t>(corner + CHUNK_VERTICES + 1),
+                static_cast<uint16_t>(corner + CHUNK_VERTICES),
+                corner
+            };
+            index = std::copy(quad, quad + 6, index);
+        }
+    }
+    indexMemory.get().unmapMemory();
+
+    stagingMemory = allocateBuffer(
+        profile,
+        device,
+        budget,
+        staging,
+        STAGING_SLOTS * CHUNK_BYTES,
+        vk::BufferUsageFlagBits::eTransferSrc,
+        HOST,
+        MemoryCategory::eStaging
+    );
+    stagingMapped = static_cast<uint8_t*>(stagingMemory.get().mapMemory(0, vk::WholeSize));
+    uploads.resize(framesInFlight);
+    for (auto& upload : uploads) {
+        upload.cmd = scheduler.allocateCommandBuffer(QueueType::eTransfer);
+    }
+
+    io.init();
+    // chunks are read straight into the mapped staging memory
+    std::span<uint8_t> stagingBytes{stagingMapped, STAGING_SLOTS * CHUNK_BYTES};
+    io.registerBuffers({&stagingBytes, 1});
+
+    auto maxMiB = static_cast<uint32_t>(maxPoolBytes() >> 20);
+    if (settings.budgetMiB > maxMiB) {
+        std::println("World: chunk pool budget capped to {} MiB by the device memory budget", maxMiB);
+        settings.budgetMiB = std::max(maxMiB, 1u);
+    }
+    cache.init(WORLD_CHUNKS, WORLD_CHUNKS, CHUNK_SIZE);
+    drawSlots.reserve(cache.chunkCount());
+    createPool();
+    lastTick = clock::now();
+}
+
+vk::DeviceSize ChunkStreamer::maxPoolBytes() const {
+    vk::DeviceSize largest = 0;
+    MemoryBudget::Stats memory = budget->stats();
+    for (uint32_t i = 0; i < memory.heapCount; i++) {
+        if (memory.heaps[i].deviceLocal) {
+            largest = std::max(largest, memory.heaps[i].budget);
+        }
+    }
+    return static_cast<vk::DeviceSize>(largest * MAX_BUDGET_SHARE);
+}
+
+/*
+ * One slot per chunk that fits the budget. A new budget starts over with an
+ * empty pool: rare and user triggered, so reads and copies into the old one
+ * are waited for and the frames in flight keep drawing from it until done.
+ */
+void ChunkStreamer::createPool() {
+    TRACE_FUNCTION();
+    if (*pool != nullptr) {
+        dropLoads();
+        uint64_t lastSubmit = scheduler->submittedValue(QueueType::eGraphics);
+        scheduler->retire(QueueType::eGraphics, lastSubmit, std::move(pool));
+        scheduler->retire(QueueType::eGraphics, lastSubmit, std::move(poolMemory));
+    }
+    poolBudgetMiB = settings.budgetMiB;
+    vk::DeviceSize bytes = std::min(vk::DeviceSize{settings.budgetMiB} << 20, maxPoolBytes());
+    auto capacity = static_cast<uint32_t>(std::clamp<vk::DeviceSize>(bytes / CHUNK_BYTES, 1, cache.chunkCount()));
+    allocatePool(capacity);
+    cache.setCapacity(capacity);
+}
+
+void ChunkStreamer::allocatePool(uint32_t capacity) {
+    poolMemory = allocateBuffer(
+        *profile,
+        *device,
+        *budget,
+        pool,
+        capacity * CHUNK_BYTES,
+        vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferSrc |
+            vk::BufferUsageFlagBits::eTransferDst,
+        vk::MemoryPropertyFlagBits::eDeviceLocal,
+        MemoryCategory::eBuffer
+    );
+    stats.budgetBytes = capacity * CHUNK_BYTES;
+}
+
+// Waits for the reads and copies in flight and gives their slots back.
+void ChunkStreamer::dropLoads() {
+    io.wait();
+    scheduler->wait(QueueType::eTransfer, scheduler->submittedValue(QueueType::eTransfer));
+    for (auto& slot : stagingSlots) {
+        if (slot.state != StagingSlot::State::eFree) {
+            cache.cancel(slot.chunk);
+            slot.state = StagingSlot::State::eFree;
+        }
+    }
+}
+
+/*
+ * The pool is one buffer, so shrinking it means a smaller one: the cache
+ * evicts what it can spare and packs the rest into the low slots. On the
+ * graphics queue, ahead of the next frame, the new buffer gets the low slots
+ * of the old one and then the chunks moved down from above. Frames in
+ * flight keep drawing from the old buffer until it is retired.
+ */
+vk::DeviceSize ChunkStreamer::trim(uint32_t heap, vk::DeviceSize bytes) {
+    TRACE_FUNCTION();
+    if (*pool == nullptr || poolMemory.getHeap() != heap || bytes == 0) {
+        return 0;
+    }
+    uint32_t capacity = cache.getStats().capacity;
+    vk::DeviceSize slots = (bytes + CHUNK_BYTES - 1) / CHUNK_BYTES;
+    auto target = static_cast<uint32_t>(slots < capacity ? capacity - slots : 1);
+    if (target >= capacity) {
+        return 0;
+    }
+    dropLoads();
+    std::vector<ChunkCache::Move> moves;
+    uint32_t shrunk = cache.shrink(target, scheduler->completedValue(QueueType::eGraphics), moves);
+    stats.cache = cache.getStats();
+    if (shrunk >= capacity) {
+        return 0;
+    }
+
+    vk::raii::Buffer oldPool = std::move(pool);
+    DeviceAllocation oldMemory = std::move(poolMemory);
+    allocatePool(shrunk);
+    auto cmd = scheduler->allocateCommandBuffer(QueueType::eGraphics);
+    cmd.begin({.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    scheduler->recordPendingAcquires(QueueType::eGraphics, cmd);
+    // chunks that kept their slot, free slots included: cheaper than a region each
+    cmd.copyBuffer(*oldPool, *pool, vk::BufferCopy{0, 0, vk::DeviceSize{shrunk} * CHUNK_BYTES});
+    std::vector<vk::BufferCopy> regions;
+    for (auto [from, to] : moves) {
+        regions.push_back({from * CHUNK_BYTES, to * CHUNK_BYTES, CHUNK_BYTES});
+    }
+    if (!regions.empty()) {
+        // the moved chunks land on slots the first copy wrote
+        vk::MemoryBarrier2 overwrite{
+            .srcStageMask = vk::PipelineStageFlagBits2::eCopy,
+            .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eCopy,
+            .dstAccessMask = vk::AccessFlagBits2::eTransferWrite
+        };
+        cmd.pipelineBarrier2({.memoryBarrierCount = 1, .pMemoryBarriers = &overwrite});
+        cmd.copyBuffer(*oldPool, *pool, regions);
+    }
+    // the copies are in submission order before every later frame's draws
+    vk::MemoryBarrier2 barrier{
+        .srcStageMask = vk::PipelineStageFlagBits2::eCopy,
+        .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+        .dstStageMask = vk::PipelineStageFlagBits2::eVertexAttributeInput,
+        .dstAccessMask = vk::AccessFlagBits2::eVertexAttributeRead
+    };
+    cmd.pipelineBarrier2({.memoryBarrierCount = 1, .pMemoryBarriers = &barrier});
+    cmd.end();
+    vk::CommandBuffer submit = *cmd;
+    uint64_t value = scheduler->submit({.queue = QueueType::eGraphics, .commandBuffers = {&submit, 1}});
+    scheduler->retire(QueueType::eGraphics, value, std::move(oldPool));
+    scheduler->retire(QueueType::eGraphics, value, std::move(oldMemory));
+    scheduler->retire(QueueType::eGraphics, value, std::move(cmd));
+
+    std::println(
+        "World: chunk pool trimmed from {} to {} slots, {} chunks moved",
+        capacity,
+        shrunk,
+        moves.size()
+    );
+    return vk::DeviceSize{capacity - shrunk} * CHUNK_BYTES;
+}
+
+ChunkStreamer::StagingSlot* ChunkStreamer::freeStagingSlot() {
+    for (auto& slot : stagingSlots) {
+        if (slot.state == StagingSlot::State::eFree) {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+void ChunkStreamer::beginFrame(uint32_t slot, const ChunkCache::Camera& camera) {
+    TRACE_FUNCTION();
+    auto now = clock::now();
+    if (busy) {
+        stats.loadMs += std::chrono::duration<double, std::milli>(now - lastTick).count();
+    }
+    lastTick = now;
+    this->camera = camera;
+    stats.lastFrameLoads = 0;
+    if (settings.budgetMiB != poolBudgetMiB) {
+        createPool();
+    }
+    cache.settings = settings.cache;
+    cache.beginFrame();
+
+    auto transfer = [this](const StagingSlot& staged) {
+        return QueueScheduler::BufferTransfer{
+            .buffer = *pool,
+            .offset = staged.poolSlot * CHUNK_BYTES,
+            .size = CHUNK_BYTES,
+            .src = QueueType::eTransfer,
+            .dst = QueueType::eGraphics,
+            .srcStage = vk::PipelineStageFlagBits2::eCopy,
+            .srcAccess = vk::AccessFlagBits2::eTransferWrite,
+            .dstStage = vk::PipelineStageFlagBits2::eVertexAttributeInput,
+            .dstAccess = vk::AccessFlagBits2::eVertexAttributeRead
+        };
+    };
+
+    // publish what has landed; the acquire goes into this frame's submit,
+    // ahead of the draws
+    uint64_t completed = scheduler->completedValue(QueueType::eTransfer);
+    for (auto& staged : stagingSlots) {
+        if (staged.state == StagingSlot::State::eCopying && staged.value <= completed) {
+            scheduler->enqueueAcquire(transfer(staged), staged.value);
+            cache.loaded(staged.chunk);
+            staged.state = StagingSlot::State::eFree;
+        }
+    }
+
+    // copy finished reads into their pool slots
+    auto& upload = uploads[slot];
+    bool recording = false;
+    uint32_t timedScope = 0;
+    for (auto& staged : stagingSlots) {
+        if (staged.state != StagingSlot::State::eReading || upload.value > completed) {
+            continue;
+        }
+        int64_t result = staged.result.load(std::memory_order_acquire);
+        if (result == READING) {
+            continue;
+        }
+        if (result != static_cast<int64_t>(CHUNK_BYTES)) {
+            // missing or short world file: the chunk stays absent and is asked for again
+            cache.cancel(staged.chunk);
+            staged.state = StagingSlot::State::eFree;
+            stats.failedReads++;
+            continue;
+        }
+        if (!recording) {
+            upload.cmd.reset();
+            upload.cmd.begin({.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+            timedScope = scheduler->beginTimedScope(QueueType::eTransfer, upload.cmd);
+            recording = true;
+        }
+        // the slot's previous chunk was only evicted once no frame in flight drew it
+        vk::DeviceSize stagingOffset = static_cast<vk::DeviceSize>(&staged - stagingSlots.data()) * CHUNK_BYTES;
+        upload.cmd.copyBuffer(
+            *staging, *pool, vk::BufferCopy{stagingOffset, staged.poolSlot * CHUNK_BYTES, CHUNK_BYTES}
+        );
+        scheduler->recordRelease(upload.cmd, transfer(staged));
+        staged.state = StagingSlot::State::eCopying;
+        staged.value = 0;
+        stats.loadedBytes += CHUNK_BYTES;
+    }
+    if (recording) {
+        scheduler->endTimedScope(QueueType::eTransfer, upload.cmd, timedScope);
+        upload.cmd.end();
+        vk::CommandBuffer cmd = *upload.cmd;
+        upload.value = scheduler->submit({.queue = QueueType::eTransfer, .commandBuffers = {&cmd, 1}});
+        for (auto& staged : stagingSlots) {
+            if (staged.state == StagingSlot::State::eCopying && staged.value == 0) {
+                staged.value = upload.value;
+            }
+        }
+    }
+
+    // start reading what the camera needs next
+    cache.prioritize(camera);
+    uint64_t drawn = scheduler->completedValue(QueueType::eGraphics);
+    auto maxLoads = static_cast<uint32_t>(std::max<vk::DeviceSize>(settings.bytesPerFrame / CHUNK_BYTES, 1));
+    ChunkCache::Load load;
+    while (stats.lastFrameLoads < maxLoads) {
+        StagingSlot* staged = freeStagingSlot();
+        if (staged == nullptr || !cache.nextLoad(drawn, load)) {
+            break;
+        }
+        staged->state = StagingSlot::State::eReading;
+        staged->chunk = load.chunk;
+        staged->poolSlot = load.slot;
+        staged->result.store(READING, std::memory_order_relaxed);
+        std::span<uint8_t> dst{stagingMapped + (staged - stagingSlots.data()) * CHUNK_BYTES, CHUNK_BYTES};
+        io.read(path, load.chunk * CHUNK_BYTES, dst, [staged](AsyncIO::Completion& completion) {
+            staged->result.store(
+                completion.error != 0 ? -int64_t{completion.error} : static_cast<int64_t>(completion.bytes.size()),
+                std::memory_order_release
+            );
+        });
+        stats.lastFrameLoads++;
+    }
+
+    busy = std::any_of(stagingSlots.begin(), stagingSlots.end(), [](const StagingSlot& staged) {
+        return staged.state != StagingSlot::State::eFree;
+    });
+    stats.cache = cache.getStats();
+    stats.residentBytes = stats.cache.resident * CHUNK_BYTES;
+}
+
+void ChunkStreamer::addPass(RenderGraph& graph, RenderGraph::Handle target, vk::Extent2D extent) {
+    if (!ready()) {
+        return;
+    }
+    // every chunk overlapping the view, missing ones count as cache misses
+    auto [halfWidth, halfHeight] = viewHalfExtent(settings.viewRadius, extent);
+    auto range = [](float low, float high) {
+        constexpr auto COUNT = static_cast<float>(WORLD_CHUNKS);
+        return std::pair{
+            static_cast<uint32_t>(std::clamp(std::floor(low / CHUNK_SIZE), 0.f, COUNT)),
+            static_cast<uint32_t>(std::clamp(std::floor(high / CHUNK_SIZE) + 1.f, 0.f, COUNT))
+        };
+    };
+    auto [x0, x1] = range(camera.x - halfWidth, camera.x + halfWidth);
+    auto [z0, z1] = range(camera.z - halfHeight, camera.z + halfHeight);
+    drawSlots.clear();
+    stats.missing = 0;
+    for (uint32_t z = z0; z < z1; z++) {
+        for (uint32_t x = x0; x < x1; x++) {
+            uint32_t poolSlot = cache.use(cache.chunkIndex(x, z));
+            if (poolSlot != ChunkCache::NONE) {
+                drawSlots.push_back(poolSlot);
+            }
+            else {
+                stats.missing++;
+            }
+        }
+    }
+    stats.drawn = static_cast<uint32_t>(drawSlots.size());
+    stats.cache = cache.getStats();
+    if (drawSlots.empty()) {
+        return;
+    }
+
+    graph
+        .addPass(
+            "world",
+            [this, &graph, target, extent](const vk::raii::CommandBuffer& cmd) {
+                record(cmd, graph.image(target).view, extent);
+            }
+        )
+        .use(target, ResourceUsage::eColorAttachmentReadWrite);
+}
+
+void ChunkStreamer::record(
+    const vk::raii::CommandBuffer& cmd, vk::ImageView target, vk::Extent2D extent
+) const {
+    vk::RenderingAttachmentInfo attachment{
+        .imageView = target,
+        .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
+        .loadOp = vk::AttachmentLoadOp::eLoad,
+        .storeOp = vk::AttachmentStoreOp::eStore
+    };
+    cmd.beginRendering({
+        .renderArea = {.offset = {0, 0}, .extent = extent},
+        .layerCount = 1,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &attachment
+    });
+    cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, *pipeline);
+    cmd.setViewport(0, vk::Viewport{
+        .width = static_cast<float>(extent.width),
+        .height = static_cast<float>(extent.height),
+        .maxDepth = 1.0f
+    });
+    cmd.setScissor(0, vk::Rect2D{.offset = {0, 0}, .extent = extent});
+    auto [halfWidth, halfHeight] = viewHalfExtent(settings.viewRadius, extent);
+    Params params{
+        .scale = {1.f / halfWidth, 1.f / halfHeight},
+        .offset = {-camera.x / halfWidth, -camera.z / halfHeight}
+    };
+    cmd.pushConstants<Params>(*layout, vk::ShaderStageFlagBits::eVertex, 0, params);
+    cmd.bindVertexBuffers(0, *pool, {0});
+    cmd.bindIndexBuffer(*indices, 0, vk::IndexType::eUint16);
+    for (uint32_t poolSlot : drawSlots) {
+        cmd.drawIndexed(INDEX_COUNT, 1, 0, static_cast<int32_t>(poolSlot * CHUNK_VERTEX_COUNT), 0);
+    }
+    cmd.endRendering();
+}
+
+void ChunkStreamer::submitted(uint64_t value) {
+    cache.submitted(value);
+}
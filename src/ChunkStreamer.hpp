@@ -0,0 +1,187 @@
+#ifndef CHUNKSTREAMER_HPP
+#define CHUNKSTREAMER_HPP
+
+// c++ std libs
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <span>
+#include <string>
+#include <vector>
+
+// vulkan-hpp headers
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "AsyncIO.hpp"
+#include "ChunkCache.hpp"
+#include "DeviceProfile.hpp"
+#include "MemoryBudget.hpp"
+#include "QueueScheduler.hpp"
+#include "RenderGraph.hpp"
+#include "utils.hpp"
+
+/*
+ * A terrain far larger than the memory it may use on the GPU: a grid of
+ * WORLD_CHUNKS x WORLD_CHUNKS heightfield chunks in one file, drawn from
+ * above. The GPU side is a single vertex buffer cut into chunk-sized slots,
+ * as many as fit the memory budget; ChunkCache decides which chunk lives in
+ * which slot.
+ *
+ * Every frame beginFrame() asks the cache for the chunks missing around the
+ * camera (nearest first, favouring the direction of travel) and reads them
+ * with AsyncIO straight into mapped staging slots, at most `bytesPerFrame` a
+ * frame. Finished reads are copied into their pool slot on the transfer
+ * queue and handed to the graphics queue once that transfer has completed.
+ * addPass() draws the resident chunks in view; missing ones are left out.
+ * Under memory pressure trim() shrinks the pool, keeping the chunks that
+ * were used most recently.
+ *
+ *     ChunkStreamer::generate(path);          // once, writes the world file
+ *     streamer.init(..., path);
+ *     streamer.beginFrame(frameIndex, camera); // after the frame's fence wait
+ *     streamer.addPass(renderGraph, target, extent);
+ *     streamer.submitted(submitValue);        // the frame's graphics submit
+ */
+class ChunkStreamer {
+public:
+    static constexpr uint32_t WORLD_CHUNKS = 32;    // per side
+    static constexpr uint32_t CHUNK_VERTICES = 64;  // per side, neighbours share their edge
+    static constexpr float CHUNK_SIZE = 64.f;       // world units
+    static constexpr uint32_t STAGING_SLOTS = 32;   // reads in flight
+
+    // must match shaders/world.hlsl
+    struct Vertex {
+        float x, y, z;
+        uint32_t color;  // R8G8B8A8, linear
+    };
+    static constexpr vk::DeviceSize CHUNK_BYTES =
+        vk::DeviceSize{CHUNK_VERTICES} * CHUNK_VERTICES * sizeof(Vertex);
+
+    struct Settings {
+        // of the chunk pool, capped by init(); trim() may keep the pool below it
+        uint32_t budgetMiB = 8;
+        vk::DeviceSize bytesPerFrame = 1ull << 20;
+        float viewRadius = 160.f;  // half the height of the view, world units
+        ChunkCache::Settings cache;
+    };
+
+    struct Stats {
+        ChunkCache::Stats cache;
+        vk::DeviceSize budgetBytes = 0;
+        vk::DeviceSize residentBytes = 0;
+        vk::DeviceSize loadedBytes = 0;
+        double loadMs = 0;  // wall time with reads or copies in flight
+        uint32_t lastFrameLoads = 0;
+        uint32_t drawn = 0;
+        uint32_t missing = 0;  // in view but not resident
+        uint64_t failedReads = 0;
+
+        double bandwidthMiBs() const {
+            return loadMs > 0 ? loadedBytes / double(1 << 20) / (loadMs / 1000.0) : 0.0;
+        }
+    };
+
+private:
+    using clock = std::chrono::steady_clock;
+    // not a valid byte count or -errno
+    static constexpr int64_t READING = std::numeric_limits<int64_t>::min();
+
+    struct StagingSlot {
+        enum class State : uint8_t {
+            eFree,
+            eReading,
+            eCopying,
+        };
+        State state = State::eFree;
+        uint32_t chunk = ChunkCache::NONE;
+        uint32_t poolSlot = ChunkCache::NONE;
+        uint64_t value = 0;  // transfer timeline value of the copy
+        // written by the I/O thread: bytes read, -errno, or READING
+        std::atomic<int64_t> result = READING;
+    };
+    struct Upload {
+        vk::raii::CommandBuffer cmd = nullptr;
+        uint64_t value = 0;  // transfer timeline value of the last use
+    };
+
+    const DeviceProfile* profile = nullptr;
+    const vk::raii::Device* device = nullptr;
+    MemoryBudget* budget = nullptr;
+    QueueScheduler* scheduler = nullptr;
+    vk::raii::PipelineLayout layout = nullptr;
+    vk::raii::Pipeline pipeline = nullptr;
+    std::string path;
+
+    vk::raii::Buffer pool = nullptr;
+    DeviceAllocation poolMemory = nullptr;
+    uint32_t poolBudgetMiB = 0;
+    vk::raii::Buffer indices = nullptr;
+    DeviceAllocation indexMemory = nullptr;
+    vk::raii::Buffer staging = nullptr;
+    DeviceAllocation stagingMemory = nullptr;
+    uint8_t* stagingMapped = nullptr;
+    std::array<StagingSlot, STAGING_SLOTS> stagingSlots;
+    std::vector<Upload> uploads;
+    // reads into `staging` and `stagingSlots`: declared after them so its
+    // threads drain and stop first
+    AsyncIO io;
+
+    ChunkCache cache;
+    ChunkCache::Camera camera;
+    std::vector<uint32_t> drawSlots;
+    Stats stats;
+    clock::time_point lastTick;
+    bool busy = false;  // reads or copies in flight since lastTick
+
+    vk::DeviceSize maxPoolBytes() const;
+    void createPool();
+    void allocatePool(uint32_t capacity);
+    void dropLoads();
+    StagingSlot* freeStagingSlot();
+    void record(const vk::raii::CommandBuffer& cmd, vk::ImageView target, vk::Extent2D extent) const;
+
+public:
+    Settings settings;
+
+    ChunkStreamer() = default;
+    DISABLE_COPY(ChunkStreamer)
+
+    // Writes the procedural world to `path` unless a file of the right size is there.
+    static void generate(const std::filesystem::path& path);
+
+    void init(
+        const DeviceProfile& profile,
+        const vk::raii::Device& device,
+        MemoryBudget& budget,
+        QueueScheduler& scheduler,
+        uint32_t framesInFlight,
+        std::span<const char> spv,
+        vk::Format colorFormat,
+        const std::filesystem::path& path
+    );
+    bool ready() const {
+        return *pipeline != nullptr;
+    }
+
+    // Call once the fence of `slot` has been waited on: publishes chunks that
+    // have landed, copies finished reads and starts the next ones.
+    void beginFrame(uint32_t slot, const ChunkCache::Camera& camera);
+    // Draw the resident chunks around the camera over `target` (loaded).
+    void addPass(RenderGraph& graph, RenderGraph::Handle target, vk::Extent2D extent);
+    // The graphics submit of the frame addPass() was called for.
+    void submitted(uint64_t value);
+    // Memory pressure on `heap`: shrinks the pool by at least `bytes` if it
+    // lives there, as far as the chunks drawn by frames in flight allow.
+    // Returns what the pool gave up, freed once those frames are done.
+    vk::DeviceSize trim(uint32_t heap, vk::DeviceSize bytes);
+
+    const Stats& getStats() const {
+        return stats;
+    }
+};
+
+#endif  // CHUNKSTREAMER_HPP
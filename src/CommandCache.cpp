@@ -0,0 +1,52 @@
+#include "CommandCache.hpp"
+
+// std c++
+#include <chrono>
+#include <utility>
+
+// vulkan
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+void CommandCache::init(const vk::raii::Device& device, uint32_t queueFamily, uint32_t framesInFlight) {
+    pool = vk::raii::CommandPool(device, vk::CommandPoolCreateInfo{
+        .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+        .queueFamilyIndex = queueFamily
+    });
+    vk::raii::CommandBuffers buffers(device, vk::CommandBufferAllocateInfo{
+        .commandPool = *pool,
+        .level = vk::CommandBufferLevel::eSecondary,
+        .commandBufferCount = framesInFlight
+    });
+    slots.clear();
+    for (auto& buffer : buffers) {
+        slots.push_back({.cmd = std::move(buffer)});
+    }
+}
+
+void CommandCache::invalidate() {
+    for (auto& slot : slots) {
+        slot.valid = false;
+    }
+}
+
+void CommandCache::beginRecording(Slot& slot, vk::Format colorFormat) {
+    vk::CommandBufferInheritanceRenderingInfo rendering{
+        .colorAttachmentCount = 1,
+        .pColorAttachmentFormats = &colorFormat,
+        .rasterizationSamples = vk::SampleCountFlagBits::e1
+    };
+    vk::CommandBufferInheritanceInfo inheritance{.pNext = &rendering};
+    slot.cmd.reset();
+    slot.cmd.begin({
+        .flags = vk::CommandBufferUsageFlagBits::eRenderPassContinue,
+        .pInheritanceInfo = &inheritance
+    });
+}
+
+void CommandCache::endRecording(Slot& slot, clock::time_point start) {
+    slot.cmd.end();
+    slot.valid = true;
+    stats.recordCount++;
+    stats.lastRecordUs = std::chrono::duration<double, std::micro>(clock::now() - start).count();
+}
@@ -0,0 +1,84 @@
+#ifndef COMMANDCACHE_HPP
+#define COMMANDCACHE_HPP
+
+// c++ std libs
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// vulkan-hpp headers
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "Trace.hpp"
+#include "utils.hpp"
+
+/*
+ * Secondary command buffers for draws that rarely change, recorded once and
+ * executed every frame. There is one buffer per frame in flight, so a stale
+ * one can be re-recorded as soon as its frame's fence has been waited on,
+ * without SIMULTANEOUS_USE. The owner decides what invalidates the contents
+ * (pipelines, viewport, scene edits) and calls invalidate(); get() then
+ * re-records each slot the next time it comes around.
+ *
+ * The contents run inside dynamic rendering begun with
+ * eContentsSecondaryCommandBuffers and a single color attachment of the
+ * format given to get(). Dynamic state isn't inherited, so the callback must
+ * set viewport & co itself.
+ *
+ *     if (key != lastKey) cache.invalidate();
+ *     beginRendering(..., vk::RenderingFlagBits::eContentsSecondaryCommandBuffers);
+ *     cmd.executeCommands(cache.get(frameIndex, format, [&](const vk::raii::CommandBuffer& secondary) {
+ *         ...draws...
+ *     }));
+ */
+class CommandCache {
+public:
+    struct Stats {
+        uint32_t recordCount = 0;  // re-recordings since init
+        double lastRecordUs = 0;   // CPU time of the latest one
+    };
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct Slot {
+        vk::raii::CommandBuffer cmd = nullptr;
+        bool valid = false;
+    };
+
+    vk::raii::CommandPool pool = nullptr;
+    std::vector<Slot> slots;
+    Stats stats;
+
+    void beginRecording(Slot& slot, vk::Format colorFormat);
+    void endRecording(Slot& slot, clock::time_point start);
+
+public:
+    CommandCache() = default;
+    DISABLE_COPY(CommandCache)
+
+    void init(const vk::raii::Device& device, uint32_t queueFamily, uint32_t framesInFlight);
+    void invalidate();
+
+    // The slot's buffer, recorded with `record(const vk::raii::CommandBuffer&)`
+    // first when stale. The frame that last executed it must have completed.
+    template <class Record>
+    vk::CommandBuffer get(uint32_t slot, vk::Format colorFormat, Record&& record) {
+        Slot& entry = slots[slot];
+        if (!entry.valid) {
+            TRACE_ZONE("record cached commands");
+            auto start = clock::now();
+            beginRecording(entry, colorFormat);
+            record(entry.cmd);
+            endRecording(entry, start);
+        }
+        return *entry.cmd;
+    }
+
+    const Stats& getStats() const {
+        return stats;
+    }
+};
+
+#endif  // COMMANDCACHE_HPP
@@ -0,0 +1,245 @@
+#include "DeviceProfile.hpp"
+
+// std c++
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <print>
+#include <stdexcept>
+
+// vulkan
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace {
+
+constexpr const char* DEVICE_ENV = "LEARN_VULKAN_DEVICE";
+
+int64_t deviceTypeScore(vk::PhysicalDeviceType type) {
+    switch (type) {
+        case vk::PhysicalDeviceType::eDiscreteGpu:
+            return 10000;
+        case vk::PhysicalDeviceType::eIntegratedGpu:
+            return 5000;
+        case vk::PhysicalDeviceType::eVirtualGpu:
+            return 2000;
+        case vk::PhysicalDeviceType::eCpu:
+            return 100;
+        default:
+            return 0;
+    }
+}
+
+bool containsIgnoreCase(std::string_view haystack, std::string_view needle) {
+    auto it = std::search(
+        haystack.begin(), haystack.end(), needle.begin(), needle.end(), [](char a, char b) {
+            return std::tolower(static_cast<unsigned char>(a)) ==
+                   std::tolower(static_cast<unsigned char>(b));
+        }
+    );
+    return it != haystack.end();
+}
+
+void queryFeatures(DeviceProfile& profile) {
+    auto chain = profile.device.getFeatures2<
+        vk::PhysicalDeviceFeatures2,
+        vk::PhysicalDeviceVulkan11Features,
+        vk::PhysicalDeviceVulkan12Features,
+        vk::PhysicalDeviceVulkan13Features,
+        vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT,
+        vk::PhysicalDeviceShaderObjectFeaturesEXT,
+        vk::PhysicalDevicePresentIdFeaturesKHR,
+        vk::PhysicalDevicePresentWaitFeaturesKHR>();
+    const auto& core = chain.get<vk::PhysicalDeviceFeatures2>().features;
+    const auto& v11 = chain.get<vk::PhysicalDeviceVulkan11Features>();
+    const auto& v12 = chain.get<vk::PhysicalDeviceVulkan12Features>();
+    const auto& v13 = chain.get<vk::PhysicalDeviceVulkan13Features>();
+    auto& f = profile.features;
+    f.shaderDrawParameters = v11.shaderDrawParameters;
+    f.hostQueryReset = v12.hostQueryReset;
+    f.timelineSemaphore = v12.timelineSemaphore;
+    f.synchronization2 = v13.synchronization2;
+    f.dynamicRendering = v13.dynamicRendering;
+    f.extendedDynamicState =
+        chain.get<vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT>().extendedDynamicState;
+    f.samplerAnisotropy = core.samplerAnisotropy;
+    f.timestampComputeAndGraphics = profile.properties.limits.timestampComputeAndGraphics;
+    f.fillModeNonSolid = core.fillModeNonSolid;
+    f.shaderObject = profile.hasExtension(vk::EXTShaderObjectExtensionName) &&
+                     chain.get<vk::PhysicalDeviceShaderObjectFeaturesEXT>().shaderObject;
+    f.presentWait = profile.hasExtension(vk::KHRPresentIdExtensionName) &&
+                    profile.hasExtension(vk::KHRPresentWaitExtensionName) &&
+                    chain.get<vk::PhysicalDevicePresentIdFeaturesKHR>().presentId &&
+                    chain.get<vk::PhysicalDevicePresentWaitFeaturesKHR>().presentWait;
+    if (profile.hasExtension(vk::EXTCalibratedTimestampsExtensionName)) {
+        auto domains = profile.device.getCalibrateableTimeDomainsEXT();
+        auto has = [&](vk::TimeDomainEXT domain) {
+            return std::find(domains.begin(), domains.end(), domain) != domains.end();
+        };
+        f.calibratedTimestamps = has(vk::TimeDomainEXT::eDevice) && has(vk::TimeDomainEXT::eClockMonotonic);
+    }
+}
+
+void queryQueues(DeviceProfile& profile, const vk::raii::SurfaceKHR& surface) {
+    for (uint32_t i = 0; i < profile.queueFamilies.size(); i++) {
+        auto flags = profile.queueFamilies[i].queueFlags;
+        if (profile.graphicsPresentFamily == ~0u &&
+            (flags & vk::QueueFlagBits::eGraphics) &&
+            profile.device.getSurfaceSupportKHR(i, *surface)) {
+            profile.graphicsPresentFamily = i;
+        }
+        if ((flags & vk::QueueFlagBits::eCompute) && !(flags & vk::QueueFlagBits::eGraphics)) {
+            profile.hasDedicatedCompute = true;
+        }
+        if ((flags & vk::QueueFlagBits::eTransfer) &&
+            !(flags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute))) {
+            profile.hasDedicatedTransfer = true;
+        }
+    }
+}
+
+std::string checkSuitable(
+    const DeviceProfile& profile, std::span<const char* const> requiredExtensions
+) {
+    if (profile.properties.apiVersion < VK_API_VERSION_1_3) {
+        return "no Vulkan 1.3";
+    }
+    if (profile.graphicsPresentFamily == ~0u) {
+        return "no graphics+present queue";
+    }
+    for (const char* extension : requiredExtensions) {
+        if (!profile.hasExtension(extension)) {
+            return std::format("missing {}", extension);
+        }
+    }
+    const auto& f = profile.features;
+    if (!(f.shaderDrawParameters && f.hostQueryReset && f.timelineSemaphore &&
+          f.synchronization2 && f.dynamicRendering && f.extendedDynamicState)) {
+        return "missing required features";
+    }
+    return {};
+}
+
+int64_t scoreProfile(const DeviceProfile& profile) {
+    int64_t score = deviceTypeScore(profile.properties.deviceType);
+    // 10 points per GiB of device local memory, capped so it can't outweigh the type
+    score += std::min<int64_t>(profile.deviceLocalBytes >> 30, 64) * 10;
+    score += profile.hasDedicatedCompute ? 200 : 0;
+    score += profile.hasDedicatedTransfer ? 200 : 0;
+    score += profile.features.samplerAnisotropy ? 50 : 0;
+    score += profile.features.timestampComputeAndGraphics ? 50 : 0;
+    return score;
+}
+
+}  // namespace
+
+bool DeviceProfile::hasExtension(std::string_view extension) const {
+    for (const auto& e : extensions) {
+        if (extension == e.extensionName.data()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<DeviceProfile> enumerateDeviceProfiles(
+    const vk::raii::Instance& instance,
+    const vk::raii::SurfaceKHR& surface,
+    std::span<const char* const> requiredExtensions
+) {
+    std::vector<DeviceProfile> profiles;
+    uint32_t index = 0;
+    for (auto& device : instance.enumeratePhysicalDevices()) {
+        DeviceProfile profile;
+        profile.device = std::move(device);
+        profile.enumerationIndex = index++;
+        profile.properties = profile.device.getProperties();
+        profile.memory = profile.device.getMemoryProperties();
+        profile.queueFamilies = profile.device.getQueueFamilyProperties();
+        profile.extensions = profile.device.enumerateDeviceExtensionProperties();
+        queryFeatures(profile);
+        queryQueues(profile, surface);
+
+        for (uint32_t i = 0; i < profile.memory.memoryHeapCount; i++) {
+            const auto& heap = profile.memory.memoryHeaps[i];
+            if (heap.flags & vk::MemoryHeapFlagBits::eDeviceLocal) {
+                profile.deviceLocalBytes += heap.size;
+            }
+        }
+
+        profile.rejectReason = checkSuitable(profile, requiredExtensions);
+        profile.suitable = profile.rejectReason.empty();
+        profile.score = profile.suitable ? scoreProfile(profile) : -1;
+        profiles.push_back(std::move(profile));
+    }
+    return profiles;
+}
+
+DeviceProfile selectDeviceProfile(std::vector<DeviceProfile>&& profiles, std::string_view override) {
+    for (const auto& p : profiles) {
+        std::println(
+            "  [{}] {} ({}, {} MiB local): {}",
+            p.enumerationIndex,
+            p.name(),
+            vk::to_string(p.properties.deviceType),
+            p.deviceLocalBytes >> 20,
+            p.suitable ? std::format("score {}", p.score) : p.rejectReason
+        );
+    }
+
+    if (override.empty()) {
+        const char* env = std::getenv(DEVICE_ENV);
+        override = env != nullptr ? env : "";
+    }
+
+    DeviceProfile* selected = nullptr;
+    if (!override.empty()) {
+        uint32_t index = ~0u;
+        auto [end, ec] = std::from_chars(override.data(), override.data() + override.size(), index);
+        bool isIndex = ec == std::errc() && end == override.data() + override.size();
+        for (auto& p : profiles) {
+            if (isIndex ? p.enumerationIndex == index : containsIgnoreCase(p.name(), override)) {
+                selected = &p;
+                break;
+            }
+        }
+        if (selected == nullptr) {
+            throw std::runtime_error(std::format("requested device '{}' not found", override));
+        }
+        if (!selected->suitable) {
+            throw std::runtime_error(std::format(
+                "requested device '{}' is not suitable: {}", selected->name(), selected->rejectReason
+            ));
+        }
+    }
+    else {
+        for (auto& p : profiles) {
+            if (p.suitable && (selected == nullptr || p.score > selected->score)) {
+                selected = &p;
+            }
+        }
+        if (selected == nullptr) {
+            throw std::runtime_error("failed to find a suitable GPU!");
+        }
+    }
+
+    std::println("Device: {}", selected->name());
+    return std::move(*selected);
+}
+
+uint32_t findMemoryType(
+    const vk::PhysicalDeviceMemoryProperties& memProperties,
+    uint32_t typeFilter,
+    vk::MemoryPropertyFlags properties
+) {
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("failed to find suitable memory type!");
+}
@@ -0,0 +1,83 @@
+#ifndef DEVICEPROFILE_HPP
+#define DEVICEPROFILE_HPP
+
+// c++ std libs
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// vulkan-hpp headers
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+/*
+ * Everything the engine needs to know about a physical device, queried once
+ * at startup. Use this instead of calling getProperties() & co. again.
+ */
+struct DeviceProfile {
+    struct Features {
+        bool shaderDrawParameters = false;
+        bool hostQueryReset = false;
+        bool timelineSemaphore = false;
+        bool synchronization2 = false;
+        bool dynamicRendering = false;
+        bool extendedDynamicState = false;
+        // optional
+        bool samplerAnisotropy = false;
+        bool timestampComputeAndGraphics = false;
+        bool fillModeNonSolid = false;
+        bool shaderObject = false;  // VK_EXT_shader_object
+        bool presentWait = false;   // VK_KHR_present_id + VK_KHR_present_wait
+        // VK_EXT_calibrated_timestamps with the device and CLOCK_MONOTONIC domains
+        bool calibratedTimestamps = false;
+    };
+
+    vk::raii::PhysicalDevice device = nullptr;
+    uint32_t enumerationIndex = 0;
+    vk::PhysicalDeviceProperties properties;
+    vk::PhysicalDeviceMemoryProperties memory;
+    std::vector<vk::QueueFamilyProperties> queueFamilies;
+    std::vector<vk::ExtensionProperties> extensions;
+    Features features;
+    // first family with graphics and present support, ~0 if none
+    uint32_t graphicsPresentFamily = ~0u;
+    bool hasDedicatedCompute = false;
+    bool hasDedicatedTransfer = false;
+    vk::DeviceSize deviceLocalBytes = 0;
+
+    bool suitable = false;
+    std::string rejectReason;
+    int64_t score = 0;
+
+    std::string_view name() const {
+        return properties.deviceName.data();
+    }
+    bool hasExtension(std::string_view extension) const;
+};
+
+/*
+ * Query every physical device once and score it. Unsuitable devices are kept
+ * in the list with `rejectReason` set so they show up in the report.
+ */
+std::vector<DeviceProfile> enumerateDeviceProfiles(
+    const vk::raii::Instance& instance,
+    const vk::raii::SurfaceKHR& surface,
+    std::span<const char* const> requiredExtensions
+);
+
+/*
+ * Pick the highest scoring suitable device. `override` (an enumeration index
+ * or a case-insensitive substring of the device name) takes precedence; when
+ * empty the LEARN_VULKAN_DEVICE environment variable is consulted.
+ */
+DeviceProfile selectDeviceProfile(std::vector<DeviceProfile>&& profiles, std::string_view override);
+
+uint32_t findMemoryType(
+    const vk::PhysicalDeviceMemoryProperties& memProperties,
+    uint32_t typeFilter,
+    vk::MemoryPropertyFlags properties
+);
+
+#endif  // DEVICEPROFILE_HPP
@@ -0,0 +1,34 @@
+#include "DynamicResolution.hpp"
+
+// std c++
+#include <algorithm>
+#include <cmath>
+
+float DynamicResolution::update(double gpuMs) {
+    if (gpuMs <= 0) {
+        return scale();
+    }
+    smoothedMs = smoothedMs > 0 ? smoothedMs + (gpuMs - smoothedMs) * settings.smoothing : gpuMs;
+    if (!settings.enabled) {
+        currentScale = settings.maxScale;
+        return scale();
+    }
+
+    bool overBudget = smoothedMs > settings.targetMs;
+    bool hasHeadroom = smoothedMs < settings.targetMs * settings.headroom;
+    if (overBudget || hasHeadroom) {
+        // smoothedMs was measured at currentScale; aim for the scale that hits the target
+        float desired = currentScale * static_cast<float>(std::sqrt(settings.targetMs / smoothedMs));
+        float step = std::clamp(desired - currentScale, -settings.maxStep, settings.maxStep);
+        currentScale = std::clamp(currentScale + step, settings.minScale, settings.maxScale);
+    }
+    return scale();
+}
+
+vk::Extent2D DynamicResolution::renderExtent(vk::Extent2D full) const {
+    auto scaled = [s = scale()](uint32_t size) {
+        auto pixels = static_cast<uint32_t>(std::lround(size * s)) & ~1u;
+        return std::max(1u, std::min(pixels, size));
+    };
+    return {scaled(full.width), scaled(full.height)};
+}
@@ -0,0 +1,49 @@
+#ifndef DYNAMICRESOLUTION_HPP
+#define DYNAMICRESOLUTION_HPP
+
+// c++ std libs
+#include <cstdint>
+
+// vulkan-hpp headers
+#include <vulkan/vulkan.hpp>
+
+/*
+ * Picks the scene's render resolution each frame so the measured GPU frame
+ * time stays under a budget. GPU cost is assumed to scale with pixel count,
+ * i.e. with scale^2, so the correction is sqrt(target / measured). The
+ * measurement is smoothed and the step per frame is capped because samples
+ * arrive a few frames late; scaling back up only starts once there is some
+ * headroom, which keeps the scale from oscillating around the target.
+ */
+class DynamicResolution {
+public:
+    struct Settings {
+        bool enabled = true;
+        float targetMs = 1000.f / 60.f;
+        float minScale = 0.5f;
+        float maxScale = 1.f;
+        float maxStep = 0.05f;    // per update
+        float headroom = 0.85f;   // only scale up below targetMs * headroom
+        float smoothing = 0.2f;   // EMA weight of a new sample
+    };
+
+private:
+    float currentScale = 1.f;
+    double smoothedMs = 0;
+
+public:
+    Settings settings;
+
+    // Feed the latest GPU frame time; returns the scale to render the next frame at.
+    float update(double gpuMs);
+    float scale() const {
+        return settings.enabled ? currentScale : 1.f;
+    }
+    double smoothedGpuMs() const {
+        return smoothedMs;
+    }
+    // `full` scaled and rounded to even pixels, never zero or larger than `full`.
+    vk::Extent2D renderExtent(vk::Extent2D full) const;
+};
+
+#endif  // DYNAMICRESOLUTION_HPP
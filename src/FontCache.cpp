@@ -0,0 +1,234 @@
+#include "FontCache.hpp"
+
+// std c++
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <print>
+#include <stdexcept>
+#include <system_error>
+
+namespace {
+
+constexpr uint32_t CACHE_MAGIC = 0x4346564c;  // "LVFC"
+constexpr uint32_t CACHE_VERSION = 1;
+
+uint64_t fnv1a(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ull) {
+    auto bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+template <class T>
+uint64_t hashValue(uint64_t hash, const T& value) {
+    return fnv1a(&value, sizeof(value), hash);
+}
+
+}  // namespace
+
+size_t FontCache::GlyphKeyHash::operator()(const GlyphKey& key) const {
+    uint64_t hash = hashValue(0xcbf29ce484222325ull, std::bit_cast<uint32_t>(key.size));
+    hash = hashValue(hash, std::bit_cast<uint32_t>(key.density));
+    return hashValue(hash, key.codepoint);
+}
+
+FontCache::FontCache(std::filesystem::path directory) : directory(std::move(directory)) {
+    const ImFontLoader* stb = ImFontAtlasGetFontLoaderForStbTruetype();
+    static_cast<ImFontLoader&>(fontLoader) = *stb;
+    fontLoader.Name = "stb_truetype (cached)";
+    fontLoader.FontBakedLoadGlyph = loadGlyph;
+    fontLoader.cache = this;
+}
+
+void FontCache::open(std::span<const char> ttf, const ImFontConfig& config) {
+    key = fnv1a(ttf.data(), ttf.size());
+    key = hashValue(key, CACHE_VERSION);
+    key = hashValue(key, config.SizePixels);
+    key = hashValue(key, config.OversampleH);
+    key = hashValue(key, config.OversampleV);
+    key = hashValue(key, config.RasterizerDensity);
+    key = hashValue(key, config.PixelSnapH);
+    key = hashValue(key, config.PixelSnapV);
+    key = hashValue(key, config.GlyphOffset.x);
+    key = hashValue(key, config.GlyphOffset.y);
+    path = directory / std::format("{:016x}.bin", key);
+
+    entries.clear();
+    newPixels.clear();
+    newCount = 0;
+    filePixels = nullptr;
+    stats = {};
+    if (!file.open(path)) {
+        return;
+    }
+
+    // anything that doesn't add up is treated as a miss and rewritten on save()
+    auto bytes = file.bytes();
+    FileHeader header;
+    if (bytes.size() < sizeof(header)) {
+        file.close();
+        return;
+    }
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    size_t recordBytes = size_t(header.glyphCount) * sizeof(GlyphRecord);
+    if (header.magic != CACHE_MAGIC || header.version != CACHE_VERSION || header.key != key ||
+        bytes.size() != sizeof(header) + recordBytes + header.pixelBytes) {
+        file.close();
+        return;
+    }
+    filePixels = bytes.data() + sizeof(header) + recordBytes;
+    for (uint32_t i = 0; i < header.glyphCount; i++) {
+        GlyphRecord record;
+        std::memcpy(&record, bytes.data() + sizeof(header) + i * sizeof(GlyphRecord), sizeof(record));
+        if (size_t(record.pixelOffset) + size_t(record.width) * record.height > header.pixelBytes) {
+            continue;
+        }
+        entries[{record.size, record.density, record.codepoint}] = {record, true};
+    }
+}
+
+bool FontCache::loadGlyph(
+    ImFontAtlas* atlas,
+    ImFontConfig* src,
+    ImFontBaked* baked,
+    void* loaderData,
+    ImWchar codepoint,
+    ImFontGlyph* outGlyph,
+    float* outAdvanceX
+) {
+    FontCache* cache = static_cast<const Loader*>(src->FontLoader)->cache;
+    auto it = cache->entries.find({baked->Size, baked->RasterizerDensity, codepoint});
+    if (it != cache->entries.end()) {
+        if (outAdvanceX != nullptr) {
+            *outAdvanceX = it->second.record.advanceX;
+            return true;
+        }
+        if (cache->loadCached(atlas, src, baked, it->second, outGlyph)) {
+            cache->stats.hits++;
+            return true;
+        }
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    const ImFontLoader* stb = ImFontAtlasGetFontLoaderForStbTruetype();
+    bool loaded = stb->FontBakedLoadGlyph(atlas, src, baked, loaderData, codepoint, outGlyph, outAdvanceX);
+    if (loaded && outGlyph != nullptr) {
+        cache->capture(atlas, baked, *outGlyph);
+        cache->stats.misses++;
+        cache->stats.missMs +=
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    }
+    return loaded;
+}
+
+bool FontCache::loadCached(
+    ImFontAtlas* atlas, ImFontConfig* src, ImFontBaked* baked, const Entry& entry, ImFontGlyph* outGlyph
+) {
+    const GlyphRecord& record = entry.record;
+    outGlyph->Codepoint = record.codepoint;
+    outGlyph->AdvanceX = record.advanceX;
+    if (record.width == 0) {
+        return true;
+    }
+
+    ImFontAtlasRectId packId = ImFontAtlasPackAddRect(atlas, record.width, record.height);
+    if (packId == ImFontAtlasRectId_Invalid) {
+        return false;
+    }
+    ImTextureRect* rect = ImFontAtlasPackGetRect(atlas, packId);
+    const uint8_t* pixels = (entry.inFile ? filePixels : newPixels.data()) + record.pixelOffset;
+    outGlyph->X0 = record.x0;
+    outGlyph->Y0 = record.y0;
+    outGlyph->X1 = record.x1;
+    outGlyph->Y1 = record.y1;
+    outGlyph->Visible = true;
+    outGlyph->PackId = packId;
+    ImFontAtlasBakedSetFontGlyphBitmap(
+        atlas, baked, src, outGlyph, rect, pixels, ImTextureFormat_Alpha8, record.width
+    );
+    return true;
+}
+
+void FontCache::capture(ImFontAtlas* atlas, const ImFontBaked* baked, const ImFontGlyph& glyph) {
+    GlyphRecord record{
+        .size = baked->Size,
+        .density = baked->RasterizerDensity,
+        .codepoint = glyph.Codepoint,
+        .advanceX = glyph.AdvanceX,
+        .x0 = glyph.X0,
+        .y0 = glyph.Y0,
+        .x1 = glyph.X1,
+        .y1 = glyph.Y1,
+        .width = 0,
+        .height = 0,
+        .pixelOffset = static_cast<uint32_t>(newPixels.size()),
+    };
+    if (glyph.Visible) {
+        // read the bitmap stb just wrote back out of the atlas texture
+        const ImTextureRect* rect = ImFontAtlasPackGetRect(atlas, glyph.PackId);
+        ImTextureData* tex = atlas->TexData;
+        record.width = rect->w;
+        record.height = rect->h;
+        for (int y = 0; y < rect->h; y++) {
+            auto row = static_cast<const uint8_t*>(tex->GetPixelsAt(rect->x, rect->y + y));
+            for (int x = 0; x < rect->w; x++) {
+                // RGBA32 atlases store coverage in alpha
+                newPixels.push_back(tex->Format == ImTextureFormat_RGBA32 ? row[x * 4 + 3] : row[x]);
+            }
+        }
+    }
+    entries[{record.size, record.density, record.codepoint}] = {record, false};
+    newCount++;
+}
+
+void FontCache::save() {
+    if (newCount == 0 || path.empty()) {
+        return;
+    }
+
+    std::vector<GlyphRecord> records;
+    std::vector<uint8_t> pixels;
+    records.reserve(entries.size());
+    for (const auto& [_, entry] : entries) {
+        GlyphRecord record = entry.record;
+        const uint8_t* from = (entry.inFile ? filePixels : newPixels.data()) + record.pixelOffset;
+        record.pixelOffset = static_cast<uint32_t>(pixels.size());
+        pixels.insert(pixels.end(), from, from + size_t(record.width) * record.height);
+        records.push_back(record);
+    }
+    FileHeader header{
+        .magic = CACHE_MAGIC,
+        .version = CACHE_VERSION,
+        .key = key,
+        .glyphCount = static_cast<uint32_t>(records.size()),
+        .pixelBytes = static_cast<uint32_t>(pixels.size()),
+    };
+
+    // write then rename so a crash never leaves a truncated cache behind, and
+    // the current mapping keeps pointing at the old (unlinked) file
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    std::filesystem::path tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            std::println("Font cache: failed to write {}", tmp.string());
+            return;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(GlyphRecord));
+        out.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+    }
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        std::println("Font cache: failed to replace {}: {}", path.string(), ec.message());
+        return;
+    }
+    std::println("Font cache: saved {} glyphs ({} new) to {}", records.size(), newCount, path.string());
+    newCount = 0;
+}
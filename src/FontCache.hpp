@@ -0,0 +1,115 @@
+#ifndef FONTCACHE_HPP
+#define FONTCACHE_HPP
+
+// c++ std libs
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+// imgui
+#include <imgui.h>
+#include <imgui_internal.h>
+
+#include "MappedFile.hpp"
+#include "utils.hpp"
+
+/*
+ * Disk cache for rasterized ImGui glyphs. ImGui 1.92 bakes glyphs lazily per
+ * (size, density), so instead of a single atlas image the cache stores every
+ * glyph bitmap and its metrics, keyed by baked size, rasterizer density and
+ * codepoint. The file itself is keyed by a hash of the TTF data and the
+ * ImFontConfig settings that affect rasterization (size, oversampling,
+ * RasterizerDensity, pixel snapping), so editing any of them starts a new
+ * file. Cached glyphs are copied straight from the mmapped file into the
+ * atlas; misses fall through to stb_truetype and are appended on save().
+ *
+ * Set the loader on the ImFontConfig before adding the font:
+ *     cache.open(ttf, cfg); cfg.FontLoader = cache.loader();
+ */
+class FontCache {
+public:
+    struct Stats {
+        uint32_t hits = 0;
+        uint32_t misses = 0;
+        double missMs = 0;  // time spent in stb_truetype
+    };
+
+    // on-disk layout: FileHeader, GlyphRecord[glyphCount], alpha8 pixels
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint32_t glyphCount;
+        uint32_t pixelBytes;
+    };
+    struct GlyphRecord {
+        float size;
+        float density;
+        uint32_t codepoint;
+        float advanceX;
+        float x0, y0, x1, y1;
+        uint16_t width;  // 0 for invisible glyphs
+        uint16_t height;
+        uint32_t pixelOffset;
+    };
+
+private:
+    struct GlyphKey {
+        float size;
+        float density;
+        uint32_t codepoint;
+        bool operator==(const GlyphKey&) const = default;
+    };
+    struct GlyphKeyHash {
+        size_t operator()(const GlyphKey& key) const;
+    };
+    struct Entry {
+        GlyphRecord record;
+        bool inFile;  // pixels live in the mapping rather than newPixels
+    };
+    struct Loader : ImFontLoader {
+        FontCache* cache;
+    };
+
+    std::filesystem::path directory;
+    std::filesystem::path path;
+    uint64_t key = 0;
+    MappedFile file;
+    const uint8_t* filePixels = nullptr;
+    std::unordered_map<GlyphKey, Entry, GlyphKeyHash> entries;
+    std::vector<uint8_t> newPixels;
+    uint32_t newCount = 0;
+    Stats stats;
+    Loader fontLoader;
+
+    static bool loadGlyph(
+        ImFontAtlas* atlas,
+        ImFontConfig* src,
+        ImFontBaked* baked,
+        void* loaderData,
+        ImWchar codepoint,
+        ImFontGlyph* outGlyph,
+        float* outAdvanceX
+    );
+    bool loadCached(ImFontAtlas* atlas, ImFontConfig* src, ImFontBaked* baked, const Entry& entry, ImFontGlyph* outGlyph);
+    void capture(ImFontAtlas* atlas, const ImFontBaked* baked, const ImFontGlyph& glyph);
+
+public:
+    explicit FontCache(std::filesystem::path directory = "cache/fonts");
+    DISABLE_COPY(FontCache)
+
+    // Compute the key for this font + config and map its cache file if present.
+    void open(std::span<const char> ttf, const ImFontConfig& config);
+    const ImFontLoader* loader() const {
+        return &fontLoader;
+    }
+    // Write cached and newly rasterized glyphs back if anything was added.
+    void save();
+    const Stats& getStats() const {
+        return stats;
+    }
+};
+
+#endif  // FONTCACHE_HPP
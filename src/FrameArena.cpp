@@ -0,0 +1,47 @@
+#include "FrameArena.hpp"
+
+// std c++
+#include <algorithm>
+#include <bit>
+#include <new>
+
+FrameArena::FrameArena(size_t capacity)
+    : block(std::make_unique_for_overwrite<std::byte[]>(capacity)), capacity(capacity) {}
+
+FrameArena::~FrameArena() {
+    freeSpills();
+}
+
+void* FrameArena::do_allocate(size_t bytes, size_t alignment) {
+    auto base = reinterpret_cast<uintptr_t>(block.get());
+    uintptr_t start = (base + offset + alignment - 1) & ~(uintptr_t(alignment) - 1);
+    if (start + bytes <= base + capacity) {
+        offset = start + bytes - base;
+        return reinterpret_cast<void*>(start);
+    }
+    void* memory = ::operator new(bytes, std::align_val_t(alignment));
+    spills.emplace_back(memory, alignment);
+    spilledBytes += bytes + alignment;
+    return memory;
+}
+
+void FrameArena::freeSpills() {
+    for (auto [memory, alignment] : spills) {
+        ::operator delete(memory, std::align_val_t(alignment));
+    }
+    spills.clear();
+}
+
+void FrameArena::reset() {
+    size_t used = offset + spilledBytes;
+    peak = std::max(peak, used);
+    if (!spills.empty()) {
+        // grow once to fit the whole frame instead of spilling every frame
+        freeSpills();
+        capacity = std::bit_ceil(used);
+        block = std::make_unique_for_overwrite<std::byte[]>(capacity);
+        grows++;
+    }
+    offset = 0;
+    spilledBytes = 0;
+}
@@ -0,0 +1,65 @@
+#ifndef FRAMEARENA_HPP
+#define FRAMEARENA_HPP
+
+// c++ std libs
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+#include "utils.hpp"
+
+/*
+ * Bump allocator for CPU data that only lives until the next frame starts,
+ * exposed as a std::pmr::memory_resource so containers can use it directly:
+ *
+ *     arena.reset();
+ *     std::pmr::vector<vk::ImageMemoryBarrier2> barriers(&arena);
+ *
+ * Nothing is freed individually. Requests that don't fit the block spill to
+ * the heap until reset(), which then grows the block to the frame's peak, so
+ * after a few frames a steady workload never touches the heap. Not thread
+ * safe, each recording thread needs its own arena.
+ */
+class FrameArena : public std::pmr::memory_resource {
+public:
+    struct Stats {
+        size_t used = 0;      // bytes handed out this frame, spills included
+        size_t capacity = 0;  // size of the block
+        size_t peak = 0;      // largest `used` seen at a reset()
+        uint32_t grows = 0;
+    };
+
+private:
+    std::unique_ptr<std::byte[]> block;
+    size_t capacity = 0;
+    size_t offset = 0;
+    size_t spilledBytes = 0;
+    size_t peak = 0;
+    uint32_t grows = 0;
+    // heap allocations made because the block was full, freed by reset()
+    std::vector<std::pair<void*, size_t>> spills;
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+    void freeSpills();
+
+public:
+    explicit FrameArena(size_t capacity = 64 * 1024);
+    ~FrameArena() override;
+    DISABLE_COPY(FrameArena)
+
+    // Invalidates everything allocated since the last reset().
+    void reset();
+
+    Stats stats() const {
+        return {offset + spilledBytes, capacity, peak, grows};
+    }
+};
+
+#endif  // FRAMEARENA_HPP
@@ -0,0 +1,362 @@
+#include "FrameCapture.hpp"
+
+// std c++
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <print>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Layout of the swapchain formats we can be asked to capture.
+bool isBgra(vk::Format format) {
+    return format == vk::Format::eB8G8R8A8Srgb || format == vk::Format::eB8G8R8A8Unorm;
+}
+
+uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+    static const auto table = []() {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+void putBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+void putChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data) {
+    putBigEndian(out, static_cast<uint32_t>(data.size()));
+    size_t typeOffset = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    putBigEndian(out, crc32(out.data() + typeOffset, out.size() - typeOffset));
+}
+
+/*
+ * 8-bit RGB PNG with stored (uncompressed) deflate blocks: a few times bigger
+ * than zlib output, but writing it costs little more than a memcpy, which is
+ * what matters for keeping up with the frame rate.
+ */
+std::vector<uint8_t> encodePng(const uint8_t* pixels, vk::Extent2D extent, bool bgra) {
+    const uint32_t width = extent.width, height = extent.height;
+    std::vector<uint8_t> raw;
+    raw.reserve(size_t(height) * (1 + width * 3));
+    for (uint32_t y = 0; y < height; y++) {
+        raw.push_back(0);  // filter: none
+        const uint8_t* row = pixels + size_t(y) * width * 4;
+        for (uint32_t x = 0; x < width; x++) {
+            const uint8_t* p = row + x * 4;
+            raw.push_back(p[bgra ? 2 : 0]);
+            raw.push_back(p[1]);
+            raw.push_back(p[bgra ? 0 : 2]);
+        }
+    }
+
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    uint32_t a = 1, b = 0;  // adler32
+    for (size_t offset = 0; offset < raw.size() || offset == 0;) {
+        size_t size = std::min<size_t>(raw.size() - offset, 0xffff);
+        bool last = offset + size == raw.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(static_cast<uint8_t>(size));
+        zlib.push_back(static_cast<uint8_t>(size >> 8));
+        zlib.push_back(static_cast<uint8_t>(~size));
+        zlib.push_back(static_cast<uint8_t>(~size >> 8));
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + size);
+        for (size_t i = offset; i < offset + size; i++) {
+            a = (a + raw[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+        offset += size;
+        if (last) {
+            break;
+        }
+    }
+    putBigEndian(zlib, (b << 16) | a);
+
+    std::vector<uint8_t> header;
+    putBigEndian(header, width);
+    putBigEndian(header, height);
+    header.insert(header.end(), {8, 2, 0, 0, 0});  // 8 bit, RGB, deflate, no filter, no interlace
+
+    std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    putChunk(png, "IHDR", header);
+    putChunk(png, "IDAT", zlib);
+    putChunk(png, "IEND", {});
+    return png;
+}
+
+// Full-range BT.601 4:4:4 planes, "C444" in Y4M terms.
+std::vector<uint8_t> encodeY4mFrame(const uint8_t* pixels, vk::Extent2D extent, bool bgra) {
+    size_t count = size_t(extent.width) * extent.height;
+    std::vector<uint8_t> planes(count * 3);
+    uint8_t* yPlane = planes.data();
+    uint8_t* uPlane = yPlane + count;
+    uint8_t* vPlane = uPlane + count;
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t* p = pixels + i * 4;
+        int r = p[bgra ? 2 : 0], g = p[1], b = p[bgra ? 0 : 2];
+        yPlane[i] = static_cast<uint8_t>((77 * r + 150 * g + 29 * b + 128) >> 8);
+        uPlane[i] = static_cast<uint8_t>(std::clamp((-43 * r - 85 * g + 128 * b + 128) / 256 + 128, 0, 255));
+        vPlane[i] = static_cast<uint8_t>(std::clamp((128 * r - 107 * g - 21 * b + 128) / 256 + 128, 0, 255));
+    }
+    return planes;
+}
+
+}  // namespace
+
+void FrameCapture::init(
+    const DeviceProfile& profile, const vk::raii::Device& device, MemoryBudget& budget
+) {
+    this->profile = &profile;
+    this->device = &device;
+    this->budget = &budget;
+    worker = std::jthread([this](std::stop_token stop) { workerLoop(stop); });
+}
+
+void FrameCapture::start(std::filesystem::path directory, Format format, uint32_t frameCount) {
+    std::filesystem::create_directories(directory);
+    session = {
+        .id = session.id + 1,
+        .directory = std::move(directory),
+        .format = format,
+        .framesLeft = frameCount,
+    };
+    recording = true;
+    std::println(
+        "Capture: writing {} to {}",
+        format == Format::ePng ? "PNG frames" : "capture.y4m",
+        session.directory.string()
+    );
+}
+
+void FrameCapture::stop() {
+    recording = false;
+}
+
+void FrameCapture::ensureCapacity(Slot& slot, vk::DeviceSize size) {
+    if (slot.capacity >= size) {
+        return;
+    }
+    slot.memory = nullptr;
+    slot.buffer = vk::raii::Buffer(*device, vk::BufferCreateInfo{
+        .size = size,
+        .usage = vk::BufferUsageFlagBits::eTransferDst,
+        .sharingMode = vk::SharingMode::eExclusive
+    });
+
+    // prefer cached memory, CPU reads from write-combined memory are very slow
+    vk::MemoryRequirements requirements = slot.buffer.getMemoryRequirements();
+    const auto& memory = profile->memory;
+    uint32_t typeIndex = ~0u;
+    auto cached = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCached;
+    for (uint32_t i = 0; i < memory.memoryTypeCount; i++) {
+        if ((requirements.memoryTypeBits & (1 << i)) &&
+            (memory.memoryTypes[i].propertyFlags & cached) == cached) {
+            typeIndex = i;
+            break;
+        }
+    }
+    if (typeIndex == ~0u) {
+        typeIndex = findMemoryType(
+            memory,
+            requirements.memoryTypeBits,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+        );
+    }
+    slot.coherent = static_cast<bool>(
+        memory.memoryTypes[typeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostCoherent
+    );
+    slot.memory = budget->allocate(
+        *device,
+        vk::MemoryAllocateInfo{.allocationSize = requirements.size, .memoryTypeIndex = typeIndex},
+        MemoryCategory::eReadback
+    );
+    slot.buffer.bindMemory(*slot.memory, 0);
+    slot.mapped = static_cast<const uint8_t*>(slot.memory.get().mapMemory(0, vk::WholeSize));
+    slot.capacity = size;
+}
+
+FrameCapture::Slot* FrameCapture::acquire(vk::Extent2D extent, vk::Format format) {
+    if (!recording || device == nullptr) {
+        return nullptr;
+    }
+    Slot& slot = slots[nextSlot];
+    if (slot.state.load(std::memory_order_acquire) != Slot::State::eFree) {
+        dropped++;
+        return nullptr;
+    }
+    nextSlot = (nextSlot + 1) % SLOT_COUNT;
+
+    ensureCapacity(slot, vk::DeviceSize(extent.width) * extent.height * 4);
+    slot.extent = extent;
+    slot.format = format;
+    slot.frame = session.nextFrame++;
+    slot.state.store(Slot::State::eRecorded, std::memory_order_relaxed);
+    if (session.framesLeft > 0 && --session.framesLeft == 0) {
+        recording = false;
+    }
+    return &slot;
+}
+
+void FrameCapture::recordCopy(const vk::raii::CommandBuffer& cmd, const Slot& slot, vk::Image image) const {
+    vk::BufferImageCopy2 region{
+        .bufferOffset = 0,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource = {vk::ImageAspectFlagBits::eColor, 0, 0, 1},
+        .imageOffset = {0, 0, 0},
+        .imageExtent = {slot.extent.width, slot.extent.height, 1}
+    };
+    cmd.copyImageToBuffer2({
+        .srcImage = image,
+        .srcImageLayout = vk::ImageLayout::eTransferSrcOptimal,
+        .dstBuffer = *slot.buffer,
+        .regionCount = 1,
+        .pRegions = &region
+    });
+}
+
+void FrameCapture::submitted(Slot* slot, uint64_t timelineValue) {
+    if (slot == nullptr) {
+        return;
+    }
+    slot->timelineValue = timelineValue;
+    slot->state.store(Slot::State::eSubmitted, std::memory_order_relaxed);
+}
+
+void FrameCapture::poll(uint64_t completedValue) {
+    std::array<Slot*, SLOT_COUNT> ready{};
+    size_t count = 0;
+    for (auto& slot : slots) {
+        if (slot.state.load(std::memory_order_relaxed) == Slot::State::eSubmitted &&
+            slot.timelineValue <= completedValue) {
+            ready[count++] = &slot;
+        }
+    }
+    if (count == 0) {
+        return;
+    }
+    // y4m is a single stream, keep frames in order
+    std::sort(ready.begin(), ready.begin() + count, [](const Slot* a, const Slot* b) {
+        return a->frame < b->frame;
+    });
+    {
+        std::lock_guard lock(mutex);
+        for (size_t i = 0; i < count; i++) {
+            Slot* slot = ready[i];
+            if (!slot->coherent) {
+                device->invalidateMappedMemoryRanges(vk::MappedMemoryRange{
+                    .memory = *slot->memory,
+                    .offset = 0,
+                    .size = vk::WholeSize
+                });
+            }
+            slot->state.store(Slot::State::eEncoding, std::memory_order_release);
+            jobs.push_back({slot, session.id, session.format, session.directory});
+        }
+    }
+    cv.notify_one();
+}
+
+vk::DeviceSize FrameCapture::trim() {
+    if (recording) {
+        return 0;
+    }
+    vk::DeviceSize freed = 0;
+    for (auto& slot : slots) {
+        // slots still in flight or being encoded come back to eFree on their own
+        if (slot.capacity == 0 || slot.state.load(std::memory_order_acquire) != Slot::State::eFree) {
+            continue;
+        }
+        freed += slot.memory.getSize();
+        slot.mapped = nullptr;
+        slot.buffer = nullptr;
+        slot.memory = nullptr;
+        slot.capacity = 0;
+    }
+    return freed;
+}
+
+void FrameCapture::workerLoop(std::stop_token stop) {
+    std::unique_lock lock(mutex);
+    while (true) {
+        // on stop, keep going until the queue is drained
+        if (!cv.wait(lock, stop, [&]() { return !jobs.empty(); }) && jobs.empty()) {
+            break;
+        }
+        Job job = std::move(jobs.front());
+        jobs.pop_front();
+        lock.unlock();
+
+        auto begin = std::chrono::steady_clock::now();
+        try {
+            encode(job);
+            written++;
+        }
+        catch (const std::exception& e) {
+            std::println(stderr, "Capture: frame {} failed: {}", job.slot->frame, e.what());
+            dropped++;
+        }
+        encodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        job.slot->state.store(Slot::State::eFree, std::memory_order_release);
+
+        lock.lock();
+    }
+}
+
+void FrameCapture::encode(const Job& job) {
+    const Slot& slot = *job.slot;
+    bool bgra = isBgra(slot.format);
+    if (job.format == Format::ePng) {
+        auto png = encodePng(slot.mapped, slot.extent, bgra);
+        auto path = job.directory / std::format("frame_{:05}.png", slot.frame);
+        std::ofstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error(std::format("failed to open {}", path.string()));
+        }
+        file.write(reinterpret_cast<const char*>(png.data()), png.size());
+        return;
+    }
+
+    if (job.session != y4mSession) {
+        y4m.close();
+        auto path = job.directory / "capture.y4m";
+        y4m.open(path, std::ios::binary | std::ios::trunc);
+        if (!y4m.is_open()) {
+            throw std::runtime_error(std::format("failed to open {}", path.string()));
+        }
+        // nominal 60 fps; frames are whatever was presented. Players assume
+        // limited range unless told otherwise.
+        y4m << std::format(
+            "YUV4MPEG2 W{} H{} F60:1 Ip A1:1 C444 XCOLORRANGE=FULL\n", slot.extent.width, slot.extent.height
+        );
+        y4mSession = job.session;
+        y4mExtent = slot.extent;
+    }
+    if (slot.extent != y4mExtent) {
+        throw std::runtime_error("resolution changed mid-recording");
+    }
+    auto planes = encodeY4mFrame(slot.mapped, slot.extent, bgra);
+    y4m << "FRAME\n";
+    y4m.write(reinterpret_cast<const char*>(planes.data()), planes.size());
+    y4m.flush();
+}
@@ -0,0 +1,136 @@
+#ifndef FRAMECAPTURE_HPP
+#define FRAMECAPTURE_HPP
+
+// c++ std libs
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+// vulkan-hpp headers
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "DeviceProfile.hpp"
+#include "MemoryBudget.hpp"
+#include "utils.hpp"
+
+/*
+ * Copies presented frames into a ring of persistently mapped readback buffers
+ * and streams them to disk from a worker thread. The render loop never waits:
+ * a slot is handed to the worker only once the graphics timeline has passed
+ * the value of the submit that filled it, and if every slot is still in
+ * flight or being encoded the frame is skipped and counted as dropped.
+ *
+ *     if (auto* slot = capture.acquire(extent, format)) {
+ *         // copy the image into slot->buffer, export it as eHostRead
+ *     }
+ *     uint64_t value = scheduler.submit(...);
+ *     capture.submitted(slot, value);
+ *     ...
+ *     capture.poll(scheduler.completedValue(QueueType::eGraphics));
+ */
+class FrameCapture {
+public:
+    enum class Format {
+        ePng,  // frame_00000.png, ... (uncompressed deflate, fast to write)
+        eY4m,  // capture.y4m, 4:4:4, playable with ffplay/mpv
+    };
+
+    struct Slot {
+        vk::raii::Buffer buffer = nullptr;
+        DeviceAllocation memory = nullptr;
+        const uint8_t* mapped = nullptr;
+        vk::DeviceSize capacity = 0;
+        bool coherent = true;
+        vk::Extent2D extent;
+        vk::Format format = vk::Format::eUndefined;
+        uint64_t timelineValue = 0;
+        uint32_t frame = 0;
+        // eFree -> eRecorded (acquire) -> eSubmitted -> eEncoding (poll) -> eFree (worker)
+        enum class State : uint32_t { eFree, eRecorded, eSubmitted, eEncoding };
+        std::atomic<State> state{State::eFree};
+    };
+
+    struct Stats {
+        uint32_t written = 0;
+        uint32_t dropped = 0;
+        double encodeMs = 0;  // worker time of the last frame
+    };
+
+private:
+    // frames in flight plus slack for the worker
+    static constexpr size_t SLOT_COUNT = 4;
+
+    struct Session {
+        uint32_t id = 0;
+        std::filesystem::path directory;
+        Format format = Format::ePng;
+        uint32_t framesLeft = 0;  // 0 records until stop()
+        uint32_t nextFrame = 0;
+    };
+    struct Job {
+        Slot* slot;
+        uint32_t session;
+        Format format;
+        std::filesystem::path directory;
+    };
+
+    const DeviceProfile* profile = nullptr;
+    const vk::raii::Device* device = nullptr;
+    MemoryBudget* budget = nullptr;
+    std::array<Slot, SLOT_COUNT> slots;
+    uint32_t nextSlot = 0;
+    Session session;
+    bool recording = false;
+    std::atomic<uint32_t> written{0};
+    std::atomic<uint32_t> dropped{0};
+    std::atomic<double> encodeMs{0};
+
+    // worker side; the thread is last so it joins before the buffers go away
+    std::mutex mutex;
+    std::condition_variable_any cv;
+    std::deque<Job> jobs;
+    std::ofstream y4m;
+    uint32_t y4mSession = 0;
+    vk::Extent2D y4mExtent;
+    std::jthread worker;
+
+    void ensureCapacity(Slot& slot, vk::DeviceSize size);
+    void workerLoop(std::stop_token stop);
+    void encode(const Job& job);
+
+public:
+    FrameCapture() = default;
+    DISABLE_COPY(FrameCapture)
+
+    void init(const DeviceProfile& profile, const vk::raii::Device& device, MemoryBudget& budget);
+
+    // Begin writing into `directory`; frameCount 0 records until stop().
+    void start(std::filesystem::path directory, Format format, uint32_t frameCount = 0);
+    void stop();
+    bool active() const {
+        return recording;
+    }
+
+    // A free slot sized for the frame, or null if not recording / all busy.
+    Slot* acquire(vk::Extent2D extent, vk::Format format);
+    // Record the copy of `image` (in eTransferSrcOptimal) into the slot.
+    void recordCopy(const vk::raii::CommandBuffer& cmd, const Slot& slot, vk::Image image) const;
+    void submitted(Slot* slot, uint64_t timelineValue);
+    // Hand every slot the GPU has finished to the worker.
+    void poll(uint64_t completedValue);
+    // Free the readback buffers of idle slots while not recording; returns bytes freed.
+    vk::DeviceSize trim();
+
+    Stats stats() const {
+        return {written.load(), dropped.load(), encodeMs.load()};
+    }
+};
+
+#endif  // FRAMECAPTURE_HPP
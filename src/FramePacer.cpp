@@ -0,0 +1,121 @@
+#include "FramePacer.hpp"
+
+// std c++
+#include <chrono>
+#include <thread>
+
+// vulkan
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+// project
+#include "Trace.hpp"
+
+namespace {
+
+double toMs(FramePacer::clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+}  // namespace
+
+void FramePacer::init(QueueScheduler& scheduler, bool presentWait) {
+    this->scheduler = &scheduler;
+    this->presentWait = presentWait;
+    stats.presentWait = presentWait;
+}
+
+double FramePacer::smooth(double average, double sample) const {
+    return average > 0 ? average + (sample - average) * settings.smoothing : sample;
+}
+
+// Returns false on a timeout or when the swapchain went out of date; present()
+// reports the latter and the swapchain gets recreated.
+bool FramePacer::waitForPresent(
+    const vk::raii::SwapchainKHR& swapchain, uint64_t id, uint64_t timeout
+) {
+    vk::Result result;
+    try {
+        result = swapchain.waitForPresent(id, timeout);
+    }
+    catch (const vk::SystemError&) {
+        reset();
+        return false;
+    }
+    if (result == vk::Result::eTimeout) {
+        return false;
+    }
+    presented(id, clock::now());
+    return true;
+}
+
+// A finished wait for `id` means every earlier id has been presented too.
+void FramePacer::presented(uint64_t id, clock::time_point when) {
+    while (!pending.empty() && pending.front().id <= id) {
+        if (pending.front().id == id) {
+            stats.submitToPresentMs =
+                smooth(stats.submitToPresentMs, toMs(when - pending.front().submitted));
+        }
+        pending.pop_front();
+    }
+    if (lastPresentId != 0 && id == lastPresentId + 1) {
+        // a missed vblank shows up as a multiple of the interval, skip those
+        double interval = toMs(when - lastPresent);
+        if (stats.refreshMs == 0 || interval < stats.refreshMs * 1.5) {
+            stats.refreshMs = smooth(stats.refreshMs, interval);
+        }
+    }
+    lastPresentId = id;
+    lastPresent = when;
+}
+
+void FramePacer::beginFrame(const vk::raii::SwapchainKHR& swapchain, double gpuMs) {
+    TRACE_FUNCTION();
+    auto start = clock::now();
+    bool previousPresented = false;
+    if (presentWait && !pending.empty()) {
+        if (settings.lowLatency) {
+            previousPresented = waitForPresent(swapchain, pending.back().id, PRESENT_TIMEOUT_NS);
+        }
+        else {
+            while (!pending.empty() && waitForPresent(swapchain, pending.front().id, 0)) {
+            }
+        }
+    }
+    else if (settings.lowLatency) {
+        // no present timing, at least don't queue up behind the previous frame
+        scheduler->wait(QueueType::eGraphics, scheduler->submittedValue(QueueType::eGraphics));
+    }
+
+    stats.workMs = stats.inputToSubmitMs + gpuMs;
+    if (previousPresented && stats.refreshMs > 0) {
+        // start as late as possible and still make the next vblank
+        double delayMs = stats.refreshMs - stats.workMs - settings.marginMs;
+        auto deadline = lastPresent + std::chrono::duration_cast<clock::duration>(
+                                          std::chrono::duration<double, std::milli>(delayMs)
+                                      );
+        if (deadline > clock::now()) {
+            TRACE_ZONE("sleep until deadline");
+            std::this_thread::sleep_until(deadline);
+        }
+    }
+    stats.waitMs = toMs(clock::now() - start);
+}
+
+uint64_t FramePacer::submitted(clock::time_point inputTime) {
+    auto now = clock::now();
+    stats.inputToSubmitMs = smooth(stats.inputToSubmitMs, toMs(now - inputTime));
+    if (!presentWait) {
+        return 0;
+    }
+    // drops the oldest when nobody looked for a while
+    pending.push_back({nextPresentId, now});
+    return nextPresentId++;
+}
+
+void FramePacer::reset() {
+    while (!pending.empty()) {
+        pending.pop_front();
+    }
+    lastPresentId = 0;
+}
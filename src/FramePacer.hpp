@@ -0,0 +1,100 @@
+#ifndef FRAMEPACER_HPP
+#define FRAMEPACER_HPP
+
+// c++ std libs
+#include <chrono>
+#include <cstdint>
+
+// vulkan-hpp headers
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "QueueScheduler.hpp"
+#include "utils.hpp"
+
+/*
+ * Latency bookkeeping and the optional low-latency frame start. Normally a
+ * frame polls input, then waits on its fence for up to a frame, so input is
+ * a frame old by the time it's recorded. In low-latency mode the frame
+ * instead waits until the previous one has been presented
+ * (VK_KHR_present_wait), then sleeps until the predicted deadline minus the
+ * expected CPU + GPU time, and only then polls input and records. Without
+ * present wait it can only wait for the previous frame to finish on the GPU.
+ *
+ * Presents are tagged with VK_KHR_present_id. Outside low-latency mode the
+ * pacer polls for finished presents at the start of each frame, so
+ * submit-to-present is an upper bound there, off by up to a frame.
+ *
+ *     pacer.beginFrame(swapchain, gpuMs);  // after the frame fence wait
+ *     window.pollEvents();
+ *     ... record, submit ...
+ *     uint64_t id = pacer.submitted(window.getLastPollTime());  // chain into vkQueuePresentKHR
+ */
+class FramePacer {
+public:
+    using clock = std::chrono::steady_clock;
+
+    struct Settings {
+        bool lowLatency = false;
+        float marginMs = 1.f;    // slack left before the predicted deadline
+        float smoothing = 0.1f;  // EMA weight of a new sample
+    };
+
+    struct Stats {
+        bool presentWait = false;
+        double inputToSubmitMs = 0;
+        double submitToPresentMs = 0;  // 0 until a present has been seen
+        double waitMs = 0;             // time spent in the last beginFrame()
+        double refreshMs = 0;          // between consecutive presents
+        double workMs = 0;             // predicted input to GPU done
+    };
+
+private:
+    struct Pending {
+        uint64_t id = 0;
+        clock::time_point submitted;
+    };
+    // presents with a timing that hasn't been seen yet
+    static constexpr size_t MAX_PENDING = 8;
+    static constexpr uint64_t PRESENT_TIMEOUT_NS = 100'000'000;
+
+    QueueScheduler* scheduler = nullptr;
+    bool presentWait = false;
+    uint64_t nextPresentId = 1;
+    RingBuffer<Pending, MAX_PENDING> pending;
+    uint64_t lastPresentId = 0;
+    clock::time_point lastPresent;
+    Stats stats;
+
+    double smooth(double average, double sample) const;
+    bool waitForPresent(const vk::raii::SwapchainKHR& swapchain, uint64_t id, uint64_t timeout);
+    void presented(uint64_t id, clock::time_point when);
+
+public:
+    Settings settings;
+
+    FramePacer() = default;
+    DISABLE_COPY(FramePacer)
+
+    // `presentWait`: VK_KHR_present_id and VK_KHR_present_wait are enabled.
+    void init(QueueScheduler& scheduler, bool presentWait);
+    bool hasPresentWait() const {
+        return presentWait;
+    }
+
+    // Between the frame fence wait and input polling; in low-latency mode
+    // returns at the latest time the frame can start. `gpuMs` is the last
+    // measured GPU frame time.
+    void beginFrame(const vk::raii::SwapchainKHR& swapchain, double gpuMs);
+    // Right after the frame's submit. Returns the present id to chain into
+    // the present, 0 without present wait.
+    uint64_t submitted(clock::time_point inputTime);
+    // The swapchain was recreated, pending present ids are gone with it.
+    void reset();
+
+    const Stats& getStats() const {
+        return stats;
+    }
+};
+
+#endif  // FRAMEPACER_HPP
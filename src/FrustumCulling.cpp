@@ -0,0 +1,571 @@
+#include "FrustumCulling.hpp"
+
+// std c++
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CULL_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define CULL_NEON 1
+#include <arm_neon.h>
+#endif
+
+// GCC and Clang only emit AVX2 inside functions marked for it, MSVC always can
+#if defined(__GNUC__) || defined(__clang__)
+#define CULL_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define CULL_TARGET_AVX2
+#endif
+
+// project
+#include "Trace.hpp"
+
+namespace {
+
+Plane normalized(float x, float y, float z, float d) {
+    float length = std::sqrt(x * x + y * y + z * z);
+    return {x / length, y / length, z / length, d / length};
+}
+
+bool sphereVisible(const Frustum& frustum, float x, float y, float z, float radius) {
+    for (const Plane& p : frustum.planes) {
+        if (p.x * x + p.y * y + p.z * z + p.d < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// the box's projection onto the normal is |n| . extent
+bool boxVisible(const Frustum& frustum, float cx, float cy, float cz, float ex, float ey, float ez) {
+    for (const Plane& p : frustum.planes) {
+        float distance = p.x * cx + p.y * cy + p.z * cz + p.d;
+        float radius = std::abs(p.x) * ex + std::abs(p.y) * ey + std::abs(p.z) * ez;
+        if (distance + radius < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// branchless: every index is written, only visible ones advance the output
+uint32_t cullSpheresScalar(
+    const Frustum& frustum, const SphereBounds& b, uint32_t first, uint32_t count, uint32_t* out
+) {
+    uint32_t visible = 0;
+    for (uint32_t i = first; i < first + count; i++) {
+        out[visible] = i;
+        visible += sphereVisible(frustum, b.x[i], b.y[i], b.z[i], b.radius[i]) ? 1 : 0;
+    }
+    return visible;
+}
+
+uint32_t cullBoxesScalar(
+    const Frustum& frustum, const BoxBounds& b, uint32_t first, uint32_t count, uint32_t* out
+) {
+    uint32_t visible = 0;
+    for (uint32_t i = first; i < first + count; i++) {
+        out[visible] = i;
+        visible += boxVisible(
+                       frustum, b.centerX[i], b.centerY[i], b.centerZ[i], b.extentX[i], b.extentY[i], b.extentZ[i]
+                   )
+                       ? 1
+                       : 0;
+    }
+    return visible;
+}
+
+// 4-wide kernels hand back a lane mask, expand it bit by bit
+inline uint32_t appendLanes(uint32_t mask, uint32_t base, uint32_t* out) {
+    uint32_t written = 0;
+    while (mask != 0) {
+        out[written++] = base + std::countr_zero(mask);
+        mask &= mask - 1;
+    }
+    return written;
+}
+
+#ifdef CULL_X86
+
+uint32_t cullSpheresSse2(
+    const Frustum& frustum, const SphereBounds& b, uint32_t first, uint32_t count, uint32_t* out
+) {
+    __m128 px[6], py[6], pz[6], pd[6];
+    for (int p = 0; p < 6; p++) {
+        px[p] = _mm_set1_ps(frustum.planes[p].x);
+        py[p] = _mm_set1_ps(frustum.planes[p].y);
+        pz[p] = _mm_set1_ps(frustum.planes[p].z);
+        pd[p] = _mm_set1_ps(frustum.planes[p].d);
+    }
+    uint32_t visible = 0;
+    uint32_t i = first;
+    uint32_t end = first + count;
+    for (; i + 4 <= end; i += 4) {
+        __m128 x = _mm_loadu_ps(&b.x[i]);
+        __m128 y = _mm_loadu_ps(&b.y[i]);
+        __m128 z = _mm_loadu_ps(&b.z[i]);
+        __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&b.radius[i]));
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(px[p], x), _mm_mul_ps(py[p], y)),
+                _mm_add_ps(_mm_mul_ps(pz[p], z), pd[p])
+            );
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+        }
+        visible += appendLanes(_mm_movemask_ps(inside), i, out + visible);
+    }
+    return visible + cullSpheresScalar(frustum, b, i, end - i, out + visible);
+}
+
+uint32_t cullBoxesSse2(
+    const Frustum& frustum, const BoxBounds& b, uint32_t first, uint32_t count, uint32_t* out
+) {
+    __m128 px[6], py[6], pz[6], pd[6], ax[6], ay[6], az[6];
+    for (int p = 0; p < 6; p++) {
+        const Plane& plane = frustum.planes[p];
+        px[p] = _mm_set1_ps(plane.x);
+        py[p] = _mm_set1_ps(plane.y);
+        pz[p] = _mm_set1_ps(plane.z);
+        pd[p] = _mm_set1_ps(plane.d);
+        ax[p] = _mm_set1_ps(std::abs(plane.x));
+        ay[p] = _mm_set1_ps(std::abs(plane.y));
+        az[p] = _mm_set1_ps(std::abs(plane.z));
+    }
+    uint32_t visible = 0;
+    uint32_t i = first;
+    uint32_t end = first + count;
+    for (; i + 4 <= end; i += 4) {
+        __m128 cx = _mm_loadu_ps(&b.centerX[i]);
+        __m128 cy = _mm_loadu_ps(&b.centerY[i]);
+        __m128 cz = _mm_loadu_ps(&b.centerZ[i]);
+        __m128 ex = _mm_loadu_ps(&b.extentX[i]);
+        __m128 ey = _mm_loadu_ps(&b.extentY[i]);
+        __m128 ez = _mm_loadu_ps(&b.extentZ[i]);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(px[p], cx), _mm_mul_ps(py[p], cy)),
+                _mm_add_ps(_mm_mul_ps(pz[p], cz), pd[p])
+            );
+            __m128 radius = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)), _mm_mul_ps(az[p], ez)
+            );
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+        }
+        visible += appendLanes(_mm_movemask_ps(inside), i, out + visible);
+    }
+    return visible + cullBoxesScalar(frustum, b, i, end - i, out + visible);
+}
+
+// lanes of the set bits of an 8-bit mask, packed to the front
+struct CompactTable {
+    alignas(32) uint32_t lanes[256][8];
+};
+constexpr CompactTable COMPACT_TABLE = []() {
+    CompactTable table{};
+    for (uint32_t mask = 0; mask < 256; mask++) {
+        uint32_t n = 0;
+        for (uint32_t lane = 0; lane < 8; lane++) {
+            if (mask & (1u << lane)) {
+                table.lanes[mask][n++] = lane;
+            }
+        }
+    }
+    return table;
+}();
+
+// Store all 8 lanes of the packed indices and advance by the visible count.
+CULL_TARGET_AVX2 inline uint32_t storeLanes(uint32_t mask, uint32_t base, uint32_t* out) {
+    __m256i lanes = _mm256_load_si256(reinterpret_cast<const __m256i*>(COMPACT_TABLE.lanes[mask]));
+    __m256i indices = _mm256_add_epi32(lanes, _mm256_set1_epi32(static_cast<int>(base)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), indices);
+    return std::popcount(mask);
+}
+
+CULL_TARGET_AVX2 uint32_t cullSpheresAvx2(
+    const Frustum& frustum, const SphereBounds& b, uint32_t first, uint32_t count, uint32_t* out
+) {
+    __m256 px[6], py[6], pz[6], pd[6];
+    for (int p = 0; p < 6; p++) {
+        px[p] = _mm256_set1_ps(frustum.planes[p].x);
+        py[p] = _mm256_set1_ps(frustum.planes[p].y);
+        pz[p] = _mm256_set1_ps(frustum.planes[p].z);
+        pd[p] = _mm256_set1_ps(frustum.planes[p].d);
+    }
+    uint32_t visible = 0;
+    uint32_t i = first;
+    uint32_t end = first + count;
+    for (; i + 8 <= end; i += 8) {
+        __m256 x = _mm256_loadu_ps(&b.x[i]);
+        __m256 y = _mm256_loadu_ps(&b.y[i]);
+        __m256 z = _mm256_loadu_ps(&b.z[i]);
+        __m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&b.radius[i]));
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            __m256 distance = _mm256_fmadd_ps(
+                px[p], x, _mm256_fmadd_ps(py[p], y, _mm256_fmadd_ps(pz[p], z, pd[p]))
+            );
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+        }
+        // at most 8 past `visible`, which is never ahead of i - first
+        visible += storeLanes(_mm256_movemask_ps(inside), i, out + visible);
+    }
+    return visible + cullSpheresScalar(frustum, b, i, end - i, out + visible);
+}
+
+CULL_TARGET_AVX2 uint32_t cullBoxesAvx2(
+    const Frustum& frustum, const BoxBounds& b, uint32_t first, uint32_t count, uint32_t* out
+) {
+    __m256 px[6], py[6], pz[6], pd[6], ax[6], ay[6], az[6];
+    for (int p = 0; p < 6; p++) {
+        const Plane& plane = frustum.planes[p];
+        px[p] = _mm256_set1_ps(plane.x);
+        py[p] = _mm256_set1_ps(plane.y);
+        pz[p] = _mm256_set1_ps(plane.z);
+        pd[p] = _mm256_set1_ps(plane.d);
+        ax[p] = _mm256_set1_ps(std::abs(plane.x));
+        ay[p] = _mm256_set1_ps(std::abs(plane.y));
+        az[p] = _mm256_set1_ps(std::abs(plane.z));
+    }
+    uint32_t visible = 0;
+    uint32_t i = first;
+    uint32_t end = first + count;
+    for (; i + 8 <= end; i += 8) {
+        __m256 cx = _mm256_loadu_ps(&b.centerX[i]);
+        __m256 cy = _mm256_loadu_ps(&b.centerY[i]);
+        __m256 cz = _mm256_loadu_ps(&b.centerZ[i]);
+        __m256 ex = _mm256_loadu_ps(&b.extentX[i]);
+        __m256 ey = _mm256_loadu_ps(&b.extentY[i]);
+        __m256 ez = _mm256_loadu_ps(&b.extentZ[i]);
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            __m256 distance = _mm256_fmadd_ps(
+                px[p], cx, _mm256_fmadd_ps(py[p], cy, _mm256_fmadd_ps(pz[p], cz, pd[p]))
+            );
+            __m256 reach = _mm256_fmadd_ps(
+                ax[p], ex, _mm256_fmadd_ps(ay[p], ey, _mm256_fmadd_ps(az[p], ez, distance))
+            );
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(reach, _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+        visible += storeLanes(_mm256_movemask_ps(inside), i, out + visible);
+    }
+    return visible + cullBoxesScalar(frustum, b, i, end - i, out + visible);
+}
+
+bool cpuHasAvx2() {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    int regs[4];
+    __cpuid(regs, 1);
+    bool osxsave = regs[2] & (1 << 27);
+    bool fma = regs[2] & (1 << 12);
+    if (!osxsave || !fma || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+    __cpuidex(regs, 7, 0);
+    return regs[1] & (1 << 5);
+#endif
+}
+
+#endif  // CULL_X86
+
+#ifdef CULL_NEON
+
+inline uint32_t laneMask(uint32x4_t inside) {
+    const uint32_t bits[4] = {1, 2, 4, 8};
+    return vaddvq_u32(vandq_u32(inside, vld1q_u32(bits)));
+}
+
+uint32_t cullSpheresNeon(
+    const Frustum& frustum, const SphereBounds& b, uint32_t first, uint32_t count, uint32_t* out
+) {
+    uint32_t visible = 0;
+    uint32_t i = first;
+    uint32_t end = first + count;
+    for (; i + 4 <= end; i += 4) {
+        float32x4_t x = vld1q_f32(&b.x[i]);
+        float32x4_t y = vld1q_f32(&b.y[i]);
+        float32x4_t z = vld1q_f32(&b.z[i]);
+        float32x4_t negRadius = vnegq_f32(vld1q_f32(&b.radius[i]));
+        uint32x4_t inside = vdupq_n_u32(~0u);
+        for (const Plane& p : frustum.planes) {
+            float32x4_t distance = vfmaq_n_f32(vfmaq_n_f32(vfmaq_n_f32(vdupq_n_f32(p.d), z, p.z), y, p.y), x, p.x);
+            inside = vandq_u32(inside, vcgeq_f32(distance, negRadius));
+        }
+        visible += appendLanes(laneMask(inside), i, out + visible);
+    }
+    return visible + cullSpheresScalar(frustum, b, i, end - i, out + visible);
+}
+
+uint32_t cullBoxesNeon(
+    const Frustum& frustum, const BoxBounds& b, uint32_t first, uint32_t count, uint32_t* out
+) {
+    uint32_t visible = 0;
+    uint32_t i = first;
+    uint32_t end = first + count;
+    for (; i + 4 <= end; i += 4) {
+        float32x4_t cx = vld1q_f32(&b.centerX[i]);
+        float32x4_t cy = vld1q_f32(&b.centerY[i]);
+        float32x4_t cz = vld1q_f32(&b.centerZ[i]);
+        float32x4_t ex = vld1q_f32(&b.extentX[i]);
+        float32x4_t ey = vld1q_f32(&b.extentY[i]);
+        float32x4_t ez = vld1q_f32(&b.extentZ[i]);
+        uint32x4_t inside = vdupq_n_u32(~0u);
+        for (const Plane& p : frustum.planes) {
+            float32x4_t reach = vfmaq_n_f32(vfmaq_n_f32(vfmaq_n_f32(vdupq_n_f32(p.d), cz, p.z), cy, p.y), cx, p.x);
+            reach = vfmaq_n_f32(reach, ex, std::abs(p.x));
+            reach = vfmaq_n_f32(reach, ey, std::abs(p.y));
+            reach = vfmaq_n_f32(reach, ez, std::abs(p.z));
+            inside = vandq_u32(inside, vcgeq_f32(reach, vdupq_n_f32(0.f)));
+        }
+        visible += appendLanes(laneMask(inside), i, out + visible);
+    }
+    return visible + cullBoxesScalar(frustum, b, i, end - i, out + visible);
+}
+
+#endif  // CULL_NEON
+
+}  // namespace
+
+const char* toString(FrustumCuller::Isa isa) {
+    switch (isa) {
+        case FrustumCuller::Isa::eScalar:
+            return "scalar";
+        case FrustumCuller::Isa::eSse2:
+            return "SSE2";
+        case FrustumCuller::Isa::eAvx2:
+            return "AVX2";
+        case FrustumCuller::Isa::eNeon:
+            return "NEON";
+    }
+    return "unknown";
+}
+
+Frustum Frustum::fromMatrix(std::span<const float, 16> m) {
+    auto row = [&](int i) {
+        return std::array{m[i], m[4 + i], m[8 + i], m[12 + i]};
+    };
+    auto r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+    auto combine = [](const std::array<float, 4>& a, const std::array<float, 4>& b, float sign) {
+        return normalized(a[0] + sign * b[0], a[1] + sign * b[1], a[2] + sign * b[2], a[3] + sign * b[3]);
+    };
+    return {{
+        combine(r3, r0, 1.f),
+        combine(r3, r0, -1.f),
+        combine(r3, r1, 1.f),
+        combine(r3, r1, -1.f),
+        normalized(r2[0], r2[1], r2[2], r2[3]),  // z >= 0
+        combine(r3, r2, -1.f),
+    }};
+}
+
+void SphereBounds::clear() {
+    x.clear();
+    y.clear();
+    z.clear();
+    radius.clear();
+}
+
+void SphereBounds::push_back(float cx, float cy, float cz, float r) {
+    x.push_back(cx);
+    y.push_back(cy);
+    z.push_back(cz);
+    radius.push_back(r);
+}
+
+void BoxBounds::clear() {
+    centerX.clear();
+    centerY.clear();
+    centerZ.clear();
+    extentX.clear();
+    extentY.clear();
+    extentZ.clear();
+}
+
+void BoxBounds::push_back(float cx, float cy, float cz, float ex, float ey, float ez) {
+    centerX.push_back(cx);
+    centerY.push_back(cy);
+    centerZ.push_back(cz);
+    extentX.push_back(ex);
+    extentY.push_back(ey);
+    extentZ.push_back(ez);
+}
+
+bool FrustumCuller::supports(Isa isa) {
+    switch (isa) {
+        case Isa::eScalar:
+            return true;
+#ifdef CULL_X86
+        case Isa::eSse2:
+            return true;
+        case Isa::eAvx2: {
+            static const bool avx2 = cpuHasAvx2();
+            return avx2;
+        }
+#endif
+#ifdef CULL_NEON
+        case Isa::eNeon:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+FrustumCuller::Isa FrustumCuller::bestIsa() {
+    for (Isa isa : {Isa::eAvx2, Isa::eSse2, Isa::eNeon}) {
+        if (supports(isa)) {
+            return isa;
+        }
+    }
+    return Isa::eScalar;
+}
+
+uint32_t FrustumCuller::cullSpheres(
+    Isa isa, const Frustum& frustum, const SphereBounds& bounds, uint32_t first, uint32_t count, uint32_t* out
+) {
+    switch (isa) {
+#ifdef CULL_X86
+        case Isa::eSse2:
+            return cullSpheresSse2(frustum, bounds, first, count, out);
+        case Isa::eAvx2:
+            return cullSpheresAvx2(frustum, bounds, first, count, out);
+#endif
+#ifdef CULL_NEON
+        case Isa::eNeon:
+            return cullSpheresNeon(frustum, bounds, first, count, out);
+#endif
+        default:
+            return cullSpheresScalar(frustum, bounds, first, count, out);
+    }
+}
+
+uint32_t FrustumCuller::cullBoxes(
+    Isa isa, const Frustum& frustum, const BoxBounds& bounds, uint32_t first, uint32_t count, uint32_t* out
+) {
+    switch (isa) {
+#ifdef CULL_X86
+        case Isa::eSse2:
+            return cullBoxesSse2(frustum, bounds, first, count, out);
+        case Isa::eAvx2:
+            return cullBoxesAvx2(frustum, bounds, first, count, out);
+#endif
+#ifdef CULL_NEON
+        case Isa::eNeon:
+            return cullBoxesNeon(frustum, bounds, first, count, out);
+#endif
+        default:
+            return cullBoxesScalar(frustum, bounds, first, count, out);
+    }
+}
+
+FrustumCuller::FrustumCuller(uint32_t workerCount) {
+    for (uint32_t i = 0; i < workerCount; i++) {
+        workers.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+FrustumCuller::~FrustumCuller() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void FrustumCuller::workerLoop() {
+    TRACE_THREAD_NAME("cull worker");
+    uint64_t seen = 0;
+    std::unique_lock lock(mutex);
+    while (true) {
+        wake.wait(lock, [&]() { return stopping || generation != seen; });
+        if (stopping) {
+            return;
+        }
+        seen = generation;
+        busyWorkers++;
+        lock.unlock();
+        runChunks();
+        lock.lock();
+        busyWorkers--;
+        done.notify_all();
+    }
+}
+
+void FrustumCuller::runChunks() {
+    while (true) {
+        uint32_t chunk = nextChunk.fetch_add(1, std::memory_order_relaxed);
+        if (chunk >= job.chunkCount) {
+            return;
+        }
+        uint32_t first = chunk * CHUNK_SIZE;
+        uint32_t count = std::min(CHUNK_SIZE, job.objectCount - first);
+        uint32_t* out = indices.get() + first;
+        chunkVisible[chunk] = job.spheres != nullptr
+                                  ? cullSpheres(active, *job.frustum, *job.spheres, first, count, out)
+                                  : cullBoxes(active, *job.frustum, *job.boxes, first, count, out);
+        if (chunksDone.fetch_add(1, std::memory_order_acq_rel) + 1 == job.chunkCount) {
+            std::lock_guard lock(mutex);
+            done.notify_all();
+        }
+    }
+}
+
+std::span<const uint32_t> FrustumCuller::run(const Job& next) {
+    TRACE_ZONE("frustum cull");
+    if (next.objectCount == 0) {
+        return {};
+    }
+    if (indexCapacity < next.objectCount) {
+        indices = std::make_unique_for_overwrite<uint32_t[]>(next.objectCount);
+        indexCapacity = next.objectCount;
+    }
+    uint32_t chunkCount = (next.objectCount + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    chunkVisible.resize(chunkCount);
+
+    std::unique_lock lock(mutex);
+    // a worker still inside the previous job reads `job` unlocked
+    done.wait(lock, [&]() { return busyWorkers == 0; });
+    job = next;
+    job.chunkCount = chunkCount;
+    nextChunk.store(0, std::memory_order_relaxed);
+    chunksDone.store(0, std::memory_order_relaxed);
+    generation++;
+    lock.unlock();
+    wake.notify_all();
+
+    runChunks();
+    lock.lock();
+    done.wait(lock, [&]() { return chunksDone.load(std::memory_order_acquire) == chunkCount; });
+    lock.unlock();
+
+    // pack the chunks, each one's indices start at its first object
+    uint32_t total = chunkVisible[0];
+    for (uint32_t chunk = 1; chunk < chunkCount; chunk++) {
+        std::memmove(
+            indices.get() + total, indices.get() + chunk * CHUNK_SIZE, chunkVisible[chunk] * sizeof(uint32_t)
+        );
+        total += chunkVisible[chunk];
+    }
+    return {indices.get(), total};
+}
+
+std::span<const uint32_t> FrustumCuller::cull(const Frustum& frustum, const SphereBounds& bounds) {
+    return run({.frustum = &frustum, .spheres = &bounds, .objectCount = static_cast<uint32_t>(bounds.size())});
+}
+
+std::span<const uint32_t> FrustumCuller::cull(const Frustum& frustum, const BoxBounds& bounds) {
+    return run({.frustum = &frustum, .boxes = &bounds, .objectCount = static_cast<uint32_t>(bounds.size())});
+}
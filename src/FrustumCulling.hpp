@@ -0,0 +1,147 @@
+#ifndef FRUSTUMCULLING_HPP
+#define FRUSTUMCULLING_HPP
+
+// c++ std libs
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "utils.hpp"
+
+// dot(normal, p) + d >= 0 on the inside
+struct Plane {
+    float x, y, z, d;
+};
+
+struct Frustum {
+    std::array<Plane, 6> planes;  // left, right, bottom, top, near, far
+
+    // Gribb-Hartmann extraction from a column-major view-projection matrix
+    // (glm layout, Vulkan's [0, 1] clip depth), planes normalized.
+    static Frustum fromMatrix(std::span<const float, 16> columnMajor);
+};
+
+// Bounding spheres as structure-of-arrays, one lane per object in the kernels.
+struct SphereBounds {
+    std::vector<float> x, y, z, radius;
+
+    size_t size() const {
+        return x.size();
+    }
+    void clear();
+    void push_back(float cx, float cy, float cz, float r);
+};
+
+// Axis-aligned boxes in center / half-extent form.
+struct BoxBounds {
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+
+    size_t size() const {
+        return centerX.size();
+    }
+    void clear();
+    void push_back(float cx, float cy, float cz, float ex, float ey, float ez);
+};
+
+/*
+ * Frustum culling over SoA bounds. The kernels test 4 (SSE2, NEON) or 8
+ * (AVX2) objects against all six planes at once; the widest one the CPU
+ * supports is picked at runtime and the scalar kernel is the reference.
+ *
+ * cull() splits the objects into chunks that the calling thread and a pool
+ * of workers claim from an atomic counter. Each chunk writes its visible
+ * indices at its own offset, the chunks are then packed together, so the
+ * result is in ascending index order regardless of the thread count.
+ *
+ *     FrustumCuller culler;
+ *     auto visible = culler.cull(Frustum::fromMatrix(viewProj), spheres);
+ *     for (uint32_t index : visible) { record draw... }
+ */
+class FrustumCuller {
+public:
+    enum class Isa {
+        eScalar,
+        eSse2,
+        eAvx2,
+        eNeon,
+    };
+
+    // Write the visible indices of [first, first + count) to `out` and return
+    // how many there are. `out` may be written up to 8 entries past the result,
+    // but never past out + count.
+    static uint32_t cullSpheres(
+        Isa isa, const Frustum& frustum, const SphereBounds& bounds, uint32_t first, uint32_t count, uint32_t* out
+    );
+    static uint32_t cullBoxes(
+        Isa isa, const Frustum& frustum, const BoxBounds& bounds, uint32_t first, uint32_t count, uint32_t* out
+    );
+    static bool supports(Isa isa);
+    // the widest kernel this CPU runs
+    static Isa bestIsa();
+
+private:
+    static constexpr uint32_t CHUNK_SIZE = 16384;  // multiple of every kernel's width
+
+    struct Job {
+        const Frustum* frustum = nullptr;
+        const SphereBounds* spheres = nullptr;
+        const BoxBounds* boxes = nullptr;
+        uint32_t objectCount = 0;
+        uint32_t chunkCount = 0;
+    };
+
+    Isa active = bestIsa();
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    uint64_t generation = 0;  // bumped for every job, guarded by `mutex`
+    uint32_t busyWorkers = 0;
+    bool stopping = false;
+    Job job;
+    std::atomic<uint32_t> nextChunk{0};
+    std::atomic<uint32_t> chunksDone{0};
+
+    // visible indices, chunk c first written at c * CHUNK_SIZE
+    std::unique_ptr<uint32_t[]> indices;
+    size_t indexCapacity = 0;
+    std::vector<uint32_t> chunkVisible;
+
+    void workerLoop();
+    void runChunks();
+    std::span<const uint32_t> run(const Job& next);
+
+public:
+    // 0 workers culls on the calling thread only
+    explicit FrustumCuller(uint32_t workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1);
+    ~FrustumCuller();
+    DISABLE_COPY(FrustumCuller)
+
+    Isa isa() const {
+        return active;
+    }
+    // Falls back to the scalar kernel when the CPU lacks `isa`.
+    void setIsa(Isa isa) {
+        active = supports(isa) ? isa : Isa::eScalar;
+    }
+    uint32_t threadCount() const {
+        return static_cast<uint32_t>(workers.size()) + 1;
+    }
+
+    // Visible indices in ascending order, valid until the next cull().
+    std::span<const uint32_t> cull(const Frustum& frustum, const SphereBounds& bounds);
+    std::span<const uint32_t> cull(const Frustum& frustum, const BoxBounds& bounds);
+};
+
+const char* toString(FrustumCuller::Isa isa);
+
+#endif  // FRUSTUMCULLING_HPP
@@ -0,0 +1,38 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+// c++ std libs
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include "utils.hpp"
+
+/*
+ * Read-only view of a whole file, mmapped on POSIX and read into memory on
+ * Windows. Pages are only faulted in when touched, so large assets can be
+ * opened up front and consumed piecewise.
+ */
+class MappedFile {
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    std::vector<uint8_t> fallback;
+
+public:
+    MappedFile() = default;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    ~MappedFile();
+    DISABLE_COPY(MappedFile)
+
+    bool open(const std::filesystem::path& path);
+    void close();
+    std::span<const uint8_t> bytes() const {
+        return {data, size};
+    }
+};
+
+#endif  // MAPPEDFILE_HPP
@@ -0,0 +1,200 @@
+#include "MemoryBudget.hpp"
+
+// std c++
+#include <algorithm>
+#include <utility>
+
+// project
+#include "Trace.hpp"
+
+namespace {
+// TRACE_COUNTER keeps the name pointer, so it has to be a literal per heap
+constexpr const char* HEAP_COUNTER_NAMES[] = {
+    "heap 0 usage MiB", "heap 1 usage MiB", "heap 2 usage MiB", "heap 3 usage MiB",
+    "heap 4 usage MiB", "heap 5 usage MiB", "heap 6 usage MiB", "heap 7 usage MiB",
+};
+}  // namespace
+
+const char* toString(MemoryCategory category) {
+    switch (category) {
+        case MemoryCategory::eBuffer:
+            return "buffers";
+        case MemoryCategory::eImage:
+            return "images";
+        case MemoryCategory::eStaging:
+            return "staging";
+        case MemoryCategory::eReadback:
+            return "readback";
+        case MemoryCategory::eUi:
+            return "ui";
+    }
+    return "unknown";
+}
+
+DeviceAllocation::DeviceAllocation(
+    vk::raii::DeviceMemory&& memory,
+    MemoryBudget* budget,
+    vk::DeviceSize size,
+    uint32_t heap,
+    MemoryCategory category
+)
+    : memory(std::move(memory)), budget(budget), size(size), heap(heap), category(category) {}
+
+DeviceAllocation::DeviceAllocation(DeviceAllocation&& other) noexcept
+    : memory(std::move(other.memory)),
+      budget(std::exchange(other.budget, nullptr)),
+      size(std::exchange(other.size, 0)),
+      heap(other.heap),
+      category(other.category) {}
+
+DeviceAllocation& DeviceAllocation::operator=(DeviceAllocation&& other) noexcept {
+    if (this != &other) {
+        release();
+        memory = std::move(other.memory);
+        budget = std::exchange(other.budget, nullptr);
+        size = std::exchange(other.size, 0);
+        heap = other.heap;
+        category = other.category;
+    }
+    return *this;
+}
+
+DeviceAllocation::~DeviceAllocation() {
+    release();
+}
+
+void DeviceAllocation::release() {
+    memory = nullptr;
+    if (budget != nullptr) {
+        budget->release(heap, category, size);
+        budget = nullptr;
+        size = 0;
+    }
+}
+
+void MemoryBudget::init(const DeviceProfile& profile, bool budgetExtension) {
+    std::lock_guard lock(mutex);
+    this->profile = &profile;
+    useExtension = budgetExtension;
+    heaps.assign(profile.memory.memoryHeapCount, {});
+    for (uint32_t i = 0; i < profile.memory.memoryHeapCount; i++) {
+        const auto& heap = profile.memory.memoryHeaps[i];
+        heaps[i].stats.size = heap.size;
+        heaps[i].stats.budget = static_cast<vk::DeviceSize>(heap.size * fallbackBudgetRatio);
+        heaps[i].stats.deviceLocal = static_cast<bool>(heap.flags & vk::MemoryHeapFlagBits::eDeviceLocal);
+    }
+}
+
+DeviceAllocation MemoryBudget::allocate(
+    const vk::raii::Device& device, const vk::MemoryAllocateInfo& info, MemoryCategory category
+) {
+    uint32_t heap = profile->memory.memoryTypes[info.memoryTypeIndex].heapIndex;
+    // allocate outside the lock, the driver call is the slow part
+    vk::raii::DeviceMemory memory(device, info);
+    {
+        std::lock_guard lock(mutex);
+        heaps[heap].stats.tracked += info.allocationSize;
+        categoryBytes[static_cast<size_t>(category)] += info.allocationSize;
+        allocationCount++;
+    }
+    return {std::move(memory), this, info.allocationSize, heap, category};
+}
+
+void MemoryBudget::release(uint32_t heap, MemoryCategory category, vk::DeviceSize size) {
+    std::lock_guard lock(mutex);
+    heaps[heap].stats.tracked -= size;
+    categoryBytes[static_cast<size_t>(category)] -= size;
+    allocationCount--;
+}
+
+void MemoryBudget::setUiBytes(vk::DeviceSize bytes) {
+    std::lock_guard lock(mutex);
+    auto& total = categoryBytes[static_cast<size_t>(MemoryCategory::eUi)];
+    total = total - uiBytes + bytes;
+    uiBytes = bytes;
+}
+
+uint32_t MemoryBudget::addPressureCallback(PressureCallback callback) {
+    std::lock_guard lock(mutex);
+    uint32_t id = nextCallbackId++;
+    callbacks.emplace_back(id, std::move(callback));
+    return id;
+}
+
+void MemoryBudget::removePressureCallback(uint32_t id) {
+    std::lock_guard lock(mutex);
+    std::erase_if(callbacks, [id](const auto& entry) { return entry.first == id; });
+}
+
+void MemoryBudget::update() {
+    TRACE_FUNCTION();
+    if (profile == nullptr) {
+        return;
+    }
+    std::vector<Pressure> pressure;
+    std::vector<PressureCallback> listeners;
+    {
+        std::lock_guard lock(mutex);
+        if (useExtension) {
+            auto chain = profile->device.getMemoryProperties2<
+                vk::PhysicalDeviceMemoryProperties2,
+                vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+            const auto& budget = chain.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+            for (uint32_t i = 0; i < heaps.size(); i++) {
+                heaps[i].stats.budget = budget.heapBudget[i];
+                heaps[i].stats.usage = budget.heapUsage[i];
+            }
+        } else {
+            for (auto& heap : heaps) {
+                heap.stats.usage = heap.stats.tracked;
+            }
+        }
+
+        for (uint32_t i = 0; i < heaps.size(); i++) {
+            auto& heap = heaps[i];
+            auto threshold = static_cast<vk::DeviceSize>(heap.stats.budget * pressureThreshold);
+            if (i < std::size(HEAP_COUNTER_NAMES)) {
+                TRACE_COUNTER(HEAP_COUNTER_NAMES[i], heap.stats.usage / double(1 << 20));
+            }
+            if (heap.stats.usage <= threshold) {
+                heap.underPressure = false;
+                continue;
+            }
+            if (!heap.underPressure || ++heap.framesSincePressure >= pressureRepeatFrames) {
+                heap.underPressure = true;
+                heap.framesSincePressure = 0;
+                pressure.push_back({
+                    .heap = i,
+                    .usage = heap.stats.usage,
+                    .budget = heap.stats.budget,
+                    .bytesOver = heap.stats.usage - threshold,
+                });
+            }
+        }
+        if (!pressure.empty()) {
+            for (const auto& [id, callback] : callbacks) {
+                listeners.push_back(callback);
+            }
+        }
+    }
+    // callbacks free memory, which takes the lock again
+    for (const auto& event : pressure) {
+        for (const auto& callback : listeners) {
+            callback(event);
+        }
+    }
+}
+
+MemoryBudget::Stats MemoryBudget::stats() const {
+    std::lock_guard lock(mutex);
+    Stats result{
+        .heapCount = static_cast<uint32_t>(heaps.size()),
+        .categoryBytes = categoryBytes,
+        .allocationCount = allocationCount,
+        .fromExtension = useExtension,
+    };
+    for (uint32_t i = 0; i < heaps.size(); i++) {
+        result.heaps[i] = heaps[i].stats;
+    }
+    return result;
+}
@@ -0,0 +1,163 @@
+#ifndef MEMORYBUDGET_HPP
+#define MEMORYBUDGET_HPP
+
+// c++ std libs
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// vulkan-hpp headers
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "DeviceProfile.hpp"
+#include "utils.hpp"
+
+enum class MemoryCategory : uint32_t {
+    eBuffer,
+    eImage,
+    eStaging,
+    eReadback,
+    eUi,  // estimated from ImGui's textures, the backend allocates on its own
+};
+constexpr size_t MEMORY_CATEGORY_COUNT = 5;
+
+const char* toString(MemoryCategory category);
+
+class MemoryBudget;
+
+/*
+ * vk::raii::DeviceMemory that reports its size back to the MemoryBudget it
+ * was allocated from when it is freed.
+ */
+class DeviceAllocation {
+private:
+    vk::raii::DeviceMemory memory = nullptr;
+    MemoryBudget* budget = nullptr;
+    vk::DeviceSize size = 0;
+    uint32_t heap = 0;
+    MemoryCategory category = MemoryCategory::eBuffer;
+
+    void release();
+
+public:
+    DeviceAllocation() = default;
+    DeviceAllocation(std::nullptr_t) {}
+    DeviceAllocation(
+        vk::raii::DeviceMemory&& memory,
+        MemoryBudget* budget,
+        vk::DeviceSize size,
+        uint32_t heap,
+        MemoryCategory category
+    );
+    DeviceAllocation(DeviceAllocation&& other) noexcept;
+    DeviceAllocation& operator=(DeviceAllocation&& other) noexcept;
+    ~DeviceAllocation();
+    DISABLE_COPY(DeviceAllocation)
+
+    const vk::raii::DeviceMemory& get() const {
+        return memory;
+    }
+    vk::DeviceMemory operator*() const {
+        return *memory;
+    }
+    vk::DeviceSize getSize() const {
+        return size;
+    }
+    uint32_t getHeap() const {
+        return heap;
+    }
+};
+
+/*
+ * Accounting for device memory: every allocation made through allocate() is
+ * tracked per heap and per category, and update() refreshes the per-heap
+ * usage and budget from VK_EXT_memory_budget when the device has it (usage
+ * then also covers memory we don't allocate ourselves, e.g. the ImGui
+ * backend and driver internals). Without the extension the budget falls back
+ * to a fraction of the heap size and usage to what we tracked.
+ *
+ * Pressure callbacks fire when a heap goes over `pressureThreshold` of its
+ * budget and then every `pressureRepeatFrames` updates while it stays there,
+ * so caches get a chance to evict before allocations start failing.
+ */
+class MemoryBudget {
+public:
+    struct HeapStats {
+        vk::DeviceSize size = 0;
+        vk::DeviceSize budget = 0;
+        vk::DeviceSize usage = 0;
+        vk::DeviceSize tracked = 0;
+        bool deviceLocal = false;
+
+        double usageRatio() const {
+            return budget > 0 ? static_cast<double>(usage) / budget : 0.0;
+        }
+    };
+    // copied into the UI every frame, so fixed size
+    struct Stats {
+        std::array<HeapStats, VK_MAX_MEMORY_HEAPS> heaps{};
+        uint32_t heapCount = 0;
+        std::array<vk::DeviceSize, MEMORY_CATEGORY_COUNT> categoryBytes{};
+        uint32_t allocationCount = 0;
+        bool fromExtension = false;
+    };
+    struct Pressure {
+        uint32_t heap;
+        vk::DeviceSize usage;
+        vk::DeviceSize budget;
+        // how much has to go to get back under the threshold
+        vk::DeviceSize bytesOver;
+    };
+    using PressureCallback = std::function<void(const Pressure&)>;
+
+    float pressureThreshold = 0.9f;
+    // budget used for heaps when VK_EXT_memory_budget is missing
+    float fallbackBudgetRatio = 0.8f;
+    uint32_t pressureRepeatFrames = 60;
+
+private:
+    struct Heap {
+        HeapStats stats;
+        bool underPressure = false;
+        uint32_t framesSincePressure = 0;
+    };
+
+    const DeviceProfile* profile = nullptr;
+    bool useExtension = false;
+    mutable std::mutex mutex;
+    std::vector<Heap> heaps;
+    std::array<vk::DeviceSize, MEMORY_CATEGORY_COUNT> categoryBytes{};
+    vk::DeviceSize uiBytes = 0;
+    uint32_t allocationCount = 0;
+    std::vector<std::pair<uint32_t, PressureCallback>> callbacks;
+    uint32_t nextCallbackId = 0;
+
+    friend class DeviceAllocation;
+    void release(uint32_t heap, MemoryCategory category, vk::DeviceSize size);
+
+public:
+    MemoryBudget() = default;
+    DISABLE_COPY(MemoryBudget)
+
+    // `budgetExtension`: VK_EXT_memory_budget was enabled on the device.
+    void init(const DeviceProfile& profile, bool budgetExtension);
+
+    DeviceAllocation allocate(
+        const vk::raii::Device& device, const vk::MemoryAllocateInfo& info, MemoryCategory category
+    );
+    // The ImGui backend allocates its textures itself; report their estimated size.
+    void setUiBytes(vk::DeviceSize bytes);
+
+    uint32_t addPressureCallback(PressureCallback callback);
+    void removePressureCallback(uint32_t id);
+
+    // Refresh usage / budget and fire pressure callbacks, once per frame.
+    void update();
+    Stats stats() const;
+};
+
+#endif  // MEMORYBUDGET_HPP
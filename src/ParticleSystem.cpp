@@ -0,0 +1,572 @@
+#include "ParticleSystem.hpp"
+
+// std c++
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <print>
+
+// vulkan
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+// project
+#include "Trace.hpp"
+
+namespace {
+
+// numthreads of the per-particle entry points in shaders/particles.hlsl
+constexpr uint32_t GROUP_SIZE = 256;
+constexpr uint32_t MIN_CAPACITY = 1u << 10;
+constexpr uint32_t MAX_CAPACITY = 1u << 23;
+
+// byte offsets into the args buffer, DRAW_ARGS / EMIT_ARGS / SIMULATE_ARGS in the shader
+constexpr vk::DeviceSize DRAW_ARGS_OFFSET = 0;
+constexpr vk::DeviceSize EMIT_ARGS_OFFSET = 4 * sizeof(uint32_t);
+constexpr vk::DeviceSize SIMULATE_ARGS_OFFSET = 8 * sizeof(uint32_t);
+constexpr vk::DeviceSize ARGS_BYTES = 12 * sizeof(uint32_t);
+
+constexpr vk::ShaderStageFlags PARAMS_STAGES =
+    vk::ShaderStageFlagBits::eCompute | vk::ShaderStageFlagBits::eVertex;
+
+// Sections of the state buffer, in binding order.
+enum Section : uint32_t {
+    ePositions,
+    eVelocities,
+    eColors,
+    eDeadList,
+    eAliveLists,
+    eCounters,
+    SECTION_COUNT,
+};
+// the args buffer follows the state sections
+constexpr uint32_t ARGS_BINDING = SECTION_COUNT;
+constexpr uint32_t BINDING_COUNT = SECTION_COUNT + 1;
+
+struct StateLayout {
+    std::array<vk::DeviceSize, SECTION_COUNT> offset;
+    std::array<vk::DeviceSize, SECTION_COUNT> size;
+    vk::DeviceSize total = 0;
+};
+
+StateLayout stateLayout(uint32_t capacity, vk::DeviceSize alignment) {
+    vk::DeviceSize n = capacity;
+    StateLayout layout;
+    layout.size = {
+        n * 4 * sizeof(float),     // positions
+        n * 4 * sizeof(float),     // velocities
+        n * sizeof(uint32_t),      // colors
+        n * sizeof(uint32_t),      // dead list
+        2 * n * sizeof(uint32_t),  // alive lists
+        4 * sizeof(int32_t),       // counters
+    };
+    for (uint32_t i = 0; i < SECTION_COUNT; i++) {
+        layout.total = (layout.total + alignment - 1) / alignment * alignment;
+        layout.offset[i] = layout.total;
+        layout.total += layout.size[i];
+    }
+    return layout;
+}
+
+uint32_t groupCount(uint32_t threads) {
+    return (threads + GROUP_SIZE - 1) / GROUP_SIZE;
+}
+
+// how the compute stages use both buffers: storage and dispatch arguments
+constexpr vk::PipelineStageFlags2 COMPUTE_STAGES =
+    vk::PipelineStageFlagBits2::eComputeShader | vk::PipelineStageFlagBits2::eDrawIndirect;
+constexpr vk::AccessFlags2 COMPUTE_ACCESS = vk::AccessFlagBits2::eShaderStorageRead |
+                                            vk::AccessFlagBits2::eShaderStorageWrite |
+                                            vk::AccessFlagBits2::eIndirectCommandRead;
+
+// makes one dispatch's writes visible to the next, the render graph no longer
+// sees the compute stages
+void computeBarrier(const vk::raii::CommandBuffer& cmd) {
+    vk::MemoryBarrier2 barrier{
+        .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+        .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+        .dstStageMask = COMPUTE_STAGES,
+        .dstAccessMask = COMPUTE_ACCESS
+    };
+    cmd.pipelineBarrier2({.memoryBarrierCount = 1, .pMemoryBarriers = &barrier});
+}
+
+vk::raii::Pipeline createComputePipeline(
+    const vk::raii::Device& device,
+    const vk::raii::ShaderModule& module,
+    const vk::raii::PipelineLayout& layout,
+    const char* entry
+) {
+    return {device, nullptr, vk::ComputePipelineCreateInfo{
+        .stage = {.stage = vk::ShaderStageFlagBits::eCompute, .module = module, .pName = entry},
+        .layout = layout
+    }};
+}
+
+// Additive quads, no vertex input: everything is pulled from the SoA buffers.
+vk::raii::Pipeline createDrawPipeline(
+    const vk::raii::Device& device,
+    const vk::raii::ShaderModule& module,
+    const vk::raii::PipelineLayout& layout,
+    vk::Format colorFormat
+) {
+    vk::PipelineShaderStageCreateInfo shaderStages[] = {
+        {.stage = vk::ShaderStageFlagBits::eVertex, .module = module, .pName = "vertMain"},
+        {.stage = vk::ShaderStageFlagBits::eFragment, .module = module, .pName = "fragMain"},
+    };
+    vk::PipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vk::PipelineInputAssemblyStateCreateInfo inputAssembly{
+        .topology = vk::PrimitiveTopology::eTriangleList
+    };
+    vk::PipelineViewportStateCreateInfo viewportState{
+        .viewportCount = 1, .scissorCount = 1
+    };
+    vk::PipelineRasterizationStateCreateInfo rasterizer{
+        .depthClampEnable = vk::False,
+        .rasterizerDiscardEnable = vk::False,
+        .polygonMode = vk::PolygonMode::eFill,
+        .cullMode = vk::CullModeFlagBits::eNone,
+        .frontFace = vk::FrontFace::eClockwise,
+        .depthBiasEnable = vk::False,
+        .lineWidth = 1.0f
+    };
+    vk::PipelineMultisampleStateCreateInfo multisampling{
+        .rasterizationSamples = vk::SampleCountFlagBits::e1,
+        .sampleShadingEnable = vk::False
+    };
+    vk::PipelineColorBlendAttachmentState colorBlendAttachment{
+        .blendEnable = vk::True,
+        .srcColorBlendFactor = vk::BlendFactor::eSrcAlpha,
+        .dstColorBlendFactor = vk::BlendFactor::eOne,
+        .colorBlendOp = vk::BlendOp::eAdd,
+        .srcAlphaBlendFactor = vk::BlendFactor::eZero,
+        .dstAlphaBlendFactor = vk::BlendFactor::eOne,
+        .alphaBlendOp = vk::BlendOp::eAdd,
+        .colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+                          vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA
+    };
+    vk::PipelineColorBlendStateCreateInfo colorBlending{
+        .logicOpEnable = vk::False,
+        .attachmentCount = 1,
+        .pAttachments = &colorBlendAttachment
+    };
+    std::array dynamicStates = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+    vk::PipelineDynamicStateCreateInfo dynamicState{
+        .dynamicStateCount = static_cast<uint32_t>(dynamicStates.size()),
+        .pDynamicStates = dynamicStates.data()
+    };
+
+    vk::StructureChain pipelineCreateInfoChain{
+        vk::GraphicsPipelineCreateInfo{
+            .stageCount = 2,
+            .pStages = shaderStages,
+            .pVertexInputState = &vertexInputInfo,
+            .pInputAssemblyState = &inputAssembly,
+            .pViewportState = &viewportState,
+            .pRasterizationState = &rasterizer,
+            .pMultisampleState = &multisampling,
+            .pColorBlendState = &colorBlending,
+            .pDynamicState = &dynamicState,
+            .layout = layout,
+            .renderPass = nullptr
+        },
+        vk::PipelineRenderingCreateInfo{
+            .colorAttachmentCount = 1,
+            .pColorAttachmentFormats = &colorFormat
+        }
+    };
+    return {device, nullptr, pipelineCreateInfoChain.get<vk::GraphicsPipelineCreateInfo>()};
+}
+
+}  // namespace
+
+void ParticleSystem::init(
+    const DeviceProfile& profile,
+    const vk::raii::Device& device,
+    MemoryBudget& budget,
+    QueueScheduler& scheduler,
+    uint32_t framesInFlight,
+    std::span<const char> computeSpv,
+    std::span<const char> drawSpv,
+    vk::Format colorFormat
+) {
+    this->profile = &profile;
+    this->device = &device;
+    this->budget = &budget;
+    this->scheduler = &scheduler;
+
+    std::array<vk::DescriptorSetLayoutBinding, BINDING_COUNT> bindings;
+    for (uint32_t i = 0; i < BINDING_COUNT; i++) {
+        bindings[i] = {
+            .binding = i,
+            .descriptorType = vk::DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = PARAMS_STAGES
+        };
+    }
+    setLayout = vk::raii::DescriptorSetLayout(device, vk::DescriptorSetLayoutCreateInfo{
+        .bindingCount = static_cast<uint32_t>(bindings.size()),
+        .pBindings = bindings.data()
+    });
+    vk::PushConstantRange pushConstants{
+        .stageFlags = PARAMS_STAGES, .offset = 0, .size = sizeof(Params)
+    };
+    layout = vk::raii::PipelineLayout(device, vk::PipelineLayoutCreateInfo{
+        .setLayoutCount = 1,
+        .pSetLayouts = &*setLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstants
+    });
+
+    auto shaderModule = [&](std::span<const char> spv) {
+        return vk::raii::ShaderModule(device, vk::ShaderModuleCreateInfo{
+            .codeSize = spv.size(),
+            .pCode = reinterpret_cast<const uint32_t*>(spv.data())
+        });
+    };
+    auto computeModule = shaderModule(computeSpv);
+    resetPipeline = createComputePipeline(device, computeModule, layout, "resetMain");
+    kickoffPipeline = createComputePipeline(device, computeModule, layout, "kickoffMain");
+    emitPipeline = createComputePipeline(device, computeModule, layout, "emitMain");
+    simulatePipeline = createComputePipeline(device, computeModule, layout, "simulateMain");
+    finishPipeline = createComputePipeline(device, computeModule, layout, "finishMain");
+    drawPipeline = createDrawPipeline(device, shaderModule(drawSpv), layout, colorFormat);
+
+    uint32_t queryCount = framesInFlight * STAGE_COUNT * 2;
+    timestamps = vk::raii::QueryPool(device, vk::QueryPoolCreateInfo{
+        .queryType = vk::QueryType::eTimestamp,
+        .queryCount = queryCount
+    });
+    timestamps.reset(0, queryCount);
+    slotWritten.assign(framesInFlight, 0);
+    computeTimestamps =
+        scheduler.getFamilies().timestampValidBits[static_cast<size_t>(QueueType::eCompute)] != 0;
+    simulations.resize(framesInFlight);
+    for (auto& simulation : simulations) {
+        simulation.cmd = scheduler.allocateCommandBuffer(QueueType::eCompute);
+    }
+
+    // positions and velocities are the largest sections a descriptor covers
+    const auto& limits = profile.properties.limits;
+    uint64_t maxCapacity = std::min<uint64_t>(
+        {MAX_CAPACITY,
+         limits.maxStorageBufferRange / (4 * sizeof(float)),
+         uint64_t{limits.maxComputeWorkGroupCount[0]} * GROUP_SIZE}
+    );
+    stats.maxCapacity = std::bit_floor(static_cast<uint32_t>(maxCapacity));
+    std::println("Particles: up to {} on this device", stats.maxCapacity);
+}
+
+/*
+ * New buffers start out with garbage, the reset pass fills the dead list
+ * before anything else runs. The old ones are retired until the frames that
+ * still use them have finished; each draw waited for its simulation, so the
+ * graphics timeline covers the compute queue too.
+ */
+void ParticleSystem::createStorage(uint32_t capacity) {
+    TRACE_FUNCTION();
+    const auto& limits = profile->properties.limits;
+    StateLayout sections = stateLayout(capacity, limits.minStorageBufferOffsetAlignment);
+
+    Storage created;
+    created.capacity = capacity;
+    auto allocate = [&](vk::raii::Buffer& buffer, vk::DeviceSize size, vk::BufferUsageFlags usage) {
+        buffer = vk::raii::Buffer(*device, vk::BufferCreateInfo{
+            .size = size,
+            .usage = usage,
+            .sharingMode = vk::SharingMode::eExclusive
+        });
+        vk::MemoryRequirements requirements = buffer.getMemoryRequirements();
+        auto memory = budget->allocate(
+            *device,
+            vk::MemoryAllocateInfo{
+                .allocationSize = requirements.size,
+                .memoryTypeIndex = findMemoryType(
+                    profile->memory, requirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal
+                )
+            },
+            MemoryCategory::eBuffer
+        );
+        buffer.bindMemory(*memory, 0);
+        return memory;
+    };
+    created.stateMemory = allocate(created.state, sections.total, vk::BufferUsageFlagBits::eStorageBuffer);
+    created.argsMemory = allocate(
+        created.args,
+        ARGS_BYTES,
+        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer
+    );
+
+    vk::DescriptorPoolSize poolSize{
+        .type = vk::DescriptorType::eStorageBuffer, .descriptorCount = BINDING_COUNT
+    };
+    created.pool = vk::raii::DescriptorPool(*device, vk::DescriptorPoolCreateInfo{
+        .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+        .maxSets = 1,
+        .poolSizeCount = 1,
+        .pPoolSizes = &poolSize
+    });
+    vk::raii::DescriptorSets sets(*device, vk::DescriptorSetAllocateInfo{
+        .descriptorPool = *created.pool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &*setLayout
+    });
+    created.set = std::move(sets.front());
+
+    std::array<vk::DescriptorBufferInfo, BINDING_COUNT> infos;
+    std::array<vk::WriteDescriptorSet, BINDING_COUNT> writes;
+    for (uint32_t i = 0; i < BINDING_COUNT; i++) {
+        infos[i] = i == ARGS_BINDING
+                       ? vk::DescriptorBufferInfo{.buffer = *created.args, .offset = 0, .range = ARGS_BYTES}
+                       : vk::DescriptorBufferInfo{
+                             .buffer = *created.state,
+                             .offset = sections.offset[i],
+                             .range = sections.size[i]
+                         };
+        writes[i] = {
+            .dstSet = *created.set,
+            .dstBinding = i,
+            .descriptorCount = 1,
+            .descriptorType = vk::DescriptorType::eStorageBuffer,
+            .pBufferInfo = &infos[i]
+        };
+    }
+    device->updateDescriptorSets(writes, {});
+
+    if (*storage.state != nullptr) {
+        scheduler->retire(
+            QueueType::eGraphics, scheduler->submittedValue(QueueType::eGraphics), std::move(storage)
+        );
+    }
+    storage = std::move(created);
+    needsReset = true;
+    drawReleased = false;
+    parity = 0;
+    stats.capacity = capacity;
+    stats.bytes = storage.stateMemory.getSize() + storage.argsMemory.getSize();
+    std::println("Particles: {} ({} MiB)", capacity, stats.bytes >> 20);
+}
+
+// eAllCommands waits for the earlier stages, so each one is measured on its own
+void ParticleSystem::writeTimestamp(const vk::raii::CommandBuffer& cmd, Stage stage, bool end) const {
+    if (stage != Stage::eDraw && !computeTimestamps) {
+        return;
+    }
+    uint32_t query = (frameSlot * STAGE_COUNT + static_cast<uint32_t>(stage)) * 2 + (end ? 1 : 0);
+    cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, *timestamps, query);
+}
+
+void ParticleSystem::readTimestamps(uint32_t slot) {
+    if (!slotWritten[slot]) {
+        return;
+    }
+    constexpr uint32_t COUNT = STAGE_COUNT * 2;
+    uint32_t first = slot * COUNT;
+    double period = profile->properties.limits.timestampPeriod;
+    // stage by stage: the compute ones are never written without compute timestamps
+    for (uint32_t i = 0; i < STAGE_COUNT; i++) {
+        if (static_cast<Stage>(i) != Stage::eDraw && !computeTimestamps) {
+            continue;
+        }
+        // getResult into a fixed array, getResults would allocate a vector every frame
+        auto [result, stamps] = timestamps.getResult<std::array<uint64_t, 2>>(
+            first + 2 * i, 2, sizeof(uint64_t), vk::QueryResultFlagBits::e64
+        );
+        if (result == vk::Result::eSuccess) {
+            uint64_t ticks = stamps[1] >= stamps[0] ? stamps[1] - stamps[0] : 0;
+            stats.stageMs[i] = ticks * period / 1e6;
+        }
+    }
+    timestamps.reset(first, COUNT);
+    slotWritten[slot] = 0;
+}
+
+void ParticleSystem::beginFrame(uint32_t slot, float frameSeconds) {
+    if (!ready()) {
+        return;
+    }
+    frameSlot = slot;
+    readTimestamps(slot);
+    if (!settings.enabled) {
+        return;
+    }
+
+    uint32_t capacity = std::clamp(std::bit_floor(settings.capacity), MIN_CAPACITY, stats.maxCapacity);
+    if (capacity != storage.capacity) {
+        try {
+            createStorage(capacity);
+        }
+        catch (const vk::OutOfDeviceMemoryError&) {
+            std::println("Particles: out of device memory for {}, keeping {}", capacity, storage.capacity);
+            if (storage.capacity == 0) {
+                settings.enabled = false;
+                return;
+            }
+            capacity = storage.capacity;
+        }
+    }
+    settings.capacity = capacity;
+
+    // a long stall (resize, breakpoint) would otherwise emit everything at once
+    dt = std::min(frameSeconds, 0.1f);
+    time += dt;
+    emitCarry += settings.emitRate * dt;
+    double whole = std::floor(emitCarry);
+    emitCarry -= whole;
+    emitRequest = static_cast<uint32_t>(std::min<double>(whole, capacity));
+}
+
+void ParticleSystem::bind(
+    const vk::raii::CommandBuffer& cmd,
+    const vk::raii::Pipeline& pipeline,
+    vk::PipelineBindPoint bindPoint,
+    const Params& params
+) const {
+    cmd.bindPipeline(bindPoint, *pipeline);
+    cmd.bindDescriptorSets(bindPoint, *layout, 0, *storage.set, {});
+    cmd.pushConstants<Params>(*layout, PARAMS_STAGES, 0, params);
+}
+
+// Both buffers passing between the simulation and the draw, in either direction.
+std::array<QueueScheduler::BufferTransfer, 2> ParticleSystem::handOver(QueueType src, QueueType dst) const {
+    bool toDraw = dst == QueueType::eGraphics;
+    auto transfer = [&](vk::Buffer buffer, vk::PipelineStageFlags2 drawStage, vk::AccessFlags2 drawAccess) {
+        return QueueScheduler::BufferTransfer{
+            .buffer = buffer,
+            .src = src,
+            .dst = dst,
+            .srcStage = toDraw ? COMPUTE_STAGES : drawStage,
+            // the draw only reads, there is nothing to make available
+            .srcAccess = toDraw ? vk::AccessFlagBits2::eShaderStorageWrite : vk::AccessFlagBits2::eNone,
+            .dstStage = toDraw ? drawStage : COMPUTE_STAGES,
+            .dstAccess = toDraw ? drawAccess : COMPUTE_ACCESS
+        };
+    };
+    return {
+        transfer(*storage.state, vk::PipelineStageFlagBits2::eVertexShader, vk::AccessFlagBits2::eShaderStorageRead),
+        transfer(*storage.args, vk::PipelineStageFlagBits2::eDrawIndirect, vk::AccessFlagBits2::eIndirectCommandRead)
+    };
+}
+
+/*
+ * Records and submits the compute stages. The submit waits for the draw that
+ * last read the buffers; the frame's graphics submit then waits for this one
+ * and acquires them back. Same-family queues skip the ownership barriers, the
+ * timeline waits alone order the work.
+ */
+void ParticleSystem::simulate(const Params& params) {
+    auto& simulation = simulations[frameSlot];
+    // already done whenever the frame fence of this slot was
+    scheduler->wait(QueueType::eCompute, simulation.value);
+    if (drawReleased) {
+        // no later graphics submit than the draw's has been made yet
+        for (const auto& transfer : handOver(QueueType::eGraphics, QueueType::eCompute)) {
+            scheduler->enqueueAcquire(transfer, scheduler->submittedValue(QueueType::eGraphics));
+        }
+        drawReleased = false;
+    }
+
+    const auto& cmd = simulation.cmd;
+    cmd.reset();
+    cmd.begin({.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    uint32_t timedScope = scheduler->beginTimedScope(QueueType::eCompute, cmd);
+    scheduler->recordPendingAcquires(QueueType::eCompute, cmd);
+    constexpr auto COMPUTE = vk::PipelineBindPoint::eCompute;
+    if (needsReset) {
+        needsReset = false;
+        bind(cmd, resetPipeline, COMPUTE, params);
+        cmd.dispatch(groupCount(params.capacity), 1, 1);
+        computeBarrier(cmd);
+    }
+    writeTimestamp(cmd, Stage::eEmit, false);
+    bind(cmd, kickoffPipeline, COMPUTE, params);
+    cmd.dispatch(1, 1, 1);
+    computeBarrier(cmd);
+    bind(cmd, emitPipeline, COMPUTE, params);
+    cmd.dispatchIndirect(*storage.args, EMIT_ARGS_OFFSET);
+    writeTimestamp(cmd, Stage::eEmit, true);
+    computeBarrier(cmd);
+    writeTimestamp(cmd, Stage::eSimulate, false);
+    bind(cmd, simulatePipeline, COMPUTE, params);
+    cmd.dispatchIndirect(*storage.args, SIMULATE_ARGS_OFFSET);
+    computeBarrier(cmd);
+    bind(cmd, finishPipeline, COMPUTE, params);
+    cmd.dispatch(1, 1, 1);
+    writeTimestamp(cmd, Stage::eSimulate, true);
+    auto toDraw = handOver(QueueType::eCompute, QueueType::eGraphics);
+    for (const auto& transfer : toDraw) {
+        scheduler->recordRelease(cmd, transfer);
+    }
+    scheduler->endTimedScope(QueueType::eCompute, cmd, timedScope);
+    cmd.end();
+
+    vk::CommandBuffer handle = *cmd;
+    simulation.value = scheduler->submit({.queue = QueueType::eCompute, .commandBuffers = {&handle, 1}});
+    for (const auto& transfer : toDraw) {
+        scheduler->enqueueAcquire(transfer, simulation.value);
+    }
+}
+
+void ParticleSystem::addPasses(RenderGraph& graph, RenderGraph::Handle target, vk::Extent2D extent) {
+    if (!ready() || *storage.state == nullptr) {
+        return;
+    }
+    Params params{
+        .dt = dt,
+        .time = time,
+        .emitRequest = emitRequest,
+        .capacity = storage.capacity,
+        .parity = parity,
+        .lifetime = settings.lifetime,
+        .pointExtent = {
+            settings.pointSize * 2.f / static_cast<float>(extent.width),
+            settings.pointSize * 2.f / static_cast<float>(extent.height)
+        }
+    };
+    simulate(params);
+
+    // the acquire at the start of the frame's command buffer, queued by
+    // simulate(), is all the synchronization the draw needs
+    auto state = graph.importBuffer("particle state", *storage.state);
+    auto args = graph.importBuffer("particle args", *storage.args);
+    graph
+        .addPass(
+            "particles draw",
+            [this, params, &graph, target, extent](const vk::raii::CommandBuffer& cmd) {
+                writeTimestamp(cmd, Stage::eDraw, false);
+                vk::RenderingAttachmentInfo attachment{
+                    .imageView = graph.image(target).view,
+                    .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
+                    .loadOp = vk::AttachmentLoadOp::eLoad,
+                    .storeOp = vk::AttachmentStoreOp::eStore
+                };
+                cmd.beginRendering({
+                    .renderArea = {.offset = {0, 0}, .extent = extent},
+                    .layerCount = 1,
+                    .colorAttachmentCount = 1,
+                    .pColorAttachments = &attachment
+                });
+                bind(cmd, drawPipeline, vk::PipelineBindPoint::eGraphics, params);
+                cmd.setViewport(0, vk::Viewport{
+                    .width = static_cast<float>(extent.width),
+                    .height = static_cast<float>(extent.height),
+                    .maxDepth = 1.0f
+                });
+                cmd.setScissor(0, vk::Rect2D{.offset = {0, 0}, .extent = extent});
+                cmd.drawIndirect(*storage.args, DRAW_ARGS_OFFSET, 1, sizeof(vk::DrawIndirectCommand));
+                cmd.endRendering();
+                writeTimestamp(cmd, Stage::eDraw, true);
+                // back to the next simulation
+                for (const auto& transfer : handOver(QueueType::eGraphics, QueueType::eCompute)) {
+                    scheduler->recordRelease(cmd, transfer);
+                }
+            }
+        )
+        .use(target, ResourceUsage::eColorAttachmentReadWrite)
+        .use(state, ResourceUsage::eVertexStorageRead)
+        .use(args, ResourceUsage::eIndirectBuffer);
+
+    drawReleased = true;
+    parity ^= 1;
+    slotWritten[frameSlot] = 1;
+}
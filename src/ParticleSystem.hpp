@@ -0,0 +1,168 @@
+#ifndef PARTICLESYSTEM_HPP
+#define PARTICLESYSTEM_HPP
+
+// c++ std libs
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// vulkan-hpp headers
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "DeviceProfile.hpp"
+#include "MemoryBudget.hpp"
+#include "QueueScheduler.hpp"
+#include "RenderGraph.hpp"
+#include "utils.hpp"
+
+/*
+ * Particles that never leave the GPU. State is structure-of-arrays (position,
+ * velocity, color) plus a dead list and two alive lists of indices, all
+ * sections of one storage buffer; a second buffer holds the indirect
+ * arguments. Each frame runs these stages (shaders/particles.hlsl):
+ *
+ *   kickoff   clamp the emit count to the dead list, size the dispatches
+ *   emit      pop dead indices, initialize them, append to the alive list
+ *   simulate  integrate the alive list, survivors are compacted into the
+ *             other alive list and the rest pushed back onto the dead list
+ *   finish    write the draw arguments from the survivor count
+ *   draw      one quad per survivor, pulled from the SoA buffers
+ *
+ * Everything up to finish is submitted on the compute queue as soon as
+ * addPasses() is called, so it overlaps the graphics work recorded before the
+ * draw. The two buffers change hands through the timeline semaphores: the
+ * frame's graphics submit waits for the simulation and acquires them, the
+ * next simulation waits for that draw and takes them back.
+ *
+ * The CPU only ever chooses how many particles to emit. Every stage is
+ * bracketed by timestamps, read back once the frame slot comes around again;
+ * the compute stages only where the compute queue supports timestamps.
+ */
+class ParticleSystem {
+public:
+    enum class Stage : uint32_t {
+        eEmit,      // kickoff + emit
+        eSimulate,  // simulate + finish
+        eDraw,
+    };
+    static constexpr size_t STAGE_COUNT = 3;
+
+    struct Settings {
+        bool enabled = true;
+        uint32_t capacity = 1u << 20;
+        float emitRate = 250000.f;  // particles per second
+        float lifetime = 4.f;       // seconds, each particle gets 50-100% of it
+        float pointSize = 2.f;      // quad half size in pixels
+    };
+
+    struct Stats {
+        std::array<double, STAGE_COUNT> stageMs{};
+        uint32_t capacity = 0;     // of the current buffers
+        uint32_t maxCapacity = 0;  // limited by maxStorageBufferRange
+        vk::DeviceSize bytes = 0;
+    };
+
+private:
+    // everything sized by the capacity, replaced as a whole when it changes
+    struct Storage {
+        uint32_t capacity = 0;
+        vk::raii::Buffer state = nullptr;
+        DeviceAllocation stateMemory = nullptr;
+        vk::raii::Buffer args = nullptr;
+        DeviceAllocation argsMemory = nullptr;
+        vk::raii::DescriptorPool pool = nullptr;
+        vk::raii::DescriptorSet set = nullptr;
+    };
+    // push constants shared by every stage, mirrors Params in the shaders
+    struct Params {
+        float dt;
+        float time;
+        uint32_t emitRequest;
+        uint32_t capacity;
+        uint32_t parity;
+        float lifetime;
+        float pointExtent[2];
+    };
+    struct Simulation {
+        vk::raii::CommandBuffer cmd = nullptr;
+        uint64_t value = 0;  // compute timeline value of the last use
+    };
+
+    const DeviceProfile* profile = nullptr;
+    const vk::raii::Device* device = nullptr;
+    MemoryBudget* budget = nullptr;
+    QueueScheduler* scheduler = nullptr;
+
+    vk::raii::DescriptorSetLayout setLayout = nullptr;
+    vk::raii::PipelineLayout layout = nullptr;
+    vk::raii::Pipeline resetPipeline = nullptr;
+    vk::raii::Pipeline kickoffPipeline = nullptr;
+    vk::raii::Pipeline emitPipeline = nullptr;
+    vk::raii::Pipeline simulatePipeline = nullptr;
+    vk::raii::Pipeline finishPipeline = nullptr;
+    vk::raii::Pipeline drawPipeline = nullptr;
+    // two per stage per frame in flight
+    vk::raii::QueryPool timestamps = nullptr;
+    std::vector<uint8_t> slotWritten;
+    bool computeTimestamps = false;  // the compute queue has valid timestamp bits
+    std::vector<Simulation> simulations;  // one per frame in flight
+
+    Storage storage;
+    bool needsReset = false;
+    bool drawReleased = false;  // the last draw handed the buffers back to compute
+    uint32_t parity = 0;
+    uint32_t frameSlot = 0;
+    float time = 0;
+    float dt = 0;
+    double emitCarry = 0;  // fractional particles left over from earlier frames
+    uint32_t emitRequest = 0;
+    Stats stats;
+
+    void createStorage(uint32_t capacity);
+    void readTimestamps(uint32_t slot);
+    void writeTimestamp(const vk::raii::CommandBuffer& cmd, Stage stage, bool end) const;
+    void bind(
+        const vk::raii::CommandBuffer& cmd,
+        const vk::raii::Pipeline& pipeline,
+        vk::PipelineBindPoint bindPoint,
+        const Params& params
+    ) const;
+    std::array<QueueScheduler::BufferTransfer, 2> handOver(QueueType src, QueueType dst) const;
+    void simulate(const Params& params);
+
+public:
+    Settings settings;
+
+    ParticleSystem() = default;
+    DISABLE_COPY(ParticleSystem)
+
+    void init(
+        const DeviceProfile& profile,
+        const vk::raii::Device& device,
+        MemoryBudget& budget,
+        QueueScheduler& scheduler,
+        uint32_t framesInFlight,
+        std::span<const char> computeSpv,
+        std::span<const char> drawSpv,
+        vk::Format colorFormat
+    );
+    bool ready() const {
+        return *drawPipeline != nullptr;
+    }
+
+    // Call once the fence of `slot` has been waited on: resolves that slot's
+    // timings, applies capacity changes and advances the simulation clock.
+    void beginFrame(uint32_t slot, float frameSeconds);
+    // Submit this frame's simulation on the compute queue and add the draw
+    // into `target` (loaded, not cleared). The frame's graphics submit waits
+    // for the simulation.
+    void addPasses(RenderGraph& graph, RenderGraph::Handle target, vk::Extent2D extent);
+
+    const Stats& getStats() const {
+        return stats;
+    }
+};
+
+#endif  // PARTICLESYSTEM_HPP
@@ -0,0 +1,129 @@
+#ifndef PIPELINETHREAD_HPP
+#define PIPELINETHREAD_HPP
+
+// c++ std libs
+#include <cassert>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <utility>
+
+#include "SpscQueue.hpp"
+#include "Trace.hpp"
+#include "utils.hpp"
+
+/*
+ * One worker thread running `step` on inputs handed over through an SPSC
+ * queue, with the outputs coming back through another one. The owner
+ * submit()s the input for the next frame and collect()s the output when it
+ * needs it, so the step overlaps with whatever the owner does in between.
+ * Inputs are copied, keep them to plain snapshots; anything bigger that the
+ * step touches must be left alone by the owner until it's collected.
+ *
+ *     PipelineThread<Input, Output> simulation;
+ *     simulation.start("simulation", [&](const Input& in) { return simulate(in); });
+ *     simulation.submit(next);           // frame N+1 starts
+ *     ...                                // finish frame N
+ *     Output out = simulation.collect(); // blocks if it isn't done yet
+ */
+template <class In, class Out, size_t Depth = 2>
+class PipelineThread {
+private:
+    struct Job {
+        In input{};
+        bool stop = false;
+    };
+    struct Result {
+        Out output{};
+        std::exception_ptr error;
+    };
+
+    SpscQueue<Job, Depth> jobs;
+    SpscQueue<Result, Depth> results;
+    std::function<Out(const In&)> step;
+    std::thread thread;
+    uint32_t inFlight = 0;  // owner side only
+
+    void loop(const char* name) {
+        TRACE_THREAD_NAME(name);
+        Job job;
+        while (true) {
+            jobs.wait();
+            jobs.tryPop(job);
+            if (job.stop) {
+                return;
+            }
+            Result result;
+            try {
+                result.output = step(job.input);
+            }
+            catch (...) {
+                result.error = std::current_exception();
+            }
+            // never full: at most Depth jobs are in flight
+            results.tryPush(std::move(result));
+        }
+    }
+
+public:
+    PipelineThread() = default;
+    ~PipelineThread() {
+        stop();
+    }
+    DISABLE_COPY(PipelineThread)
+
+    // `name` labels the thread in traces and must outlive it.
+    void start(const char* name, std::function<Out(const In&)> fn) {
+        stop();
+        step = std::move(fn);
+        thread = std::thread([this, name] { loop(name); });
+    }
+    // Waits for the jobs in flight, their outputs are dropped.
+    void stop() {
+        if (!thread.joinable()) {
+            return;
+        }
+        while (inFlight > 0) {
+            try {
+                collect();
+            }
+            catch (...) {
+            }
+        }
+        jobs.tryPush(Job{.stop = true});
+        thread.join();
+    }
+
+    bool running() const {
+        return thread.joinable();
+    }
+    uint32_t pending() const {
+        return inFlight;
+    }
+
+    // False (and nothing queued) when Depth jobs are already in flight.
+    bool submit(const In& input) {
+        assert(running());
+        if (inFlight == Depth || !jobs.tryPush(Job{.input = input})) {
+            return false;
+        }
+        inFlight++;
+        return true;
+    }
+    // The output of the oldest job, blocking until it's done; rethrows what
+    // the step threw. Only call with pending() > 0.
+    Out collect() {
+        assert(inFlight > 0);
+        results.wait();
+        Result result;
+        results.tryPop(result);
+        inFlight--;
+        if (result.error) {
+            std::rethrow_exception(result.error);
+        }
+        return std::move(result.output);
+    }
+};
+
+#endif  // PIPELINETHREAD_HPP
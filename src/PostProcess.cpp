@@ -0,0 +1,579 @@
+#include "PostProcess.hpp"
+
+// std c++
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <print>
+
+// vulkan
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace {
+
+// numthreads of shaders/postprocess.hlsl
+constexpr uint32_t BLUR_GROUP = 128;
+constexpr uint32_t LUMINANCE_GROUP = 16;
+constexpr uint32_t TILE_GROUP = 8;  // bloom and tonemap
+constexpr float MAX_BLUR_RADIUS = 32.f;
+
+// auto exposure maps the average luminance to middle grey
+constexpr float EXPOSURE_KEY = 0.18f;
+constexpr vk::DeviceSize EXPOSURE_BYTES = 4 * sizeof(uint32_t);
+constexpr uint32_t EXPOSURE_BINDING = 3;
+
+// pass and image names have to outlive the frame's graph
+constexpr std::array<const char*, PostProcess::MAX_BLOOM_LEVELS> BLOOM_LEVEL_NAMES = {
+    "bloom 1", "bloom 2", "bloom 3", "bloom 4", "bloom 5", "bloom 6", "bloom 7", "bloom 8"
+};
+constexpr std::array<const char*, PostProcess::MAX_BLOOM_LEVELS> DOWNSAMPLE_NAMES = {
+    "bloom downsample 1",
+    "bloom downsample 2",
+    "bloom downsample 3",
+    "bloom downsample 4",
+    "bloom downsample 5",
+    "bloom downsample 6",
+    "bloom downsample 7",
+    "bloom downsample 8"
+};
+constexpr std::array<const char*, PostProcess::MAX_BLOOM_LEVELS> UPSAMPLE_NAMES = {
+    "bloom upsample 1",
+    "bloom upsample 2",
+    "bloom upsample 3",
+    "bloom upsample 4",
+    "bloom upsample 5",
+    "bloom upsample 6",
+    "bloom upsample 7",
+    "bloom upsample 8"
+};
+
+uint32_t groupCount(uint32_t texels, uint32_t groupSize) {
+    return (texels + groupSize - 1) / groupSize;
+}
+
+vk::Extent2D mipExtent(vk::Extent2D extent, uint32_t level) {
+    return {std::max(extent.width >> level, 1u), std::max(extent.height >> level, 1u)};
+}
+
+vk::raii::Pipeline createComputePipeline(
+    const vk::raii::Device& device,
+    const vk::raii::ShaderModule& module,
+    const vk::raii::PipelineLayout& layout,
+    const char* entry
+) {
+    return {device, nullptr, vk::ComputePipelineCreateInfo{
+        .stage = {.stage = vk::ShaderStageFlagBits::eCompute, .module = module, .pName = entry},
+        .layout = layout
+    }};
+}
+
+}  // namespace
+
+bool PostProcess::supported(const DeviceProfile& profile) {
+    auto chain = profile.device.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceSubgroupProperties>();
+    const auto& subgroup = chain.get<vk::PhysicalDeviceSubgroupProperties>();
+    constexpr auto OPERATIONS = vk::SubgroupFeatureFlagBits::eBasic | vk::SubgroupFeatureFlagBits::eArithmetic;
+    return (subgroup.supportedStages & vk::ShaderStageFlagBits::eCompute) &&
+           (subgroup.supportedOperations & OPERATIONS) == OPERATIONS;
+}
+
+void PostProcess::init(
+    const DeviceProfile& profile,
+    const vk::raii::Device& device,
+    MemoryBudget& budget,
+    uint32_t framesInFlight,
+    std::span<const char> spv
+) {
+    this->profile = &profile;
+    this->device = &device;
+    this->budget = &budget;
+
+    std::array bindings{
+        vk::DescriptorSetLayoutBinding{
+            .binding = 0,
+            .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+            .descriptorCount = 1,
+            .stageFlags = vk::ShaderStageFlagBits::eCompute
+        },
+        vk::DescriptorSetLayoutBinding{
+            .binding = 1,
+            .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+            .descriptorCount = 1,
+            .stageFlags = vk::ShaderStageFlagBits::eCompute
+        },
+        vk::DescriptorSetLayoutBinding{
+            .binding = 2,
+            .descriptorType = vk::DescriptorType::eStorageImage,
+            .descriptorCount = 1,
+            .stageFlags = vk::ShaderStageFlagBits::eCompute
+        },
+        vk::DescriptorSetLayoutBinding{
+            .binding = EXPOSURE_BINDING,
+            .descriptorType = vk::DescriptorType::eStorageBuffer,
+            .descriptorCount = 1,
+            .stageFlags = vk::ShaderStageFlagBits::eCompute
+        },
+    };
+    setLayout = vk::raii::DescriptorSetLayout(device, vk::DescriptorSetLayoutCreateInfo{
+        .bindingCount = static_cast<uint32_t>(bindings.size()),
+        .pBindings = bindings.data()
+    });
+    vk::PushConstantRange pushConstants{
+        .stageFlags = vk::ShaderStageFlagBits::eCompute, .offset = 0, .size = sizeof(Params)
+    };
+    layout = vk::raii::PipelineLayout(device, vk::PipelineLayoutCreateInfo{
+        .setLayoutCount = 1,
+        .pSetLayouts = &*setLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstants
+    });
+    vk::raii::ShaderModule module(device, vk::ShaderModuleCreateInfo{
+        .codeSize = spv.size(),
+        .pCode = reinterpret_cast<const uint32_t*>(spv.data())
+    });
+    blurHorizontalPipeline = createComputePipeline(device, module, layout, "blurHorizontal");
+    blurVerticalPipeline = createComputePipeline(device, module, layout, "blurVertical");
+    luminancePipeline = createComputePipeline(device, module, layout, "luminance");
+    adaptPipeline = createComputePipeline(device, module, layout, "adapt");
+    downsamplePipeline = createComputePipeline(device, module, layout, "bloomDownsample");
+    upsamplePipeline = createComputePipeline(device, module, layout, "bloomUpsample");
+    tonemapPipeline = createComputePipeline(device, module, layout, "tonemap");
+    sampler = vk::raii::Sampler(device, vk::SamplerCreateInfo{
+        .magFilter = vk::Filter::eLinear,
+        .minFilter = vk::Filter::eLinear,
+        .mipmapMode = vk::SamplerMipmapMode::eNearest,
+        .addressModeU = vk::SamplerAddressMode::eClampToEdge,
+        .addressModeV = vk::SamplerAddressMode::eClampToEdge,
+        .addressModeW = vk::SamplerAddressMode::eClampToEdge
+    });
+
+    // cleared by the first addPasses()
+    exposure = vk::raii::Buffer(device, vk::BufferCreateInfo{
+        .size = EXPOSURE_BYTES,
+        .usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+        .sharingMode = vk::SharingMode::eExclusive
+    });
+    vk::MemoryRequirements requirements = exposure.getMemoryRequirements();
+    exposureMemory = budget.allocate(
+        device,
+        vk::MemoryAllocateInfo{
+            .allocationSize = requirements.size,
+            .memoryTypeIndex = findMemoryType(
+                profile.memory, requirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal
+            )
+        },
+        MemoryCategory::eBuffer
+    );
+    exposure.bindMemory(*exposureMemory, 0);
+    needsReset = true;
+
+    uint32_t setCount = framesInFlight * MAX_PASSES;
+    std::array poolSizes{
+        vk::DescriptorPoolSize{.type = vk::DescriptorType::eCombinedImageSampler, .descriptorCount = 2 * setCount},
+        vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageImage, .descriptorCount = setCount},
+        vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageBuffer, .descriptorCount = setCount},
+    };
+    descriptorPool = vk::raii::DescriptorPool(device, vk::DescriptorPoolCreateInfo{
+        .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+        .maxSets = setCount,
+        .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+        .pPoolSizes = poolSizes.data()
+    });
+    std::vector<vk::DescriptorSetLayout> setLayouts(setCount, *setLayout);
+    vk::raii::DescriptorSets allocated(device, vk::DescriptorSetAllocateInfo{
+        .descriptorPool = *descriptorPool,
+        .descriptorSetCount = setCount,
+        .pSetLayouts = setLayouts.data()
+    });
+    sets.clear();
+    // the images change every frame, the exposure buffer never does
+    vk::DescriptorBufferInfo exposureInfo{.buffer = *exposure, .offset = 0, .range = EXPOSURE_BYTES};
+    for (auto& set : allocated) {
+        device.updateDescriptorSets(
+            vk::WriteDescriptorSet{
+                .dstSet = *set,
+                .dstBinding = EXPOSURE_BINDING,
+                .descriptorCount = 1,
+                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                .pBufferInfo = &exposureInfo
+            },
+            {}
+        );
+        sets.push_back(std::move(set));
+    }
+
+    uint32_t queryCount = framesInFlight * STAGE_COUNT * 2;
+    timestamps = vk::raii::QueryPool(device, vk::QueryPoolCreateInfo{
+        .queryType = vk::QueryType::eTimestamp,
+        .queryCount = queryCount
+    });
+    timestamps.reset(0, queryCount);
+    stagesWritten.assign(framesInFlight, 0);
+
+    auto chain = profile.device.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceSubgroupProperties>();
+    stats.subgroupSize = chain.get<vk::PhysicalDeviceSubgroupProperties>().subgroupSize;
+    std::println("Post-processing: subgroup size {}", stats.subgroupSize);
+}
+
+// eAllCommands waits for the earlier stages, so each one is measured on its own
+void PostProcess::writeTimestamp(const vk::raii::CommandBuffer& cmd, Stage stage, bool end) const {
+    uint32_t query = (frameSlot * STAGE_COUNT + static_cast<uint32_t>(stage)) * 2 + (end ? 1 : 0);
+    cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, *timestamps, query);
+}
+
+// Stages that didn't run in that frame read as 0.
+void PostProcess::readTimestamps(uint32_t slot) {
+    uint32_t first = slot * STAGE_COUNT * 2;
+    double period = profile->properties.limits.timestampPeriod;
+    for (uint32_t i = 0; i < STAGE_COUNT; i++) {
+        if (!(stagesWritten[slot] & (1u << i))) {
+            stats.stageMs[i] = 0;
+            continue;
+        }
+        auto [result, stamps] = timestamps.getResult<std::array<uint64_t, 2>>(
+            first + 2 * i, 2, sizeof(uint64_t), vk::QueryResultFlagBits::e64
+        );
+        if (result == vk::Result::eSuccess) {
+            uint64_t ticks = stamps[1] >= stamps[0] ? stamps[1] - stamps[0] : 0;
+            stats.stageMs[i] = ticks * period / 1e6;
+        }
+    }
+    if (stagesWritten[slot] != 0) {
+        timestamps.reset(first, STAGE_COUNT * 2);
+        stagesWritten[slot] = 0;
+    }
+}
+
+void PostProcess::beginFrame(uint32_t slot, float frameSeconds) {
+    if (!ready()) {
+        return;
+    }
+    frameSlot = slot;
+    readTimestamps(slot);
+    settings.bloomLevels = std::clamp(settings.bloomLevels, 1u, MAX_BLOOM_LEVELS);
+    settings.blurSigma = std::clamp(settings.blurSigma, 0.5f, MAX_BLUR_RADIUS / 3.f);
+    // adaptation after a long stall (resize, breakpoint) snaps at most this far
+    dt = std::min(frameSeconds, 0.25f);
+}
+
+PostProcess::Dispatch PostProcess::makeDispatch(const vk::raii::Pipeline& pipeline) {
+    assert(passCount < MAX_PASSES);
+    Dispatch dispatch;
+    dispatch.pipeline = &pipeline;
+    dispatch.set = passCount++;
+    return dispatch;
+}
+
+/*
+ * The frame's sets were last used by the frame that had this slot before,
+ * whose fence has been waited on, so they can be rewritten while recording;
+ * every dispatch has its own set.
+ */
+void PostProcess::record(
+    const vk::raii::CommandBuffer& cmd, const RenderGraph& graph, const Dispatch& dispatch
+) const {
+    const auto& set = sets[frameSlot * MAX_PASSES + dispatch.set];
+    std::array<vk::DescriptorImageInfo, 3> images;
+    std::array<vk::WriteDescriptorSet, 3> writes;
+    uint32_t count = 0;
+    auto bindImage = [&](uint32_t binding, RenderGraph::Handle handle, bool storage) {
+        if (handle == NONE) {
+            return;
+        }
+        images[count] = {
+            .sampler = *sampler,
+            .imageView = graph.image(handle).view,
+            .imageLayout = storage ? vk::ImageLayout::eGeneral : vk::ImageLayout::eShaderReadOnlyOptimal
+        };
+        writes[count] = {
+            .dstSet = *set,
+            .dstBinding = binding,
+            .descriptorCount = 1,
+            .descriptorType = storage ? vk::DescriptorType::eStorageImage : vk::DescriptorType::eCombinedImageSampler,
+            .pImageInfo = &images[count]
+        };
+        count++;
+    };
+    bindImage(0, dispatch.input, false);
+    bindImage(1, dispatch.secondary, false);
+    bindImage(2, dispatch.output, true);
+    device->updateDescriptorSets(vk::ArrayProxy<const vk::WriteDescriptorSet>(count, writes.data()), {});
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, **dispatch.pipeline);
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *layout, 0, *set, {});
+    cmd.pushConstants<Params>(*layout, vk::ShaderStageFlagBits::eCompute, 0, dispatch.params);
+    cmd.dispatch(dispatch.groups[0], dispatch.groups[1], dispatch.groups[2]);
+}
+
+void PostProcess::addPasses(
+    RenderGraph& graph,
+    RenderGraph::Handle scene,
+    vk::Extent2D region,
+    RenderGraph::Handle target,
+    vk::Extent2D targetExtent
+) {
+    if (!ready()) {
+        return;
+    }
+    passCount = 0;
+    uint8_t& written = stagesWritten[frameSlot];
+    auto stageBit = [](Stage stage) {
+        return static_cast<uint8_t>(1u << static_cast<uint32_t>(stage));
+    };
+    vk::Extent2D sceneExtent = graph.image(scene).extent;
+    auto hdrImage = [&](const char* name, vk::Extent2D extent, vk::ImageUsageFlags usage) {
+        return graph.createImage(name, {.format = HDR_FORMAT, .extent = extent, .usage = usage});
+    };
+    constexpr auto STORAGE_SAMPLED = vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled;
+    auto setRegion = [](int32_t (&dst)[2], vk::Extent2D extent) {
+        dst[0] = static_cast<int32_t>(extent.width);
+        dst[1] = static_cast<int32_t>(extent.height);
+    };
+    auto setInvSize = [](float (&dst)[2], vk::Extent2D extent) {
+        dst[0] = 1.f / static_cast<float>(extent.width);
+        dst[1] = 1.f / static_cast<float>(extent.height);
+    };
+
+    // scales the region up to the whole target and converts to its format
+    auto addBlit = [&](RenderGraph::Handle source, bool timed) {
+        graph
+            .addPass(
+                "post blit",
+                [this, &graph, source, region, target, targetExtent, timed](const vk::raii::CommandBuffer& cmd) {
+                    auto corner = [](vk::Extent2D extent) {
+                        return vk::Offset3D{
+                            static_cast<int32_t>(extent.width), static_cast<int32_t>(extent.height), 1
+                        };
+                    };
+                    vk::ImageBlit2 blit{
+                        .srcSubresource = {vk::ImageAspectFlagBits::eColor, 0, 0, 1},
+                        .srcOffsets = std::array{vk::Offset3D{0, 0, 0}, corner(region)},
+                        .dstSubresource = {vk::ImageAspectFlagBits::eColor, 0, 0, 1},
+                        .dstOffsets = std::array{vk::Offset3D{0, 0, 0}, corner(targetExtent)}
+                    };
+                    cmd.blitImage2({
+                        .srcImage = graph.image(source).image,
+                        .srcImageLayout = vk::ImageLayout::eTransferSrcOptimal,
+                        .dstImage = graph.image(target).image,
+                        .dstImageLayout = vk::ImageLayout::eTransferDstOptimal,
+                        .regionCount = 1,
+                        .pRegions = &blit,
+                        .filter = vk::Filter::eLinear
+                    });
+                    if (timed) {
+                        writeTimestamp(cmd, Stage::eTonemap, true);
+                    }
+                }
+            )
+            .use(source, ResourceUsage::eTransferSrc)
+            .use(target, ResourceUsage::eTransferDst);
+    };
+    if (!settings.enabled) {
+        addBlit(scene, false);
+        stats.passCount = 0;
+        return;
+    }
+
+    // last frame's passes may still be using it
+    auto exposureBuffer = graph.importBuffer(
+        "exposure",
+        *exposure,
+        {.stages = vk::PipelineStageFlagBits2::eComputeShader, .access = vk::AccessFlagBits2::eShaderStorageWrite}
+    );
+    if (needsReset) {
+        needsReset = false;
+        graph
+            .addPass(
+                "exposure reset",
+                [this](const vk::raii::CommandBuffer& cmd) {
+                    cmd.fillBuffer(*exposure, 0, vk::WholeSize, 0);
+                }
+            )
+            .use(exposureBuffer, ResourceUsage::eTransferDst);
+    }
+
+    RenderGraph::Handle source = scene;
+    if (settings.blur) {
+        auto temp = hdrImage("blur temp", sceneExtent, STORAGE_SAMPLED);
+        auto blurred = hdrImage("blurred scene", sceneExtent, STORAGE_SAMPLED);
+        Dispatch rows = makeDispatch(blurHorizontalPipeline);
+        rows.input = source;
+        rows.output = temp;
+        rows.groups[0] = groupCount(region.width, BLUR_GROUP);
+        rows.groups[1] = region.height;
+        setRegion(rows.params.region, region);
+        setRegion(rows.params.srcRegion, region);
+        rows.params.a = settings.blurSigma;
+        rows.params.b = std::min(std::ceil(3.f * settings.blurSigma), MAX_BLUR_RADIUS);
+        Dispatch columns = makeDispatch(blurVerticalPipeline);
+        columns.params = rows.params;
+        columns.input = temp;
+        columns.output = blurred;
+        columns.groups[0] = region.width;
+        columns.groups[1] = groupCount(region.height, BLUR_GROUP);
+        graph
+            .addPass(
+                "blur horizontal",
+                [this, &graph, rows](const vk::raii::CommandBuffer& cmd) {
+                    writeTimestamp(cmd, Stage::eBlur, false);
+                    record(cmd, graph, rows);
+                }
+            )
+            .use(source, ResourceUsage::eComputeSampled)
+            .use(temp, ResourceUsage::eComputeStorageWrite);
+        graph
+            .addPass(
+                "blur vertical",
+                [this, &graph, columns](const vk::raii::CommandBuffer& cmd) {
+                    record(cmd, graph, columns);
+                    writeTimestamp(cmd, Stage::eBlur, true);
+                }
+            )
+            .use(temp, ResourceUsage::eComputeSampled)
+            .use(blurred, ResourceUsage::eComputeStorageWrite);
+        source = blurred;
+        written |= stageBit(Stage::eBlur);
+    }
+
+    bool autoExposure = settings.tonemap && settings.autoExposure;
+    if (autoExposure) {
+        Dispatch sum = makeDispatch(luminancePipeline);
+        sum.input = source;
+        sum.groups[0] = groupCount(region.width, LUMINANCE_GROUP);
+        sum.groups[1] = groupCount(region.height, LUMINANCE_GROUP);
+        setRegion(sum.params.region, region);
+        setRegion(sum.params.srcRegion, region);
+        Dispatch adapt = makeDispatch(adaptPipeline);
+        adapt.params.a = dt;
+        adapt.params.b = settings.adaptationSpeed;
+        adapt.params.c = EXPOSURE_KEY * std::exp2(settings.exposureCompensation);
+        adapt.params.d = static_cast<float>(region.width) * static_cast<float>(region.height);
+        graph
+            .addPass(
+                "exposure luminance",
+                [this, &graph, sum](const vk::raii::CommandBuffer& cmd) {
+                    writeTimestamp(cmd, Stage::eExposure, false);
+                    record(cmd, graph, sum);
+                }
+            )
+            .use(source, ResourceUsage::eComputeSampled)
+            .use(exposureBuffer, ResourceUsage::eComputeStorageReadWrite);
+        graph
+            .addPass(
+                "exposure adapt",
+                [this, &graph, adapt](const vk::raii::CommandBuffer& cmd) {
+                    record(cmd, graph, adapt);
+                    writeTimestamp(cmd, Stage::eExposure, true);
+                }
+            )
+            .use(exposureBuffer, ResourceUsage::eComputeStorageReadWrite);
+        written |= stageBit(Stage::eExposure);
+    }
+
+    // level 0 is the (blurred) scene, level i is 1/2^i of it
+    std::array<RenderGraph::Handle, MAX_BLOOM_LEVELS + 1> levels{};
+    std::array<vk::Extent2D, MAX_BLOOM_LEVELS + 1> extents{};
+    std::array<vk::Extent2D, MAX_BLOOM_LEVELS + 1> regions{};
+    levels[0] = source;
+    extents[0] = sceneExtent;
+    regions[0] = region;
+    uint32_t levelCount = 0;
+    if (settings.bloom) {
+        levelCount = settings.bloomLevels;
+        while (levelCount > 1 && std::min(region.width, region.height) >> levelCount == 0) {
+            levelCount--;
+        }
+        for (uint32_t i = 1; i <= levelCount; i++) {
+            extents[i] = mipExtent(sceneExtent, i);
+            regions[i] = mipExtent(region, i);
+            levels[i] = hdrImage(BLOOM_LEVEL_NAMES[i - 1], extents[i], STORAGE_SAMPLED);
+            Dispatch down = makeDispatch(downsamplePipeline);
+            down.input = levels[i - 1];
+            down.output = levels[i];
+            down.groups[0] = groupCount(regions[i].width, TILE_GROUP);
+            down.groups[1] = groupCount(regions[i].height, TILE_GROUP);
+            setRegion(down.params.region, regions[i]);
+            setRegion(down.params.srcRegion, regions[i - 1]);
+            down.params.a = i == 1 ? settings.bloomThreshold : -1.f;
+            down.params.b = settings.bloomKnee;
+            bool first = i == 1;
+            bool last = levelCount == 1;
+            graph
+                .addPass(
+                    DOWNSAMPLE_NAMES[i - 1],
+                    [this, &graph, down, first, last](const vk::raii::CommandBuffer& cmd) {
+                        if (first) {
+                            writeTimestamp(cmd, Stage::eBloom, false);
+                        }
+                        record(cmd, graph, down);
+                        if (last) {
+                            writeTimestamp(cmd, Stage::eBloom, true);
+                        }
+                    }
+                )
+                .use(levels[i - 1], ResourceUsage::eComputeSampled)
+                .use(levels[i], ResourceUsage::eComputeStorageWrite);
+        }
+        for (uint32_t i = levelCount - 1; i >= 1; i--) {
+            Dispatch up = makeDispatch(upsamplePipeline);
+            up.secondary = levels[i + 1];
+            up.output = levels[i];
+            up.groups[0] = groupCount(regions[i].width, TILE_GROUP);
+            up.groups[1] = groupCount(regions[i].height, TILE_GROUP);
+            setRegion(up.params.region, regions[i]);
+            setRegion(up.params.srcRegion, regions[i + 1]);
+            setInvSize(up.params.srcInvSize, extents[i + 1]);
+            up.params.a = 1.f;
+            bool last = i == 1;
+            graph
+                .addPass(
+                    UPSAMPLE_NAMES[i - 1],
+                    [this, &graph, up, last](const vk::raii::CommandBuffer& cmd) {
+                        record(cmd, graph, up);
+                        if (last) {
+                            writeTimestamp(cmd, Stage::eBloom, true);
+                        }
+                    }
+                )
+                .use(levels[i + 1], ResourceUsage::eComputeSampled)
+                .use(levels[i], ResourceUsage::eComputeStorageReadWrite);
+        }
+        written |= stageBit(Stage::eBloom);
+    }
+
+    auto output = hdrImage(
+        "post output", sceneExtent, vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eTransferSrc
+    );
+    Dispatch tonemap = makeDispatch(tonemapPipeline);
+    tonemap.input = source;
+    // bound either way, the shader skips it when the intensity is 0
+    tonemap.secondary = levelCount > 0 ? levels[1] : source;
+    tonemap.output = output;
+    tonemap.groups[0] = groupCount(region.width, TILE_GROUP);
+    tonemap.groups[1] = groupCount(region.height, TILE_GROUP);
+    setRegion(tonemap.params.region, region);
+    setRegion(tonemap.params.srcRegion, region);
+    setInvSize(tonemap.params.srcInvSize, levelCount > 0 ? extents[1] : sceneExtent);
+    tonemap.params.a = levelCount > 0 ? settings.bloomIntensity : 0.f;
+    tonemap.params.b = settings.tonemap ? 1.f : 0.f;
+    // the adapted exposure already includes the compensation
+    tonemap.params.c = autoExposure ? 1.f : std::exp2(settings.exposureCompensation);
+    tonemap.params.d = autoExposure ? 1.f : 0.f;
+    auto tonemapPass = graph.addPass(
+        "tonemap",
+        [this, &graph, tonemap](const vk::raii::CommandBuffer& cmd) {
+            writeTimestamp(cmd, Stage::eTonemap, false);
+            record(cmd, graph, tonemap);
+        }
+    );
+    tonemapPass.use(source, ResourceUsage::eComputeSampled)
+        .use(output, ResourceUsage::eComputeStorageWrite)
+        .use(exposureBuffer, ResourceUsage::eComputeStorageRead);
+    if (levelCount > 0) {
+        tonemapPass.use(levels[1], ResourceUsage::eComputeSampled);
+    }
+    addBlit(output, true);
+    written |= stageBit(Stage::eTonemap);
+    stats.passCount = passCount + 1;
+}
@@ -0,0 +1,174 @@
+#ifndef POSTPROCESS_HPP
+#define POSTPROCESS_HPP
+
+// c++ std libs
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// vulkan-hpp headers
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "DeviceProfile.hpp"
+#include "MemoryBudget.hpp"
+#include "RenderGraph.hpp"
+#include "utils.hpp"
+
+/*
+ * Compute post-processing of an HDR scene (shaders/postprocess.hlsl). Each
+ * frame adds these passes, every intermediate a transient RGBA16F image:
+ *
+ *   blur      optional separable gaussian, rows then columns, each group
+ *             filtering a 128 texel span from a shared-memory tile
+ *   exposure  average log luminance reduced per subgroup (WaveActiveSum)
+ *             with one atomic per group, then adapted towards the target
+ *             over time in a persistent buffer, all on the GPU
+ *   bloom     thresholded downsample chain of up to MAX_BLOOM_LEVELS half
+ *             resolution levels, each group reading its input through an
+ *             18x18 shared tile, then summed back up with tent filters
+ *   tonemap   scene + bloom, exposed and ACES tonemapped
+ *
+ * The tonemapped image is blitted to the target: the blit scales up a
+ * dynamic resolution region and encodes sRGB, which storage image writes to
+ * the (usually sRGB) swapchain couldn't do. With `enabled` off only the blit
+ * runs, so the comparison shows what the chain costs.
+ *
+ *     post.init(profile, device, budget, framesInFlight, spv);
+ *     auto hdr = graph.createImage("hdr scene", {PostProcess::HDR_FORMAT, extent, ...});
+ *     post.beginFrame(frameIndex, seconds);  // after the frame's fence wait
+ *     post.addPasses(graph, hdr, renderExtent, swapchain, swapchainExtent);
+ */
+class PostProcess {
+public:
+    static constexpr vk::Format HDR_FORMAT = vk::Format::eR16G16B16A16Sfloat;
+    static constexpr uint32_t MAX_BLOOM_LEVELS = 8;
+
+    enum class Stage : uint32_t {
+        eBlur,
+        eExposure,
+        eBloom,
+        eTonemap,  // tonemap + blit
+    };
+    static constexpr size_t STAGE_COUNT = 4;
+
+    struct Settings {
+        bool enabled = true;
+        bool blur = false;
+        float blurSigma = 4.f;  // texels of the scene
+        bool bloom = true;
+        float bloomThreshold = 0.8f;
+        float bloomKnee = 0.5f;
+        float bloomIntensity = 0.6f;
+        uint32_t bloomLevels = 5;
+        bool tonemap = true;
+        bool autoExposure = true;
+        float exposureCompensation = 0.f;  // EV
+        float adaptationSpeed = 2.f;       // 1/s
+    };
+
+    struct Stats {
+        std::array<double, STAGE_COUNT> stageMs{};
+        uint32_t subgroupSize = 0;
+        uint32_t passCount = 0;
+    };
+
+private:
+    static constexpr uint32_t MAX_PASSES = 2 * MAX_BLOOM_LEVELS + 6;
+    static constexpr RenderGraph::Handle NONE = ~0u;
+
+    // push constants, mirrors Params in the shader
+    struct Params {
+        int32_t region[2]{};
+        int32_t srcRegion[2]{};
+        float srcInvSize[2]{};
+        float a = 0;
+        float b = 0;
+        float c = 0;
+        float d = 0;
+    };
+    // one compute dispatch and the images it binds, recorded by a pass
+    struct Dispatch {
+        const vk::raii::Pipeline* pipeline = nullptr;
+        uint32_t set = 0;
+        RenderGraph::Handle input = NONE;      // binding 0, sampled
+        RenderGraph::Handle secondary = NONE;  // binding 1, sampled
+        RenderGraph::Handle output = NONE;     // binding 2, storage
+        uint32_t groups[3] = {1, 1, 1};
+        Params params;
+    };
+
+    const DeviceProfile* profile = nullptr;
+    const vk::raii::Device* device = nullptr;
+    MemoryBudget* budget = nullptr;
+
+    vk::raii::DescriptorSetLayout setLayout = nullptr;
+    vk::raii::PipelineLayout layout = nullptr;
+    vk::raii::Pipeline blurHorizontalPipeline = nullptr;
+    vk::raii::Pipeline blurVerticalPipeline = nullptr;
+    vk::raii::Pipeline luminancePipeline = nullptr;
+    vk::raii::Pipeline adaptPipeline = nullptr;
+    vk::raii::Pipeline downsamplePipeline = nullptr;
+    vk::raii::Pipeline upsamplePipeline = nullptr;
+    vk::raii::Pipeline tonemapPipeline = nullptr;
+    vk::raii::Sampler sampler = nullptr;
+    vk::raii::DescriptorPool descriptorPool = nullptr;
+    // MAX_PASSES per frame in flight, each written right before its dispatch
+    std::vector<vk::raii::DescriptorSet> sets;
+    // [0] luminance accumulator, [1] adapted exposure; survives across frames
+    vk::raii::Buffer exposure = nullptr;
+    DeviceAllocation exposureMemory = nullptr;
+    bool needsReset = false;
+    // two per stage per frame in flight
+    vk::raii::QueryPool timestamps = nullptr;
+    std::vector<uint8_t> stagesWritten;  // bit per stage, per slot
+    uint32_t frameSlot = 0;
+    uint32_t passCount = 0;
+    float dt = 0;
+    Stats stats;
+
+    void readTimestamps(uint32_t slot);
+    void writeTimestamp(const vk::raii::CommandBuffer& cmd, Stage stage, bool end) const;
+    void record(const vk::raii::CommandBuffer& cmd, const RenderGraph& graph, const Dispatch& dispatch) const;
+    Dispatch makeDispatch(const vk::raii::Pipeline& pipeline);
+
+public:
+    Settings settings;
+
+    PostProcess() = default;
+    DISABLE_COPY(PostProcess)
+
+    // False if the device lacks compute subgroup arithmetic.
+    static bool supported(const DeviceProfile& profile);
+
+    void init(
+        const DeviceProfile& profile,
+        const vk::raii::Device& device,
+        MemoryBudget& budget,
+        uint32_t framesInFlight,
+        std::span<const char> spv
+    );
+    bool ready() const {
+        return *tonemapPipeline != nullptr;
+    }
+
+    // Call once the fence of `slot` has been waited on: resolves that slot's
+    // timings and advances the exposure adaptation clock.
+    void beginFrame(uint32_t slot, float frameSeconds);
+    // `scene` (HDR_FORMAT, sampled + transfer src) holds the image in its
+    // top-left `region`; all of `target` is overwritten, it needs transfer dst.
+    void addPasses(
+        RenderGraph& graph,
+        RenderGraph::Handle scene,
+        vk::Extent2D region,
+        RenderGraph::Handle target,
+        vk::Extent2D targetExtent
+    );
+
+    const Stats& getStats() const {
+        return stats;
+    }
+};
+
+#endif  // POSTPROCESS_HPP
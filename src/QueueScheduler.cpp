@@ -0,0 +1,481 @@
+#include "QueueScheduler.hpp"
+
+// std c++
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <map>
+#include <memory_resource>
+#include <stdexcept>
+
+// vulkan
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace {
+
+constexpr size_t idx(QueueType type) {
+    return static_cast<size_t>(type);
+}
+
+bool hasFlags(const vk::QueueFamilyProperties& p, vk::QueueFlags flags) {
+    return (p.queueFlags & flags) == flags;
+}
+
+/*
+ * Find a family with `want` but none of `avoid`. Returns ~0 if none exists.
+ */
+uint32_t findFamily(
+    std::span<const vk::QueueFamilyProperties> properties,
+    vk::QueueFlags want,
+    vk::QueueFlags avoid
+) {
+    for (uint32_t i = 0; i < properties.size(); i++) {
+        if (hasFlags(properties[i], want) && !(properties[i].queueFlags & avoid)) {
+            return i;
+        }
+    }
+    return ~0u;
+}
+
+}  // namespace
+
+const char* toString(QueueType type) {
+    switch (type) {
+        case QueueType::eGraphics:
+            return "graphics";
+        case QueueType::eCompute:
+            return "compute";
+        case QueueType::eTransfer:
+            return "transfer";
+    }
+    return "unknown";
+}
+
+QueueFamilies findQueueFamilies(
+    std::span<const vk::QueueFamilyProperties> properties,
+    uint32_t graphicsPresentFamily
+) {
+    assert(graphicsPresentFamily < properties.size());
+    QueueFamilies result;
+    // number of queues already handed out per family
+    std::vector<uint32_t> used(properties.size(), 0);
+    auto take = [&](QueueType type, uint32_t family) {
+        // share the last queue of the family once all of them are in use
+        uint32_t index = std::min(used[family], properties[family].queueCount - 1);
+        used[family] = std::min(used[family] + 1, properties[family].queueCount);
+        result.family[idx(type)] = family;
+        result.index[idx(type)] = index;
+        result.timestampValidBits[idx(type)] = properties[family].timestampValidBits;
+    };
+
+    take(QueueType::eGraphics, graphicsPresentFamily);
+
+    uint32_t compute = findFamily(
+        properties, vk::QueueFlagBits::eCompute, vk::QueueFlagBits::eGraphics
+    );
+    take(QueueType::eCompute, compute != ~0u ? compute : graphicsPresentFamily);
+
+    uint32_t transfer = findFamily(
+        properties,
+        vk::QueueFlagBits::eTransfer,
+        vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute
+    );
+    if (transfer == ~0u) {
+        transfer = findFamily(
+            properties, vk::QueueFlagBits::eTransfer, vk::QueueFlagBits::eGraphics
+        );
+    }
+    // graphics and compute queues implicitly support transfer
+    take(QueueType::eTransfer, transfer != ~0u ? transfer : result.familyOf(QueueType::eCompute));
+
+    return result;
+}
+
+std::vector<vk::DeviceQueueCreateInfo> makeQueueCreateInfos(
+    const QueueFamilies& families,
+    std::span<const vk::QueueFamilyProperties> properties,
+    std::vector<float>& priorities
+) {
+    std::map<uint32_t, uint32_t> queueCounts;
+    for (size_t i = 0; i < QUEUE_TYPE_COUNT; i++) {
+        auto& count = queueCounts[families.family[i]];
+        count = std::max(count, families.index[i] + 1);
+    }
+
+    // graphics keeps the highest priority, async queues run in its shadow
+    priorities.assign(QUEUE_TYPE_COUNT, 0.5f);
+    priorities[0] = 1.f;
+
+    std::vector<vk::DeviceQueueCreateInfo> infos;
+    for (auto [family, count] : queueCounts) {
+        assert(count <= properties[family].queueCount);
+        infos.push_back({
+            .queueFamilyIndex = family,
+            .queueCount = count,
+            .pQueuePriorities = priorities.data()
+        });
+    }
+    return infos;
+}
+
+QueueScheduler::QueueScheduler(
+    const vk::raii::Device& device,
+    const QueueFamilies& families,
+    float timestampPeriod,
+    bool calibratedTimestamps
+) : device(&device), families(families), timestampPeriod(timestampPeriod), calibrated(calibratedTimestamps) {
+    vk::SemaphoreTypeCreateInfo timelineInfo{
+        .semaphoreType = vk::SemaphoreType::eTimeline,
+        .initialValue = 0
+    };
+    for (size_t i = 0; i < QUEUE_TYPE_COUNT; i++) {
+        auto& q = queues[i];
+        q.queue = vk::raii::Queue(device, families.family[i], families.index[i]);
+        q.timeline = vk::raii::Semaphore(device, vk::SemaphoreCreateInfo{.pNext = &timelineInfo});
+        q.pool = vk::raii::CommandPool(
+            device,
+            vk::CommandPoolCreateInfo{
+                .flags = vk::CommandPoolCreateFlagBits::eTransient |
+                         vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+                .queueFamilyIndex = families.family[i]
+            }
+        );
+        if (families.timestampValidBits[i] != 0) {
+            q.timestamps = vk::raii::QueryPool(
+                device,
+                vk::QueryPoolCreateInfo{
+                    .queryType = vk::QueryType::eTimestamp,
+                    .queryCount = TIMESTAMP_QUERY_COUNT
+                }
+            );
+            q.timestamps.reset(0, TIMESTAMP_QUERY_COUNT);
+        }
+    }
+}
+
+vk::raii::CommandBuffer QueueScheduler::allocateCommandBuffer(QueueType type) {
+    vk::CommandBufferAllocateInfo allocInfo{
+        .commandPool = get(type).pool,
+        .level = vk::CommandBufferLevel::ePrimary,
+        .commandBufferCount = 1
+    };
+    vk::raii::CommandBuffers buffers{*device, allocInfo};
+    return std::move(buffers[0]);
+}
+
+vk::SemaphoreSubmitInfo QueueScheduler::timelineSignal(
+    QueueType type, uint64_t value, vk::PipelineStageFlags2 stages
+) const {
+    return {
+        .semaphore = *get(type).timeline,
+        .value = value,
+        .stageMask = stages
+    };
+}
+
+uint64_t QueueScheduler::submit(const Submission& submission) {
+    auto& q = get(submission.queue);
+    // the submit info arrays are only needed for the call, keep them on the stack
+    std::array<std::byte, 2048> scratchBuffer;
+    std::pmr::monotonic_buffer_resource scratch(scratchBuffer.data(), scratchBuffer.size());
+
+    std::pmr::vector<vk::SemaphoreSubmitInfo> waits(
+        submission.extraWaits.begin(), submission.extraWaits.end(), &scratch
+    );
+    auto addWait = [&](const Wait& wait) {
+        // waiting on our own timeline is implied by submission order
+        if (wait.queue == submission.queue || wait.value == 0) {
+            return;
+        }
+        waits.push_back(timelineSignal(wait.queue, wait.value, wait.stages));
+    };
+    for (const auto& wait : submission.waits) {
+        addWait(wait);
+    }
+    for (const auto& wait : q.pendingWaits) {
+        addWait(wait);
+    }
+    q.pendingWaits.clear();
+
+    uint64_t value = ++q.submitted;
+    std::pmr::vector<vk::SemaphoreSubmitInfo> signals(
+        submission.extraSignals.begin(), submission.extraSignals.end(), &scratch
+    );
+    signals.push_back(timelineSignal(submission.queue, value, vk::PipelineStageFlagBits2::eAllCommands));
+
+    std::pmr::vector<vk::CommandBufferSubmitInfo> cmdInfos(&scratch);
+    cmdInfos.reserve(submission.commandBuffers.size());
+    for (auto cmd : submission.commandBuffers) {
+        cmdInfos.push_back({.commandBuffer = cmd});
+    }
+
+    vk::SubmitInfo2 submitInfo{
+        .waitSemaphoreInfoCount = static_cast<uint32_t>(waits.size()),
+        .pWaitSemaphoreInfos = waits.data(),
+        .commandBufferInfoCount = static_cast<uint32_t>(cmdInfos.size()),
+        .pCommandBufferInfos = cmdInfos.data(),
+        .signalSemaphoreInfoCount = static_cast<uint32_t>(signals.size()),
+        .pSignalSemaphoreInfos = signals.data()
+    };
+    q.queue.submit2(submitInfo, submission.fence);
+
+    for (auto& interval : openIntervals) {
+        if (interval.queue == submission.queue && interval.value == 0) {
+            interval.value = value;
+        }
+    }
+    return value;
+}
+
+uint64_t QueueScheduler::completedValue(QueueType type) {
+    auto& q = get(type);
+    q.completed = q.timeline.getCounterValue();
+    return q.completed;
+}
+
+void QueueScheduler::wait(QueueType type, uint64_t value) {
+    auto& q = get(type);
+    if (q.completed >= value) {
+        return;
+    }
+    vk::SemaphoreWaitInfo waitInfo{
+        .semaphoreCount = 1,
+        .pSemaphores = &*q.timeline,
+        .pValues = &value
+    };
+    if (device->waitSemaphores(waitInfo, UINT64_MAX) != vk::Result::eSuccess) {
+        throw std::runtime_error("failed to wait for timeline semaphore!");
+    }
+    q.completed = value;
+}
+
+void QueueScheduler::poll() {
+    for (size_t i = 0; i < QUEUE_TYPE_COUNT; i++) {
+        completedValue(static_cast<QueueType>(i));
+    }
+
+    std::erase_if(retired, [this](const Retired& r) {
+        return get(r.queue).completed >= r.value;
+    });
+
+    bool calibratedThisPoll = false;
+    while (!openIntervals.empty()) {
+        auto& open = openIntervals.front();
+        if (open.value == 0 || get(open.queue).completed < open.value) {
+            break;
+        }
+        auto& q = get(open.queue);
+        // getResult into a fixed array, getResults would allocate a vector every frame
+        auto [result, stamps] = q.timestamps.getResult<std::array<uint64_t, 2>>(
+            open.query, 2, sizeof(uint64_t), vk::QueryResultFlagBits::e64
+        );
+        if (result == vk::Result::eSuccess && stamps[1] >= stamps[0]) {
+            // one sample a poll is plenty, the clocks drift by far less than a frame
+            if (calibrated && !calibratedThisPoll) {
+                calibrate();
+                calibratedThisPoll = true;
+            }
+            auto& history = intervals[idx(open.queue)];
+            // drops the oldest sample once the history is full
+            history.push_back({toNs(open.queue, stamps[0]), toNs(open.queue, stamps[1])});
+        }
+        openIntervals.pop_front();
+    }
+}
+
+/*
+ * Device timestamps are defined per queue: the spec only makes them
+ * comparable within one. The device time domain of
+ * VK_EXT_calibrated_timestamps is comparable with the values every queue's
+ * vkCmdWriteTimestamp2 produces, so one (device, host) pair maps each
+ * queue's ticks, wrapped to its valid bits, onto CLOCK_MONOTONIC.
+ */
+void QueueScheduler::calibrate() {
+    std::array<vk::CalibratedTimestampInfoEXT, 2> infos{{
+        {.timeDomain = vk::TimeDomainEXT::eDevice},
+        {.timeDomain = vk::TimeDomainEXT::eClockMonotonic},
+    }};
+    std::array<uint64_t, 2> stamps{};
+    uint64_t maxDeviation = 0;
+    // the C entry point fills our arrays, the raii wrapper returns a new vector
+    auto result = static_cast<vk::Result>(device->getDispatcher()->vkGetCalibratedTimestampsEXT(
+        static_cast<VkDevice>(**device),
+        static_cast<uint32_t>(infos.size()),
+        reinterpret_cast<const VkCalibratedTimestampInfoEXT*>(infos.data()),
+        stamps.data(),
+        &maxDeviation
+    ));
+    if (result == vk::Result::eSuccess) {
+        calibration = {.device = stamps[0], .hostNs = static_cast<int64_t>(stamps[1])};
+    }
+}
+
+int64_t QueueScheduler::toNs(QueueType type, uint64_t ticks) const {
+    if (!calibrated) {
+        return static_cast<int64_t>(static_cast<double>(ticks) * timestampPeriod);
+    }
+    uint32_t bits = std::clamp(families.timestampValidBits[idx(type)], 1u, 64u);
+    // stamps from before the calibration come out negative
+    uint64_t delta = ticks - calibration.device;
+    auto signedDelta = static_cast<int64_t>(delta << (64 - bits)) >> (64 - bits);
+    return calibration.hostNs + static_cast<int64_t>(static_cast<double>(signedDelta) * timestampPeriod);
+}
+
+void QueueScheduler::recordRelease(const vk::raii::CommandBuffer& cmd, const BufferTransfer& transfer) const {
+    if (!needsOwnershipTransfer(transfer.src, transfer.dst)) {
+        return;
+    }
+    vk::BufferMemoryBarrier2 barrier{
+        .srcStageMask = transfer.srcStage,
+        .srcAccessMask = transfer.srcAccess,
+        .srcQueueFamilyIndex = family(transfer.src),
+        .dstQueueFamilyIndex = family(transfer.dst),
+        .buffer = transfer.buffer,
+        .offset = transfer.offset,
+        .size = transfer.size
+    };
+    cmd.pipelineBarrier2({.bufferMemoryBarrierCount = 1, .pBufferMemoryBarriers = &barrier});
+}
+
+void QueueScheduler::recordRelease(const vk::raii::CommandBuffer& cmd, const ImageTransfer& transfer) const {
+    if (!needsOwnershipTransfer(transfer.src, transfer.dst)) {
+        return;
+    }
+    vk::ImageMemoryBarrier2 barrier{
+        .srcStageMask = transfer.srcStage,
+        .srcAccessMask = transfer.srcAccess,
+        .oldLayout = transfer.oldLayout,
+        .newLayout = transfer.newLayout,
+        .srcQueueFamilyIndex = family(transfer.src),
+        .dstQueueFamilyIndex = family(transfer.dst),
+        .image = transfer.image,
+        .subresourceRange = transfer.range
+    };
+    cmd.pipelineBarrier2({.imageMemoryBarrierCount = 1, .pImageMemoryBarriers = &barrier});
+}
+
+void QueueScheduler::enqueueAcquire(const BufferTransfer& transfer, uint64_t srcValue) {
+    auto& q = get(transfer.dst);
+    q.pendingWaits.push_back({transfer.src, srcValue, transfer.dstStage});
+    // same family: the timeline wait is already a full memory dependency
+    if (!needsOwnershipTransfer(transfer.src, transfer.dst)) {
+        return;
+    }
+    q.pendingBufferAcquires.push_back({
+        .dstStageMask = transfer.dstStage,
+        .dstAccessMask = transfer.dstAccess,
+        .srcQueueFamilyIndex = family(transfer.src),
+        .dstQueueFamilyIndex = family(transfer.dst),
+        .buffer = transfer.buffer,
+        .offset = transfer.offset,
+        .size = transfer.size
+    });
+}
+
+void QueueScheduler::enqueueAcquire(const ImageTransfer& transfer, uint64_t srcValue) {
+    auto& q = get(transfer.dst);
+    q.pendingWaits.push_back({transfer.src, srcValue, transfer.dstStage});
+    bool transferOwnership = needsOwnershipTransfer(transfer.src, transfer.dst);
+    // a layout change still needs a barrier on the destination queue
+    if (!transferOwnership && transfer.oldLayout == transfer.newLayout) {
+        return;
+    }
+    q.pendingImageAcquires.push_back({
+        .dstStageMask = transfer.dstStage,
+        .dstAccessMask = transfer.dstAccess,
+        .oldLayout = transfer.oldLayout,
+        .newLayout = transfer.newLayout,
+        .srcQueueFamilyIndex = transferOwnership ? family(transfer.src) : vk::QueueFamilyIgnored,
+        .dstQueueFamilyIndex = transferOwnership ? family(transfer.dst) : vk::QueueFamilyIgnored,
+        .image = transfer.image,
+        .subresourceRange = transfer.range
+    });
+}
+
+void QueueScheduler::recordPendingAcquires(QueueType type, const vk::raii::CommandBuffer& cmd) {
+    auto& q = get(type);
+    if (q.pendingBufferAcquires.empty() && q.pendingImageAcquires.empty()) {
+        return;
+    }
+    vk::DependencyInfo dependencyInfo{
+        .bufferMemoryBarrierCount = static_cast<uint32_t>(q.pendingBufferAcquires.size()),
+        .pBufferMemoryBarriers = q.pendingBufferAcquires.data(),
+        .imageMemoryBarrierCount = static_cast<uint32_t>(q.pendingImageAcquires.size()),
+        .pImageMemoryBarriers = q.pendingImageAcquires.data()
+    };
+    cmd.pipelineBarrier2(dependencyInfo);
+    q.pendingBufferAcquires.clear();
+    q.pendingImageAcquires.clear();
+}
+
+uint32_t QueueScheduler::beginTimedScope(QueueType type, const vk::raii::CommandBuffer& cmd) {
+    auto& q = get(type);
+    if (q.timestamps == nullptr) {
+        return ~0u;
+    }
+    uint32_t query = q.nextQuery;
+    // the slot is still owned by an unresolved scope, skip this sample
+    for (const auto& open : openIntervals) {
+        if (open.queue == type && open.query == query) {
+            return ~0u;
+        }
+    }
+    q.nextQuery = (q.nextQuery + 2) % TIMESTAMP_QUERY_COUNT;
+    q.timestamps.reset(query, 2);
+    cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eTopOfPipe, *q.timestamps, query);
+    openIntervals.push_back({type, query, 0});
+    return query;
+}
+
+void QueueScheduler::endTimedScope(QueueType type, const vk::raii::CommandBuffer& cmd, uint32_t scope) {
+    if (scope == ~0u) {
+        return;
+    }
+    cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eBottomOfPipe, *get(type).timestamps, scope + 1);
+}
+
+double QueueScheduler::lastScopeMs(QueueType type) const {
+    const auto& history = intervals[idx(type)];
+    if (history.empty()) {
+        return 0.0;
+    }
+    return static_cast<double>(history.back().end - history.back().begin) / 1e6;
+}
+
+QueueScheduler::OverlapStats QueueScheduler::overlapStats() const {
+    OverlapStats stats;
+    stats.calibrated = calibrated;
+    auto toMs = [](int64_t ns) {
+        return static_cast<double>(ns) / 1e6;
+    };
+
+    const auto& graphics = intervals[idx(QueueType::eGraphics)];
+    int64_t windowBegin = INT64_MAX, windowEnd = INT64_MIN;
+    for (size_t i = 0; i < QUEUE_TYPE_COUNT; i++) {
+        for (const auto& a : intervals[i]) {
+            stats.busyMs[i] += toMs(a.end - a.begin);
+            // uncalibrated clocks of different queues don't line up
+            if (!calibrated) {
+                continue;
+            }
+            windowBegin = std::min(windowBegin, a.begin);
+            windowEnd = std::max(windowEnd, a.end);
+            if (i == idx(QueueType::eGraphics) || !families.isAsync(static_cast<QueueType>(i))) {
+                continue;
+            }
+            // graphics intervals come from one queue so they never overlap each other
+            for (const auto& g : graphics) {
+                int64_t begin = std::max(a.begin, g.begin);
+                int64_t end = std::min(a.end, g.end);
+                if (begin < end) {
+                    stats.overlapWithGraphicsMs[i] += toMs(end - begin);
+                }
+            }
+        }
+    }
+    if (windowEnd > windowBegin) {
+        stats.windowMs = toMs(windowEnd - windowBegin);
+    }
+    return stats;
+}
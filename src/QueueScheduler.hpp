@@ -0,0 +1,260 @@
+#ifndef QUEUESCHEDULER_HPP
+#define QUEUESCHEDULER_HPP
+
+// c++ std libs
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <span>
+#include <vector>
+
+// vulkan-hpp headers
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "utils.hpp"
+
+enum class QueueType : uint32_t {
+    eGraphics = 0,
+    eCompute,
+    eTransfer,
+};
+constexpr size_t QUEUE_TYPE_COUNT = 3;
+
+const char* toString(QueueType type);
+
+/*
+ * Which family / queue index each logical queue lives on. Compute and transfer
+ * fall back to the graphics queue when the device has no dedicated family.
+ */
+struct QueueFamilies {
+    std::array<uint32_t, QUEUE_TYPE_COUNT> family{~0u, ~0u, ~0u};
+    std::array<uint32_t, QUEUE_TYPE_COUNT> index{0, 0, 0};
+    std::array<uint32_t, QUEUE_TYPE_COUNT> timestampValidBits{0, 0, 0};
+
+    uint32_t familyOf(QueueType type) const {
+        return family[static_cast<size_t>(type)];
+    }
+    // true if work on `type` can run concurrently with the graphics queue
+    bool isAsync(QueueType type) const {
+        auto i = static_cast<size_t>(type);
+        auto g = static_cast<size_t>(QueueType::eGraphics);
+        return family[i] != family[g] || index[i] != index[g];
+    }
+};
+
+/*
+ * Pick graphics(+present), async compute and transfer queues.
+ * Preference: dedicated family > second queue of a shared family > graphics queue.
+ */
+QueueFamilies findQueueFamilies(
+    std::span<const vk::QueueFamilyProperties> properties,
+    uint32_t graphicsPresentFamily
+);
+
+/*
+ * Build one DeviceQueueCreateInfo per used family. `priorities` must outlive
+ * the returned infos.
+ */
+std::vector<vk::DeviceQueueCreateInfo> makeQueueCreateInfos(
+    const QueueFamilies& families,
+    std::span<const vk::QueueFamilyProperties> properties,
+    std::vector<float>& priorities
+);
+
+/*
+ * Submission scheduler over the graphics / compute / transfer queues.
+ * Every queue owns a timeline semaphore; each submit signals the next value,
+ * and other queues wait on (queue, value) pairs instead of binary semaphores.
+ */
+class QueueScheduler {
+public:
+    struct Wait {
+        QueueType queue;
+        uint64_t value;
+        vk::PipelineStageFlags2 stages = vk::PipelineStageFlagBits2::eAllCommands;
+    };
+
+    struct Submission {
+        QueueType queue = QueueType::eGraphics;
+        std::span<const vk::CommandBuffer> commandBuffers;
+        std::span<const Wait> waits;
+        // binary semaphores, e.g. swapchain acquire / present
+        std::span<const vk::SemaphoreSubmitInfo> extraWaits;
+        std::span<const vk::SemaphoreSubmitInfo> extraSignals;
+        vk::Fence fence = nullptr;
+    };
+
+    /*
+     * A queue family ownership transfer of a buffer range. The release half is
+     * recorded on `src`, the acquire half on `dst`; both are no-ops when the two
+     * queues share a family.
+     */
+    struct BufferTransfer {
+        vk::Buffer buffer;
+        vk::DeviceSize offset = 0;
+        vk::DeviceSize size = vk::WholeSize;
+        QueueType src;
+        QueueType dst;
+        vk::PipelineStageFlags2 srcStage;
+        vk::AccessFlags2 srcAccess;
+        vk::PipelineStageFlags2 dstStage;
+        vk::AccessFlags2 dstAccess;
+    };
+
+    struct ImageTransfer {
+        vk::Image image;
+        vk::ImageSubresourceRange range{vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1};
+        vk::ImageLayout oldLayout;
+        vk::ImageLayout newLayout;
+        QueueType src;
+        QueueType dst;
+        vk::PipelineStageFlags2 srcStage;
+        vk::AccessFlags2 srcAccess;
+        vk::PipelineStageFlags2 dstStage;
+        vk::AccessFlags2 dstAccess;
+    };
+
+    // Busy time and overlap with graphics over the sampled window, in ms.
+    // Timestamps of different queues are only comparable once calibrated
+    // against the host clock; without that only busyMs is filled in.
+    struct OverlapStats {
+        std::array<double, QUEUE_TYPE_COUNT> busyMs{};
+        std::array<double, QUEUE_TYPE_COUNT> overlapWithGraphicsMs{};
+        double windowMs = 0;
+        bool calibrated = false;
+
+        double overlapRatio(QueueType type) const {
+            auto i = static_cast<size_t>(type);
+            return busyMs[i] > 0 ? overlapWithGraphicsMs[i] / busyMs[i] : 0.0;
+        }
+    };
+
+private:
+    struct PerQueue {
+        vk::raii::Queue queue = nullptr;
+        vk::raii::Semaphore timeline = nullptr;
+        vk::raii::CommandPool pool = nullptr;
+        vk::raii::QueryPool timestamps = nullptr;
+        uint64_t submitted = 0;
+        uint64_t completed = 0;
+        uint32_t nextQuery = 0;
+        // acquire barriers to record into the next command buffer on this queue
+        std::vector<vk::BufferMemoryBarrier2> pendingBufferAcquires;
+        std::vector<vk::ImageMemoryBarrier2> pendingImageAcquires;
+        std::vector<Wait> pendingWaits;
+    };
+    struct TimedInterval {
+        QueueType queue;
+        uint32_t query;
+        uint64_t value;  // timeline value that makes the query available
+    };
+    struct Retired {
+        QueueType queue;
+        uint64_t value;
+        std::move_only_function<void()> holder;
+    };
+    // nanoseconds, on CLOCK_MONOTONIC when calibrated, else since an arbitrary
+    // point of the queue's own clock
+    struct Interval {
+        int64_t begin;
+        int64_t end;
+    };
+    // a device timestamp and the host time it was taken at
+    struct Calibration {
+        uint64_t device = 0;
+        int64_t hostNs = 0;
+    };
+
+    static constexpr uint32_t TIMESTAMP_QUERY_COUNT = 128;
+    static constexpr size_t INTERVAL_HISTORY = 64;
+
+    const vk::raii::Device* device = nullptr;
+    QueueFamilies families;
+    std::array<PerQueue, QUEUE_TYPE_COUNT> queues;
+    // every query pair of every queue can be open at once
+    RingBuffer<TimedInterval, TIMESTAMP_QUERY_COUNT / 2 * QUEUE_TYPE_COUNT> openIntervals;
+    std::array<RingBuffer<Interval, INTERVAL_HISTORY>, QUEUE_TYPE_COUNT> intervals;
+    std::deque<Retired> retired;
+    float timestampPeriod = 1.f;
+    bool calibrated = false;  // VK_EXT_calibrated_timestamps is enabled
+    Calibration calibration;
+
+    PerQueue& get(QueueType type) {
+        return queues[static_cast<size_t>(type)];
+    }
+    const PerQueue& get(QueueType type) const {
+        return queues[static_cast<size_t>(type)];
+    }
+    void calibrate();
+    int64_t toNs(QueueType type, uint64_t ticks) const;
+
+public:
+    QueueScheduler() = default;
+    // `calibratedTimestamps`: VK_EXT_calibrated_timestamps was enabled and has
+    // the device and CLOCK_MONOTONIC time domains.
+    QueueScheduler(
+        const vk::raii::Device& device,
+        const QueueFamilies& families,
+        float timestampPeriod,
+        bool calibratedTimestamps = false
+    );
+    QueueScheduler(QueueScheduler&&) = default;
+    QueueScheduler& operator=(QueueScheduler&&) = default;
+    DISABLE_COPY(QueueScheduler)
+
+    const QueueFamilies& getFamilies() const {
+        return families;
+    }
+    uint32_t family(QueueType type) const {
+        return families.familyOf(type);
+    }
+    const vk::raii::Queue& queue(QueueType type) const {
+        return get(type).queue;
+    }
+    const vk::raii::CommandPool& commandPool(QueueType type) const {
+        return get(type).pool;
+    }
+
+    // Allocate a primary command buffer from the queue's transient pool.
+    vk::raii::CommandBuffer allocateCommandBuffer(QueueType type);
+
+    // Returns the timeline value signaled when the submission completes.
+    uint64_t submit(const Submission& submission);
+    // Non-blocking; refreshes completed values and frees retired resources.
+    void poll();
+    uint64_t completedValue(QueueType type);
+    uint64_t submittedValue(QueueType type) const {
+        return get(type).submitted;
+    }
+    void wait(QueueType type, uint64_t value);
+    vk::SemaphoreSubmitInfo timelineSignal(QueueType type, uint64_t value, vk::PipelineStageFlags2 stages) const;
+
+    // Keep `object` alive until `queue` reaches `value`.
+    template <class T>
+    void retire(QueueType queue, uint64_t value, T&& object) {
+        retired.push_back({queue, value, [obj = std::forward<T>(object)]() {}});
+    }
+
+    bool needsOwnershipTransfer(QueueType src, QueueType dst) const {
+        return family(src) != family(dst);
+    }
+    void recordRelease(const vk::raii::CommandBuffer& cmd, const BufferTransfer& transfer) const;
+    void recordRelease(const vk::raii::CommandBuffer& cmd, const ImageTransfer& transfer) const;
+    // Queue the acquire half (and the wait on `srcValue`) for the next submit on transfer.dst.
+    void enqueueAcquire(const BufferTransfer& transfer, uint64_t srcValue);
+    void enqueueAcquire(const ImageTransfer& transfer, uint64_t srcValue);
+    // Record queued acquire barriers; call at the start of a command buffer for `type`.
+    void recordPendingAcquires(QueueType type, const vk::raii::CommandBuffer& cmd);
+
+    // GPU timestamps bracketing a command buffer, used to measure busy time and,
+    // with calibrated timestamps, cross-queue overlap.
+    uint32_t beginTimedScope(QueueType type, const vk::raii::CommandBuffer& cmd);
+    void endTimedScope(QueueType type, const vk::raii::CommandBuffer& cmd, uint32_t scope);
+    OverlapStats overlapStats() const;
+    // Duration of the most recently resolved timed scope on `type`, 0 if none yet.
+    double lastScopeMs(QueueType type) const;
+};
+
+#endif  // QUEUESCHEDULER_HPP
@@ -0,0 +1,640 @@
+#include "RenderGraph.hpp"
+
+// std c++
+#include <cassert>
+#include <format>
+#include <stdexcept>
+
+// vulkan
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace {
+
+using Stage = vk::PipelineStageFlagBits2;
+using Access = vk::AccessFlagBits2;
+using Layout = vk::ImageLayout;
+
+// vk::to_string on flags gives "{ A | B }", strip the braces
+std::string flagsToString(const std::string& flags) {
+    if (flags.size() >= 4 && flags.front() == '{') {
+        return flags.substr(2, flags.size() - 4);
+    }
+    return flags;
+}
+
+}  // namespace
+
+UsageInfo usageInfo(ResourceUsage usage) {
+    switch (usage) {
+        case ResourceUsage::eColorAttachmentWrite:
+            return {
+                Layout::eColorAttachmentOptimal,
+                Stage::eColorAttachmentOutput,
+                Access::eColorAttachmentWrite,
+                Access::eColorAttachmentWrite,
+                false
+            };
+        case ResourceUsage::eColorAttachmentReadWrite:
+            return {
+                Layout::eColorAttachmentOptimal,
+                Stage::eColorAttachmentOutput,
+                Access::eColorAttachmentRead | Access::eColorAttachmentWrite,
+                Access::eColorAttachmentWrite,
+                true
+            };
+        case ResourceUsage::eDepthAttachmentWrite:
+            return {
+                Layout::eDepthAttachmentOptimal,
+                Stage::eEarlyFragmentTests | Stage::eLateFragmentTests,
+                Access::eDepthStencilAttachmentRead | Access::eDepthStencilAttachmentWrite,
+                Access::eDepthStencilAttachmentWrite,
+                true
+            };
+        case ResourceUsage::eFragmentSampled:
+            return {
+                Layout::eShaderReadOnlyOptimal,
+                Stage::eFragmentShader,
+                Access::eShaderSampledRead,
+                {},
+                true
+            };
+        case ResourceUsage::eComputeSampled:
+            return {
+                Layout::eShaderReadOnlyOptimal,
+                Stage::eComputeShader,
+                Access::eShaderSampledRead,
+                {},
+                true
+            };
+        case ResourceUsage::eComputeStorageRead:
+            return {
+                Layout::eGeneral,
+                Stage::eComputeShader,
+                Access::eShaderStorageRead,
+                {},
+                true
+            };
+        case ResourceUsage::eComputeStorageWrite:
+            return {
+                Layout::eGeneral,
+                Stage::eComputeShader,
+                Access::eShaderStorageWrite,
+                Access::eShaderStorageWrite,
+                false
+            };
+        case ResourceUsage::eComputeStorageReadWrite:
+            return {
+                Layout::eGeneral,
+                Stage::eComputeShader,
+                Access::eShaderStorageRead | Access::eShaderStorageWrite,
+                Access::eShaderStorageWrite,
+                true
+            };
+        case ResourceUsage::eVertexStorageRead:
+            return {
+                Layout::eGeneral,
+                Stage::eVertexShader,
+                Access::eShaderStorageRead,
+                {},
+                true
+            };
+        case ResourceUsage::eTransferSrc:
+            return {
+                Layout::eTransferSrcOptimal,
+                Stage::eAllTransfer,
+                Access::eTransferRead,
+                {},
+                true
+            };
+        case ResourceUsage::eTransferDst:
+            return {
+                Layout::eTransferDstOptimal,
+                Stage::eAllTransfer,
+                Access::eTransferWrite,
+                Access::eTransferWrite,
+                false
+            };
+        case ResourceUsage::eVertexBuffer:
+            return {
+                Layout::eUndefined,
+                Stage::eVertexAttributeInput,
+                Access::eVertexAttributeRead,
+                {},
+                true
+            };
+        case ResourceUsage::eIndexBuffer:
+            return {
+                Layout::eUndefined,
+                Stage::eIndexInput,
+                Access::eIndexRead,
+                {},
+                true
+            };
+        case ResourceUsage::eIndirectBuffer:
+            return {
+                Layout::eUndefined,
+                Stage::eDrawIndirect,
+                Access::eIndirectCommandRead,
+                {},
+                true
+            };
+        case ResourceUsage::eUniformBuffer:
+            return {
+                Layout::eUndefined,
+                Stage::eVertexShader | Stage::eFragmentShader | Stage::eComputeShader,
+                Access::eUniformRead,
+                {},
+                true
+            };
+        case ResourceUsage::eHostRead:
+            return {
+                Layout::eUndefined,
+                Stage::eHost,
+                Access::eHostRead,
+                {},
+                true
+            };
+        case ResourceUsage::ePresent:
+            // presentation engine waits on a semaphore, nothing to make visible
+            return {
+                Layout::ePresentSrcKHR,
+                Stage::eNone,
+                Access::eNone,
+                {},
+                true
+            };
+    }
+    throw std::runtime_error("Unknown resource usage");
+}
+
+const char* toString(ResourceUsage usage) {
+    switch (usage) {
+        case ResourceUsage::eColorAttachmentWrite:
+            return "ColorAttachmentWrite";
+        case ResourceUsage::eColorAttachmentReadWrite:
+            return "ColorAttachmentReadWrite";
+        case ResourceUsage::eDepthAttachmentWrite:
+            return "DepthAttachmentWrite";
+        case ResourceUsage::eFragmentSampled:
+            return "FragmentSampled";
+        case ResourceUsage::eComputeSampled:
+            return "ComputeSampled";
+        case ResourceUsage::eComputeStorageRead:
+            return "ComputeStorageRead";
+        case ResourceUsage::eComputeStorageWrite:
+            return "ComputeStorageWrite";
+        case ResourceUsage::eComputeStorageReadWrite:
+            return "ComputeStorageReadWrite";
+        case ResourceUsage::eVertexStorageRead:
+            return "VertexStorageRead";
+        case ResourceUsage::eTransferSrc:
+            return "TransferSrc";
+        case ResourceUsage::eTransferDst:
+            return "TransferDst";
+        case ResourceUsage::eVertexBuffer:
+            return "VertexBuffer";
+        case ResourceUsage::eIndexBuffer:
+            return "IndexBuffer";
+        case ResourceUsage::eIndirectBuffer:
+            return "IndirectBuffer";
+        case ResourceUsage::eUniformBuffer:
+            return "UniformBuffer";
+        case ResourceUsage::eHostRead:
+            return "HostRead";
+        case ResourceUsage::ePresent:
+            return "Present";
+    }
+    return "Unknown";
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::use(Handle resource, ResourceUsage usage) {
+    assert(resource < graph.resources.size());
+    auto& uses = graph.passes[pass].uses;
+    for (const auto& u : uses) {
+        if (u.resource == resource) {
+            throw std::runtime_error(std::format(
+                "pass {} uses resource {} twice",
+                graph.passes[pass].name,
+                graph.resources[resource].name
+            ));
+        }
+    }
+    uses.push_back({resource, usage});
+    graph.compiled = false;
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::sideEffect() {
+    graph.passes[pass].sideEffect = true;
+    return *this;
+}
+
+void RenderGraph::reset(std::pmr::memory_resource* frameMemory) {
+    resources.clear();
+    passes.clear();
+    ownMemory.release();
+    memory = frameMemory != nullptr ? frameMemory : &ownMemory;
+    batches.clear();
+    imageBarriers.clear();
+    bufferBarriers.clear();
+    compiled = false;
+}
+
+RenderGraph::Handle RenderGraph::importImage(
+    const char* name, const ImageDesc& desc, ResourceState initial
+) {
+    resources.push_back({
+        .name = name,
+        .isImage = true,
+        .image = desc,
+        .initial = initial
+    });
+    return static_cast<Handle>(resources.size() - 1);
+}
+
+RenderGraph::Handle RenderGraph::importBuffer(
+    const char* name, vk::Buffer buffer, ResourceState initial
+) {
+    resources.push_back({
+        .name = name,
+        .isImage = false,
+        .buffer = buffer,
+        .initial = initial
+    });
+    return static_cast<Handle>(resources.size() - 1);
+}
+
+RenderGraph::Handle RenderGraph::createImage(const char* name, const RenderTargetDesc& desc) {
+    resources.push_back({
+        .name = name,
+        .isImage = true,
+        .image = {
+            .format = desc.format,
+            .extent = desc.extent,
+            .range = {aspectOf(desc.format), 0, 1, 0, 1}
+        },
+        .transient = true,
+        .target = desc
+    });
+    return static_cast<Handle>(resources.size() - 1);
+}
+
+void RenderGraph::exportResource(Handle resource, ResourceUsage finalUsage) {
+    resources[resource].exported = true;
+    resources[resource].finalUsage = finalUsage;
+    compiled = false;
+}
+
+RenderGraph::PassBuilder RenderGraph::addPassImpl(const char* name, ExecuteFn execute) {
+    passes.push_back({.name = name, .execute = execute, .uses = std::pmr::vector<Use>(memory)});
+    compiled = false;
+    return {*this, static_cast<uint32_t>(passes.size() - 1)};
+}
+
+/*
+ * Walk the passes backwards: a pass is alive if it has side effects or writes
+ * something that is exported or read by a later live pass.
+ */
+void RenderGraph::cull() {
+    std::pmr::vector<bool> needed(resources.size(), false, memory);
+    for (Handle r = 0; r < resources.size(); r++) {
+        needed[r] = resources[r].exported;
+    }
+    for (auto pass = passes.rbegin(); pass != passes.rend(); pass++) {
+        bool alive = pass->sideEffect;
+        for (const auto& use : pass->uses) {
+            if (usageInfo(use.usage).write() && needed[use.resource]) {
+                alive = true;
+            }
+        }
+        pass->culled = !alive;
+        if (!alive) {
+            continue;
+        }
+        for (const auto& use : pass->uses) {
+            auto info = usageInfo(use.usage);
+            if (info.write() && !info.read) {
+                // overwritten here, earlier contents are irrelevant
+                needed[use.resource] = false;
+            }
+        }
+        for (const auto& use : pass->uses) {
+            if (usageInfo(use.usage).read) {
+                needed[use.resource] = true;
+            }
+        }
+    }
+}
+
+/*
+ * Get the transient images that survived culling from the pool, each with the
+ * range of passes using it. A target starts out undefined, but its memory may
+ * still be in use by an earlier target of the same block or by last frame's
+ * passes, so its first barrier waits for every stage the block is used at.
+ */
+void RenderGraph::realizeTargets() {
+    constexpr uint32_t NONE = UINT32_MAX;
+    targetRequests.clear();
+    targetHandles.clear();
+    std::pmr::vector<uint32_t> requestOf(resources.size(), NONE, memory);
+    for (uint32_t p = 0; p < passes.size(); p++) {
+        if (passes[p].culled) {
+            continue;
+        }
+        for (const auto& use : passes[p].uses) {
+            const auto& resource = resources[use.resource];
+            if (!resource.transient) {
+                continue;
+            }
+            if (resource.exported) {
+                throw std::runtime_error(std::format("transient image {} can't be exported", resource.name));
+            }
+            uint32_t& request = requestOf[use.resource];
+            if (request == NONE) {
+                request = static_cast<uint32_t>(targetRequests.size());
+                targetRequests.push_back({.desc = resource.target, .firstPass = p});
+                targetHandles.push_back(use.resource);
+            }
+            targetRequests[request].lastPass = p;
+        }
+    }
+    if (targetPool == nullptr) {
+        if (!targetRequests.empty()) {
+            throw std::runtime_error("transient images need setTargetPool()");
+        }
+        return;
+    }
+    auto targets = targetPool->realize(targetRequests);
+
+    // block indices are below the target count
+    std::pmr::vector<ResourceState> blockUse(targets.size(), ResourceState{}, memory);
+    for (const auto& pass : passes) {
+        if (pass.culled) {
+            continue;
+        }
+        for (const auto& use : pass.uses) {
+            if (requestOf[use.resource] != NONE) {
+                auto info = usageInfo(use.usage);
+                auto& block = blockUse[targets[requestOf[use.resource]].block];
+                block.stages |= info.stages;
+                block.access |= info.writeAccess;
+            }
+        }
+    }
+    for (size_t i = 0; i < targets.size(); i++) {
+        auto& resource = resources[targetHandles[i]];
+        resource.image.image = targets[i].image;
+        resource.image.view = targets[i].view;
+        resource.initial = blockUse[targets[i].block];
+        resource.initial.layout = vk::ImageLayout::eUndefined;
+    }
+}
+
+void RenderGraph::addBarrier(Handle handle, ResourceUsage usage) {
+    const auto& resource = resources[handle];
+    auto& t = tracked[handle];
+    auto info = usageInfo(usage);
+    vk::ImageLayout oldLayout = t.layout;
+    bool layoutChange = resource.isImage && oldLayout != info.layout;
+
+    vk::PipelineStageFlags2 srcStages;
+    vk::AccessFlags2 srcAccess;
+    bool needed = false;
+    if (info.write() || layoutChange) {
+        // WAW, WAR or a layout transition: wait for every earlier access
+        srcStages = t.writeStages | t.readStages;
+        srcAccess = t.writeAccess;
+        needed = layoutChange || srcStages;
+        // a layout transition counts as a write happening at the dst stages
+        t.layout = resource.isImage ? info.layout : t.layout;
+        t.writeStages = info.stages;
+        t.writeAccess = info.writeAccess;
+        t.readStages = {};
+        t.visibleStages = info.stages;
+        t.visibleAccess = info.access;
+    }
+    else if (t.writeStages &&
+             ((t.visibleStages & info.stages) != info.stages ||
+              (t.visibleAccess & info.access) != info.access)) {
+        // RAW not yet covered by an earlier barrier
+        srcStages = t.writeStages;
+        srcAccess = t.writeAccess;
+        needed = true;
+        t.visibleStages |= info.stages;
+        t.visibleAccess |= info.access;
+    }
+    if (info.read) {
+        t.readStages |= info.stages;
+    }
+    if (!needed) {
+        return;
+    }
+
+    auto& batch = batches.back();
+    if (resource.isImage) {
+        imageBarriers.push_back({
+            .srcStageMask = srcStages,
+            .srcAccessMask = srcAccess,
+            .dstStageMask = info.stages,
+            .dstAccessMask = info.access,
+            .oldLayout = oldLayout,
+            .newLayout = info.layout,
+            .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .image = resource.image.image,
+            .subresourceRange = resource.image.range
+        });
+        batch.imageCount++;
+    }
+    else {
+        bufferBarriers.push_back({
+            .srcStageMask = srcStages,
+            .srcAccessMask = srcAccess,
+            .dstStageMask = info.stages,
+            .dstAccessMask = info.access,
+            .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .buffer = resource.buffer,
+            .offset = 0,
+            .size = vk::WholeSize
+        });
+        batch.bufferCount++;
+    }
+}
+
+void RenderGraph::compile() {
+    cull();
+    realizeTargets();
+
+    tracked.clear();
+    for (const auto& resource : resources) {
+        tracked.push_back({
+            .layout = resource.initial.layout,
+            .writeStages = resource.initial.stages,
+            .writeAccess = resource.initial.access,
+        });
+    }
+
+    batches.clear();
+    imageBarriers.clear();
+    bufferBarriers.clear();
+    for (const auto& pass : passes) {
+        batches.push_back({
+            .firstImage = static_cast<uint32_t>(imageBarriers.size()),
+            .firstBuffer = static_cast<uint32_t>(bufferBarriers.size())
+        });
+        if (pass.culled) {
+            continue;
+        }
+        for (const auto& use : pass.uses) {
+            addBarrier(use.resource, use.usage);
+        }
+    }
+    batches.push_back({
+        .firstImage = static_cast<uint32_t>(imageBarriers.size()),
+        .firstBuffer = static_cast<uint32_t>(bufferBarriers.size())
+    });
+    for (Handle r = 0; r < resources.size(); r++) {
+        if (resources[r].exported) {
+            addBarrier(r, resources[r].finalUsage);
+        }
+    }
+    compiled = true;
+}
+
+void RenderGraph::execute(const vk::raii::CommandBuffer& cmd) {
+    if (!compiled) {
+        compile();
+    }
+    auto flush = [&](const BarrierBatch& batch) {
+        if (batch.imageCount == 0 && batch.bufferCount == 0) {
+            return;
+        }
+        vk::DependencyInfo dependencyInfo{
+            .bufferMemoryBarrierCount = batch.bufferCount,
+            .pBufferMemoryBarriers = bufferBarriers.data() + batch.firstBuffer,
+            .imageMemoryBarrierCount = batch.imageCount,
+            .pImageMemoryBarriers = imageBarriers.data() + batch.firstImage
+        };
+        cmd.pipelineBarrier2(dependencyInfo);
+    };
+    for (size_t i = 0; i < passes.size(); i++) {
+        if (passes[i].culled) {
+            continue;
+        }
+        flush(batches[i]);
+        passes[i].execute(cmd);
+    }
+    flush(batches.back());
+}
+
+std::string RenderGraph::dump() const {
+    std::string out = std::format(
+        "render graph: {} passes, {} resources\n", passes.size(), resources.size()
+    );
+    for (const auto& r : resources) {
+        if (r.transient) {
+            out += std::format(
+                "  transient {}: {} {}x{}\n",
+                r.name,
+                vk::to_string(r.target.format),
+                r.target.extent.width,
+                r.target.extent.height
+            );
+        }
+    }
+    auto dumpBatch = [&](const BarrierBatch& batch) {
+        for (uint32_t i = 0; i < batch.imageCount; i++) {
+            const auto& b = imageBarriers[batch.firstImage + i];
+            const char* name = "?";
+            for (const auto& r : resources) {
+                if (r.isImage && r.image.image == b.image) {
+                    name = r.name;
+                }
+            }
+            out += std::format(
+                "    barrier image {}: {} -> {}, stage {} -> {}, access {} -> {}\n",
+                name,
+                vk::to_string(b.oldLayout),
+                vk::to_string(b.newLayout),
+                flagsToString(vk::to_string(b.srcStageMask)),
+                flagsToString(vk::to_string(b.dstStageMask)),
+                flagsToString(vk::to_string(b.srcAccessMask)),
+                flagsToString(vk::to_string(b.dstAccessMask))
+            );
+        }
+        for (uint32_t i = 0; i < batch.bufferCount; i++) {
+            const auto& b = bufferBarriers[batch.firstBuffer + i];
+            const char* name = "?";
+            for (const auto& r : resources) {
+                if (!r.isImage && r.buffer == b.buffer) {
+                    name = r.name;
+                }
+            }
+            out += std::format(
+                "    barrier buffer {}: stage {} -> {}, access {} -> {}\n",
+                name,
+                flagsToString(vk::to_string(b.srcStageMask)),
+                flagsToString(vk::to_string(b.dstStageMask)),
+                flagsToString(vk::to_string(b.srcAccessMask)),
+                flagsToString(vk::to_string(b.dstAccessMask))
+            );
+        }
+    };
+    for (size_t i = 0; i < passes.size(); i++) {
+        const auto& pass = passes[i];
+        out += std::format("  pass {}{}\n", pass.name, pass.culled ? " (culled)" : "");
+        for (const auto& use : pass.uses) {
+            out += std::format(
+                "    uses {} as {}\n", resources[use.resource].name, toString(use.usage)
+            );
+        }
+        if (compiled && !pass.culled) {
+            dumpBatch(batches[i]);
+        }
+    }
+    if (compiled) {
+        out += "  end of frame\n";
+        dumpBatch(batches.back());
+    }
+    return out;
+}
+
+std::string RenderGraph::toDot() const {
+    std::string out = "digraph RenderGraph {\n    rankdir=LR;\n";
+    for (Handle r = 0; r < resources.size(); r++) {
+        out += std::format(
+            "    r{} [label=\"{}\" shape={}{}{}];\n",
+            r,
+            resources[r].name,
+            resources[r].isImage ? "box" : "cylinder",
+            resources[r].exported ? " peripheries=2" : "",
+            resources[r].transient ? " style=dashed" : ""
+        );
+    }
+    for (size_t p = 0; p < passes.size(); p++) {
+        const auto& pass = passes[p];
+        out += std::format(
+            "    p{} [label=\"{}\" shape=ellipse{}];\n",
+            p,
+            pass.name,
+            pass.culled ? " style=dashed color=gray" : ""
+        );
+        for (const auto& use : pass.uses) {
+            auto info = usageInfo(use.usage);
+            if (info.read) {
+                out += std::format(
+                    "    r{} -> p{} [label=\"{}\"];\n", use.resource, p, toString(use.usage)
+                );
+            }
+            if (info.write()) {
+                out += std::format(
+                    "    p{} -> r{} [label=\"{}\"];\n", p, use.resource, toString(use.usage)
+                );
+            }
+        }
+    }
+    out += "}\n";
+    return out;
+}
@@ -0,0 +1,223 @@
+#ifndef RENDERGRAPH_HPP
+#define RENDERGRAPH_HPP
+
+// c++ std libs
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// vulkan-hpp headers
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "RenderTargetPool.hpp"
+#include "utils.hpp"
+
+/*
+ * How a pass touches a resource. Each usage maps to one layout plus the
+ * sync2 stage / access masks it needs, see usageInfo().
+ */
+enum class ResourceUsage : uint32_t {
+    eColorAttachmentWrite,      // loadOp clear / dont care
+    eColorAttachmentReadWrite,  // loadOp load
+    eDepthAttachmentWrite,
+    eFragmentSampled,
+    eComputeSampled,
+    eComputeStorageRead,
+    eComputeStorageWrite,
+    eComputeStorageReadWrite,
+    eVertexStorageRead,  // storage buffers fetched in the vertex shader
+    eTransferSrc,
+    eTransferDst,
+    eVertexBuffer,
+    eIndexBuffer,
+    eIndirectBuffer,
+    eUniformBuffer,
+    eHostRead,  // readback buffers, mapped and read after the submit completes
+    ePresent,
+};
+
+struct ResourceState {
+    vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+    vk::PipelineStageFlags2 stages = vk::PipelineStageFlagBits2::eNone;
+    vk::AccessFlags2 access = vk::AccessFlagBits2::eNone;
+};
+
+struct UsageInfo {
+    vk::ImageLayout layout;
+    vk::PipelineStageFlags2 stages;
+    vk::AccessFlags2 access;
+    vk::AccessFlags2 writeAccess;  // empty for read-only usages
+    bool read;
+
+    bool write() const {
+        return static_cast<bool>(writeAccess);
+    }
+};
+
+UsageInfo usageInfo(ResourceUsage usage);
+const char* toString(ResourceUsage usage);
+
+/*
+ * A frame graph rebuilt every frame: passes declare the resources they use,
+ * compile() drops passes that don't reach an exported resource and works out
+ * one batched vk::DependencyInfo in front of each surviving pass.
+ *
+ * Pass callbacks and use lists live in the frame memory given to reset(), so
+ * with a FrameArena declaring the graph doesn't touch the heap.
+ *
+ * Images made with createImage() are transient: compile() gets them from the
+ * RenderTargetPool for the range of passes that use them, so they only exist
+ * after compile() and passes look them up with image() when they run.
+ */
+class RenderGraph {
+public:
+    using Handle = uint32_t;
+
+    struct ImageDesc {
+        vk::Image image;
+        vk::ImageView view;
+        vk::Format format = vk::Format::eUndefined;
+        vk::Extent2D extent;
+        vk::ImageSubresourceRange range{vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1};
+    };
+
+    class PassBuilder {
+    private:
+        RenderGraph& graph;
+        uint32_t pass;
+
+    public:
+        PassBuilder(RenderGraph& graph, uint32_t pass) : graph(graph), pass(pass) {}
+        PassBuilder& use(Handle resource, ResourceUsage usage);
+        // keep the pass even if nothing exported depends on it
+        PassBuilder& sideEffect();
+    };
+
+private:
+    // type-erased pass callback; the callable itself is stored in frame memory
+    struct ExecuteFn {
+        const void* callable = nullptr;
+        void (*invoke)(const void*, const vk::raii::CommandBuffer&) = nullptr;
+
+        void operator()(const vk::raii::CommandBuffer& cmd) const {
+            invoke(callable, cmd);
+        }
+    };
+    struct Use {
+        Handle resource;
+        ResourceUsage usage;
+    };
+    struct Pass {
+        const char* name;
+        ExecuteFn execute;
+        std::pmr::vector<Use> uses;
+        bool sideEffect = false;
+        bool culled = false;
+    };
+    struct Resource {
+        const char* name;
+        bool isImage;
+        ImageDesc image;
+        vk::Buffer buffer;
+        ResourceState initial;
+        bool transient = false;
+        RenderTargetDesc target;
+        bool exported = false;
+        ResourceUsage finalUsage{};
+    };
+    // barriers recorded in front of passes[i]; the last batch follows the last pass
+    struct BarrierBatch {
+        uint32_t firstImage = 0;
+        uint32_t imageCount = 0;
+        uint32_t firstBuffer = 0;
+        uint32_t bufferCount = 0;
+    };
+    // per-resource sync state while walking the passes
+    struct Tracked {
+        vk::ImageLayout layout;
+        vk::PipelineStageFlags2 writeStages;
+        vk::AccessFlags2 writeAccess;
+        vk::PipelineStageFlags2 readStages;
+        vk::PipelineStageFlags2 visibleStages;
+        vk::AccessFlags2 visibleAccess;
+    };
+
+    std::vector<Resource> resources;
+    std::vector<Pass> passes;
+    std::vector<BarrierBatch> batches;
+    std::vector<vk::ImageMemoryBarrier2> imageBarriers;
+    std::vector<vk::BufferMemoryBarrier2> bufferBarriers;
+    std::vector<Tracked> tracked;
+    RenderTargetPool* targetPool = nullptr;
+    std::vector<RenderTargetPool::Request> targetRequests;
+    std::vector<Handle> targetHandles;
+    bool compiled = false;
+    // used when reset() isn't given frame memory, released by the next reset()
+    std::pmr::monotonic_buffer_resource ownMemory;
+    std::pmr::memory_resource* memory = &ownMemory;
+
+    void cull();
+    void realizeTargets();
+    void addBarrier(Handle resource, ResourceUsage usage);
+    PassBuilder addPassImpl(const char* name, ExecuteFn execute);
+
+public:
+    RenderGraph() = default;
+    DISABLE_COPY(RenderGraph)
+
+    // `frameMemory` must stay valid until the next reset(); nothing allocated
+    // from it is freed individually.
+    void reset(std::pmr::memory_resource* frameMemory = nullptr);
+
+    Handle importImage(const char* name, const ImageDesc& desc, ResourceState initial = {});
+    Handle importBuffer(const char* name, vk::Buffer buffer, ResourceState initial = {});
+    // A transient image from the target pool; contents start undefined every frame.
+    Handle createImage(const char* name, const RenderTargetDesc& desc);
+    void setTargetPool(RenderTargetPool& pool) {
+        targetPool = &pool;
+    }
+    // Mark a resource as a graph output and transition it to `finalUsage` at the end.
+    void exportResource(Handle resource, ResourceUsage finalUsage);
+
+    // `execute` runs during execute(); it is never destroyed, so it may only
+    // capture trivially destructible state (references, handles, pointers).
+    template <class F>
+    PassBuilder addPass(const char* name, F&& execute) {
+        using Fn = std::decay_t<F>;
+        static_assert(
+            std::is_trivially_destructible_v<Fn>,
+            "pass callbacks live in frame memory and are never destroyed"
+        );
+        void* storage = memory->allocate(sizeof(Fn), alignof(Fn));
+        const Fn* callable = ::new (storage) Fn(std::forward<F>(execute));
+        return addPassImpl(
+            name,
+            ExecuteFn{
+                callable,
+                [](const void* fn, const vk::raii::CommandBuffer& cmd) {
+                    (*static_cast<const Fn*>(fn))(cmd);
+                }
+            }
+        );
+    }
+
+    void compile();
+    void execute(const vk::raii::CommandBuffer& cmd);
+
+    // Transient images are filled in by compile().
+    const ImageDesc& image(Handle resource) const {
+        return resources[resource].image;
+    }
+
+    // Human readable summary of the compiled graph: passes, culling and barriers.
+    std::string dump() const;
+    // Graphviz description of the compiled graph.
+    std::string toDot() const;
+};
+
+#endif  // RENDERGRAPH_HPP
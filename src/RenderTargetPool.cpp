@@ -0,0 +1,193 @@
+#include "RenderTargetPool.hpp"
+
+// std c++
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <utility>
+
+// vulkan
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+// project
+#include "QueueScheduler.hpp"
+#include "Trace.hpp"
+
+namespace {
+
+// usages an image may have and still be created with eTransientAttachment
+constexpr vk::ImageUsageFlags ATTACHMENT_USAGE = vk::ImageUsageFlagBits::eColorAttachment |
+                                                 vk::ImageUsageFlagBits::eDepthStencilAttachment |
+                                                 vk::ImageUsageFlagBits::eInputAttachment;
+
+bool overlaps(const RenderTargetPool::Request& a, const RenderTargetPool::Request& b) {
+    return a.firstPass <= b.lastPass && b.firstPass <= a.lastPass;
+}
+
+}  // namespace
+
+vk::ImageAspectFlags aspectOf(vk::Format format) {
+    switch (format) {
+        case vk::Format::eD16Unorm:
+        case vk::Format::eX8D24UnormPack32:
+        case vk::Format::eD32Sfloat:
+            return vk::ImageAspectFlagBits::eDepth;
+        case vk::Format::eS8Uint:
+            return vk::ImageAspectFlagBits::eStencil;
+        case vk::Format::eD16UnormS8Uint:
+        case vk::Format::eD24UnormS8Uint:
+        case vk::Format::eD32SfloatS8Uint:
+            return vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+        default:
+            return vk::ImageAspectFlagBits::eColor;
+    }
+}
+
+void RenderTargetPool::init(
+    const DeviceProfile& profile,
+    const vk::raii::Device& device,
+    MemoryBudget& budget,
+    QueueScheduler& scheduler
+) {
+    this->profile = &profile;
+    this->device = &device;
+    this->budget = &budget;
+    this->scheduler = &scheduler;
+    lazyMemoryTypes = 0;
+    for (uint32_t i = 0; i < profile.memory.memoryTypeCount; i++) {
+        if (profile.memory.memoryTypes[i].propertyFlags & vk::MemoryPropertyFlagBits::eLazilyAllocated) {
+            lazyMemoryTypes |= 1u << i;
+        }
+    }
+}
+
+void RenderTargetPool::clear() {
+    if (!current.entries.empty()) {
+        // submitted frames may still render into them
+        scheduler->retire(
+            QueueType::eGraphics, scheduler->submittedValue(QueueType::eGraphics), std::move(current)
+        );
+    }
+    current = {};
+    requests.clear();
+    targets.clear();
+}
+
+std::span<const RenderTargetPool::Target> RenderTargetPool::realize(std::span<const Request> frameRequests) {
+    if (!std::ranges::equal(frameRequests, requests)) {
+        rebuild(frameRequests);
+    }
+    return targets;
+}
+
+/*
+ * Greedy interval packing: biggest target first, each into the first block
+ * none of whose targets is alive during its passes. Every target is bound at
+ * offset 0, so a block is as large as its largest target.
+ */
+void RenderTargetPool::rebuild(std::span<const Request> newRequests) {
+    TRACE_ZONE("rebuild render targets");
+    clear();
+    requests.assign(newRequests.begin(), newRequests.end());
+    targets.assign(requests.size(), {});
+    stats.targetCount = static_cast<uint32_t>(requests.size());
+    stats.blockCount = 0;
+    stats.lazyCount = 0;
+    stats.aliasedBytes = 0;
+    stats.unaliasedBytes = 0;
+    stats.rebuildCount++;
+
+    std::vector<vk::MemoryRequirements> memRequirements;
+    std::vector<bool> lazy;
+    for (const auto& request : requests) {
+        const auto& desc = request.desc;
+        bool attachmentOnly = !(desc.usage & ~ATTACHMENT_USAGE);
+        auto& entry = current.entries.emplace_back();
+        entry.image = vk::raii::Image(*device, vk::ImageCreateInfo{
+            .imageType = vk::ImageType::e2D,
+            .format = desc.format,
+            .extent = {desc.extent.width, desc.extent.height, 1},
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = desc.samples,
+            .tiling = vk::ImageTiling::eOptimal,
+            .usage = attachmentOnly ? desc.usage | vk::ImageUsageFlagBits::eTransientAttachment : desc.usage,
+            .sharingMode = vk::SharingMode::eExclusive,
+            .initialLayout = vk::ImageLayout::eUndefined
+        });
+        auto& req = memRequirements.emplace_back(entry.image.getMemoryRequirements());
+        lazy.push_back(attachmentOnly && (req.memoryTypeBits & lazyMemoryTypes));
+        stats.unaliasedBytes += req.size;
+    }
+
+    struct Block {
+        vk::DeviceSize size = 0;
+        uint32_t memoryTypeBits = 0;
+        bool lazy = false;
+        std::vector<uint32_t> members;
+    };
+    std::vector<Block> blocks;
+    std::vector<uint32_t> order(requests.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::ranges::stable_sort(order, std::greater{}, [&](uint32_t i) { return memRequirements[i].size; });
+    for (uint32_t i : order) {
+        const auto& req = memRequirements[i];
+        auto fits = [&](const Block& block) {
+            return !block.lazy && (block.memoryTypeBits & req.memoryTypeBits) &&
+                   std::ranges::none_of(block.members, [&](uint32_t m) {
+                       return overlaps(requests[m], requests[i]);
+                   });
+        };
+        auto block = lazy[i] ? blocks.end() : std::ranges::find_if(blocks, fits);
+        if (block == blocks.end()) {
+            blocks.push_back({
+                .size = req.size,
+                .memoryTypeBits = lazy[i] ? req.memoryTypeBits & lazyMemoryTypes : req.memoryTypeBits,
+                .lazy = lazy[i]
+            });
+            block = blocks.end() - 1;
+        }
+        block->size = std::max(block->size, req.size);
+        block->memoryTypeBits &= req.memoryTypeBits;
+        block->members.push_back(i);
+    }
+
+    for (uint32_t b = 0; b < blocks.size(); b++) {
+        const auto& block = blocks[b];
+        auto& memory = current.blocks.emplace_back(budget->allocate(
+            *device,
+            vk::MemoryAllocateInfo{
+                .allocationSize = block.size,
+                .memoryTypeIndex = findMemoryType(
+                    profile->memory,
+                    block.memoryTypeBits,
+                    block.lazy ? vk::MemoryPropertyFlagBits::eLazilyAllocated
+                               : vk::MemoryPropertyFlagBits::eDeviceLocal
+                )
+            },
+            MemoryCategory::eImage
+        ));
+        for (uint32_t m : block.members) {
+            current.entries[m].image.bindMemory(*memory, 0);
+            targets[m].block = b;
+        }
+        stats.aliasedBytes += block.size;
+        stats.lazyCount += block.lazy ? 1 : 0;
+    }
+    stats.blockCount = static_cast<uint32_t>(blocks.size());
+    stats.peakAliasedBytes = std::max(stats.peakAliasedBytes, stats.aliasedBytes);
+    stats.peakUnaliasedBytes = std::max(stats.peakUnaliasedBytes, stats.unaliasedBytes);
+
+    for (size_t i = 0; i < requests.size(); i++) {
+        auto& entry = current.entries[i];
+        entry.view = vk::raii::ImageView(*device, vk::ImageViewCreateInfo{
+            .image = *entry.image,
+            .viewType = vk::ImageViewType::e2D,
+            .format = requests[i].desc.format,
+            .subresourceRange = {aspectOf(requests[i].desc.format), 0, 1, 0, 1}
+        });
+        targets[i].image = *entry.image;
+        targets[i].view = *entry.view;
+    }
+}
@@ -0,0 +1,126 @@
+#ifndef RENDERTARGETPOOL_HPP
+#define RENDERTARGETPOOL_HPP
+
+// c++ std libs
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// vulkan-hpp headers
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "DeviceProfile.hpp"
+#include "MemoryBudget.hpp"
+#include "utils.hpp"
+
+class QueueScheduler;
+
+struct RenderTargetDesc {
+    vk::Format format = vk::Format::eUndefined;
+    vk::Extent2D extent;
+    vk::ImageUsageFlags usage;
+    vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1;
+
+    bool operator==(const RenderTargetDesc&) const = default;
+};
+
+// eDepth / eStencil for depth formats, eColor otherwise
+vk::ImageAspectFlags aspectOf(vk::Format format);
+
+/*
+ * Images for render targets that only live within a frame (depth, HDR color,
+ * post-processing chains). The render graph hands over every transient image
+ * of a frame together with the first and last pass that uses it; targets
+ * whose pass ranges don't overlap are bound to the same memory block. The
+ * contents therefore never survive the frame, nor the next target sharing
+ * the block: every target starts out undefined.
+ *
+ * The assignment is kept for as long as the frame asks for the same targets
+ * in the same order, so a steady frame gets last frame's images back without
+ * creating or allocating anything. When the requests change (resize, a pass
+ * toggled) everything is rebuilt and the old images are retired to the
+ * graphics queue.
+ *
+ * Targets used only as attachments get eTransientAttachment and, on devices
+ * that have it (tilers), lazily allocated memory of their own, which may never
+ * be backed at all.
+ *
+ *     pool.init(profile, device, budget, scheduler);
+ *     renderGraph.setTargetPool(pool);
+ *     auto depth = renderGraph.createImage("depth", {.format = ..., .usage = ...});
+ */
+class RenderTargetPool {
+public:
+    struct Request {
+        RenderTargetDesc desc;
+        uint32_t firstPass = 0;
+        uint32_t lastPass = 0;
+
+        bool operator==(const Request&) const = default;
+    };
+    struct Target {
+        vk::Image image;
+        vk::ImageView view;
+        // targets with the same block share memory; lazily allocated ones get their own
+        uint32_t block = 0;
+    };
+    struct Stats {
+        uint32_t targetCount = 0;
+        uint32_t blockCount = 0;
+        uint32_t lazyCount = 0;
+        uint32_t rebuildCount = 0;
+        // what the current targets take, and would take with one allocation each
+        vk::DeviceSize aliasedBytes = 0;
+        vk::DeviceSize unaliasedBytes = 0;
+        // highest of the above since init()
+        vk::DeviceSize peakAliasedBytes = 0;
+        vk::DeviceSize peakUnaliasedBytes = 0;
+    };
+
+private:
+    struct Entry {
+        vk::raii::Image image = nullptr;
+        vk::raii::ImageView view = nullptr;
+    };
+    // one assignment of targets to memory; retired as a whole
+    struct Generation {
+        std::vector<DeviceAllocation> blocks;
+        std::vector<Entry> entries;
+    };
+
+    const DeviceProfile* profile = nullptr;
+    const vk::raii::Device* device = nullptr;
+    MemoryBudget* budget = nullptr;
+    QueueScheduler* scheduler = nullptr;
+    uint32_t lazyMemoryTypes = 0;  // bit i: memory type i is lazily allocated
+
+    Generation current;
+    std::vector<Request> requests;
+    std::vector<Target> targets;
+    Stats stats;
+
+    void rebuild(std::span<const Request> newRequests);
+
+public:
+    RenderTargetPool() = default;
+    DISABLE_COPY(RenderTargetPool)
+
+    void init(
+        const DeviceProfile& profile,
+        const vk::raii::Device& device,
+        MemoryBudget& budget,
+        QueueScheduler& scheduler
+    );
+    // Drop every target; the GPU may still be using them.
+    void clear();
+
+    // One target per request, in order, valid until the next call.
+    std::span<const Target> realize(std::span<const Request> frameRequests);
+
+    const Stats& getStats() const {
+        return stats;
+    }
+};
+
+#endif  // RENDERTARGETPOOL_HPP
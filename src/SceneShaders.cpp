@@ -0,0 +1,250 @@
+#include "SceneShaders.hpp"
+
+// std c++
+#include <array>
+#include <chrono>
+#include <tuple>
+
+// vulkan
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+// project
+#include "Trace.hpp"
+#include "vertex.hpp"
+
+namespace {
+
+constexpr vk::ColorComponentFlags ALL_COMPONENTS =
+    vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+    vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+
+double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+vk::raii::Pipeline createPipeline(
+    const vk::raii::Device& device,
+    const vk::raii::ShaderModule& module,
+    const vk::raii::PipelineLayout& layout,
+    vk::Format colorFormat,
+    const RasterState& state
+) {
+    vk::PipelineShaderStageCreateInfo shaderStages[] = {
+        {.stage = vk::ShaderStageFlagBits::eVertex, .module = module, .pName = "vertMain"},
+        {.stage = vk::ShaderStageFlagBits::eFragment, .module = module, .pName = "fragMain"},
+    };
+
+    auto bindingDescription = SimpleVertex::bindingDescription();
+    auto attributeDescriptions = SimpleVertex::attributeDescriptions();
+    vk::PipelineVertexInputStateCreateInfo vertexInputInfo{
+        .vertexBindingDescriptionCount = 1,
+        .pVertexBindingDescriptions = &bindingDescription,
+        .vertexAttributeDescriptionCount = attributeDescriptions.size(),
+        .pVertexAttributeDescriptions = attributeDescriptions.data()
+    };
+    vk::PipelineInputAssemblyStateCreateInfo inputAssembly{
+        .topology = vk::PrimitiveTopology::eTriangleList
+    };
+    vk::PipelineViewportStateCreateInfo viewportState{
+        .viewportCount = 1, .scissorCount = 1
+    };
+    vk::PipelineRasterizationStateCreateInfo rasterizer{
+        .depthClampEnable = vk::False,
+        .rasterizerDiscardEnable = vk::False,
+        .polygonMode = state.polygonMode,
+        .cullMode = state.cullMode,
+        .frontFace = state.frontFace,
+        .depthBiasEnable = vk::False,
+        .depthBiasSlopeFactor = 1.0f,
+        .lineWidth = 1.0f
+    };
+    vk::PipelineMultisampleStateCreateInfo multisampling{
+        .rasterizationSamples = vk::SampleCountFlagBits::e1,
+        .sampleShadingEnable = vk::False
+    };
+    vk::PipelineColorBlendAttachmentState colorBlendAttachment{
+        .blendEnable = state.blend,
+        .srcColorBlendFactor = vk::BlendFactor::eSrcAlpha,
+        .dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha,
+        .colorBlendOp = vk::BlendOp::eAdd,
+        .srcAlphaBlendFactor = vk::BlendFactor::eOne,
+        .dstAlphaBlendFactor = vk::BlendFactor::eZero,
+        .alphaBlendOp = vk::BlendOp::eAdd,
+        .colorWriteMask = ALL_COMPONENTS
+    };
+    vk::PipelineColorBlendStateCreateInfo colorBlending{
+        .logicOpEnable = vk::False,
+        .logicOp = vk::LogicOp::eCopy,
+        .attachmentCount = 1,
+        .pAttachments = &colorBlendAttachment
+    };
+    std::array dynamicStates = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+    vk::PipelineDynamicStateCreateInfo dynamicState{
+        .dynamicStateCount = static_cast<uint32_t>(dynamicStates.size()),
+        .pDynamicStates = dynamicStates.data()
+    };
+
+    vk::StructureChain pipelineCreateInfoChain{
+        vk::GraphicsPipelineCreateInfo{
+            .stageCount = 2,
+            .pStages = shaderStages,
+            .pVertexInputState = &vertexInputInfo,
+            .pInputAssemblyState = &inputAssembly,
+            .pViewportState = &viewportState,
+            .pRasterizationState = &rasterizer,
+            .pMultisampleState = &multisampling,
+            .pColorBlendState = &colorBlending,
+            .pDynamicState = &dynamicState,
+            .layout = layout,
+            .renderPass = nullptr
+        },
+        vk::PipelineRenderingCreateInfo{
+            .colorAttachmentCount = 1,
+            .pColorAttachmentFormats = &colorFormat
+        }
+    };
+    return {device, nullptr, pipelineCreateInfoChain.get<vk::GraphicsPipelineCreateInfo>()};
+}
+
+}  // namespace
+
+void SceneShaders::init(
+    const vk::raii::Device& device,
+    const DeviceProfile::Features& features,
+    std::span<const char> spv,
+    vk::Format colorFormat
+) {
+    this->device = &device;
+    this->colorFormat = colorFormat;
+    fillModeNonSolid = features.fillModeNonSolid;
+
+    auto start = std::chrono::steady_clock::now();
+    module = vk::raii::ShaderModule(device, vk::ShaderModuleCreateInfo{
+        .codeSize = spv.size(),
+        .pCode = reinterpret_cast<const uint32_t*>(spv.data())
+    });
+    layout = vk::raii::PipelineLayout(device, vk::PipelineLayoutCreateInfo{});
+    pipeline(RasterState{});
+    stats.pipelineCreateMs = elapsedMs(start);
+
+    if (features.shaderObject) {
+        start = std::chrono::steady_clock::now();
+        // linked, so the driver may optimize across the two stages like a pipeline
+        std::array infos{
+            vk::ShaderCreateInfoEXT{
+                .flags = vk::ShaderCreateFlagBitsEXT::eLinkStage,
+                .stage = vk::ShaderStageFlagBits::eVertex,
+                .nextStage = vk::ShaderStageFlagBits::eFragment,
+                .codeType = vk::ShaderCodeTypeEXT::eSpirv,
+                .codeSize = spv.size(),
+                .pCode = spv.data(),
+                .pName = "vertMain"
+            },
+            vk::ShaderCreateInfoEXT{
+                .flags = vk::ShaderCreateFlagBitsEXT::eLinkStage,
+                .stage = vk::ShaderStageFlagBits::eFragment,
+                .codeType = vk::ShaderCodeTypeEXT::eSpirv,
+                .codeSize = spv.size(),
+                .pCode = spv.data(),
+                .pName = "fragMain"
+            },
+        };
+        shaders = vk::raii::ShaderEXTs(device, infos);
+        stats.shaderObjectCreateMs = elapsedMs(start);
+        active = Backend::eShaderObject;
+    }
+}
+
+const vk::raii::Pipeline& SceneShaders::pipeline(const RasterState& state) {
+    for (const auto& [key, pipeline] : pipelines) {
+        if (key == state) {
+            return pipeline;
+        }
+    }
+    TRACE_ZONE("compile scene pipeline");
+    auto start = std::chrono::steady_clock::now();
+    pipelines.emplace_back(state, createPipeline(*device, module, layout, colorFormat, state));
+    stats.pipelineCompileMs += elapsedMs(start);
+    stats.pipelineCount++;
+    return pipelines.back().second;
+}
+
+/*
+ * With shader objects nothing is baked, so every state a draw depends on has
+ * to be set, including the ones a pipeline would have left at their defaults.
+ */
+void SceneShaders::setDynamicState(const vk::raii::CommandBuffer& cmd, const RasterState& state) const {
+    auto binding = SimpleVertex::bindingDescription();
+    auto attributes = SimpleVertex::attributeDescriptions();
+    vk::VertexInputBindingDescription2EXT binding2{
+        .binding = binding.binding,
+        .stride = binding.stride,
+        .inputRate = binding.inputRate,
+        .divisor = 1
+    };
+    std::array<vk::VertexInputAttributeDescription2EXT, std::tuple_size_v<decltype(attributes)>> attributes2;
+    for (size_t i = 0; i < attributes.size(); i++) {
+        attributes2[i] = {
+            .location = attributes[i].location,
+            .binding = attributes[i].binding,
+            .format = attributes[i].format,
+            .offset = attributes[i].offset
+        };
+    }
+    cmd.setVertexInputEXT(binding2, attributes2);
+    cmd.setPrimitiveTopology(vk::PrimitiveTopology::eTriangleList);
+    cmd.setPrimitiveRestartEnable(vk::False);
+
+    cmd.setRasterizerDiscardEnable(vk::False);
+    cmd.setPolygonModeEXT(state.polygonMode);
+    cmd.setCullMode(state.cullMode);
+    cmd.setFrontFace(state.frontFace);
+    cmd.setLineWidth(1.0f);
+    cmd.setDepthBiasEnable(vk::False);
+    cmd.setRasterizationSamplesEXT(vk::SampleCountFlagBits::e1);
+    cmd.setSampleMaskEXT(vk::SampleCountFlagBits::e1, vk::SampleMask{~0u});
+    cmd.setAlphaToCoverageEnableEXT(vk::False);
+
+    cmd.setDepthTestEnable(vk::False);
+    cmd.setDepthWriteEnable(vk::False);
+    cmd.setDepthBoundsTestEnable(vk::False);
+    cmd.setStencilTestEnable(vk::False);
+
+    cmd.setColorBlendEnableEXT(0, vk::Bool32{state.blend});
+    cmd.setColorWriteMaskEXT(0, ALL_COMPONENTS);
+    if (state.blend) {
+        cmd.setColorBlendEquationEXT(0, vk::ColorBlendEquationEXT{
+            .srcColorBlendFactor = vk::BlendFactor::eSrcAlpha,
+            .dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha,
+            .colorBlendOp = vk::BlendOp::eAdd,
+            .srcAlphaBlendFactor = vk::BlendFactor::eOne,
+            .dstAlphaBlendFactor = vk::BlendFactor::eZero,
+            .alphaBlendOp = vk::BlendOp::eAdd
+        });
+    }
+}
+
+void SceneShaders::bind(const vk::raii::CommandBuffer& cmd, const RasterState& state, vk::Extent2D extent) {
+    RasterState effective = state;
+    if (!supportsPolygonMode(effective.polygonMode)) {
+        effective.polygonMode = vk::PolygonMode::eFill;
+    }
+    vk::Viewport viewport(
+        0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 1.0f
+    );
+    vk::Rect2D scissor(vk::Offset2D(0, 0), extent);
+
+    if (active == Backend::eShaderObject) {
+        constexpr std::array stages{vk::ShaderStageFlagBits::eVertex, vk::ShaderStageFlagBits::eFragment};
+        std::array handles{*shaders[0], *shaders[1]};
+        cmd.bindShadersEXT(stages, handles);
+        setDynamicState(cmd, effective);
+        cmd.setViewportWithCount(viewport);
+        cmd.setScissorWithCount(scissor);
+        return;
+    }
+    cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, *pipeline(effective));
+    cmd.setViewport(0, viewport);
+    cmd.setScissor(0, scissor);
+}
@@ -0,0 +1,100 @@
+#ifndef SCENESHADERS_HPP
+#define SCENESHADERS_HPP
+
+// c++ std libs
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+// vulkan-hpp headers
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "DeviceProfile.hpp"
+#include "utils.hpp"
+
+// Fixed-function state of a scene draw.
+struct RasterState {
+    vk::PolygonMode polygonMode = vk::PolygonMode::eFill;
+    vk::CullModeFlags cullMode = vk::CullModeFlagBits::eBack;
+    vk::FrontFace frontFace = vk::FrontFace::eClockwise;
+    bool blend = false;
+
+    bool operator==(const RasterState&) const = default;
+};
+
+/*
+ * The scene's vertMain / fragMain behind two backends:
+ *
+ *   ePipeline      one monolithic vk::Pipeline per RasterState, compiled the
+ *                  first time that state is bound
+ *   eShaderObject  VK_EXT_shader_object: the two stages are compiled once and
+ *                  every piece of fixed-function state is set at record time
+ *
+ * Both are created when the device supports shader objects so they can be
+ * compared at runtime; bind() records whatever the active backend needs.
+ */
+class SceneShaders {
+public:
+    enum class Backend {
+        ePipeline,
+        eShaderObject,
+    };
+
+    struct Stats {
+        double pipelineCreateMs = 0;      // first pipeline, at init()
+        double shaderObjectCreateMs = 0;  // both stages, at init()
+        uint32_t pipelineCount = 0;
+        double pipelineCompileMs = 0;     // every pipeline compiled so far
+    };
+
+private:
+    const vk::raii::Device* device = nullptr;
+    vk::Format colorFormat = vk::Format::eUndefined;
+    bool fillModeNonSolid = false;
+    Backend active = Backend::ePipeline;
+    Stats stats;
+
+    vk::raii::ShaderModule module = nullptr;
+    vk::raii::PipelineLayout layout = nullptr;
+    std::vector<std::pair<RasterState, vk::raii::Pipeline>> pipelines;
+    // vertex, fragment; empty without VK_EXT_shader_object
+    std::vector<vk::raii::ShaderEXT> shaders;
+
+    const vk::raii::Pipeline& pipeline(const RasterState& state);
+    void setDynamicState(const vk::raii::CommandBuffer& cmd, const RasterState& state) const;
+
+public:
+    SceneShaders() = default;
+    DISABLE_COPY(SceneShaders)
+
+    void init(
+        const vk::raii::Device& device,
+        const DeviceProfile::Features& features,
+        std::span<const char> spv,
+        vk::Format colorFormat
+    );
+
+    bool supports(Backend backend) const {
+        return backend == Backend::ePipeline || !shaders.empty();
+    }
+    Backend backend() const {
+        return active;
+    }
+    void setBackend(Backend backend) {
+        active = supports(backend) ? backend : Backend::ePipeline;
+    }
+    // Wireframe needs the fillModeNonSolid feature.
+    bool supportsPolygonMode(vk::PolygonMode mode) const {
+        return mode == vk::PolygonMode::eFill || fillModeNonSolid;
+    }
+    const Stats& getStats() const {
+        return stats;
+    }
+
+    // Bind shaders, state and a full-extent viewport for drawing with `state`.
+    void bind(const vk::raii::CommandBuffer& cmd, const RasterState& state, vk::Extent2D extent);
+};
+
+#endif  // SCENESHADERS_HPP
@@ -0,0 +1,315 @@
+#include "SpriteBatch.hpp"
+
+// std c++
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SPRITE_SSE2 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define SPRITE_NEON 1
+#include <arm_neon.h>
+#endif
+
+// project
+#include "Trace.hpp"
+
+namespace {
+
+constexpr uint32_t INDEX_MASK = 0xffffffffu;
+
+uint64_t sortKey(const Sprite& sprite, uint32_t index) {
+    return uint64_t{sprite.layer} << 48 | uint64_t{sprite.texture} << 32 | index;
+}
+
+// corners in index buffer order: top-left, top-right, bottom-right, bottom-left
+void writeSpriteScalar(const Sprite& s, SpriteVertex* out) {
+    float c = std::cos(s.rotation);
+    float n = std::sin(s.rotation);
+    float ax = 0.5f * s.width * c, ay = 0.5f * s.width * n;     // half the rotated x axis
+    float bx = -0.5f * s.height * n, by = 0.5f * s.height * c;  // half the rotated y axis
+    out[0] = {s.x - ax - bx, s.y - ay - by, s.u0, s.v0, s.color};
+    out[1] = {s.x + ax - bx, s.y + ay - by, s.u1, s.v0, s.color};
+    out[2] = {s.x + ax + bx, s.y + ay + by, s.u1, s.v1, s.color};
+    out[3] = {s.x - ax + bx, s.y - ay + by, s.u0, s.v1, s.color};
+}
+
+#if defined(SPRITE_SSE2) || defined(SPRITE_NEON)
+#define SPRITE_SIMD 1
+
+// the handful of 4-wide operations the kernel needs, so it is written once
+#ifdef SPRITE_SSE2
+
+using F4 = __m128;
+using I4 = __m128i;
+
+inline F4 set4(float a, float b, float c, float d) {
+    return _mm_setr_ps(a, b, c, d);
+}
+inline F4 splat(float a) {
+    return _mm_set1_ps(a);
+}
+inline F4 add(F4 a, F4 b) {
+    return _mm_add_ps(a, b);
+}
+inline F4 sub(F4 a, F4 b) {
+    return _mm_sub_ps(a, b);
+}
+inline F4 mul(F4 a, F4 b) {
+    return _mm_mul_ps(a, b);
+}
+// round to nearest, the default MXCSR mode
+inline I4 roundToInt(F4 a) {
+    return _mm_cvtps_epi32(a);
+}
+inline F4 toFloat(I4 a) {
+    return _mm_cvtepi32_ps(a);
+}
+inline I4 addInt(I4 a, int32_t b) {
+    return _mm_add_epi32(a, _mm_set1_epi32(b));
+}
+// all ones in lanes where `bit` is set
+inline I4 testBit(I4 a, int32_t bit) {
+    I4 b = _mm_set1_epi32(bit);
+    return _mm_cmpeq_epi32(_mm_and_si128(a, b), b);
+}
+inline F4 select(I4 mask, F4 a, F4 b) {
+    F4 m = _mm_castsi128_ps(mask);
+    return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+}
+// negate lanes where bit 1 of `a` is set
+inline F4 negateIfBit1(F4 value, I4 a) {
+    I4 sign = _mm_slli_epi32(_mm_and_si128(a, _mm_set1_epi32(2)), 30);
+    return _mm_xor_ps(value, _mm_castsi128_ps(sign));
+}
+inline void transpose(F4& a, F4& b, F4& c, F4& d) {
+    _MM_TRANSPOSE4_PS(a, b, c, d);
+}
+inline void store(float* out, F4 a) {
+    _mm_storeu_ps(out, a);
+}
+
+#else  // SPRITE_NEON
+
+using F4 = float32x4_t;
+using I4 = int32x4_t;
+
+inline F4 set4(float a, float b, float c, float d) {
+    const float lanes[4] = {a, b, c, d};
+    return vld1q_f32(lanes);
+}
+inline F4 splat(float a) {
+    return vdupq_n_f32(a);
+}
+inline F4 add(F4 a, F4 b) {
+    return vaddq_f32(a, b);
+}
+inline F4 sub(F4 a, F4 b) {
+    return vsubq_f32(a, b);
+}
+inline F4 mul(F4 a, F4 b) {
+    return vmulq_f32(a, b);
+}
+inline I4 roundToInt(F4 a) {
+    return vcvtnq_s32_f32(a);
+}
+inline F4 toFloat(I4 a) {
+    return vcvtq_f32_s32(a);
+}
+inline I4 addInt(I4 a, int32_t b) {
+    return vaddq_s32(a, vdupq_n_s32(b));
+}
+inline I4 testBit(I4 a, int32_t bit) {
+    return vreinterpretq_s32_u32(vtstq_s32(a, vdupq_n_s32(bit)));
+}
+inline F4 select(I4 mask, F4 a, F4 b) {
+    return vbslq_f32(vreinterpretq_u32_s32(mask), a, b);
+}
+inline F4 negateIfBit1(F4 value, I4 a) {
+    I4 sign = vshlq_n_s32(vandq_s32(a, vdupq_n_s32(2)), 30);
+    return vreinterpretq_f32_s32(veorq_s32(vreinterpretq_s32_f32(value), sign));
+}
+inline void transpose(F4& a, F4& b, F4& c, F4& d) {
+    float32x4x2_t ab = vtrnq_f32(a, b);
+    float32x4x2_t cd = vtrnq_f32(c, d);
+    a = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+    b = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+    c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+    d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+}
+inline void store(float* out, F4 a) {
+    vst1q_f32(out, a);
+}
+
+#endif
+
+/*
+ * Cephes sinf / cosf: reduce to [-pi/4, pi/4] around the nearest multiple of
+ * pi/2 (in three steps to keep precision), evaluate both polynomials and
+ * pick / negate by quadrant. About 1e-7 absolute error for the angles sprites
+ * use.
+ */
+inline void sinCos(F4 x, F4& sin, F4& cos) {
+    I4 quadrant = roundToInt(mul(x, splat(0.63661977236f)));  // 2 / pi
+    F4 q = toFloat(quadrant);
+    F4 r = sub(x, mul(q, splat(1.5703125f)));
+    r = sub(r, mul(q, splat(4.837512969970703125e-4f)));
+    r = sub(r, mul(q, splat(7.54978995489188216e-8f)));
+    F4 z = mul(r, r);
+
+    F4 s = add(mul(splat(-1.9515295891e-4f), z), splat(8.3321608736e-3f));
+    s = add(mul(s, z), splat(-1.6666654611e-1f));
+    s = add(mul(mul(s, z), r), r);
+    F4 c = add(mul(splat(2.443315711809948e-5f), z), splat(-1.388731625493765e-3f));
+    c = add(mul(c, z), splat(4.166664568298827e-2f));
+    c = add(sub(mul(mul(c, z), z), mul(z, splat(0.5f))), splat(1.f));
+
+    // quadrant 0: (s, c), 1: (c, -s), 2: (-s, -c), 3: (-c, s)
+    I4 swap = testBit(quadrant, 1);
+    sin = negateIfBit1(select(swap, c, s), quadrant);
+    cos = negateIfBit1(select(swap, s, c), addInt(quadrant, 1));
+}
+
+// the same corners as writeSpriteScalar() for four sprites
+void writeSpritesSimd(const Sprite* const* s, SpriteVertex* out) {
+    auto lanes = [&](float Sprite::* field) {
+        return set4(s[0]->*field, s[1]->*field, s[2]->*field, s[3]->*field);
+    };
+    F4 x = lanes(&Sprite::x), y = lanes(&Sprite::y);
+    F4 u0 = lanes(&Sprite::u0), v0 = lanes(&Sprite::v0);
+    F4 u1 = lanes(&Sprite::u1), v1 = lanes(&Sprite::v1);
+    F4 halfWidth = mul(lanes(&Sprite::width), splat(0.5f));
+    F4 halfHeight = mul(lanes(&Sprite::height), splat(0.5f));
+    F4 sin, cos;
+    sinCos(lanes(&Sprite::rotation), sin, cos);
+    F4 ax = mul(halfWidth, cos), ay = mul(halfWidth, sin);
+    F4 bx = mul(halfHeight, sin), by = mul(halfHeight, cos);  // bx negated
+
+    // (x, y, u, v) of one corner for all four sprites, transposed to one
+    // 16-byte store per vertex
+    auto corner = [&](uint32_t k, F4 cx, F4 cy, F4 u, F4 v) {
+        transpose(cx, cy, u, v);
+        store(&out[k].x, cx);
+        store(&out[4 + k].x, cy);
+        store(&out[8 + k].x, u);
+        store(&out[12 + k].x, v);
+    };
+    corner(0, add(sub(x, ax), bx), sub(sub(y, ay), by), u0, v0);
+    corner(1, add(add(x, ax), bx), sub(add(y, ay), by), u1, v0);
+    corner(2, sub(add(x, ax), bx), add(add(y, ay), by), u1, v1);
+    corner(3, sub(sub(x, ax), bx), add(sub(y, ay), by), u0, v1);
+    for (uint32_t i = 0; i < 4; i++) {
+        for (uint32_t k = 0; k < 4; k++) {
+            out[4 * i + k].color = s[i]->color;
+        }
+    }
+}
+
+#endif  // SPRITE_SSE2 || SPRITE_NEON
+
+}  // namespace
+
+bool SpriteBatch::simdAvailable() {
+#ifdef SPRITE_SIMD
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::span<Sprite> SpriteBatch::append(size_t count) {
+    size_t first = sprites.size();
+    sprites.resize(first + count);
+    return std::span(sprites).subspan(first);
+}
+
+/*
+ * LSD radix sort of the keys on their upper 32 bits, a byte per pass. The
+ * keys start out in submission order and every pass is stable, so the index
+ * in the low bits only comes along for the ride. Bytes that are the same in
+ * every key (few textures, few layers) skip their pass.
+ */
+void SpriteBatch::sort() {
+    size_t count = sprites.size();
+    keys.resize(count);
+    scratch.resize(count);
+    std::array<std::array<uint32_t, 256>, 4> histograms{};
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t key = sortKey(sprites[i], i);
+        keys[i] = key;
+        for (uint32_t d = 0; d < 4; d++) {
+            histograms[d][(key >> (32 + 8 * d)) & 0xff]++;
+        }
+    }
+
+    uint64_t* src = keys.data();
+    uint64_t* dst = scratch.data();
+    stats.sortPasses = 0;
+    for (uint32_t d = 0; d < 4 && count > 0; d++) {
+        uint32_t shift = 32 + 8 * d;
+        auto& histogram = histograms[d];
+        if (histogram[(src[0] >> shift) & 0xff] == count) {
+            continue;
+        }
+        uint32_t offset = 0;
+        for (auto& bucket : histogram) {
+            offset += std::exchange(bucket, offset);
+        }
+        for (size_t i = 0; i < count; i++) {
+            dst[histogram[(src[i] >> shift) & 0xff]++] = src[i];
+        }
+        std::swap(src, dst);
+        stats.sortPasses++;
+    }
+    if (src != keys.data()) {
+        keys.swap(scratch);
+    }
+}
+
+void SpriteBatch::writeVertices(SpriteVertex* out) const {
+    size_t count = sprites.size();
+    size_t i = 0;
+#ifdef SPRITE_SIMD
+    if (simd) {
+        for (; i + 4 <= count; i += 4) {
+            const Sprite* group[4] = {
+                &sprites[keys[i] & INDEX_MASK],
+                &sprites[keys[i + 1] & INDEX_MASK],
+                &sprites[keys[i + 2] & INDEX_MASK],
+                &sprites[keys[i + 3] & INDEX_MASK],
+            };
+            writeSpritesSimd(group, out + 4 * i);
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        writeSpriteScalar(sprites[keys[i] & INDEX_MASK], out + 4 * i);
+    }
+}
+
+std::span<const SpriteBatch::Run> SpriteBatch::build(SpriteVertex* out) {
+    TRACE_FUNCTION();
+    auto start = std::chrono::steady_clock::now();
+    sort();
+    auto sorted = std::chrono::steady_clock::now();
+    writeVertices(out);
+    auto written = std::chrono::steady_clock::now();
+
+    runs.clear();
+    for (uint32_t i = 0; i < keys.size(); i++) {
+        auto texture = static_cast<uint16_t>(keys[i] >> 32);
+        if (runs.empty() || runs.back().texture != texture) {
+            runs.push_back({.texture = texture, .firstSprite = i, .spriteCount = 0});
+        }
+        runs.back().spriteCount++;
+    }
+
+    stats.spriteCount = static_cast<uint32_t>(sprites.size());
+    stats.runCount = static_cast<uint32_t>(runs.size());
+    stats.sortUs = std::chrono::duration<double, std::micro>(sorted - start).count();
+    stats.vertexUs = std::chrono::duration<double, std::micro>(written - sorted).count();
+    return runs;
+}
@@ -0,0 +1,105 @@
+#ifndef SPRITEBATCH_HPP
+#define SPRITEBATCH_HPP
+
+// c++ std libs
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "utils.hpp"
+
+struct Sprite {
+    float x, y;           // center, in pixels from the top-left corner
+    float width, height;  // in pixels
+    float rotation;       // radians, clockwise on screen (y points down)
+    float u0, v0, u1, v1;
+    uint32_t color;    // RGBA8, R in the low byte, multiplied with the texture
+    uint16_t texture;  // SpriteRenderer texture slot
+    uint16_t layer;    // lower layers are drawn first
+};
+
+// pixel-space position, texture coordinate and color; four per sprite
+struct SpriteVertex {
+    float x, y;
+    float u, v;
+    uint32_t color;
+};
+
+/*
+ * Sprites collected for one frame, turned into quads by build(). The sprites
+ * are radix sorted by layer, then texture, then submission order, so every
+ * run of sprites sharing a texture becomes one indexed draw. Within a layer,
+ * sprites with different textures therefore don't keep their relative order.
+ *
+ * The corners are generated four sprites at a time with SSE2 or NEON, sine
+ * and cosine of the rotation included, and written straight to `out` (a
+ * mapped vertex buffer). The scalar path is the reference.
+ *
+ *     batch.clear();
+ *     batch.add({.x = 100, .y = 100, .width = 32, .height = 32, ...});
+ *     for (const auto& run : batch.build(mappedVertices)) {
+ *         bind run.texture; drawIndexed(run.spriteCount * 6, 1, run.firstSprite * 6, 0, 0);
+ *     }
+ */
+class SpriteBatch {
+public:
+    struct Run {
+        uint16_t texture;
+        uint32_t firstSprite;
+        uint32_t spriteCount;
+    };
+    struct Stats {
+        uint32_t spriteCount = 0;
+        uint32_t runCount = 0;
+        uint32_t sortPasses = 0;  // radix passes not skipped
+        double sortUs = 0;
+        double vertexUs = 0;
+    };
+
+private:
+    std::vector<Sprite> sprites;
+    // layer << 48 | texture << 32 | submission index
+    std::vector<uint64_t> keys;
+    std::vector<uint64_t> scratch;
+    std::vector<Run> runs;
+    Stats stats;
+
+    void sort();
+    void writeVertices(SpriteVertex* out) const;
+
+public:
+    bool simd = simdAvailable();
+
+    SpriteBatch() = default;
+    DISABLE_COPY(SpriteBatch)
+
+    static bool simdAvailable();
+
+    void clear() {
+        sprites.clear();
+    }
+    void add(const Sprite& sprite) {
+        sprites.push_back(sprite);
+    }
+    // `count` new sprites at the end for the caller to fill in
+    std::span<Sprite> append(size_t count);
+    size_t size() const {
+        return sprites.size();
+    }
+    // Trades sprite lists (capacity included) with `other`, to take over
+    // sprites filled on another thread without copying them.
+    void swapSprites(SpriteBatch& other) {
+        sprites.swap(other.sprites);
+    }
+
+    // Sort, write size() * 4 vertices to `out` and return the draws, valid
+    // until the next build().
+    std::span<const Run> build(SpriteVertex* out);
+
+    const Stats& getStats() const {
+        return stats;
+    }
+};
+
+#endif  // SPRITEBATCH_HPP
@@ -0,0 +1,406 @@
+#include "SpriteRenderer.hpp"
+
+// std c++
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+
+// vulkan
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+// project
+#include "Trace.hpp"
+
+namespace {
+
+constexpr uint32_t MIN_CAPACITY = 1u << 10;
+constexpr vk::Format WHITE_FORMAT = vk::Format::eR8G8B8A8Unorm;
+constexpr vk::ImageSubresourceRange WHITE_RANGE{vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1};
+
+// push constants of shaders/sprite.hlsl
+struct Params {
+    float scale[2];  // pixels to clip space
+    float offset[2];
+};
+
+// Alpha blended quads from SpriteVertex, pixel positions scaled by Params.
+vk::raii::Pipeline createPipeline(
+    const vk::raii::Device& device,
+    const vk::raii::ShaderModule& module,
+    const vk::raii::PipelineLayout& layout,
+    vk::Format colorFormat
+) {
+    vk::PipelineShaderStageCreateInfo shaderStages[] = {
+        {.stage = vk::ShaderStageFlagBits::eVertex, .module = module, .pName = "vertMain"},
+        {.stage = vk::ShaderStageFlagBits::eFragment, .module = module, .pName = "fragMain"},
+    };
+    vk::VertexInputBindingDescription binding{0, sizeof(SpriteVertex), vk::VertexInputRate::eVertex};
+    std::array attributes{
+        vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32Sfloat, offsetof(SpriteVertex, x)),
+        vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32Sfloat, offsetof(SpriteVertex, u)),
+        vk::VertexInputAttributeDescription(2, 0, vk::Format::eR8G8B8A8Unorm, offsetof(SpriteVertex, color)),
+    };
+    vk::PipelineVertexInputStateCreateInfo vertexInputInfo{
+        .vertexBindingDescriptionCount = 1,
+        .pVertexBindingDescriptions = &binding,
+        .vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size()),
+        .pVertexAttributeDescriptions = attributes.data()
+    };
+    vk::PipelineInputAssemblyStateCreateInfo inputAssembly{
+        .topology = vk::PrimitiveTopology::eTriangleList
+    };
+    vk::PipelineViewportStateCreateInfo viewportState{
+        .viewportCount = 1, .scissorCount = 1
+    };
+    vk::PipelineRasterizationStateCreateInfo rasterizer{
+        .depthClampEnable = vk::False,
+        .rasterizerDiscardEnable = vk::False,
+        .polygonMode = vk::PolygonMode::eFill,
+        .cullMode = vk::CullModeFlagBits::eNone,
+        .frontFace = vk::FrontFace::eClockwise,
+        .depthBiasEnable = vk::False,
+        .lineWidth = 1.0f
+    };
+    vk::PipelineMultisampleStateCreateInfo multisampling{
+        .rasterizationSamples = vk::SampleCountFlagBits::e1,
+        .sampleShadingEnable = vk::False
+    };
+    vk::PipelineColorBlendAttachmentState colorBlendAttachment{
+        .blendEnable = vk::True,
+        .srcColorBlendFactor = vk::BlendFactor::eSrcAlpha,
+        .dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha,
+        .colorBlendOp = vk::BlendOp::eAdd,
+        .srcAlphaBlendFactor = vk::BlendFactor::eOne,
+        .dstAlphaBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha,
+        .alphaBlendOp = vk::BlendOp::eAdd,
+        .colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+                          vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA
+    };
+    vk::PipelineColorBlendStateCreateInfo colorBlending{
+        .logicOpEnable = vk::False,
+        .attachmentCount = 1,
+        .pAttachments = &colorBlendAttachment
+    };
+    std::array dynamicStates = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+    vk::PipelineDynamicStateCreateInfo dynamicState{
+        .dynamicStateCount = static_cast<uint32_t>(dynamicStates.size()),
+        .pDynamicStates = dynamicStates.data()
+    };
+
+    vk::StructureChain pipelineCreateInfoChain{
+        vk::GraphicsPipelineCreateInfo{
+            .stageCount = 2,
+            .pStages = shaderStages,
+            .pVertexInputState = &vertexInputInfo,
+            .pInputAssemblyState = &inputAssembly,
+            .pViewportState = &viewportState,
+            .pRasterizationState = &rasterizer,
+            .pMultisampleState = &multisampling,
+            .pColorBlendState = &colorBlending,
+            .pDynamicState = &dynamicState,
+            .layout = layout,
+            .renderPass = nullptr
+        },
+        vk::PipelineRenderingCreateInfo{
+            .colorAttachmentCount = 1,
+            .pColorAttachmentFormats = &colorFormat
+        }
+    };
+    return {device, nullptr, pipelineCreateInfoChain.get<vk::GraphicsPipelineCreateInfo>()};
+}
+
+}  // namespace
+
+void SpriteRenderer::init(
+    const DeviceProfile& profile,
+    const vk::raii::Device& device,
+    MemoryBudget& budget,
+    uint32_t framesInFlight,
+    std::span<const char> spv,
+    vk::Format colorFormat
+) {
+    this->profile = &profile;
+    this->device = &device;
+    this->budget = &budget;
+
+    vk::DescriptorSetLayoutBinding binding{
+        .binding = 0,
+        .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+        .descriptorCount = 1,
+        .stageFlags = vk::ShaderStageFlagBits::eFragment
+    };
+    setLayout = vk::raii::DescriptorSetLayout(device, vk::DescriptorSetLayoutCreateInfo{
+        .bindingCount = 1,
+        .pBindings = &binding
+    });
+    vk::PushConstantRange pushConstants{
+        .stageFlags = vk::ShaderStageFlagBits::eVertex, .offset = 0, .size = sizeof(Params)
+    };
+    layout = vk::raii::PipelineLayout(device, vk::PipelineLayoutCreateInfo{
+        .setLayoutCount = 1,
+        .pSetLayouts = &*setLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstants
+    });
+    vk::raii::ShaderModule module(device, vk::ShaderModuleCreateInfo{
+        .codeSize = spv.size(),
+        .pCode = reinterpret_cast<const uint32_t*>(spv.data())
+    });
+    pipeline = createPipeline(device, module, layout, colorFormat);
+    sampler = vk::raii::Sampler(device, vk::SamplerCreateInfo{
+        .magFilter = vk::Filter::eLinear,
+        .minFilter = vk::Filter::eLinear,
+        .mipmapMode = vk::SamplerMipmapMode::eLinear,
+        .addressModeU = vk::SamplerAddressMode::eClampToEdge,
+        .addressModeV = vk::SamplerAddressMode::eClampToEdge,
+        .addressModeW = vk::SamplerAddressMode::eClampToEdge,
+        .maxLod = vk::LodClampNone
+    });
+
+    // cleared to white by the first addPass()
+    white = vk::raii::Image(device, vk::ImageCreateInfo{
+        .imageType = vk::ImageType::e2D,
+        .format = WHITE_FORMAT,
+        .extent = {1, 1, 1},
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = vk::SampleCountFlagBits::e1,
+        .tiling = vk::ImageTiling::eOptimal,
+        .usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst,
+        .sharingMode = vk::SharingMode::eExclusive,
+        .initialLayout = vk::ImageLayout::eUndefined
+    });
+    vk::MemoryRequirements requirements = white.getMemoryRequirements();
+    whiteMemory = budget.allocate(
+        device,
+        vk::MemoryAllocateInfo{
+            .allocationSize = requirements.size,
+            .memoryTypeIndex = findMemoryType(
+                profile.memory, requirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal
+            )
+        },
+        MemoryCategory::eImage
+    );
+    white.bindMemory(*whiteMemory, 0);
+    whiteView = vk::raii::ImageView(device, vk::ImageViewCreateInfo{
+        .image = *white,
+        .viewType = vk::ImageViewType::e2D,
+        .format = WHITE_FORMAT,
+        .subresourceRange = WHITE_RANGE
+    });
+    whiteCleared = false;
+    views.fill(nullptr);
+    views[WHITE_TEXTURE] = *whiteView;
+
+    vk::DescriptorPoolSize poolSize{
+        .type = vk::DescriptorType::eCombinedImageSampler,
+        .descriptorCount = framesInFlight * MAX_TEXTURES
+    };
+    descriptorPool = vk::raii::DescriptorPool(device, vk::DescriptorPoolCreateInfo{
+        .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+        .maxSets = framesInFlight * MAX_TEXTURES,
+        .poolSizeCount = 1,
+        .pPoolSizes = &poolSize
+    });
+    std::array<vk::DescriptorSetLayout, MAX_TEXTURES> setLayouts;
+    setLayouts.fill(*setLayout);
+    slots.clear();
+    slots.resize(framesInFlight);
+    for (auto& slot : slots) {
+        vk::raii::DescriptorSets sets(device, vk::DescriptorSetAllocateInfo{
+            .descriptorPool = *descriptorPool,
+            .descriptorSetCount = MAX_TEXTURES,
+            .pSetLayouts = setLayouts.data()
+        });
+        for (auto& set : sets) {
+            slot.sets.push_back(std::move(set));
+        }
+    }
+}
+
+void SpriteRenderer::setTexture(uint16_t texture, vk::ImageView view) {
+    if (texture < MAX_TEXTURES && texture != WHITE_TEXTURE) {
+        views[texture] = view;
+    }
+}
+
+void SpriteRenderer::beginFrame(uint32_t slot) {
+    frameSlot = slot;
+    batch.clear();
+    if (!ready()) {
+        return;
+    }
+    // the frame that last used these sets has completed
+    auto& current = slots[slot];
+    for (uint32_t i = 0; i < MAX_TEXTURES; i++) {
+        if (current.written[i] == views[i]) {
+            continue;
+        }
+        current.written[i] = views[i];
+        if (views[i] == nullptr) {
+            continue;
+        }
+        vk::DescriptorImageInfo imageInfo{
+            .sampler = *sampler,
+            .imageView = views[i],
+            .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal
+        };
+        device->updateDescriptorSets(
+            vk::WriteDescriptorSet{
+                .dstSet = *current.sets[i],
+                .dstBinding = 0,
+                .descriptorCount = 1,
+                .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                .pImageInfo = &imageInfo
+            },
+            {}
+        );
+    }
+}
+
+/*
+ * Host visible and coherent: the batch writes vertices in place and the
+ * submit makes them visible. The index buffer is the same quad pattern for
+ * every capacity, written once here.
+ */
+void SpriteRenderer::reserve(Slot& slot, uint32_t spriteCount) {
+    if (spriteCount <= slot.capacity) {
+        return;
+    }
+    TRACE_FUNCTION();
+    uint32_t capacity = std::max(MIN_CAPACITY, std::bit_ceil(spriteCount));
+    auto allocate = [&](vk::raii::Buffer& buffer, vk::DeviceSize size, vk::BufferUsageFlags usage) {
+        buffer = vk::raii::Buffer(*device, vk::BufferCreateInfo{
+            .size = size,
+            .usage = usage,
+            .sharingMode = vk::SharingMode::eExclusive
+        });
+        vk::MemoryRequirements requirements = buffer.getMemoryRequirements();
+        auto memory = budget->allocate(
+            *device,
+            vk::MemoryAllocateInfo{
+                .allocationSize = requirements.size,
+                .memoryTypeIndex = findMemoryType(
+                    profile->memory,
+                    requirements.memoryTypeBits,
+                    vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+                )
+            },
+            MemoryCategory::eBuffer
+        );
+        buffer.bindMemory(*memory, 0);
+        return memory;
+    };
+    vk::DeviceSize vertexBytes = vk::DeviceSize{capacity} * 4 * sizeof(SpriteVertex);
+    vk::DeviceSize indexBytes = vk::DeviceSize{capacity} * 6 * sizeof(uint32_t);
+    slot.vertexMemory = allocate(slot.vertices, vertexBytes, vk::BufferUsageFlagBits::eVertexBuffer);
+    slot.indexMemory = allocate(slot.indices, indexBytes, vk::BufferUsageFlagBits::eIndexBuffer);
+    slot.mapped = static_cast<SpriteVertex*>(slot.vertexMemory.get().mapMemory(0, vertexBytes));
+
+    auto* indices = static_cast<uint32_t*>(slot.indexMemory.get().mapMemory(0, indexBytes));
+    for (uint32_t quad = 0; quad < capacity; quad++) {
+        const uint32_t base = quad * 4;
+        const uint32_t pattern[6] = {base, base + 1, base + 2, base + 2, base + 3, base};
+        std::copy(pattern, pattern + 6, indices + quad * 6);
+    }
+    slot.indexMemory.get().unmapMemory();
+    slot.capacity = capacity;
+}
+
+void SpriteRenderer::addPass(RenderGraph& graph, RenderGraph::Handle target, vk::Extent2D extent) {
+    if (!ready() || batch.size() == 0) {
+        return;
+    }
+    Slot& slot = slots[frameSlot];
+    reserve(slot, static_cast<uint32_t>(batch.size()));
+    runs = batch.build(slot.mapped);
+
+    stats.batch = batch.getStats();
+    stats.capacity = slot.capacity;
+    stats.drawCount = 0;
+    stats.hiddenSprites = 0;
+    for (const auto& run : runs) {
+        if (run.texture < MAX_TEXTURES && slot.written[run.texture] != nullptr) {
+            stats.drawCount++;
+        }
+        else {
+            stats.hiddenSprites += run.spriteCount;
+        }
+    }
+
+    auto whiteTexture = graph.importImage(
+        "sprite white texture",
+        {.image = *white, .view = *whiteView, .format = WHITE_FORMAT, .extent = {1, 1}, .range = WHITE_RANGE},
+        whiteCleared ? ResourceState{.layout = vk::ImageLayout::eShaderReadOnlyOptimal} : ResourceState{}
+    );
+    if (!whiteCleared) {
+        graph
+            .addPass(
+                "sprite white clear",
+                [this](const vk::raii::CommandBuffer& cmd) {
+                    cmd.clearColorImage(
+                        *white,
+                        vk::ImageLayout::eTransferDstOptimal,
+                        vk::ClearColorValue{1.f, 1.f, 1.f, 1.f},
+                        WHITE_RANGE
+                    );
+                }
+            )
+            .use(whiteTexture, ResourceUsage::eTransferDst);
+        whiteCleared = true;
+    }
+    graph
+        .addPass(
+            "sprites",
+            [this, &graph, target, extent](const vk::raii::CommandBuffer& cmd) {
+                record(cmd, graph.image(target).view, extent);
+            }
+        )
+        .use(target, ResourceUsage::eColorAttachmentReadWrite)
+        .use(whiteTexture, ResourceUsage::eFragmentSampled);
+}
+
+void SpriteRenderer::record(
+    const vk::raii::CommandBuffer& cmd, vk::ImageView target, vk::Extent2D extent
+) const {
+    const Slot& slot = slots[frameSlot];
+    vk::RenderingAttachmentInfo attachment{
+        .imageView = target,
+        .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
+        .loadOp = vk::AttachmentLoadOp::eLoad,
+        .storeOp = vk::AttachmentStoreOp::eStore
+    };
+    cmd.beginRendering({
+        .renderArea = {.offset = {0, 0}, .extent = extent},
+        .layerCount = 1,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &attachment
+    });
+    cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, *pipeline);
+    cmd.setViewport(0, vk::Viewport{
+        .width = static_cast<float>(extent.width),
+        .height = static_cast<float>(extent.height),
+        .maxDepth = 1.0f
+    });
+    cmd.setScissor(0, vk::Rect2D{.offset = {0, 0}, .extent = extent});
+    Params params{
+        .scale = {2.f / extent.width, 2.f / extent.height},
+        .offset = {-1.f, -1.f}
+    };
+    cmd.pushConstants<Params>(*layout, vk::ShaderStageFlagBits::eVertex, 0, params);
+    cmd.bindVertexBuffers(0, *slot.vertices, {0});
+    cmd.bindIndexBuffer(*slot.indices, 0, vk::IndexType::eUint32);
+    uint16_t bound = MAX_TEXTURES;
+    for (const auto& run : runs) {
+        if (run.texture >= MAX_TEXTURES || slot.written[run.texture] == nullptr) {
+            continue;
+        }
+        if (run.texture != bound) {
+            cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *layout, 0, *slot.sets[run.texture], {});
+            bound = run.texture;
+        }
+        cmd.drawIndexed(run.spriteCount * 6, 1, run.firstSprite * 6, 0, 0);
+    }
+    cmd.endRendering();
+}
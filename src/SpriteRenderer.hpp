@@ -0,0 +1,115 @@
+#ifndef SPRITERENDERER_HPP
+#define SPRITERENDERER_HPP
+
+// c++ std libs
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// vulkan-hpp headers
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "DeviceProfile.hpp"
+#include "MemoryBudget.hpp"
+#include "RenderGraph.hpp"
+#include "SpriteBatch.hpp"
+#include "utils.hpp"
+
+/*
+ * Draws a SpriteBatch with alpha blending: the batch writes its quads
+ * straight into this frame's persistently mapped vertex buffer, and each run
+ * of sprites sharing a texture is one drawIndexed from a static quad index
+ * buffer. Buffers are per frame in flight and grow (never shrink) with the
+ * sprite count; a frame's buffers are only touched after its fence wait.
+ *
+ * Textures live in slots; slot 0 is a 1x1 white texture for untextured
+ * sprites. Every frame in flight has a descriptor set per slot, refreshed by
+ * beginFrame() when the slot's view changed, so the caller can swap views
+ * (e.g. while mip levels stream in) without waiting for the GPU.
+ *
+ *     renderer.setTexture(1, atlasView);  // any time
+ *     renderer.beginFrame(frameIndex);    // after the frame's fence wait
+ *     renderer.batch.add({...});
+ *     renderer.addPass(renderGraph, target, extent);
+ */
+class SpriteRenderer {
+public:
+    static constexpr uint32_t MAX_TEXTURES = 8;
+    static constexpr uint16_t WHITE_TEXTURE = 0;
+
+    struct Stats {
+        SpriteBatch::Stats batch;
+        uint32_t drawCount = 0;
+        uint32_t hiddenSprites = 0;  // their texture slot has no view
+        uint32_t capacity = 0;       // sprites the current frame's buffers hold
+    };
+
+private:
+    struct Slot {
+        DeviceAllocation vertexMemory = nullptr;
+        vk::raii::Buffer vertices = nullptr;
+        DeviceAllocation indexMemory = nullptr;
+        vk::raii::Buffer indices = nullptr;
+        SpriteVertex* mapped = nullptr;
+        uint32_t capacity = 0;
+        std::vector<vk::raii::DescriptorSet> sets;
+        std::array<vk::ImageView, MAX_TEXTURES> written{};
+    };
+
+    const DeviceProfile* profile = nullptr;
+    const vk::raii::Device* device = nullptr;
+    MemoryBudget* budget = nullptr;
+    vk::raii::DescriptorSetLayout setLayout = nullptr;
+    vk::raii::PipelineLayout layout = nullptr;
+    vk::raii::Pipeline pipeline = nullptr;
+    vk::raii::Sampler sampler = nullptr;
+    vk::raii::DescriptorPool descriptorPool = nullptr;
+    vk::raii::Image white = nullptr;
+    DeviceAllocation whiteMemory = nullptr;
+    vk::raii::ImageView whiteView = nullptr;
+    bool whiteCleared = false;
+    std::array<vk::ImageView, MAX_TEXTURES> views{};
+    std::vector<Slot> slots;
+    uint32_t frameSlot = 0;
+    std::span<const SpriteBatch::Run> runs;
+    Stats stats;
+
+    void reserve(Slot& slot, uint32_t spriteCount);
+    void record(const vk::raii::CommandBuffer& cmd, vk::ImageView target, vk::Extent2D extent) const;
+
+public:
+    // filled between beginFrame() and addPass()
+    SpriteBatch batch;
+
+    SpriteRenderer() = default;
+    DISABLE_COPY(SpriteRenderer)
+
+    void init(
+        const DeviceProfile& profile,
+        const vk::raii::Device& device,
+        MemoryBudget& budget,
+        uint32_t framesInFlight,
+        std::span<const char> spv,
+        vk::Format colorFormat
+    );
+    bool ready() const {
+        return *pipeline != nullptr;
+    }
+
+    // `view` is sampled in eShaderReadOnlyOptimal, its owner keeps it there.
+    // Sprites of a slot without a view are skipped.
+    void setTexture(uint16_t texture, vk::ImageView view);
+
+    // Call once the fence of `slot` has been waited on; clears the batch.
+    void beginFrame(uint32_t slot);
+    // Build the batch into this frame's buffers and draw it over `target` (loaded).
+    void addPass(RenderGraph& graph, RenderGraph::Handle target, vk::Extent2D extent);
+
+    const Stats& getStats() const {
+        return stats;
+    }
+};
+
+#endif  // SPRITERENDERER_HPP
@@ -0,0 +1,123 @@
+#ifndef SPSCQUEUE_HPP
+#define SPSCQUEUE_HPP
+
+// c++ std libs
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <utility>
+
+/*
+ * Bounded single-producer single-consumer queue. One thread may push, one
+ * other thread may pop; neither ever takes a lock or allocates. Each side
+ * owns one index and keeps a cached copy of the other one, so the shared
+ * cache lines are only touched when the cached view says the queue is full
+ * (producer) or empty (consumer).
+ *
+ * wait() lets the consumer sleep until something is pushed (C++20 atomic
+ * wait), so a thread can block on its queue instead of spinning. Only the
+ * push into an empty queue wakes it.
+ *
+ *     SpscQueue<Event, 256> events;
+ *     events.tryPush(event);     // producer thread
+ *     while (events.tryPop(e)) { ... }  // consumer thread
+ */
+template <class T, size_t Capacity>
+class SpscQueue {
+    static_assert(std::has_single_bit(Capacity), "capacity must be a power of two");
+
+private:
+    static constexpr size_t MASK = Capacity - 1;
+    // std::hardware_destructive_interference_size warns about ABI stability in GCC
+    static constexpr size_t CACHE_LINE = 64;
+
+    // written by the consumer
+    alignas(CACHE_LINE) std::atomic<size_t> head{0};
+    alignas(CACHE_LINE) size_t cachedTail = 0;
+    // written by the producer
+    alignas(CACHE_LINE) std::atomic<size_t> tail{0};
+    alignas(CACHE_LINE) size_t cachedHead = 0;
+    alignas(CACHE_LINE) std::array<T, Capacity> slots{};
+
+    bool full(size_t t) {
+        if (t - cachedHead == Capacity) {
+            cachedHead = head.load(std::memory_order_acquire);
+        }
+        return t - cachedHead == Capacity;
+    }
+
+    void publish(size_t t) {
+        tail.store(t + 1, std::memory_order_release);
+        // the consumer can only be asleep in wait() if it had popped
+        // everything, skip the wake (a syscall while it's parked) otherwise;
+        // pairs with the fence in wait()
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (head.load(std::memory_order_relaxed) == t) {
+            tail.notify_one();
+        }
+    }
+
+public:
+    SpscQueue() = default;
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    static constexpr size_t capacity() {
+        return Capacity;
+    }
+
+    // producer side; false when the queue is full
+    bool tryPush(const T& value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (full(t)) {
+            return false;
+        }
+        slots[t & MASK] = value;
+        publish(t);
+        return true;
+    }
+    bool tryPush(T&& value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (full(t)) {
+            return false;
+        }
+        slots[t & MASK] = std::move(value);
+        publish(t);
+        return true;
+    }
+
+    // consumer side; false when the queue is empty
+    bool tryPop(T& value) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h == cachedTail) {
+                return false;
+            }
+        }
+        value = std::move(slots[h & MASK]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side: blocks while the queue is empty
+    void wait() {
+        size_t h = head.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        size_t t = tail.load(std::memory_order_acquire);
+        while (t == h) {
+            tail.wait(t, std::memory_order_acquire);
+            t = tail.load(std::memory_order_acquire);
+        }
+        cachedTail = t;
+    }
+
+    // either side, a snapshot that may be stale by the time it's used
+    size_t size() const {
+        size_t h = head.load(std::memory_order_acquire);
+        return tail.load(std::memory_order_acquire) - h;
+    }
+};
+
+#endif  // SPSCQUEUE_HPP
@@ -0,0 +1,147 @@
+#include "TaskGraph.hpp"
+
+// std c++
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <format>
+#include <mutex>
+
+// project
+#include "Trace.hpp"
+
+TaskGraph::TaskId TaskGraph::add(
+    const char* name,
+    std::function<void()> fn,
+    std::initializer_list<TaskId> deps,
+    Affinity affinity
+) {
+    auto id = static_cast<TaskId>(tasks.size());
+    tasks.push_back({
+        .name = name,
+        .fn = std::move(fn),
+        .affinity = affinity,
+        .pendingDeps = static_cast<uint32_t>(deps.size())
+    });
+    for (TaskId dep : deps) {
+        assert(dep < id && "tasks can only depend on earlier tasks");
+        tasks[dep].dependents.push_back(id);
+    }
+    return id;
+}
+
+void TaskGraph::run(uint32_t workerCount) {
+    using clock = std::chrono::steady_clock;
+    auto begin = clock::now();
+    auto sinceBegin = [begin]() {
+        return std::chrono::duration<double, std::milli>(clock::now() - begin).count();
+    };
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<TaskId> readyAny, readyMain;
+    size_t remaining = tasks.size();
+    std::exception_ptr error;
+
+    for (TaskId id = 0; id < tasks.size(); id++) {
+        if (tasks[id].pendingDeps == 0) {
+            (tasks[id].affinity == Affinity::eMain ? readyMain : readyAny).push_back(id);
+        }
+    }
+
+    auto runLoop = [&](uint32_t thread) {
+        bool isMain = thread == 0;
+        if (!isMain) {
+            TRACE_THREAD_NAME("task worker");
+        }
+        std::unique_lock lock(mutex);
+        while (true) {
+            cv.wait(lock, [&]() {
+                return remaining == 0 || error || !readyAny.empty() ||
+                       (isMain && !readyMain.empty());
+            });
+            if (remaining == 0 || error) {
+                break;
+            }
+            auto& queue = isMain && !readyMain.empty() ? readyMain : readyAny;
+            TaskId id = queue.front();
+            queue.pop_front();
+            lock.unlock();
+
+            auto& task = tasks[id];
+            task.timing = {task.name, sinceBegin(), 0, thread};
+            std::exception_ptr taskError;
+            try {
+                TRACE_ZONE(task.name);
+                task.fn();
+            }
+            catch (...) {
+                taskError = std::current_exception();
+            }
+            task.timing.endMs = sinceBegin();
+
+            lock.lock();
+            if (taskError && !error) {
+                error = taskError;
+            }
+            for (TaskId dependent : task.dependents) {
+                if (--tasks[dependent].pendingDeps == 0) {
+                    (tasks[dependent].affinity == Affinity::eMain ? readyMain : readyAny)
+                        .push_back(dependent);
+                }
+            }
+            remaining--;
+            cv.notify_all();
+        }
+    };
+
+    {
+        std::vector<std::jthread> workers;
+        for (uint32_t i = 1; i <= workerCount; i++) {
+            workers.emplace_back(runLoop, i);
+        }
+        runLoop(0);
+    }
+    totalMs = sinceBegin();
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+std::vector<TaskGraph::Timing> TaskGraph::timeline() const {
+    std::vector<Timing> result;
+    for (const auto& task : tasks) {
+        result.push_back(task.timing);
+    }
+    std::ranges::sort(result, {}, &Timing::startMs);
+    return result;
+}
+
+std::string TaskGraph::report() const {
+    constexpr int BAR_WIDTH = 40;
+    std::string out = std::format("startup timeline ({:.2f} ms wall):\n", totalMs);
+    double scale = totalMs > 0 ? BAR_WIDTH / totalMs : 0;
+    double serialMs = 0;
+    for (const auto& t : timeline()) {
+        int from = static_cast<int>(t.startMs * scale);
+        int to = std::max(from + 1, static_cast<int>(t.endMs * scale));
+        to = std::min(to, BAR_WIDTH);
+        from = std::min(from, to - 1);
+        out += std::format(
+            "  {:<24} {:>8.2f} ms  [{}{}{}] @{:.2f} t{}\n",
+            t.name,
+            t.endMs - t.startMs,
+            std::string(from, ' '),
+            std::string(to - from, '#'),
+            std::string(BAR_WIDTH - to, ' '),
+            t.startMs,
+            t.thread
+        );
+        serialMs += t.endMs - t.startMs;
+    }
+    out += std::format("  sum of tasks {:.2f} ms, parallel speedup {:.2f}x\n", serialMs, totalMs > 0 ? serialMs / totalMs : 1.0);
+    return out;
+}
@@ -0,0 +1,73 @@
+#ifndef TASKGRAPH_HPP
+#define TASKGRAPH_HPP
+
+// c++ std libs
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils.hpp"
+
+/*
+ * A one-shot dependency graph of tasks run on a small pool of worker threads.
+ * Tasks can only depend on tasks added before them, so the graph is always a
+ * DAG. Tasks pinned to the main thread (e.g. GLFW calls) run on the thread
+ * calling run(), which also helps with worker tasks while it waits.
+ */
+class TaskGraph {
+public:
+    using TaskId = uint32_t;
+
+    enum class Affinity {
+        eAny,
+        eMain,
+    };
+
+    struct Timing {
+        const char* name;
+        double startMs;
+        double endMs;
+        uint32_t thread;  // 0 is the main thread
+    };
+
+private:
+    struct Task {
+        const char* name;
+        std::function<void()> fn;
+        Affinity affinity;
+        std::vector<TaskId> dependents;
+        uint32_t pendingDeps = 0;
+        Timing timing{};
+    };
+
+    std::vector<Task> tasks;
+    double totalMs = 0;
+
+public:
+    TaskGraph() = default;
+    DISABLE_COPY(TaskGraph)
+
+    TaskId add(
+        const char* name,
+        std::function<void()> fn,
+        std::initializer_list<TaskId> deps = {},
+        Affinity affinity = Affinity::eAny
+    );
+
+    // Run every task; rethrows the first exception after in-flight tasks finish.
+    void run(uint32_t workerCount = std::max(1u, std::thread::hardware_concurrency() - 1));
+
+    std::vector<Timing> timeline() const;
+    double wallTimeMs() const {
+        return totalMs;
+    }
+    // Table of per-task durations plus a bar chart of when each task ran.
+    std::string report() const;
+};
+
+#endif  // TASKGRAPH_HPP
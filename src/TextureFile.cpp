@@ -0,0 +1,179 @@
+#include "TextureFile.hpp"
+
+// std c++
+#include <array>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+constexpr std::array<uint8_t, 12> KTX2_IDENTIFIER = {
+    0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'
+};
+
+struct Ktx2Header {
+    std::array<uint8_t, 12> identifier;
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+static_assert(sizeof(Ktx2Header) == 80);
+
+struct Ktx2Level {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+// Khronos basic data format descriptor for 8-bit RGBA, see the KTX2 and
+// Khronos Data Format specifications.
+std::array<uint32_t, 23> rgba8Descriptor(bool srgb) {
+    constexpr uint32_t SAMPLE_COUNT = 4;
+    constexpr uint32_t BLOCK_SIZE = 24 + 16 * SAMPLE_COUNT;
+    std::array<uint32_t, 23> words{};
+    words[0] = 4 + BLOCK_SIZE;                        // dfdTotalSize
+    words[1] = 0;                                     // vendor 0, descriptor type 0
+    words[2] = 2 | (BLOCK_SIZE << 16);                // version 2
+    words[3] = 1 | (1 << 8) | ((srgb ? 2 : 1) << 16);  // RGBSDA, BT.709, sRGB / linear
+    words[4] = 0;                                     // 1x1x1 texel blocks
+    words[5] = 4;                                     // bytes in plane 0
+    words[6] = 0;
+    for (uint32_t c = 0; c < SAMPLE_COUNT; c++) {
+        // R, G, B, then alpha (id 15), which is always linear
+        uint32_t channel = c == 3 ? 15 | (srgb ? 0x10 : 0) : c;
+        uint32_t* sample = &words[7 + 4 * c];
+        sample[0] = (8 * c) | (7 << 16) | (channel << 24);
+        sample[1] = 0;    // sample position
+        sample[2] = 0;    // lower
+        sample[3] = 255;  // upper
+    }
+    return words;
+}
+
+}  // namespace
+
+TextureFile::TextureFile(const std::filesystem::path& path) {
+    if (!file.open(path)) {
+        throw std::runtime_error(std::format("failed to open texture {}", path.string()));
+    }
+    auto bytes = file.bytes();
+    auto fail = [&](const char* reason) {
+        return std::runtime_error(std::format("{}: {}", path.string(), reason));
+    };
+    Ktx2Header header;
+    if (bytes.size() < sizeof(header)) {
+        throw fail("too small for a KTX2 header");
+    }
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (header.identifier != KTX2_IDENTIFIER) {
+        throw fail("not a KTX2 file");
+    }
+    if (header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1 || header.pixelHeight == 0) {
+        throw fail("only single 2D images are supported");
+    }
+    if (header.supercompressionScheme != 0) {
+        throw fail("supercompressed files are not supported");
+    }
+    if (header.vkFormat == 0) {
+        throw fail("basis universal / undefined formats are not supported");
+    }
+
+    // a level count of 0 asks the loader to generate the mips
+    uint32_t levelCount = std::max(header.levelCount, 1u);
+    if (bytes.size() < sizeof(header) + levelCount * sizeof(Ktx2Level)) {
+        throw fail("truncated level index");
+    }
+    format = static_cast<vk::Format>(header.vkFormat);
+    extent = vk::Extent2D{header.pixelWidth, header.pixelHeight};
+    levels.resize(levelCount);
+    for (uint32_t i = 0; i < levelCount; i++) {
+        Ktx2Level level;
+        std::memcpy(&level, bytes.data() + sizeof(header) + i * sizeof(level), sizeof(level));
+        auto levelSize = levelExtent(i);
+        auto block = vk::blockExtent(format);
+        uint64_t expected = uint64_t((levelSize.width + block[0] - 1) / block[0]) *
+                            ((levelSize.height + block[1] - 1) / block[1]) * vk::blockSize(format);
+        if (level.byteLength != expected || level.byteOffset > bytes.size() ||
+            level.byteLength > bytes.size() - level.byteOffset) {
+            throw fail("level outside the file or of unexpected size");
+        }
+        levels[i] = {level.byteOffset, level.byteLength};
+    }
+}
+
+void TextureFile::write(
+    const std::filesystem::path& path,
+    vk::Format format,
+    vk::Extent2D extent,
+    std::span<const std::vector<uint8_t>> levels
+) {
+    if (format != vk::Format::eR8G8B8A8Unorm && format != vk::Format::eR8G8B8A8Srgb) {
+        throw std::runtime_error("TextureFile::write only handles 8-bit RGBA");
+    }
+    auto levelCount = static_cast<uint32_t>(levels.size());
+    auto descriptor = rgba8Descriptor(format == vk::Format::eR8G8B8A8Srgb);
+    uint32_t dfdOffset = sizeof(Ktx2Header) + levelCount * sizeof(Ktx2Level);
+    Ktx2Header header{
+        .identifier = KTX2_IDENTIFIER,
+        .vkFormat = static_cast<uint32_t>(format),
+        .typeSize = 1,
+        .pixelWidth = extent.width,
+        .pixelHeight = extent.height,
+        .pixelDepth = 0,
+        .layerCount = 0,
+        .faceCount = 1,
+        .levelCount = levelCount,
+        .supercompressionScheme = 0,
+        .dfdByteOffset = dfdOffset,
+        .dfdByteLength = static_cast<uint32_t>(sizeof(descriptor)),
+        .kvdByteOffset = 0,
+        .kvdByteLength = 0,
+        .sgdByteOffset = 0,
+        .sgdByteLength = 0,
+    };
+
+    // smallest level first, each aligned to 4 bytes (the RGBA8 texel size)
+    std::vector<Ktx2Level> index(levelCount);
+    uint64_t offset = dfdOffset + sizeof(descriptor);
+    for (uint32_t i = levelCount; i-- > 0;) {
+        offset = (offset + 3) & ~uint64_t(3);
+        index[i] = {offset, levels[i].size(), levels[i].size()};
+        offset += levels[i].size();
+    }
+
+    std::filesystem::create_directories(path.parent_path());
+    std::filesystem::path tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(Ktx2Level));
+        out.write(reinterpret_cast<const char*>(descriptor.data()), sizeof(descriptor));
+        uint64_t written = dfdOffset + sizeof(descriptor);
+        for (uint32_t i = levelCount; i-- > 0;) {
+            static constexpr char PADDING[4] = {};
+            out.write(PADDING, index[i].byteOffset - written);
+            out.write(reinterpret_cast<const char*>(levels[i].data()), levels[i].size());
+            written = index[i].byteOffset + levels[i].size();
+        }
+        if (!out) {
+            throw std::runtime_error(std::format("failed to write {}", tmp.string()));
+        }
+    }
+    std::filesystem::rename(tmp, path);
+}
@@ -0,0 +1,71 @@
+#ifndef TEXTUREFILE_HPP
+#define TEXTUREFILE_HPP
+
+// c++ std libs
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+// vulkan-hpp headers
+#include <vulkan/vulkan.hpp>
+
+#include "MappedFile.hpp"
+#include "utils.hpp"
+
+/*
+ * KTX2 textures, the subset the streamer needs: a single 2D image (no array
+ * layers, cube faces or depth) without supercompression. Any vk::Format is
+ * accepted, block-compressed ones included. The file stays mapped and level
+ * data is handed out in place. KTX2 stores the smallest mip first, so
+ * streaming the mip tail first reads the file front to back.
+ */
+class TextureFile {
+public:
+    struct Level {
+        uint64_t offset;
+        uint64_t size;
+    };
+
+private:
+    MappedFile file;
+    vk::Format format = vk::Format::eUndefined;
+    vk::Extent2D extent;
+    std::vector<Level> levels;  // level 0 is the full resolution image
+
+public:
+    TextureFile() = default;
+    // Throws std::runtime_error if the file is missing or outside the subset.
+    explicit TextureFile(const std::filesystem::path& path);
+    TextureFile(TextureFile&&) = default;
+    TextureFile& operator=(TextureFile&&) = default;
+    DISABLE_COPY(TextureFile)
+
+    vk::Format getFormat() const {
+        return format;
+    }
+    vk::Extent2D getExtent() const {
+        return extent;
+    }
+    uint32_t getLevelCount() const {
+        return static_cast<uint32_t>(levels.size());
+    }
+    vk::Extent2D levelExtent(uint32_t level) const {
+        return {std::max(extent.width >> level, 1u), std::max(extent.height >> level, 1u)};
+    }
+    std::span<const uint8_t> levelData(uint32_t level) const {
+        return file.bytes().subspan(levels[level].offset, levels[level].size);
+    }
+
+    // Write `levels` (level 0 first, tightly packed) as a KTX2 file. Only the
+    // 8-bit RGBA formats are supported, the data format descriptor is fixed.
+    static void write(
+        const std::filesystem::path& path,
+        vk::Format format,
+        vk::Extent2D extent,
+        std::span<const std::vector<uint8_t>> levels
+    );
+};
+
+#endif  // TEXTUREFILE_HPP
@@ -0,0 +1,606 @@
+#include "TextureStreamer.hpp"
+
+// std c++
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <numeric>
+#include <print>
+#include <tuple>
+#include <utility>
+
+// project
+#include "Trace.hpp"
+
+namespace {
+
+double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+vk::ImageSubresourceRange levelRange(uint32_t level, uint32_t count = 1) {
+    return {vk::ImageAspectFlagBits::eColor, level, count, 0, 1};
+}
+
+// trim() leaves textures at least this large on their longer side
+constexpr uint32_t MIN_TRIM_EXTENT = 64;
+
+}  // namespace
+
+void TextureStreamer::init(
+    const DeviceProfile& profile,
+    const vk::raii::Device& device,
+    MemoryBudget& budget,
+    QueueScheduler& scheduler,
+    uint32_t framesInFlight
+) {
+    this->profile = &profile;
+    this->device = &device;
+    this->budget = &budget;
+    this->scheduler = &scheduler;
+
+    sampler = vk::raii::Sampler(device, vk::SamplerCreateInfo{
+        .magFilter = vk::Filter::eLinear,
+        .minFilter = vk::Filter::eLinear,
+        .mipmapMode = vk::SamplerMipmapMode::eLinear,
+        .addressModeU = vk::SamplerAddressMode::eRepeat,
+        .addressModeV = vk::SamplerAddressMode::eRepeat,
+        .addressModeW = vk::SamplerAddressMode::eRepeat,
+        .maxLod = vk::LodClampNone,
+    });
+
+    // partial copies have to respect the transfer queue's granularity, (0, 0)
+    // means whole levels only
+    auto granularity =
+        profile.queueFamilies[scheduler.family(QueueType::eTransfer)].minImageTransferGranularity;
+    copyGranularity = {granularity.width, granularity.height};
+
+    staging.resize(framesInFlight);
+    for (auto& slot : staging) {
+        createStaging(slot, STAGING_BYTES);
+        slot.cmd = scheduler.allocateCommandBuffer(QueueType::eTransfer);
+    }
+}
+
+// A mapped, host-coherent transfer source of `size` bytes.
+void TextureStreamer::createStaging(StagingSlot& slot, vk::DeviceSize size) {
+    slot.buffer = vk::raii::Buffer(*device, vk::BufferCreateInfo{
+        .size = size,
+        .usage = vk::BufferUsageFlagBits::eTransferSrc,
+        .sharingMode = vk::SharingMode::eExclusive
+    });
+    vk::MemoryRequirements requirements = slot.buffer.getMemoryRequirements();
+    slot.memory = budget->allocate(
+        *device,
+        vk::MemoryAllocateInfo{
+            .allocationSize = requirements.size,
+            .memoryTypeIndex = findMemoryType(
+                profile->memory,
+                requirements.memoryTypeBits,
+                vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+            )
+        },
+        MemoryCategory::eStaging
+    );
+    slot.buffer.bindMemory(*slot.memory, 0);
+    slot.mapped = static_cast<uint8_t*>(slot.memory.get().mapMemory(0, vk::WholeSize));
+}
+
+TextureStreamer::Handle TextureStreamer::load(const std::filesystem::path& path) {
+    TRACE_FUNCTION();
+    auto texture = std::make_unique<Texture>();
+    texture->requested = clock::now();
+    texture->file = TextureFile(path);
+    const auto& file = texture->file;
+    auto& info = texture->info;
+    info.format = file.getFormat();
+    info.extent = file.getExtent();
+    info.levelCount = file.getLevelCount();
+
+    // a lone uncompressed level gets its mips from blits, if the format can be blitted
+    if (info.levelCount == 1 && !vk::isCompressed(info.format)) {
+        constexpr vk::FormatFeatureFlags BLIT_FEATURES = vk::FormatFeatureFlagBits::eBlitSrc |
+                                                         vk::FormatFeatureFlagBits::eBlitDst |
+                                                         vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+        auto features = profile->device.getFormatProperties(info.format).optimalTilingFeatures;
+        if ((features & BLIT_FEATURES) == BLIT_FEATURES) {
+            info.generatedMips = true;
+            info.levelCount = std::bit_width(std::max(info.extent.width, info.extent.height));
+        }
+    }
+    info.residentLevel = info.levelCount;
+    createImage(*texture);
+
+    textures.push_back(std::move(texture));
+    return static_cast<Handle>(textures.size() - 1);
+}
+
+// An image (and its memory) for info's extent and level count.
+void TextureStreamer::createImage(Texture& texture) {
+    const auto& info = texture.info;
+    // trim() copies out of the image, generated mips blit within it
+    vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferSrc |
+                                vk::ImageUsageFlagBits::eTransferDst;
+    texture.image = vk::raii::Image(*device, vk::ImageCreateInfo{
+        .imageType = vk::ImageType::e2D,
+        .format = info.format,
+        .extent = vk::Extent3D{info.extent.width, info.extent.height, 1},
+        .mipLevels = info.levelCount,
+        .arrayLayers = 1,
+        .samples = vk::SampleCountFlagBits::e1,
+        .tiling = vk::ImageTiling::eOptimal,
+        .usage = usage,
+        .sharingMode = vk::SharingMode::eExclusive,
+        .initialLayout = vk::ImageLayout::eUndefined
+    });
+    vk::MemoryRequirements requirements = texture.image.getMemoryRequirements();
+    texture.memory = budget->allocate(
+        *device,
+        vk::MemoryAllocateInfo{
+            .allocationSize = requirements.size,
+            .memoryTypeIndex = findMemoryType(
+                profile->memory, requirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal
+            )
+        },
+        MemoryCategory::eImage
+    );
+    texture.image.bindMemory(*texture.memory, 0);
+}
+
+void TextureStreamer::clear() {
+    // staging batches may still be copying into the images; this is rare and
+    // user triggered, so just wait for them
+    scheduler->wait(QueueType::eTransfer, scheduler->submittedValue(QueueType::eTransfer));
+    for (auto& texture : textures) {
+        // +1: acquire barriers for landed levels go into the next graphics submit
+        scheduler->retire(
+            QueueType::eGraphics, scheduler->submittedValue(QueueType::eGraphics) + 1, std::move(texture)
+        );
+    }
+    textures.clear();
+}
+
+uint32_t TextureStreamer::uploadLevels(const Texture& texture) const {
+    return texture.info.generatedMips ? 1 : texture.info.levelCount;
+}
+
+// mip tail first: the smallest level is uploaded first, level 0 last
+uint32_t TextureStreamer::uploadOrder(const Texture& texture, uint32_t index) const {
+    return uploadLevels(texture) - 1 - index;
+}
+
+void TextureStreamer::land(Texture& texture, uint32_t level, uint64_t value) {
+    bool generated = texture.info.generatedMips;
+    // the transfer has completed, so the wait in front of the acquire is free
+    scheduler->enqueueAcquire(
+        QueueScheduler::ImageTransfer{
+            .image = *texture.image,
+            .range = levelRange(level),
+            .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+            .newLayout = generated ? vk::ImageLayout::eTransferDstOptimal
+                                   : vk::ImageLayout::eShaderReadOnlyOptimal,
+            .src = QueueType::eTransfer,
+            .dst = QueueType::eGraphics,
+            .srcStage = vk::PipelineStageFlagBits2::eCopy,
+            .srcAccess = vk::AccessFlagBits2::eTransferWrite,
+            .dstStage = generated ? vk::PipelineStageFlagBits2::eBlit
+                                  : vk::PipelineStageFlagBits2::eFragmentShader,
+            .dstAccess = generated ? vk::AccessFlagBits2::eTransferRead
+                                   : vk::AccessFlagBits2::eShaderSampledRead
+        },
+        value
+    );
+    if (generated) {
+        texture.mips = MipState::ePending;
+    }
+    else {
+        setResident(texture, level);
+    }
+}
+
+void TextureStreamer::setResident(Texture& texture, uint32_t level) {
+    auto& info = texture.info;
+    if (*texture.view != nullptr) {
+        // only frames that were already submitted can have sampled it
+        scheduler->retire(
+            QueueType::eGraphics, scheduler->submittedValue(QueueType::eGraphics), std::move(texture.view)
+        );
+    }
+    texture.view = vk::raii::ImageView(*device, vk::ImageViewCreateInfo{
+        .image = *texture.image,
+        .viewType = vk::ImageViewType::e2D,
+        .format = info.format,
+        .subresourceRange = levelRange(level, info.levelCount - level)
+    });
+    info.view = *texture.view;
+    info.residentLevel = level;
+    info.version++;
+    if (info.firstPixelMs == 0) {
+        info.firstPixelMs = msSince(texture.requested);
+    }
+    if (level == 0 && info.completeMs == 0) {
+        info.completeMs = msSince(texture.requested);
+    }
+}
+
+// Fully streamed and sampled from every level, with one to spare.
+bool TextureStreamer::trimmable(const Texture& texture, uint32_t heap) const {
+    const auto& info = texture.info;
+    return texture.memory.getHeap() == heap && info.residentLevel == 0 && texture.landing.empty() &&
+           texture.mips == MipState::eNone && info.levelCount > 1 &&
+           std::max(info.extent.width, info.extent.height) / 2 >= MIN_TRIM_EXTENT;
+}
+
+/*
+ * One level per texture and call, largest first; pressure that persists
+ * calls again. All copies go into one graphics submit ahead of the frame's,
+ * and setResident() retires the old views to it like any view switch.
+ */
+vk::DeviceSize TextureStreamer::trim(uint32_t heap, vk::DeviceSize bytes) {
+    TRACE_FUNCTION();
+    std::vector<Texture*> candidates;
+    for (auto& texture : textures) {
+        if (trimmable(*texture, heap)) {
+            candidates.push_back(texture.get());
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Texture* a, const Texture* b) {
+        return a->memory.getSize() > b->memory.getSize();
+    });
+
+    struct Old {
+        vk::raii::Image image;
+        DeviceAllocation memory;
+    };
+    std::vector<Old> old;
+    std::vector<Texture*> trimmed;
+    vk::raii::CommandBuffer cmd = nullptr;
+    vk::DeviceSize freed = 0;
+    for (Texture* texture : candidates) {
+        if (freed >= bytes) {
+            break;
+        }
+        auto& info = texture->info;
+        if (cmd == nullptr) {
+            cmd = scheduler->allocateCommandBuffer(QueueType::eGraphics);
+            cmd.begin({.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+            scheduler->recordPendingAcquires(QueueType::eGraphics, cmd);
+        }
+        vk::DeviceSize oldBytes = texture->memory.getSize();
+        old.push_back({std::move(texture->image), std::move(texture->memory)});
+        vk::Image src = *old.back().image;
+        info.extent = {std::max(info.extent.width / 2, 1u), std::max(info.extent.height / 2, 1u)};
+        info.levelCount--;
+        info.droppedLevels++;
+        createImage(*texture);
+        freed += oldBytes - std::min(oldBytes, texture->memory.getSize());
+
+        // old levels 1.. become the new levels 0..
+        barriers.clear();
+        barriers.push_back({
+            .srcStageMask = vk::PipelineStageFlagBits2::eFragmentShader,
+            .srcAccessMask = vk::AccessFlagBits2::eNone,
+            .dstStageMask = vk::PipelineStageFlagBits2::eCopy,
+            .dstAccessMask = vk::AccessFlagBits2::eTransferRead,
+            .oldLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+            .newLayout = vk::ImageLayout::eTransferSrcOptimal,
+            .image = src,
+            .subresourceRange = levelRange(1, info.levelCount)
+        });
+        barriers.push_back({
+            .srcStageMask = vk::PipelineStageFlagBits2::eNone,
+            .srcAccessMask = vk::AccessFlagBits2::eNone,
+            .dstStageMask = vk::PipelineStageFlagBits2::eCopy,
+            .dstAccessMask = vk::AccessFlagBits2::eTransferWrite,
+            .oldLayout = vk::ImageLayout::eUndefined,
+            .newLayout = vk::ImageLayout::eTransferDstOptimal,
+            .image = *texture->image,
+            .subresourceRange = levelRange(0, info.levelCount)
+        });
+        cmd.pipelineBarrier2({
+            .imageMemoryBarrierCount = static_cast<uint32_t>(barriers.size()),
+            .pImageMemoryBarriers = barriers.data()
+        });
+        for (uint32_t level = 0; level < info.levelCount; level++) {
+            vk::ImageCopy region{
+                .srcSubresource = {vk::ImageAspectFlagBits::eColor, level + 1, 0, 1},
+                .dstSubresource = {vk::ImageAspectFlagBits::eColor, level, 0, 1},
+                .extent = vk::Extent3D{
+                    std::max(info.extent.width >> level, 1u), std::max(info.extent.height >> level, 1u), 1
+                }
+            };
+            cmd.copyImage(
+                src, vk::ImageLayout::eTransferSrcOptimal, *texture->image, vk::ImageLayout::eTransferDstOptimal, region
+            );
+        }
+        vk::ImageMemoryBarrier2 toSampled{
+            .srcStageMask = vk::PipelineStageFlagBits2::eCopy,
+            .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eFragmentShader,
+            .dstAccessMask = vk::AccessFlagBits2::eShaderSampledRead,
+            .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+            .newLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+            .image = *texture->image,
+            .subresourceRange = levelRange(0, info.levelCount)
+        };
+        cmd.pipelineBarrier2({.imageMemoryBarrierCount = 1, .pImageMemoryBarriers = &toSampled});
+        trimmed.push_back(texture);
+    }
+    if (cmd == nullptr) {
+        return 0;
+    }
+
+    cmd.end();
+    vk::CommandBuffer submit = *cmd;
+    uint64_t value = scheduler->submit({.queue = QueueType::eGraphics, .commandBuffers = {&submit, 1}});
+    scheduler->retire(QueueType::eGraphics, value, std::move(old));
+    scheduler->retire(QueueType::eGraphics, value, std::move(cmd));
+    for (Texture* texture : trimmed) {
+        setResident(*texture, 0);
+    }
+    std::println("Textures: dropped the finest level of {}, {} MiB", trimmed.size(), freed >> 20);
+    return freed;
+}
+
+void TextureStreamer::beginFrame(uint32_t slot) {
+    TRACE_FUNCTION();
+    auto now = clock::now();
+    if (busy) {
+        stats.uploadMs += std::chrono::duration<double, std::milli>(now - lastTick).count();
+    }
+    lastTick = now;
+    stats.lastFrameBytes = 0;
+
+    // publish what has landed
+    uint64_t completed = scheduler->completedValue(QueueType::eTransfer);
+    stats.streaming = 0;
+    for (auto& texture : textures) {
+        if (texture->mips == MipState::eRecorded) {
+            // the blits were submitted with the previous frame
+            texture->mips = MipState::eNone;
+            setResident(*texture, 0);
+        }
+        size_t landed = 0;
+        while (landed < texture->landing.size() && texture->landing[landed].first <= completed) {
+            land(*texture, texture->landing[landed].second, texture->landing[landed].first);
+            landed++;
+        }
+        texture->landing.erase(texture->landing.begin(), texture->landing.begin() + landed);
+        if (texture->info.residentLevel > 0) {
+            stats.streaming++;
+        }
+    }
+
+    auto& stage = staging[slot];
+    bool slotFree = stage.value <= completed;
+    vk::DeviceSize budgetBytes = std::min(settings.bytesPerFrame, STAGING_BYTES);
+    vk::DeviceSize used = 0;
+    bool recording = false;
+    uint32_t timedScope = 0;
+    // a band larger than the staging buffer, copied alone from a buffer of its own
+    StagingSlot oversized;
+
+    // plan and record this frame's bands, textures in load order
+    for (auto& texturePtr : textures) {
+        if (!slotFree) {
+            break;
+        }
+        auto& texture = *texturePtr;
+        const auto& info = texture.info;
+        vk::DeviceSize blockBytes = vk::blockSize(info.format);
+        auto block = vk::blockExtent(info.format);
+        vk::DeviceSize alignment = std::lcm(blockBytes, vk::DeviceSize(4));
+        while (texture.uploadLevel < uploadLevels(texture)) {
+            uint32_t level = uploadOrder(texture, texture.uploadLevel);
+            vk::Extent2D extent = texture.file.levelExtent(level);
+            uint32_t blockRows = (extent.height + block[1] - 1) / block[1];
+            vk::DeviceSize rowBytes = ((extent.width + block[0] - 1) / block[0]) * blockBytes;
+            // rows per band must line up with the copy granularity
+            uint32_t rowStep = copyGranularity.height == 0
+                                   ? blockRows
+                                   : std::max(1u, copyGranularity.height / block[1]);
+
+            vk::DeviceSize offset = (used + alignment - 1) / alignment * alignment;
+            uint32_t rowsLeft = blockRows - texture.uploadRow;
+            auto fit = static_cast<uint32_t>(
+                std::min<vk::DeviceSize>(offset < budgetBytes ? (budgetBytes - offset) / rowBytes : 0, rowsLeft)
+            );
+            if (fit < rowsLeft) {
+                fit = fit / rowStep * rowStep;
+            }
+            StagingSlot* source = &stage;
+            if (fit == 0) {
+                // always make progress, alone in the frame if need be
+                if (used > 0) {
+                    break;
+                }
+                fit = std::min(rowStep, rowsLeft);
+                if (fit * rowBytes > STAGING_BYTES) {
+                    // the copy granularity won't split it (without one, a band is
+                    // the whole level); a region can only read from one buffer
+                    createStaging(oversized, fit * rowBytes);
+                    source = &oversized;
+                    offset = 0;
+                }
+            }
+
+            if (!recording) {
+                stage.cmd.reset();
+                stage.cmd.begin({.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+                timedScope = scheduler->beginTimedScope(QueueType::eTransfer, stage.cmd);
+                recording = true;
+            }
+            if (texture.uploadRow == 0) {
+                vk::ImageMemoryBarrier2 toTransfer{
+                    .srcStageMask = vk::PipelineStageFlagBits2::eNone,
+                    .srcAccessMask = vk::AccessFlagBits2::eNone,
+                    .dstStageMask = vk::PipelineStageFlagBits2::eCopy,
+                    .dstAccessMask = vk::AccessFlagBits2::eTransferWrite,
+                    .oldLayout = vk::ImageLayout::eUndefined,
+                    .newLayout = vk::ImageLayout::eTransferDstOptimal,
+                    .image = *texture.image,
+                    .subresourceRange = levelRange(level)
+                };
+                stage.cmd.pipelineBarrier2({.imageMemoryBarrierCount = 1, .pImageMemoryBarriers = &toTransfer});
+            }
+
+            vk::DeviceSize bytes = fit * rowBytes;
+            auto data = texture.file.levelData(level).subspan(texture.uploadRow * rowBytes, bytes);
+            std::memcpy(source->mapped + offset, data.data(), bytes);
+            uint32_t firstTexelRow = texture.uploadRow * block[1];
+            vk::BufferImageCopy region{
+                .bufferOffset = offset,
+                .imageSubresource = {vk::ImageAspectFlagBits::eColor, level, 0, 1},
+                .imageOffset = vk::Offset3D{0, static_cast<int32_t>(firstTexelRow), 0},
+                .imageExtent = vk::Extent3D{
+                    extent.width, std::min(fit * block[1], extent.height - firstTexelRow), 1
+                }
+            };
+            stage.cmd.copyBufferToImage(
+                *source->buffer, *texture.image, vk::ImageLayout::eTransferDstOptimal, region
+            );
+            used = offset + bytes;
+            texture.uploadRow += fit;
+
+            if (texture.uploadRow == blockRows) {
+                QueueScheduler::ImageTransfer release{
+                    .image = *texture.image,
+                    .range = levelRange(level),
+                    .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+                    .newLayout = info.generatedMips ? vk::ImageLayout::eTransferDstOptimal
+                                                    : vk::ImageLayout::eShaderReadOnlyOptimal,
+                    .src = QueueType::eTransfer,
+                    .dst = QueueType::eGraphics,
+                    .srcStage = vk::PipelineStageFlagBits2::eCopy,
+                    .srcAccess = vk::AccessFlagBits2::eTransferWrite,
+                };
+                scheduler->recordRelease(stage.cmd, release);
+                // the timeline value isn't known until the submit below
+                texture.landing.push_back({0, level});
+                texture.uploadLevel++;
+                texture.uploadRow = 0;
+            }
+            else {
+                break;
+            }
+        }
+    }
+
+    if (recording) {
+        scheduler->endTimedScope(QueueType::eTransfer, stage.cmd, timedScope);
+        stage.cmd.end();
+        vk::CommandBuffer cmd = *stage.cmd;
+        stage.value = scheduler->submit({.queue = QueueType::eTransfer, .commandBuffers = {&cmd, 1}});
+        if (*oversized.buffer != nullptr) {
+            scheduler->retire(QueueType::eTransfer, stage.value, std::move(oversized));
+        }
+        for (auto& texture : textures) {
+            for (auto& [value, level] : texture->landing) {
+                if (value == 0) {
+                    value = stage.value;
+                }
+            }
+        }
+        stats.uploadedBytes += used;
+        stats.lastFrameBytes = used;
+    }
+
+    bool inFlight = std::any_of(staging.begin(), staging.end(), [&](const StagingSlot& s) {
+        return s.value > completed;
+    });
+    busy = recording || inFlight;
+}
+
+void TextureStreamer::recordMips(const vk::raii::CommandBuffer& cmd, Texture& texture) {
+    const auto& info = texture.info;
+    for (uint32_t level = 1; level < info.levelCount; level++) {
+        barriers.clear();
+        // the previous level is complete: copied (level 0) or blitted into
+        barriers.push_back({
+            .srcStageMask = vk::PipelineStageFlagBits2::eBlit,
+            .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eBlit,
+            .dstAccessMask = vk::AccessFlagBits2::eTransferRead,
+            .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+            .newLayout = vk::ImageLayout::eTransferSrcOptimal,
+            .image = *texture.image,
+            .subresourceRange = levelRange(level - 1)
+        });
+        barriers.push_back({
+            .srcStageMask = vk::PipelineStageFlagBits2::eNone,
+            .srcAccessMask = vk::AccessFlagBits2::eNone,
+            .dstStageMask = vk::PipelineStageFlagBits2::eBlit,
+            .dstAccessMask = vk::AccessFlagBits2::eTransferWrite,
+            .oldLayout = vk::ImageLayout::eUndefined,
+            .newLayout = vk::ImageLayout::eTransferDstOptimal,
+            .image = *texture.image,
+            .subresourceRange = levelRange(level)
+        });
+        cmd.pipelineBarrier2({
+            .imageMemoryBarrierCount = static_cast<uint32_t>(barriers.size()),
+            .pImageMemoryBarriers = barriers.data()
+        });
+
+        auto src = texture.file.levelExtent(0);
+        auto mipExtent = [&](uint32_t i) {
+            return vk::Offset3D{
+                static_cast<int32_t>(std::max(src.width >> i, 1u)),
+                static_cast<int32_t>(std::max(src.height >> i, 1u)),
+                1
+            };
+        };
+        vk::ImageBlit blit{
+            .srcSubresource = {vk::ImageAspectFlagBits::eColor, level - 1, 0, 1},
+            .srcOffsets = std::array{vk::Offset3D{0, 0, 0}, mipExtent(level - 1)},
+            .dstSubresource = {vk::ImageAspectFlagBits::eColor, level, 0, 1},
+            .dstOffsets = std::array{vk::Offset3D{0, 0, 0}, mipExtent(level)}
+        };
+        cmd.blitImage(
+            *texture.image,
+            vk::ImageLayout::eTransferSrcOptimal,
+            *texture.image,
+            vk::ImageLayout::eTransferDstOptimal,
+            blit,
+            vk::Filter::eLinear
+        );
+    }
+
+    // everything to sampled: the last level is still a blit destination
+    barriers.clear();
+    uint32_t last = info.levelCount - 1;
+    for (auto [first, count, layout] : {
+             std::tuple{0u, last, vk::ImageLayout::eTransferSrcOptimal},
+             std::tuple{last, 1u, vk::ImageLayout::eTransferDstOptimal},
+         }) {
+        if (count == 0) {
+            continue;
+        }
+        barriers.push_back({
+            .srcStageMask = vk::PipelineStageFlagBits2::eBlit,
+            .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eFragmentShader,
+            .dstAccessMask = vk::AccessFlagBits2::eShaderSampledRead,
+            .oldLayout = layout,
+            .newLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+            .image = *texture.image,
+            .subresourceRange = levelRange(first, count)
+        });
+    }
+    cmd.pipelineBarrier2({
+        .imageMemoryBarrierCount = static_cast<uint32_t>(barriers.size()),
+        .pImageMemoryBarriers = barriers.data()
+    });
+}
+
+void TextureStreamer::addPasses(RenderGraph& graph) {
+    for (auto& texture : textures) {
+        if (texture->mips != MipState::ePending) {
+            continue;
+        }
+        // the image isn't tracked by the graph, the pass brings its own barriers
+        graph.addPass("texture mips", [this, target = texture.get()](const vk::raii::CommandBuffer& cmd) {
+            recordMips(cmd, *target);
+        }).sideEffect();
+        texture->mips = MipState::eRecorded;
+    }
+}
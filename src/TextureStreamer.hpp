@@ -0,0 +1,178 @@
+#ifndef TEXTURESTREAMER_HPP
+#define TEXTURESTREAMER_HPP
+
+// c++ std libs
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// vulkan-hpp headers
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "DeviceProfile.hpp"
+#include "MemoryBudget.hpp"
+#include "QueueScheduler.hpp"
+#include "RenderGraph.hpp"
+#include "TextureFile.hpp"
+#include "utils.hpp"
+
+/*
+ * Streams mapped KTX2 files into sampled images over the transfer queue.
+ * Every frame copies at most `bytesPerFrame` from the files into that frame's
+ * staging buffer. Levels go smallest first and large levels are split into
+ * bands of rows, so a blurry version of a texture shows within a frame or
+ * two and detail sharpens as the bigger levels arrive.
+ *
+ * A level becomes visible once the transfer that finished it has completed.
+ * The texture's view is then recreated to start at that level, which keeps
+ * levels still in flight out of reach of the sampler. Sources with a single
+ * uncompressed level get their mip chain generated on the graphics queue
+ * with blitImage once the base level is in.
+ *
+ * Under memory pressure trim() gives up the finest level of finished
+ * textures: each is replaced by an image one level shorter, filled from the
+ * old one on the graphics queue, and the old one is retired.
+ *
+ *     auto texture = streamer.load("cache/textures/checker.ktx2");
+ *     streamer.beginFrame(frameIndex);   // after the frame's fence wait
+ *     streamer.addPasses(renderGraph);   // mip generation, when needed
+ *     if (streamer.info(texture).version != seen) { rebind info(texture).view }
+ */
+class TextureStreamer {
+public:
+    using Handle = uint32_t;
+
+    struct Settings {
+        vk::DeviceSize bytesPerFrame = 8ull << 20;
+    };
+
+    struct TextureInfo {
+        vk::Format format = vk::Format::eUndefined;
+        vk::Extent2D extent;
+        uint32_t levelCount = 0;
+        uint32_t residentLevel = 0;  // finest sampleable level, levelCount when none
+        uint32_t droppedLevels = 0;  // finest levels of the file given up by trim()
+        bool generatedMips = false;
+        vk::ImageView view;  // residentLevel and below, null until the first one arrives
+        uint32_t version = 0;  // bumped whenever `view` changes
+        double firstPixelMs = 0;  // load() to the first visible level
+        double completeMs = 0;    // load() to the full mip chain
+    };
+
+    struct Stats {
+        vk::DeviceSize uploadedBytes = 0;
+        double uploadMs = 0;  // wall time with transfers in flight
+        vk::DeviceSize lastFrameBytes = 0;
+        uint32_t streaming = 0;  // textures not complete yet
+
+        double bandwidthMiBs() const {
+            return uploadMs > 0 ? uploadedBytes / double(1 << 20) / (uploadMs / 1000.0) : 0.0;
+        }
+    };
+
+    // the largest Settings::bytesPerFrame, per frame in flight
+    static constexpr vk::DeviceSize STAGING_BYTES = 32ull << 20;
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    enum class MipState {
+        eNone,
+        ePending,   // base level landed, blits not recorded yet
+        eRecorded,  // blits go out with the current frame
+    };
+
+    struct Texture {
+        TextureFile file;
+        vk::raii::Image image = nullptr;
+        DeviceAllocation memory = nullptr;
+        vk::raii::ImageView view = nullptr;
+        TextureInfo info;
+        // next band to copy: level, in upload order, and block row within it
+        uint32_t uploadLevel = 0;
+        uint32_t uploadRow = 0;
+        // levels finished on the transfer queue: (timeline value, level)
+        std::vector<std::pair<uint64_t, uint32_t>> landing;
+        MipState mips = MipState::eNone;
+        clock::time_point requested;
+    };
+    struct StagingSlot {
+        vk::raii::Buffer buffer = nullptr;
+        DeviceAllocation memory = nullptr;
+        uint8_t* mapped = nullptr;
+        vk::raii::CommandBuffer cmd = nullptr;
+        uint64_t value = 0;  // transfer timeline value of the last use
+    };
+
+    const DeviceProfile* profile = nullptr;
+    const vk::raii::Device* device = nullptr;
+    MemoryBudget* budget = nullptr;
+    QueueScheduler* scheduler = nullptr;
+    vk::raii::Sampler sampler = nullptr;
+    vk::Extent2D copyGranularity{1, 1};
+
+    std::vector<std::unique_ptr<Texture>> textures;
+    std::vector<StagingSlot> staging;
+    std::vector<vk::ImageMemoryBarrier2> barriers;
+    Stats stats;
+    clock::time_point lastTick;
+    bool busy = false;  // transfers in flight since lastTick
+
+    uint32_t uploadOrder(const Texture& texture, uint32_t index) const;
+    uint32_t uploadLevels(const Texture& texture) const;
+    void land(Texture& texture, uint32_t level, uint64_t value);
+    void setResident(Texture& texture, uint32_t level);
+    bool trimmable(const Texture& texture, uint32_t heap) const;
+    void createImage(Texture& texture);
+    void createStaging(StagingSlot& slot, vk::DeviceSize size);
+    void recordMips(const vk::raii::CommandBuffer& cmd, Texture& texture);
+
+public:
+    Settings settings;
+
+    TextureStreamer() = default;
+    DISABLE_COPY(TextureStreamer)
+
+    void init(
+        const DeviceProfile& profile,
+        const vk::raii::Device& device,
+        MemoryBudget& budget,
+        QueueScheduler& scheduler,
+        uint32_t framesInFlight
+    );
+    bool ready() const {
+        return *sampler != nullptr;
+    }
+
+    // Map the file and create the image; the data arrives over the next frames.
+    // Throws std::runtime_error for files TextureFile can't read.
+    Handle load(const std::filesystem::path& path);
+    // Drop every texture, the GPU may still be using them.
+    void clear();
+    // Memory pressure on `heap`: drops the finest level of the largest
+    // finished textures there until at least `bytes` are given up. Returns
+    // that amount, freed once the frames in flight are done.
+    vk::DeviceSize trim(uint32_t heap, vk::DeviceSize bytes);
+
+    // Call once the fence of `slot` has been waited on: publishes levels that
+    // have landed and submits the next staging batch on the transfer queue.
+    void beginFrame(uint32_t slot);
+    // Generate mip chains for textures whose base level just arrived.
+    void addPasses(RenderGraph& graph);
+
+    const TextureInfo& info(Handle texture) const {
+        return textures[texture]->info;
+    }
+    vk::Sampler getSampler() const {
+        return *sampler;
+    }
+    const Stats& getStats() const {
+        return stats;
+    }
+};
+
+#endif  // TEXTURESTREAMER_HPP
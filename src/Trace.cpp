@@ -0,0 +1,225 @@
+#include "Trace.hpp"
+
+#ifdef LEARN_VULKAN_TRACE
+
+// std c++
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace trace {
+
+namespace {
+
+constexpr size_t RING_CAPACITY = 1 << 16;  // events per thread between collect() calls
+constexpr size_t MAX_CAPTURED = 1 << 22;
+
+/*
+ * Single producer (the owning thread) / single consumer (collect(), under the
+ * registry lock) ring. head and tail live on separate cache lines so the
+ * producer only touches shared state when its cached tail says it is full.
+ */
+struct ThreadBuffer {
+    alignas(64) std::atomic<uint64_t> head{0};
+    uint64_t cachedTail = 0;
+    uint64_t dropped = 0;
+    alignas(64) std::atomic<uint64_t> tail{0};
+    std::atomic<uint64_t> droppedPublished{0};
+    uint32_t tid = 0;
+    std::string name;
+    std::array<Event, RING_CAPACITY> events;
+};
+
+struct CapturedEvent {
+    Event event;
+    uint32_t tid;
+};
+
+struct Timebase {
+    uint64_t ticks;
+    std::chrono::steady_clock::time_point time;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::vector<CapturedEvent> captured;
+    size_t droppedCaptured = 0;
+    Timebase origin{now(), std::chrono::steady_clock::now()};
+    std::atomic<uint64_t> frameIndex{0};
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+thread_local ThreadBuffer* localBuffer = nullptr;
+
+ThreadBuffer* registerThread() {
+    auto& r = registry();
+    std::lock_guard lock(r.mutex);
+    auto buffer = std::make_unique<ThreadBuffer>();
+    buffer->tid = static_cast<uint32_t>(r.buffers.size());
+    buffer->name = buffer->tid == 0 ? "main" : "thread " + std::to_string(buffer->tid);
+    localBuffer = buffer.get();
+    r.buffers.push_back(std::move(buffer));
+    return localBuffer;
+}
+
+void appendEscaped(std::string& out, const char* text) {
+    for (const char* c = text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            out += '\\';
+        }
+        out += *c;
+    }
+}
+
+}  // namespace
+
+void record(const Event& event) {
+    ThreadBuffer* buffer = localBuffer != nullptr ? localBuffer : registerThread();
+    uint64_t head = buffer->head.load(std::memory_order_relaxed);
+    if (head - buffer->cachedTail >= RING_CAPACITY) {
+        buffer->cachedTail = buffer->tail.load(std::memory_order_acquire);
+        if (head - buffer->cachedTail >= RING_CAPACITY) {
+            buffer->droppedPublished.store(++buffer->dropped, std::memory_order_relaxed);
+            return;
+        }
+    }
+    buffer->events[head & (RING_CAPACITY - 1)] = event;
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void counter(const char* name, double value) {
+    record({name, now(), std::bit_cast<uint64_t>(value), EventType::eCounter});
+}
+
+void frameMark() {
+    uint64_t index = registry().frameIndex.fetch_add(1, std::memory_order_relaxed);
+    record({"frame", now(), index, EventType::eFrame});
+}
+
+void setThreadName(const char* name) {
+    ThreadBuffer* buffer = localBuffer != nullptr ? localBuffer : registerThread();
+    std::lock_guard lock(registry().mutex);
+    buffer->name = name;
+}
+
+void collect() {
+    auto& r = registry();
+    std::lock_guard lock(r.mutex);
+    for (auto& buffer : r.buffers) {
+        uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        for (; tail != head; tail++) {
+            if (r.captured.size() >= MAX_CAPTURED) {
+                r.droppedCaptured++;
+                continue;
+            }
+            r.captured.push_back({buffer->events[tail & (RING_CAPACITY - 1)], buffer->tid});
+        }
+        buffer->tail.store(head, std::memory_order_release);
+    }
+}
+
+void clear() {
+    collect();
+    auto& r = registry();
+    std::lock_guard lock(r.mutex);
+    r.captured.clear();
+    r.droppedCaptured = 0;
+}
+
+size_t droppedEvents() {
+    auto& r = registry();
+    std::lock_guard lock(r.mutex);
+    size_t dropped = r.droppedCaptured;
+    for (const auto& buffer : r.buffers) {
+        dropped += buffer->droppedPublished.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+size_t exportChromeTrace(const std::string& path) {
+    collect();
+    auto& r = registry();
+    std::lock_guard lock(r.mutex);
+
+    // ticks -> microseconds, calibrated over the whole run
+    Timebase end{now(), std::chrono::steady_clock::now()};
+    double elapsedUs = std::chrono::duration<double, std::micro>(end.time - r.origin.time).count();
+    double usPerTick = end.ticks > r.origin.ticks ? elapsedUs / (end.ticks - r.origin.ticks) : 0.0;
+    auto toUs = [&](uint64_t ticks) {
+        return static_cast<double>(ticks - r.origin.ticks) * usPerTick;
+    };
+
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    auto separator = [&]() {
+        if (!first) {
+            out += ",\n";
+        }
+        first = false;
+    };
+    for (const auto& buffer : r.buffers) {
+        separator();
+        out += std::format(
+            R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":")", buffer->tid
+        );
+        appendEscaped(out, buffer->name.c_str());
+        out += "\"}}";
+    }
+    for (const auto& [e, tid] : r.captured) {
+        separator();
+        out += "{\"name\":\"";
+        appendEscaped(out, e.name);
+        switch (e.type) {
+            case EventType::eZone:
+                out += std::format(
+                    R"(","ph":"X","pid":1,"tid":{},"ts":{:.3f},"dur":{:.3f}}})",
+                    tid,
+                    toUs(e.start),
+                    toUs(e.end) - toUs(e.start)
+                );
+                break;
+            case EventType::eCounter:
+                out += std::format(
+                    R"(","ph":"C","pid":1,"tid":{},"ts":{:.3f},"args":{{"value":{}}}}})",
+                    tid,
+                    toUs(e.start),
+                    std::bit_cast<double>(e.end)
+                );
+                break;
+            case EventType::eFrame:
+                out += std::format(
+                    R"(","ph":"i","s":"g","pid":1,"tid":{},"ts":{:.3f},"args":{{"index":{}}}}})",
+                    tid,
+                    toUs(e.start),
+                    e.end
+                );
+                break;
+        }
+    }
+    out += "\n]}\n";
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open trace file!");
+    }
+    file << out;
+    return r.captured.size();
+}
+
+}  // namespace trace
+
+#endif  // LEARN_VULKAN_TRACE
@@ -0,0 +1,108 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+/*
+ * CPU instrumentation. Build with LEARN_VULKAN_TRACE (xmake f --trace=y) to
+ * enable; otherwise every TRACE_* macro expands to nothing.
+ *
+ *   TRACE_ZONE("name")           time the enclosing scope
+ *   TRACE_FUNCTION()             TRACE_ZONE(__func__)
+ *   TRACE_COUNTER("name", value) sample a counter track
+ *   TRACE_FRAME_MARK()           instant event at the start of a frame
+ *   TRACE_THREAD_NAME("name")    label the calling thread in the export
+ *   TRACE_COLLECT()              drain the per-thread rings, once per frame
+ *
+ * Names must be string literals (only the pointer is stored). Events go into
+ * a per-thread lock-free ring buffer and are exported as Chrome trace JSON,
+ * which can be loaded into Perfetto (ui.perfetto.dev) or chrome://tracing.
+ */
+
+#ifdef LEARN_VULKAN_TRACE
+
+// c++ std libs
+#include <cstdint>
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <x86intrin.h>
+#define TRACE_USE_TSC 1
+#else
+#include <chrono>
+#endif
+
+namespace trace {
+
+enum class EventType : uint32_t {
+    eZone,
+    eCounter,
+    eFrame,
+};
+
+struct Event {
+    const char* name;
+    uint64_t start;
+    uint64_t end;  // counter value (bit cast double) for counters, frame index for frames
+    EventType type;
+};
+
+inline uint64_t now() {
+#ifdef TRACE_USE_TSC
+    return __rdtsc();
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+// Append to the calling thread's buffer; dropped (and counted) when full.
+void record(const Event& event);
+
+class ScopedZone {
+private:
+    const char* name;
+    uint64_t start;
+
+public:
+    explicit ScopedZone(const char* name) : name(name), start(now()) {}
+    ~ScopedZone() {
+        record({name, start, now(), EventType::eZone});
+    }
+    ScopedZone(const ScopedZone&) = delete;
+    ScopedZone& operator=(const ScopedZone&) = delete;
+};
+
+void counter(const char* name, double value);
+void frameMark();
+void setThreadName(const char* name);
+
+// Move events from all thread buffers into the capture. Call regularly
+// (e.g. once per frame) from any single thread.
+void collect();
+// Drop everything collected so far.
+void clear();
+size_t droppedEvents();
+// collect() and write the capture as Chrome trace JSON. Returns event count.
+size_t exportChromeTrace(const std::string& path);
+
+}  // namespace trace
+
+#define TRACE_CONCAT_IMPL(a, b)      a##b
+#define TRACE_CONCAT(a, b)           TRACE_CONCAT_IMPL(a, b)
+#define TRACE_ZONE(name)             ::trace::ScopedZone TRACE_CONCAT(traceZone, __LINE__)(name)
+#define TRACE_FUNCTION()             TRACE_ZONE(__func__)
+#define TRACE_COUNTER(name, value)   ::trace::counter(name, static_cast<double>(value))
+#define TRACE_FRAME_MARK()           ::trace::frameMark()
+#define TRACE_THREAD_NAME(name)      ::trace::setThreadName(name)
+#define TRACE_COLLECT()              ::trace::collect()
+
+#else
+
+#define TRACE_ZONE(name)             ((void)0)
+#define TRACE_FUNCTION()             ((void)0)
+#define TRACE_COUNTER(name, value)   ((void)0)
+#define TRACE_FRAME_MARK()           ((void)0)
+#define TRACE_THREAD_NAME(name)      ((void)0)
+#define TRACE_COLLECT()              ((void)0)
+
+#endif  // LEARN_VULKAN_TRACE
+
+#endif  // TRACE_HPP
@@ -0,0 +1,313 @@
+#include "TransformHierarchy.hpp"
+
+// std c++
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <vector>
+
+// project
+#include "Trace.hpp"
+
+namespace {
+
+// scan a level instead of sorting its queue once 1/32 of it is queued
+constexpr uint32_t DENSE_LEVEL_DIVISOR = 32;
+
+// rows of translate * rotate * scale
+InstanceTransform compose(glm::vec3 t, glm::quat q, glm::vec3 s) {
+    float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+    return {{
+        glm::vec4((1.f - 2.f * (yy + zz)) * s.x, 2.f * (xy - wz) * s.y, 2.f * (xz + wy) * s.z, t.x),
+        glm::vec4(2.f * (xy + wz) * s.x, (1.f - 2.f * (xx + zz)) * s.y, 2.f * (yz - wx) * s.z, t.y),
+        glm::vec4(2.f * (xz - wy) * s.x, 2.f * (yz + wx) * s.y, (1.f - 2.f * (xx + yy)) * s.z, t.z),
+    }};
+}
+
+// parent * local, both affine with an implicit (0, 0, 0, 1) last row
+InstanceTransform multiply(const InstanceTransform& parent, const InstanceTransform& local) {
+    InstanceTransform result;
+    for (int i = 0; i < 3; i++) {
+        const glm::vec4& p = parent.rows[i];
+        result.rows[i] = p.x * local.rows[0] + p.y * local.rows[1] + p.z * local.rows[2] +
+                         glm::vec4(0.f, 0.f, 0.f, p.w);
+    }
+    return result;
+}
+
+template <class T>
+void permute(std::vector<T>& values, const std::vector<uint32_t>& order) {
+    std::vector<T> sorted(order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        sorted[i] = values[order[i]];
+    }
+    values.swap(sorted);
+}
+
+}  // namespace
+
+TransformHierarchy::NodeId TransformHierarchy::add(
+    NodeId parent, glm::vec3 translation, glm::quat rotation, glm::vec3 scale
+) {
+    uint32_t parentSlot = parent == NO_PARENT ? NO_PARENT : slots[parent];
+    uint32_t depth = parent == NO_PARENT ? 0 : depths[parentSlot] + 1u;
+    assert(depth <= std::numeric_limits<uint16_t>::max());
+    auto id = static_cast<NodeId>(slots.size());
+    slots.push_back(static_cast<uint32_t>(ids.size()));
+
+    parents.push_back(parentSlot);
+    firstChild.push_back(0);
+    childCount.push_back(0);
+    depths.push_back(static_cast<uint16_t>(depth));
+    ids.push_back(id);
+    translations.push_back(translation);
+    rotations.push_back(rotation);
+    scales.push_back(scale);
+    world.emplace_back();
+    queued.push_back(0);
+    if (levels.size() <= depth) {
+        levels.resize(depth + 1);
+    }
+    needsSort = true;
+    return id;
+}
+
+void TransformHierarchy::clear() {
+    for (auto* values : {&parents, &firstChild, &childCount, &ids, &slots}) {
+        values->clear();
+    }
+    depths.clear();
+    translations.clear();
+    rotations.clear();
+    scales.clear();
+    world.clear();
+    queued.clear();
+    levels.clear();
+    levelStart.clear();
+    for (auto& changed : history) {
+        changed.clear();
+    }
+    needsSort = false;
+}
+
+void TransformHierarchy::reserve(size_t count) {
+    for (auto* values : {&parents, &firstChild, &childCount, &ids, &slots}) {
+        values->reserve(count);
+    }
+    depths.reserve(count);
+    translations.reserve(count);
+    rotations.reserve(count);
+    scales.reserve(count);
+    world.reserve(count);
+    queued.reserve(count);
+}
+
+void TransformHierarchy::setTranslation(NodeId node, glm::vec3 translation) {
+    translations[slots[node]] = translation;
+    markDirty(slots[node]);
+}
+
+void TransformHierarchy::setRotation(NodeId node, glm::quat rotation) {
+    rotations[slots[node]] = rotation;
+    markDirty(slots[node]);
+}
+
+void TransformHierarchy::setScale(NodeId node, glm::vec3 scale) {
+    scales[slots[node]] = scale;
+    markDirty(slots[node]);
+}
+
+void TransformHierarchy::setLocal(
+    NodeId node, glm::vec3 translation, glm::quat rotation, glm::vec3 scale
+) {
+    uint32_t slot = slots[node];
+    translations[slot] = translation;
+    rotations[slot] = rotation;
+    scales[slot] = scale;
+    markDirty(slot);
+}
+
+void TransformHierarchy::markDirty(uint32_t slot) {
+    if (!queued[slot]) {
+        queued[slot] = 1;
+        levels[depths[slot]].push_back(slot);
+    }
+}
+
+/*
+ * Breadth-first order: roots in insertion order, then the children of each
+ * node in turn. Children of the same parent end up next to each other and
+ * depth never decreases along the arrays.
+ */
+void TransformHierarchy::sortByDepth() {
+    TRACE_FUNCTION();
+    auto count = static_cast<uint32_t>(ids.size());
+
+    // children grouped by parent slot, counting sort
+    std::vector<uint32_t> offsets(count + 1, 0);
+    std::vector<uint32_t> order;
+    order.reserve(count);
+    for (uint32_t slot = 0; slot < count; slot++) {
+        if (parents[slot] == NO_PARENT) {
+            order.push_back(slot);
+        }
+        else {
+            offsets[parents[slot] + 1]++;
+        }
+    }
+    for (uint32_t slot = 0; slot < count; slot++) {
+        offsets[slot + 1] += offsets[slot];
+    }
+    std::vector<uint32_t> children(offsets[count]);
+    std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+    for (uint32_t slot = 0; slot < count; slot++) {
+        if (parents[slot] != NO_PARENT) {
+            children[cursor[parents[slot]]++] = slot;
+        }
+    }
+
+    // order[new slot] = old slot
+    uint32_t nextChild = static_cast<uint32_t>(order.size());
+    std::vector<uint32_t> newFirstChild(count), newChildCount(count);
+    for (uint32_t i = 0; i < order.size(); i++) {
+        uint32_t old = order[i];
+        newFirstChild[i] = nextChild;
+        newChildCount[i] = offsets[old + 1] - offsets[old];
+        nextChild += newChildCount[i];
+        order.insert(order.end(), children.begin() + offsets[old], children.begin() + offsets[old + 1]);
+    }
+    assert(order.size() == count);
+
+    std::vector<uint32_t> newSlot(count);
+    for (uint32_t i = 0; i < count; i++) {
+        newSlot[order[i]] = i;
+    }
+    permute(parents, order);
+    for (auto& parent : parents) {
+        if (parent != NO_PARENT) {
+            parent = newSlot[parent];
+        }
+    }
+    permute(depths, order);
+    permute(ids, order);
+    permute(translations, order);
+    permute(rotations, order);
+    permute(scales, order);
+    firstChild.swap(newFirstChild);
+    childCount.swap(newChildCount);
+    for (uint32_t i = 0; i < count; i++) {
+        slots[ids[i]] = i;
+    }
+    levelStart.assign(levels.size() + 1, count);
+    for (uint32_t i = count; i-- > 0;) {
+        levelStart[depths[i]] = i;
+    }
+
+    // anything queued is covered by the full update that follows a sort
+    std::fill(queued.begin(), queued.end(), 0);
+    for (auto& level : levels) {
+        level.clear();
+    }
+    needsSort = false;
+}
+
+void TransformHierarchy::evaluate(uint32_t slot) {
+    InstanceTransform local = compose(translations[slot], rotations[slot], scales[slot]);
+    uint32_t parent = parents[slot];
+    world[slot] = parent == NO_PARENT ? local : multiply(world[parent], local);
+}
+
+void TransformHierarchy::propagate(
+    uint32_t slot, Target& target, std::vector<uint32_t>& changed
+) {
+    evaluate(slot);
+    target.instances[ids[slot]] = world[slot];
+    changed.push_back(slot);
+    queued[slot] = 0;
+    for (uint32_t child = firstChild[slot]; child < firstChild[slot] + childCount[slot]; child++) {
+        markDirty(child);
+    }
+}
+
+// Write what `target` missed since its last update, the current one excluded.
+uint32_t TransformHierarchy::catchUp(Target& target) {
+    uint64_t behind = updateCount - target.syncedUpdate;
+    if (behind <= 1) {
+        return 0;
+    }
+    uint32_t count = nodeCount();
+    if (target.syncedUpdate < lastFullUpdate || behind > HISTORY_SIZE) {
+        for (uint32_t slot = 0; slot < count; slot++) {
+            target.instances[ids[slot]] = world[slot];
+        }
+        return count;
+    }
+    uint32_t written = 0;
+    for (uint64_t update = target.syncedUpdate + 1; update < updateCount; update++) {
+        for (uint32_t slot : history[update % HISTORY_SIZE]) {
+            target.instances[ids[slot]] = world[slot];
+        }
+        written += static_cast<uint32_t>(history[update % HISTORY_SIZE].size());
+    }
+    return written;
+}
+
+TransformHierarchy::UpdateStats TransformHierarchy::update(Target& target) {
+    if (needsSort) {
+        sortByDepth();
+        return updateAll(target);
+    }
+    TRACE_ZONE("transform update");
+    UpdateStats stats;
+    updateCount++;
+    auto& changed = history[updateCount % HISTORY_SIZE];
+    changed.clear();
+
+    // a level only gains entries while the one above it is processed
+    for (size_t depth = 0; depth < levels.size(); depth++) {
+        auto& level = levels[depth];
+        uint32_t begin = levelStart[depth], end = levelStart[depth + 1];
+        if (level.size() * DENSE_LEVEL_DIVISOR >= end - begin) {
+            for (uint32_t slot = begin; slot < end; slot++) {
+                if (queued[slot]) {
+                    propagate(slot, target, changed);
+                }
+            }
+        }
+        else {
+            std::sort(level.begin(), level.end());
+            for (uint32_t slot : level) {
+                propagate(slot, target, changed);
+            }
+        }
+        level.clear();
+    }
+    stats.recomputed = static_cast<uint32_t>(changed.size());
+    stats.written = stats.recomputed + catchUp(target);
+    target.syncedUpdate = updateCount;
+    return stats;
+}
+
+TransformHierarchy::UpdateStats TransformHierarchy::updateAll(Target& target) {
+    if (needsSort) {
+        sortByDepth();
+    }
+    TRACE_ZONE("transform update all");
+    updateCount++;
+    lastFullUpdate = updateCount;
+    history[updateCount % HISTORY_SIZE].clear();
+    std::fill(queued.begin(), queued.end(), 0);
+    for (auto& level : levels) {
+        level.clear();
+    }
+
+    uint32_t count = nodeCount();
+    for (uint32_t slot = 0; slot < count; slot++) {
+        evaluate(slot);
+        target.instances[ids[slot]] = world[slot];
+    }
+    target.syncedUpdate = updateCount;
+    return {.recomputed = count, .written = count, .full = true};
+}
@@ -0,0 +1,131 @@
+#ifndef TRANSFORMHIERARCHY_HPP
+#define TRANSFORMHIERARCHY_HPP
+
+// c++ std libs
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// glm
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "utils.hpp"
+
+// Affine world transform as three rows, the layout of one entry in the
+// per-instance buffer (a row-major float3x4 in HLSL).
+struct InstanceTransform {
+    glm::vec4 rows[3];
+};
+
+/*
+ * Parent/child transforms stored flat. Nodes live in arrays sorted by depth
+ * (breadth first), so every parent comes before its children and the children
+ * of a node are contiguous; local transforms are kept as separate
+ * translation / rotation / scale arrays.
+ *
+ * Changing a local transform queues the node on its depth level. update()
+ * walks the levels top down and recomputes only the queued nodes and their
+ * subtrees, writing each new world transform into the target instance buffer
+ * as it goes. Each level is processed in slot order (its queue sorted, or
+ * the level scanned when much of it is queued) so accesses move forward
+ * through the arrays. Targets are indexed by NodeId, which stays stable when
+ * nodes are added and the arrays get re-sorted.
+ *
+ * A target that missed updates (one buffer per frame in flight) catches up
+ * from the lists of nodes the last HISTORY_SIZE updates changed, or with a
+ * full copy when it is further behind.
+ *
+ *     auto root = hierarchy.add(TransformHierarchy::NO_PARENT);
+ *     auto child = hierarchy.add(root, {1, 0, 0});
+ *     hierarchy.setRotation(root, rotation);
+ *     TransformHierarchy::Target target{mappedInstances};
+ *     hierarchy.update(target);  // recomputes root and child
+ */
+class TransformHierarchy {
+public:
+    using NodeId = uint32_t;
+    static constexpr NodeId NO_PARENT = ~0u;
+    static constexpr uint32_t HISTORY_SIZE = 4;  // at least the frames in flight
+
+    // one copy of the per-instance buffer, nodeCount() entries
+    struct Target {
+        InstanceTransform* instances = nullptr;
+        uint64_t syncedUpdate = 0;  // last update() this copy has seen, 0 = never
+    };
+
+    struct UpdateStats {
+        uint32_t recomputed = 0;  // world transforms evaluated
+        uint32_t written = 0;     // instances written to the target
+        bool full = false;        // re-sorted or recomputed everything
+    };
+
+private:
+    // sorted by depth, indexed by slot
+    std::vector<uint32_t> parents;      // slot of the parent or NO_PARENT
+    std::vector<uint32_t> firstChild;
+    std::vector<uint32_t> childCount;
+    std::vector<uint16_t> depths;
+    std::vector<NodeId> ids;
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<InstanceTransform> world;
+    std::vector<uint8_t> queued;
+    // NodeId -> slot
+    std::vector<uint32_t> slots;
+
+    // dirty nodes per depth, filled by set*() and while walking down
+    std::vector<std::vector<uint32_t>> levels;
+    // first slot of every depth, plus the node count
+    std::vector<uint32_t> levelStart;
+    // slots changed by recent updates, update u at u % HISTORY_SIZE
+    std::array<std::vector<uint32_t>, HISTORY_SIZE> history;
+    uint64_t updateCount = 0;
+    uint64_t lastFullUpdate = 0;
+    bool needsSort = false;
+
+    void markDirty(uint32_t slot);
+    void sortByDepth();
+    void evaluate(uint32_t slot);
+    void propagate(uint32_t slot, Target& target, std::vector<uint32_t>& changed);
+    uint32_t catchUp(Target& target);
+
+public:
+    TransformHierarchy() = default;
+    DISABLE_COPY(TransformHierarchy)
+
+    // Children must be added after their parent. Re-sorts on the next update.
+    NodeId add(
+        NodeId parent,
+        glm::vec3 translation = glm::vec3(0.f),
+        glm::quat rotation = glm::quat(1.f, 0.f, 0.f, 0.f),
+        glm::vec3 scale = glm::vec3(1.f)
+    );
+    void clear();
+    void reserve(size_t count);
+
+    uint32_t nodeCount() const {
+        return static_cast<uint32_t>(ids.size());
+    }
+    uint32_t depthCount() const {
+        return static_cast<uint32_t>(levels.size());
+    }
+
+    void setTranslation(NodeId node, glm::vec3 translation);
+    void setRotation(NodeId node, glm::quat rotation);
+    void setScale(NodeId node, glm::vec3 scale);
+    void setLocal(NodeId node, glm::vec3 translation, glm::quat rotation, glm::vec3 scale);
+
+    // Recompute the dirty subtrees and bring `target` up to date.
+    UpdateStats update(Target& target);
+    // Recompute and write every node, the reference for update().
+    UpdateStats updateAll(Target& target);
+
+    const InstanceTransform& worldTransform(NodeId node) const {
+        return world[slots[node]];
+    }
+};
+
+#endif  // TRANSFORMHIERARCHY_HPP
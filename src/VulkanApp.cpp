@@ -1,11 +1,23 @@
 #include "VulkanApp.hpp"
 
 // std c++
+#include <algorithm>
+#include <bit>
 #include <cassert>
+#include <chrono>
+#include <cmath>
 #include <cstdint>
+#include <cstdio>
 #include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <future>
 #include <memory>
+#include <numbers>
 #include <print>
+#include <random>
+#include <span>
 #include <stdexcept>
 #include <tuple>
 #include <utility>
@@ -18,11 +30,35 @@
 #include <vulkan/vulkan_raii.hpp>
 #include <vulkan/vulkan_structs.hpp>
 
+// glm
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
 // imgui
 #include <backends/imgui_impl_vulkan.h>
 #include <imgui.h>
 
 // project
+#include "AllocationCounter.hpp"
+#include "AsyncIO.hpp"
+#include "ChunkStreamer.hpp"
+#include "CommandCache.hpp"
+#include "DeviceProfile.hpp"
+#include "FrameArena.hpp"
+#include "FrameCapture.hpp"
+#include "FramePacer.hpp"
+#include "FrustumCulling.hpp"
+#include "MemoryBudget.hpp"
+#include "ParticleSystem.hpp"
+#include "RenderGraph.hpp"
+#include "SceneShaders.hpp"
+#include "SpriteBatch.hpp"
+#include "SpriteRenderer.hpp"
+#include "TaskGraph.hpp"
+#include "TextureFile.hpp"
+#include "TextureStreamer.hpp"
+#include "Trace.hpp"
+#include "TransformHierarchy.hpp"
 #include "WindowApp.hpp"
 #include "backends/imgui_impl_glfw.h"
 #include "utils.hpp"
@@ -195,84 +231,15 @@ vk::raii::DebugUtilsMessengerEXT setupDebugMessenger(const vk::raii::Instance& i
     );
 }
 
-vk::raii::PhysicalDevice pickPhysicalDevice(vk::raii::Instance& instance) {
-    std::vector<vk::raii::PhysicalDevice> devices =
-        instance.enumeratePhysicalDevices();
-
-    // vk::raii::PhysicalDevice* selectedDevice = nullptr;
-
-    for (vk::raii::PhysicalDevice& device : devices) {
-        // Check if the device supports the Vulkan 1.3 API version
-        bool supportsVulkan1_3 =
-            device.getProperties().apiVersion >= VK_API_VERSION_1_3;
-
-        // Check if any of the queue families support graphics operations
-        auto queueFamilies = device.getQueueFamilyProperties();
-        bool supportsGraphics = false;
-        for (const vk::QueueFamilyProperties& qfp : queueFamilies) {
-            if (qfp.queueFlags & vk::QueueFlagBits::eGraphics) {
-                supportsGraphics = true;
-                break;
-            }
-        }
-
-        // Check if all required device extensions are available
-        std::vector<vk::ExtensionProperties> availableDeviceExtensions =
-            device.enumerateDeviceExtensionProperties();
-        bool supportsAllRequiredExtensions = true;
-        for (auto const& requiredDeviceExtension : requiredDeviceExtension) {
-            bool extensionFound = false;
-            for (auto const& availableDeviceExtension : availableDeviceExtensions) {
-                if (strcmp(availableDeviceExtension.extensionName, requiredDeviceExtension) == 0) {
-                    extensionFound = true;
-                    break;
-                }
-            }
-            if (!extensionFound) {
-                supportsAllRequiredExtensions = false;
-                break;
-            }
-        }
-
-        auto features = device.getFeatures2<
-            vk::PhysicalDeviceFeatures2,
-            vk::PhysicalDeviceVulkan11Features,
-            vk::PhysicalDeviceVulkan13Features,
-            vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT>();
-
-        bool supportsRequiredFeatures =
-            features.get<vk::PhysicalDeviceVulkan11Features>().shaderDrawParameters &&
-            features.get<vk::PhysicalDeviceVulkan13Features>().synchronization2 &&
-            features.get<vk::PhysicalDeviceVulkan13Features>().dynamicRendering &&
-            features.get<vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT>().extendedDynamicState;
-
-        if (supportsVulkan1_3 && supportsGraphics &&
-            supportsAllRequiredExtensions && supportsRequiredFeatures) {
-            std::println("Device: {}", device.getProperties().deviceName.data());
-            return device;
-        }
-    }
-
-    throw std::runtime_error("failed to find a suitable GPU!");
-}
-
-std::tuple<vk::raii::Device, uint32_t> createLogicalDeviceAndQueueIndex(
-    const vk::raii::PhysicalDevice& physicalDevice, const vk::raii::SurfaceKHR& surface
+std::tuple<vk::raii::Device, QueueFamilies> createLogicalDeviceAndQueueIndex(
+    const DeviceProfile& profile,
+    std::span<const char* const> optionalExtensions
 ) {
-    std::vector<vk::QueueFamilyProperties> queueFamilyProperties =
-        physicalDevice.getQueueFamilyProperties();
+    const auto& queueFamilyProperties = profile.queueFamilies;
 
-    // get the first index into queueFamilyProperties which supports both
+    // the profile already found the first family which supports both
     // graphics and present
-    uint32_t queueIndex = ~0;
-    for (uint32_t qfpIndex = 0; qfpIndex < queueFamilyProperties.size(); qfpIndex++) {
-        if ((queueFamilyProperties[qfpIndex].queueFlags & vk::QueueFlagBits::eGraphics) &&
-            physicalDevice.getSurfaceSupportKHR(qfpIndex, *surface)) {
-            // found a queue family that supports both graphics and present
-            queueIndex = qfpIndex;
-            break;
-        }
-    }
+    uint32_t queueIndex = profile.graphicsPresentFamily;
     if (queueIndex == ~0) {
         throw std::runtime_error(
             "Could not find a queue for graphics and present -> "
@@ -280,33 +247,94 @@ std::tuple<vk::raii::Device, uint32_t> createLogicalDeviceAndQueueIndex(
         );
     }
 
+    // async compute and transfer queues, falling back to the graphics queue
+    QueueFamilies families = findQueueFamilies(queueFamilyProperties, queueIndex);
+    for (auto type : {QueueType::eCompute, QueueType::eTransfer}) {
+        std::println(
+            "{} queue: family {} index {}{}",
+            toString(type),
+            families.familyOf(type),
+            families.index[static_cast<size_t>(type)],
+            families.isAsync(type) ? " (async)" : ""
+        );
+    }
+
     // query for Vulkan 1.3 features
     vk::StructureChain featureChain{
-        vk::PhysicalDeviceFeatures2{},
+        vk::PhysicalDeviceFeatures2{
+            .features = {.fillModeNonSolid = profile.features.fillModeNonSolid}
+        },
         vk::PhysicalDeviceVulkan11Features{.shaderDrawParameters = true},
+        vk::PhysicalDeviceVulkan12Features{.hostQueryReset = true, .timelineSemaphore = true},
         vk::PhysicalDeviceVulkan13Features{.synchronization2 = true, .dynamicRendering = true},
-        vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT{.extendedDynamicState = true}
+        vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT{.extendedDynamicState = true},
+        vk::PhysicalDeviceShaderObjectFeaturesEXT{.shaderObject = true},
+        vk::PhysicalDevicePresentIdFeaturesKHR{.presentId = true},
+        vk::PhysicalDevicePresentWaitFeaturesKHR{.presentWait = true}
     };
+    if (!profile.features.shaderObject) {
+        featureChain.unlink<vk::PhysicalDeviceShaderObjectFeaturesEXT>();
+    }
+    if (!profile.features.presentWait) {
+        featureChain.unlink<vk::PhysicalDevicePresentIdFeaturesKHR>();
+        featureChain.unlink<vk::PhysicalDevicePresentWaitFeaturesKHR>();
+    }
+
+    // optional extensions are enabled when the device has them; callers check
+    // profile.hasExtension() before relying on one
+    std::vector<const char*> extensions(requiredDeviceExtension.begin(), requiredDeviceExtension.end());
+    for (const char* extension : optionalExtensions) {
+        if (profile.hasExtension(extension)) {
+            extensions.push_back(extension);
+        }
+    }
 
     // create a Device
-    float queuePriority = 0.5f;
-    vk::DeviceQueueCreateInfo deviceQueueCreateInfo{
-        .queueFamilyIndex = queueIndex,
-        .queueCount = 1,
-        .pQueuePriorities = &queuePriority
-    };
+    std::vector<float> queuePriorities;
+    auto queueCreateInfos = makeQueueCreateInfos(families, queueFamilyProperties, queuePriorities);
     vk::DeviceCreateInfo deviceCreateInfo{
         .pNext = &featureChain.get<vk::PhysicalDeviceFeatures2>(),
-        .queueCreateInfoCount = 1,
-        .pQueueCreateInfos = &deviceQueueCreateInfo,
-        .enabledExtensionCount =
-            static_cast<uint32_t>(requiredDeviceExtension.size()),
-        .ppEnabledExtensionNames = requiredDeviceExtension.data()
+        .queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size()),
+        .pQueueCreateInfos = queueCreateInfos.data(),
+        .enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+        .ppEnabledExtensionNames = extensions.data()
     };
 
-    vk::raii::Device device(physicalDevice, deviceCreateInfo);
+    vk::raii::Device device(profile.device, deviceCreateInfo);
     // globalDeviceForImgui = &device;
-    return {std::move(device), queueIndex};
+    return {std::move(device), families};
+}
+
+vk::Format formatToSrgb(vk::Format format) {
+    switch (format) {
+        case vk::Format::eB8G8R8A8Srgb:
+        case vk::Format::eB8G8R8A8Unorm: {
+            return vk::Format::eB8G8R8A8Srgb;
+        }
+        case vk::Format::eR8G8B8A8Srgb:
+        case vk::Format::eR8G8B8A8Unorm: {
+            return vk::Format::eR8G8B8A8Srgb;
+        }
+        default: {
+            throw std::runtime_error("Format not supported yet.");
+        }
+    }
+}
+
+vk::Format formatToUnorm(vk::Format format) {
+    switch (format) {
+        case vk::Format::eB8G8R8A8Srgb:
+        case vk::Format::eB8G8R8A8Unorm: {
+            return vk::Format::eB8G8R8A8Unorm;
+        }
+        case vk::Format::eR8G8B8A8Srgb:
+        case vk::Format::eR8G8B8A8Unorm: {
+            return vk::Format::eR8G8B8A8Unorm;
+        }
+        default: {
+            throw std::runtime_error("Format not supported yet.");
+        }
+    }
 }
 
 vk::Extent2D chooseSwapExtent(
@@ -332,7 +360,8 @@ VulkanApp::SwapChain createSwapChain(
     const vk::raii::Device& device,
     const vk::raii::SurfaceKHR& surface,
     uint32_t minImageCount,
-    vk::Extent2D fbSize
+    vk::Extent2D fbSize,
+    bool allowMutableFormat
 ) {
     auto surfaceCapabilities =
         physicalDevice.getSurfaceCapabilitiesKHR(surface);
@@ -340,14 +369,32 @@ VulkanApp::SwapChain createSwapChain(
     vk::SurfaceFormatKHR swapChainSurfaceFormat = chooseSwapSurfaceFormat(
         physicalDevice.getSurfaceFormatsKHR(surface)
     );
+    // transfer dst lets the upscaler blit the scene straight into the image,
+    // transfer src lets FrameCapture copy it out
+    vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eColorAttachment |
+                                (surfaceCapabilities.supportedUsageFlags &
+                                 (vk::ImageUsageFlagBits::eTransferDst |
+                                  vk::ImageUsageFlagBits::eTransferSrc));
+    // An sRGB swapchain that can also be viewed as UNORM, so the UI can write
+    // its sRGB-space colors directly instead of linearizing them per fragment.
+    vk::Format format = swapChainSurfaceFormat.format;
+    bool mutableFormat = allowMutableFormat && formatToSrgb(format) == format;
+    std::array viewFormats{format, formatToUnorm(format)};
+    vk::ImageFormatListCreateInfo formatList{
+        .viewFormatCount = static_cast<uint32_t>(viewFormats.size()),
+        .pViewFormats = viewFormats.data()
+    };
     vk::SwapchainCreateInfoKHR swapChainCreateInfo{
+        .pNext = mutableFormat ? &formatList : nullptr,
+        .flags = mutableFormat ? vk::SwapchainCreateFlagBitsKHR::eMutableFormat
+                               : vk::SwapchainCreateFlagsKHR{},
         .surface = surface,
         .minImageCount = minImageCount,
         .imageFormat = swapChainSurfaceFormat.format,
         .imageColorSpace = swapChainSurfaceFormat.colorSpace,
         .imageExtent = swapChainExtent,
         .imageArrayLayers = 1,
-        .imageUsage = vk::ImageUsageFlagBits::eColorAttachment,
+        .imageUsage = usage,
         .imageSharingMode = vk::SharingMode::eExclusive,
         .preTransform = surfaceCapabilities.currentTransform,
         .compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque,
@@ -374,9 +421,17 @@ VulkanApp::SwapChain createSwapChain(
     std::vector<VulkanApp::SurfaceImages> views;
     for (auto& image : swapChainImages) {
         imageViewCreateInfo.image = image;
+        imageViewCreateInfo.format = swapChainSurfaceFormat.format;
+        vk::raii::ImageView view{device, imageViewCreateInfo};
+        vk::raii::ImageView viewNorm = nullptr;
+        if (mutableFormat) {
+            imageViewCreateInfo.format = viewFormats[1];
+            viewNorm = vk::raii::ImageView{device, imageViewCreateInfo};
+        }
         views.emplace_back(
             image,
-            vk::raii::ImageView{device, imageViewCreateInfo},
+            std::move(view),
+            std::move(viewNorm),
             vk::raii::Semaphore{device, vk::SemaphoreCreateInfo{}}
         );
     }
@@ -385,161 +440,59 @@ VulkanApp::SwapChain createSwapChain(
         .swapChain = std::move(swapChain),
         .surfaceFormat = swapChainSurfaceFormat,
         .extent = swapChainExtent,
+        .usage = usage,
+        .uiFormat = mutableFormat ? viewFormats[1] : swapChainSurfaceFormat.format,
         .images = std::move(views),
     };
 }
 
-void transitionImageLayout(
-    const vk::Image& image,
-    const vk::raii::CommandBuffer& commandBuffer,
-    vk::ImageLayout old_layout,
-    vk::ImageLayout new_layout,
-    vk::AccessFlags2 src_access_mask,
-    vk::AccessFlags2 dst_access_mask,
-    vk::PipelineStageFlags2 src_stage_mask,
-    vk::PipelineStageFlags2 dst_stage_mask
-) {
-    vk::ImageMemoryBarrier2 barrier = {
-        .srcStageMask = src_stage_mask,
-        .srcAccessMask = src_access_mask,
-        .dstStageMask = dst_stage_mask,
-        .dstAccessMask = dst_access_mask,
-        .oldLayout = old_layout,
-        .newLayout = new_layout,
-        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .image = image,
-        .subresourceRange = {
-            .aspectMask = vk::ImageAspectFlagBits::eColor,
-            .baseMipLevel = 0,
-            .levelCount = 1,
-            .baseArrayLayer = 0,
-            .layerCount = 1
-        }
-    };
-    vk::DependencyInfo dependency_info = {
-        .dependencyFlags = {},
-        .imageMemoryBarrierCount = 1,
-        .pImageMemoryBarriers = &barrier
-    };
-    commandBuffer.pipelineBarrier2(dependency_info);
-}
-
-vk::raii::ShaderModule createShaderModule(const vk::raii::Device& device, const std::span<char> spv) {
-    vk::ShaderModuleCreateInfo createInfo{
-        .codeSize = spv.size() * sizeof(char),
-        .pCode = reinterpret_cast<const uint32_t*>(spv.data())
+/*
+ * Format of the full-resolution scene color target, a transient image from
+ * the render target pool. Dynamic resolution renders into its top-left corner
+ * and blits that region up to the swapchain, so changing the scale never
+ * reallocates it. The format is eUndefined if it can't be blitted, in which
+ * case the scene renders straight to the swapchain.
+ */
+VulkanApp::SceneColor chooseSceneColor(const DeviceProfile& profile, vk::Format format) {
+    auto features = profile.device.getFormatProperties(format).optimalTilingFeatures;
+    if (!(features & vk::FormatFeatureFlagBits::eBlitSrc) ||
+        !(features & vk::FormatFeatureFlagBits::eBlitDst)) {
+        return {};
+    }
+    return {
+        .format = format,
+        .filter = features & vk::FormatFeatureFlagBits::eSampledImageFilterLinear
+                      ? vk::Filter::eLinear
+                      : vk::Filter::eNearest
     };
-    vk::raii::ShaderModule shaderModule{device, createInfo};
-
-    return shaderModule;
 }
 
-vk::raii::Pipeline createGraphicsPipeline(
-    const vk::raii::Device& device, vk::SurfaceFormatKHR surfaceFormat
+void beginColorRendering(
+    const vk::raii::CommandBuffer& cmd,
+    vk::ImageView view,
+    vk::Extent2D extent,
+    vk::AttachmentLoadOp loadOp,
+    vk::ClearValue clearValue = {},
+    vk::RenderingFlags flags = {}
 ) {
-    std::vector<char> spv = readFile("shaders/shader.spv");
-    vk::raii::ShaderModule shaderModule =
-        createShaderModule(device, spv);
-
-    vk::PipelineShaderStageCreateInfo vertShaderStageInfo{
-        .stage = vk::ShaderStageFlagBits::eVertex,
-        .module = shaderModule,
-        .pName = "vertMain"
-    };
-    vk::PipelineShaderStageCreateInfo fragShaderStageInfo{
-        .stage = vk::ShaderStageFlagBits::eFragment,
-        .module = shaderModule,
-        .pName = "fragMain"
-    };
-    vk::PipelineShaderStageCreateInfo shaderStages[] = {
-        vertShaderStageInfo, fragShaderStageInfo
-    };
-
-    auto bindingDescription = SimpleVertex::bindingDescription();
-    auto attributeDescriptions = SimpleVertex::attributeDescriptions();
-
-    vk::PipelineVertexInputStateCreateInfo vertexInputInfo{
-        .vertexBindingDescriptionCount = 1,
-        .pVertexBindingDescriptions = &bindingDescription,
-        .vertexAttributeDescriptionCount = attributeDescriptions.size(),
-        .pVertexAttributeDescriptions = attributeDescriptions.data()
-    };
-    vk::PipelineInputAssemblyStateCreateInfo inputAssembly{
-        .topology = vk::PrimitiveTopology::eTriangleList
-    };
-    vk::PipelineViewportStateCreateInfo viewportState{
-        .viewportCount = 1, .scissorCount = 1
-    };
-
-    vk::PipelineRasterizationStateCreateInfo rasterizer{
-        .depthClampEnable = vk::False,
-        .rasterizerDiscardEnable = vk::False,
-        .polygonMode = vk::PolygonMode::eFill,
-        .cullMode = vk::CullModeFlagBits::eBack,
-        .frontFace = vk::FrontFace::eClockwise,
-        .depthBiasEnable = vk::False,
-        .depthBiasSlopeFactor = 1.0f,
-        .lineWidth = 1.0f
-    };
-
-    vk::PipelineMultisampleStateCreateInfo multisampling{
-        .rasterizationSamples = vk::SampleCountFlagBits::e1,
-        .sampleShadingEnable = vk::False
-    };
-
-    vk::PipelineColorBlendAttachmentState colorBlendAttachment{
-        .blendEnable = vk::False,
-        .colorWriteMask = vk::ColorComponentFlagBits::eR |
-                          vk::ColorComponentFlagBits::eG |
-                          vk::ColorComponentFlagBits::eB |
-                          vk::ColorComponentFlagBits::eA
-    };
-
-    vk::PipelineColorBlendStateCreateInfo colorBlending{
-        .logicOpEnable = vk::False,
-        .logicOp = vk::LogicOp::eCopy,
-        .attachmentCount = 1,
-        .pAttachments = &colorBlendAttachment
-    };
-
-    std::vector dynamicStates = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
-    vk::PipelineDynamicStateCreateInfo dynamicState{
-        .dynamicStateCount = static_cast<uint32_t>(dynamicStates.size()),
-        .pDynamicStates = dynamicStates.data()
-    };
-
-    vk::PipelineLayoutCreateInfo pipelineLayoutInfo{
-        .setLayoutCount = 0, .pushConstantRangeCount = 0
+    vk::RenderingAttachmentInfo attachmentInfo{
+        .imageView = view,
+        .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
+        .loadOp = loadOp,
+        .storeOp = vk::AttachmentStoreOp::eStore,
+        .clearValue = clearValue
     };
-
-    vk::raii::PipelineLayout pipelineLayout(device, pipelineLayoutInfo);
-
-    vk::StructureChain pipelineCreateInfoChain{
-        vk::GraphicsPipelineCreateInfo{
-            .stageCount = 2,
-            .pStages = shaderStages,
-            .pVertexInputState = &vertexInputInfo,
-            .pInputAssemblyState = &inputAssembly,
-            .pViewportState = &viewportState,
-            .pRasterizationState = &rasterizer,
-            .pMultisampleState = &multisampling,
-            .pColorBlendState = &colorBlending,
-            .pDynamicState = &dynamicState,
-            .layout = pipelineLayout,
-            .renderPass = nullptr
+    vk::RenderingInfo renderingInfo = {
+        .flags = flags,
+        .renderArea = {
+            .offset = {0, 0},
+            .extent = extent
         },
-        vk::PipelineRenderingCreateInfo{
-            .colorAttachmentCount = 1,
-            .pColorAttachmentFormats = &surfaceFormat.format
-        }
-    };
-
-    return {
-        device,
-        nullptr,
-        pipelineCreateInfoChain.get<vk::GraphicsPipelineCreateInfo>()
+        .layerCount = 1,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &attachmentInfo
     };
+    cmd.beginRendering(renderingInfo);
 }
 
 /*
@@ -573,66 +526,304 @@ void createFrames(
     }
 }
 
-uint32_t findMemoryType(
-    const vk::raii::PhysicalDevice& physicalDevice,
-    uint32_t typeFilter,
+VulkanApp::SimpleBuffer createBuffer(
+    const DeviceProfile& profile,
+    const vk::raii::Device& device,
+    MemoryBudget& budget,
+    MemoryCategory category,
+    vk::DeviceSize size,
+    vk::BufferUsageFlags usage,
     vk::MemoryPropertyFlags properties
 ) {
-    vk::PhysicalDeviceMemoryProperties memProperties = physicalDevice.getMemoryProperties();
-
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-            return i;
-        }
-    }
-
-    throw std::runtime_error("failed to find suitable memory type!");
-}
-
-VulkanApp::SimpleBuffer createVertexBuffer(
-    const vk::raii::PhysicalDevice& physicalDevice,
-    const vk::raii::Device& device
-) {
-    const auto& vertices = TRAINGLE;
-    // create vertex buffer
     vk::BufferCreateInfo bufferInfo{
-        .size = sizeof(vertices[0]) * vertices.size(),
-        .usage = vk::BufferUsageFlagBits::eVertexBuffer,
+        .size = size,
+        .usage = usage,
         .sharingMode = vk::SharingMode::eExclusive
     };
-    vk::raii::Buffer vertexBuffer(device, bufferInfo);
+    vk::raii::Buffer buffer(device, bufferInfo);
 
     // create buffer memory
-    vk::MemoryRequirements memRequirements = vertexBuffer.getMemoryRequirements();
+    vk::MemoryRequirements memRequirements = buffer.getMemoryRequirements();
     vk::MemoryAllocateInfo memoryAllocateInfo{
         .allocationSize = memRequirements.size,
         .memoryTypeIndex = findMemoryType(
-            physicalDevice,
+            profile.memory,
             memRequirements.memoryTypeBits,
-            vk::MemoryPropertyFlagBits::eHostVisible |
-                vk::MemoryPropertyFlagBits::eHostCoherent
+            properties
         )
     };
-    vk::raii::DeviceMemory vertexBufferMemory(device, memoryAllocateInfo);
-    vertexBuffer.bindMemory(*vertexBufferMemory, 0);
-    return {std::move(vertexBuffer), std::move(vertexBufferMemory)};
+    auto memory = budget.allocate(device, memoryAllocateInfo, category);
+    buffer.bindMemory(*memory, 0);
+    return {std::move(buffer), std::move(memory)};
 }
 
-void writeVertexBuffer(const VulkanApp::SimpleBuffer& vertBuffer) {
+/*
+ * Upload the vertices through a staging buffer on the transfer queue. The
+ * graphics queue picks up the ownership transfer and the timeline wait on its
+ * next submit, so the copy overlaps with whatever graphics is doing.
+ */
+VulkanApp::SimpleBuffer createVertexBuffer(
+    const DeviceProfile& profile,
+    const vk::raii::Device& device,
+    MemoryBudget& budget,
+    QueueScheduler& scheduler
+) {
     const auto& vertices = TRAINGLE;
-    uint32_t size = sizeof(vertices[0]) * vertices.size();
-    void* data = vertBuffer.memory.mapMemory(0, size);
+    vk::DeviceSize size = sizeof(vertices[0]) * vertices.size();
+
+    auto staging = createBuffer(
+        profile,
+        device,
+        budget,
+        MemoryCategory::eStaging,
+        size,
+        vk::BufferUsageFlagBits::eTransferSrc,
+        vk::MemoryPropertyFlagBits::eHostVisible |
+            vk::MemoryPropertyFlagBits::eHostCoherent
+    );
+    void* data = staging.memory.get().mapMemory(0, size);
     memcpy(data, vertices.data(), size);
-    vertBuffer.memory.unmapMemory();
+    staging.memory.get().unmapMemory();
+
+    auto vertexBuffer = createBuffer(
+        profile,
+        device,
+        budget,
+        MemoryCategory::eBuffer,
+        size,
+        vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+        vk::MemoryPropertyFlagBits::eDeviceLocal
+    );
+
+    QueueScheduler::BufferTransfer transfer{
+        .buffer = *vertexBuffer.buffer,
+        .src = QueueType::eTransfer,
+        .dst = QueueType::eGraphics,
+        .srcStage = vk::PipelineStageFlagBits2::eCopy,
+        .srcAccess = vk::AccessFlagBits2::eTransferWrite,
+        .dstStage = vk::PipelineStageFlagBits2::eVertexAttributeInput,
+        .dstAccess = vk::AccessFlagBits2::eVertexAttributeRead
+    };
+
+    auto cmd = scheduler.allocateCommandBuffer(QueueType::eTransfer);
+    cmd.begin({.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    uint32_t scope = scheduler.beginTimedScope(QueueType::eTransfer, cmd);
+    cmd.copyBuffer(*staging.buffer, *vertexBuffer.buffer, vk::BufferCopy{.size = size});
+    scheduler.recordRelease(cmd, transfer);
+    scheduler.endTimedScope(QueueType::eTransfer, cmd, scope);
+    cmd.end();
+
+    vk::CommandBuffer cmdHandle = *cmd;
+    uint64_t value = scheduler.submit({
+        .queue = QueueType::eTransfer,
+        .commandBuffers = {&cmdHandle, 1}
+    });
+    scheduler.enqueueAcquire(transfer, value);
+    scheduler.retire(QueueType::eTransfer, value, std::move(cmd));
+    scheduler.retire(QueueType::eTransfer, value, std::move(staging));
+    return vertexBuffer;
+}
+
+// draws per frame with the state switch stress on, cycling through stressRasterState()
+constexpr uint32_t STATE_STRESS_DRAWS = 64;
+
+// 16 permutations: polygon mode, culling, winding and blending
+RasterState stressRasterState(uint32_t i) {
+    return {
+        .polygonMode = i & 1 ? vk::PolygonMode::eLine : vk::PolygonMode::eFill,
+        .cullMode = i & 2 ? vk::CullModeFlagBits::eNone : vk::CullModeFlagBits::eBack,
+        .frontFace = i & 4 ? vk::FrontFace::eCounterClockwise : vk::FrontFace::eClockwise,
+        .blend = (i & 8) != 0,
+    };
+}
+
+// the triangle has no per-object data yet, so culled draws all land on the same
+// spot; they are capped to keep the GPU side of the measurement reasonable
+constexpr uint32_t CULLED_DRAW_LIMIT = 1 << 16;
+
+// Spheres scattered in a 400^3 box around the origin, where the camera sits.
+void scatterCullObjects(SphereBounds& objects, uint32_t count) {
+    TRACE_FUNCTION();
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> position(-200.f, 200.f);
+    std::uniform_real_distribution<float> radius(0.1f, 4.f);
+    objects.clear();
+    for (uint32_t i = 0; i < count; i++) {
+        float x = position(rng), y = position(rng), z = position(rng);
+        objects.push_back(x, y, z, radius(rng));
+    }
+}
+
+// A camera at the origin turning around the y axis, 60 degree vertical fov.
+// One turn per minute, `seconds` wraps at 60.
+Frustum orbitFrustum(float seconds, vk::Extent2D extent) {
+    float angle = seconds * (2.f * std::numbers::pi_v<float> / 60.f);
+    glm::mat4 view = glm::lookAt(
+        glm::vec3(0.f), glm::vec3(std::sin(angle), 0.f, -std::cos(angle)), glm::vec3(0.f, 1.f, 0.f)
+    );
+    float aspect = static_cast<float>(extent.width) / std::max(1u, extent.height);
+    glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(60.f), aspect, 0.1f, 500.f);
+    projection[1][1] *= -1.f;
+    glm::mat4 viewProjection = projection * view;
+    return Frustum::fromMatrix(std::span<const float, 16>(glm::value_ptr(viewProjection), 16));
+}
+
+// Complete 8-ary tree, each child offset from its parent on a circle.
+void buildTransformTree(TransformHierarchy& hierarchy, uint32_t count) {
+    TRACE_FUNCTION();
+    constexpr uint32_t BRANCHING = 8;
+    hierarchy.clear();
+    hierarchy.reserve(count);
+    if (count > 0) {
+        hierarchy.add(TransformHierarchy::NO_PARENT);
+    }
+    for (uint32_t i = 1; i < count; i++) {
+        float angle = (i % BRANCHING) * (2.f * std::numbers::pi_v<float> / BRANCHING);
+        hierarchy.add(
+            (i - 1) / BRANCHING,
+            glm::vec3(std::cos(angle), 0.f, std::sin(angle)),
+            glm::quat(1.f, 0.f, 0.f, 0.f),
+            glm::vec3(0.5f)
+        );
+    }
+}
+
+// Sprites drifting on circles across `extent`, spinning, in four layers and
+// the white, streamed and generated texture slots. Placement comes from the
+// index, so the scene is the same every run.
+void fillSpriteScene(SpriteBatch& batch, uint32_t count, float seconds, vk::Extent2D extent) {
+    TRACE_FUNCTION();
+    auto sprites = batch.append(count);
+    float width = static_cast<float>(extent.width);
+    float height = static_cast<float>(extent.height);
+    for (uint32_t i = 0; i < count; i++) {
+        // cheap per-sprite pseudo random bits
+        uint32_t hash = i * 0x9E3779B9u;
+        hash ^= hash >> 15;
+        hash *= 0x85EBCA6Bu;
+        hash ^= hash >> 13;
+        auto unit = [&](uint32_t shift) { return ((hash >> shift) & 0xFF) / 255.f; };
+        float phase = seconds * (0.2f + unit(0)) + unit(8) * 2.f * std::numbers::pi_v<float>;
+        float size = 6.f + 26.f * unit(16);
+        sprites[i] = {
+            .x = unit(24) * width + 40.f * std::cos(phase),
+            .y = ((i * 2654435761u) >> 8) / float(1u << 24) * height + 40.f * std::sin(phase),
+            .width = size,
+            .height = size,
+            .rotation = phase * 2.f,
+            .u0 = 0.f,
+            .v0 = 0.f,
+            .u1 = 1.f,
+            .v1 = 1.f,
+            .color = (hash & 0x00FFFFFFu) | 0xC0000000u,  // 75% opaque
+            .texture = static_cast<uint16_t>(i % 3),
+            .layer = static_cast<uint16_t>((hash >> 4) & 3)
+        };
+    }
+}
+
+// generated test textures, kept between runs
+const std::filesystem::path TEXTURE_CACHE = "cache/textures";
+const std::filesystem::path STREAMED_TEXTURE = TEXTURE_CACHE / "checker_4096_mips.ktx2";
+const std::filesystem::path BASE_TEXTURE = TEXTURE_CACHE / "checker_2048.ktx2";
+// generated terrain for ChunkStreamer, kept between runs
+const std::filesystem::path WORLD_FILE = "cache/world/terrain.bin";
+
+// RGBA8 checkerboard over a color gradient with a fine grid, so every mip
+// level looks different.
+std::vector<uint8_t> checkerImage(uint32_t size) {
+    std::vector<uint8_t> pixels(size_t(size) * size * 4);
+    for (uint32_t y = 0; y < size; y++) {
+        for (uint32_t x = 0; x < size; x++) {
+            uint8_t* p = &pixels[(size_t(y) * size + x) * 4];
+            bool grid = x % 16 == 0 || y % 16 == 0;
+            bool light = ((x / 128) ^ (y / 128)) & 1;
+            p[0] = grid ? 255 : static_cast<uint8_t>(light ? 220 : 40 + x * 180 / size);
+            p[1] = grid ? 255 : static_cast<uint8_t>(light ? 210 : 40 + y * 180 / size);
+            p[2] = grid ? 255 : static_cast<uint8_t>(light ? 190 : 200 - x * 160 / size);
+            p[3] = 255;
+        }
+    }
+    return pixels;
+}
+
+// 2x2 box filter of a square RGBA8 image with a power of two side
+std::vector<uint8_t> halve(const std::vector<uint8_t>& pixels, uint32_t size) {
+    uint32_t half = size / 2;
+    std::vector<uint8_t> result(size_t(half) * half * 4);
+    for (uint32_t y = 0; y < half; y++) {
+        for (uint32_t x = 0; x < half; x++) {
+            for (uint32_t c = 0; c < 4; c++) {
+                auto at = [&](uint32_t sx, uint32_t sy) { return pixels[(size_t(sy) * size + sx) * 4 + c]; };
+                uint32_t sum = at(2 * x, 2 * y) + at(2 * x + 1, 2 * y) + at(2 * x, 2 * y + 1) +
+                               at(2 * x + 1, 2 * y + 1);
+                result[(size_t(y) * half + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+            }
+        }
+    }
+    return result;
+}
+
+// One texture with its whole mip chain in the file, one with only the base
+// level for the GPU to fill in. Skipped when they are cached already.
+void writeTestTextures() {
+    TRACE_FUNCTION();
+    if (!std::filesystem::exists(STREAMED_TEXTURE)) {
+        constexpr uint32_t SIZE = 4096;
+        std::vector<std::vector<uint8_t>> levels;
+        levels.push_back(checkerImage(SIZE));
+        for (uint32_t size = SIZE; size > 1; size /= 2) {
+            levels.push_back(halve(levels.back(), size));
+        }
+        TextureFile::write(STREAMED_TEXTURE, vk::Format::eR8G8B8A8Srgb, {SIZE, SIZE}, levels);
+    }
+    if (!std::filesystem::exists(BASE_TEXTURE)) {
+        constexpr uint32_t SIZE = 2048;
+        std::vector<std::vector<uint8_t>> levels;
+        levels.push_back(checkerImage(SIZE));
+        TextureFile::write(BASE_TEXTURE, vk::Format::eR8G8B8A8Srgb, {SIZE, SIZE}, levels);
+    }
 }
 
-void drawImgui(vk::raii::CommandBuffer& buffer, VulkanApp::AppState& state) {
+constexpr float WORLD_CENTER = ChunkStreamer::WORLD_CHUNKS * ChunkStreamer::CHUNK_SIZE / 2.f;
+constexpr float WORLD_PATH_RADIUS = WORLD_CENTER * 0.75f;
+// the camera is back where it started after this distance
+constexpr float WORLD_PATH_PERIOD = 2.f * std::numbers::pi_v<float> * WORLD_PATH_RADIUS;
+
+/*
+ * The streaming camera flies a figure eight over the whole world, crossing
+ * the middle in two directions: x = R sin t, z = R sin t cos t around the
+ * center, with t advancing by `speed` / R radians per second.
+ */
+ChunkCache::Camera worldCamera(float distance, float speed) {
+    float t = distance / WORLD_PATH_RADIUS;
+    return {
+        .x = WORLD_CENTER + WORLD_PATH_RADIUS * std::sin(t),
+        .z = WORLD_CENTER + WORLD_PATH_RADIUS * std::sin(t) * std::cos(t),
+        .vx = speed * std::cos(t),
+        .vz = speed * std::cos(2.f * t)
+    };
+}
+
+// The ImGui backend allocates its texture memory itself, estimate it from the atlas.
+vk::DeviceSize imguiTextureBytes() {
+    vk::DeviceSize bytes = 0;
+    for (const ImTextureData* texture : ImGui::GetPlatformIO().Textures) {
+        if (texture->Status != ImTextureStatus_Destroyed) {
+            bytes += texture->GetSizeInBytes();
+        }
+    }
+    return bytes;
+}
+
+void buildImgui(VulkanApp::AppState& state, WindowApp& window) {
+    TRACE_FUNCTION();
     ImGui_ImplVulkan_NewFrame();
-    ImGui_ImplGlfw_NewFrame();
+    window.newImguiFrame();
     ImGui::NewFrame();
     {
         auto size = ImGui::GetMainViewport()->Size;
-        ImGui::SetNextWindowSize(ImVec2(size.x * 0.75, 85.0f), ImGuiCond_Appearing);
+        ImGui::SetNextWindowSize(ImVec2(size.x * 0.75, 0.0f), ImGuiCond_Appearing);
         ImGui::Begin("Hello, world!");
         ImGui::ColorEdit3(
             "clear color",
@@ -640,98 +831,776 @@ void drawImgui(vk::raii::CommandBuffer& buffer, VulkanApp::AppState& state) {
         );
         ImGui::SameLine();
         ImGui::Checkbox("Demo Window", &state.showDemoWindow);
+        ImGui::SameLine();
+        if (ImGui::Button("Dump render graph")) {
+            state.dumpRenderGraph = true;
+        }
+        ImGui::SameLine();
+        state.requestScreenshot = ImGui::Button("Screenshot");
+        ImGui::SameLine();
+        state.toggleRecording = ImGui::Button(state.recording ? "Stop recording" : "Record");
+        if (state.recording || state.captureStats.written > 0) {
+            ImGui::Text(
+                "capture: %u written, %u dropped, encode %.1fms",
+                state.captureStats.written,
+                state.captureStats.dropped,
+                state.captureStats.encodeMs
+            );
+        }
+#ifdef LEARN_VULKAN_TRACE
+        ImGui::SameLine();
+        if (ImGui::Button("Save trace")) {
+            size_t count = trace::exportChromeTrace("trace.json");
+            std::println("Trace with {} events written to trace.json", count);
+        }
+#endif
         ImGui::Text("fps: %.2fms", 1.0 / (state.frameTime / 1000.0));
+        ImGui::SameLine();
+        const auto& overlap = state.queueOverlap;
+        if (overlap.calibrated) {
+            ImGui::Text(
+                "| async overlap: compute %.0f%%, transfer %.0f%%",
+                overlap.overlapRatio(QueueType::eCompute) * 100.0,
+                overlap.overlapRatio(QueueType::eTransfer) * 100.0
+            );
+        }
+        else {
+            // without calibration the queues' timestamps can't be compared
+            ImGui::Text(
+                "| busy: graphics %.1fms, compute %.1fms, transfer %.1fms",
+                overlap.busyMs[static_cast<size_t>(QueueType::eGraphics)],
+                overlap.busyMs[static_cast<size_t>(QueueType::eCompute)],
+                overlap.busyMs[static_cast<size_t>(QueueType::eTransfer)]
+            );
+        }
+        ImGui::Checkbox("Low latency", &state.pacing.lowLatency);
+        if (state.pacing.lowLatency) {
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x * 0.4f);
+            ImGui::SliderFloat("Deadline margin", &state.pacing.marginMs, 0.f, 8.f, "%.1f ms");
+        }
+        const auto& pacing = state.pacingStats;
+        if (pacing.presentWait) {
+            ImGui::Text(
+                "latency: input to submit %.2fms, submit to present %.2fms, waited %.2fms, "
+                "refresh %.2fms",
+                pacing.inputToSubmitMs,
+                pacing.submitToPresentMs,
+                pacing.waitMs,
+                pacing.refreshMs
+            );
+        }
+        else {
+            ImGui::Text(
+                "latency: input to submit %.2fms, waited %.2fms (no present wait)",
+                pacing.inputToSubmitMs,
+                pacing.waitMs
+            );
+        }
+        auto& resolution = state.resolution.settings;
+        ImGui::Checkbox("Dynamic resolution", &resolution.enabled);
+        ImGui::SameLine();
+        ImGui::Checkbox("UI overdraw stress", &state.uiStress);
+        ImGui::SliderFloat("GPU budget", &resolution.targetMs, 1.f, 33.f, "%.1f ms");
+        ImGui::SliderFloat("Min scale", &resolution.minScale, 0.25f, resolution.maxScale, "%.2f");
+        ImGui::Text(
+            "scene %ux%u (%.0f%%), gpu %.2fms",
+            state.renderExtent.width,
+            state.renderExtent.height,
+            state.resolution.scale() * 100.0,
+            state.resolution.smoothedGpuMs()
+        );
+        if (state.shaderObjectsSupported) {
+            ImGui::Checkbox("Shader objects", &state.useShaderObjects);
+            ImGui::SameLine();
+        }
+        if (state.wireframeSupported) {
+            bool wireframe = state.raster.polygonMode == vk::PolygonMode::eLine;
+            if (ImGui::Checkbox("Wireframe", &wireframe)) {
+                state.raster.polygonMode = wireframe ? vk::PolygonMode::eLine : vk::PolygonMode::eFill;
+            }
+            ImGui::SameLine();
+        }
+        bool cull = state.raster.cullMode != vk::CullModeFlagBits::eNone;
+        if (ImGui::Checkbox("Cull back faces", &cull)) {
+            state.raster.cullMode = cull ? vk::CullModeFlagBits::eBack : vk::CullModeFlagBits::eNone;
+        }
+        ImGui::SameLine();
+        ImGui::Checkbox("Blend", &state.raster.blend);
+        ImGui::SameLine();
+        ImGui::Checkbox("State switch stress", &state.stateStress);
+        ImGui::Checkbox("Cache static draws", &state.cacheStaticScene);
+        ImGui::SameLine();
+        ImGui::SliderInt("Static copies", &state.staticCopies, 1, 2048);
+        ImGui::Text(
+            "scene recorded in %.1f us | %u pipelines compiled (%.2f ms)",
+            state.sceneRecordUs,
+            state.sceneShaders.pipelineCount,
+            state.sceneShaders.pipelineCompileMs
+        );
+        if (state.cacheStaticScene && !state.cpuCulling) {
+            ImGui::Text(
+                "static draws: %u recordings, a full record takes %.1f us",
+                state.staticSceneStats.recordCount,
+                state.staticSceneStats.lastRecordUs
+            );
+        }
+        if (state.particlesAvailable) {
+            auto& particles = state.particles;
+            const auto& stats = state.particleStats;
+            ImGui::Checkbox("Particles", &particles.enabled);
+            ImGui::SameLine();
+            // powers of two, the buffers are only reallocated when the value changes
+            int shift = static_cast<int>(std::bit_width(particles.capacity)) - 1;
+            char label[32];
+            std::snprintf(label, sizeof(label), "%u", particles.capacity);
+            int maxShift = std::max(10, static_cast<int>(std::bit_width(stats.maxCapacity)) - 1);
+            if (ImGui::SliderInt("Max particles", &shift, 10, maxShift, label)) {
+                particles.capacity = 1u << shift;
+            }
+            ImGui::SliderFloat(
+                "Emit rate", &particles.emitRate, 1000.f, 1e7f, "%.0f /s", ImGuiSliderFlags_Logarithmic
+            );
+            ImGui::SliderFloat("Lifetime", &particles.lifetime, 0.5f, 10.f, "%.1f s");
+            ImGui::SliderFloat("Particle size", &particles.pointSize, 0.5f, 8.f, "%.1f px");
+            ImGui::Text(
+                "particles gpu: emit %.3f ms | simulate %.3f ms | draw %.3f ms | %.1f MiB",
+                stats.stageMs[static_cast<size_t>(ParticleSystem::Stage::eEmit)],
+                stats.stageMs[static_cast<size_t>(ParticleSystem::Stage::eSimulate)],
+                stats.stageMs[static_cast<size_t>(ParticleSystem::Stage::eDraw)],
+                stats.bytes / double(1 << 20)
+            );
+        }
+        if (state.spritesAvailable) {
+            ImGui::Checkbox("Sprites", &state.sprites);
+            if (state.sprites) {
+                const auto& stats = state.spriteStats;
+                ImGui::SameLine();
+                ImGui::SliderInt(
+                    "Sprite count", &state.spriteCount, 1000, 1'000'000, "%d", ImGuiSliderFlags_Logarithmic
+                );
+                ImGui::SameLine();
+                ImGui::BeginDisabled(!SpriteBatch::simdAvailable());
+                ImGui::Checkbox("SIMD", &state.spriteSimd);
+                ImGui::EndDisabled();
+                ImGui::Text(
+                    "%u sprites in %u draws (%u hidden) | sort %.1f us in %u passes | vertices %.1f us",
+                    stats.batch.spriteCount,
+                    stats.drawCount,
+                    stats.hiddenSprites,
+                    stats.batch.sortUs,
+                    stats.batch.sortPasses,
+                    stats.batch.vertexUs
+                );
+            }
+        }
+        if (state.postAvailable) {
+            auto& post = state.post;
+            const auto& stats = state.postStats;
+            ImGui::Checkbox("Post-processing", &post.enabled);
+            if (post.enabled) {
+                ImGui::SameLine();
+                ImGui::Checkbox("Bloom", &post.bloom);
+                ImGui::SameLine();
+                ImGui::Checkbox("Blur", &post.blur);
+                ImGui::SameLine();
+                ImGui::Checkbox("Tonemap", &post.tonemap);
+                ImGui::SameLine();
+                ImGui::BeginDisabled(!post.tonemap);
+                ImGui::Checkbox("Auto exposure", &post.autoExposure);
+                ImGui::EndDisabled();
+                if (post.bloom) {
+                    int levels = static_cast<int>(post.bloomLevels);
+                    if (ImGui::SliderInt("Bloom levels", &levels, 1, PostProcess::MAX_BLOOM_LEVELS)) {
+                        post.bloomLevels = static_cast<uint32_t>(levels);
+                    }
+                    ImGui::SliderFloat("Bloom threshold", &post.bloomThreshold, 0.f, 4.f, "%.2f");
+                    ImGui::SliderFloat("Bloom knee", &post.bloomKnee, 0.f, 1.f, "%.2f");
+                    ImGui::SliderFloat("Bloom intensity", &post.bloomIntensity, 0.f, 2.f, "%.2f");
+                }
+                if (post.blur) {
+                    ImGui::SliderFloat("Blur sigma", &post.blurSigma, 0.5f, 10.f, "%.1f px");
+                }
+                ImGui::SliderFloat("Exposure", &post.exposureCompensation, -4.f, 4.f, "%+.1f EV");
+                if (post.tonemap && post.autoExposure) {
+                    ImGui::SliderFloat("Adaptation", &post.adaptationSpeed, 0.1f, 10.f, "%.1f /s");
+                }
+            }
+            ImGui::Text(
+                "post gpu: blur %.3f ms | exposure %.3f ms | bloom %.3f ms | tonemap %.3f ms | %u passes, subgroup %u",
+                stats.stageMs[static_cast<size_t>(PostProcess::Stage::eBlur)],
+                stats.stageMs[static_cast<size_t>(PostProcess::Stage::eExposure)],
+                stats.stageMs[static_cast<size_t>(PostProcess::Stage::eBloom)],
+                stats.stageMs[static_cast<size_t>(PostProcess::Stage::eTonemap)],
+                stats.passCount,
+                stats.subgroupSize
+            );
+        }
+        ImGui::Checkbox("Pipelined simulation", &state.pipelinedSimulation);
+        ImGui::SameLine();
+        ImGui::Text(
+            "| culling + sprites %.1f us %s, waited %.1f us, %llu misses | %u window events",
+            state.simulateUs,
+            state.simulationAhead ? "ahead" : "inline",
+            state.simulationWaitUs,
+            static_cast<unsigned long long>(state.simulationMisses),
+            state.windowEvents
+        );
+        ImGui::Checkbox("CPU culling", &state.cpuCulling);
+        if (state.cpuCulling) {
+            ImGui::SameLine();
+            ImGui::SliderInt(
+                "Objects", &state.cullObjectCount, 1000, 10'000'000, "%d", ImGuiSliderFlags_Logarithmic
+            );
+            for (auto isa : {FrustumCuller::Isa::eScalar, FrustumCuller::Isa::eSse2,
+                             FrustumCuller::Isa::eAvx2, FrustumCuller::Isa::eNeon}) {
+                if (FrustumCuller::supports(isa)) {
+                    if (ImGui::RadioButton(toString(isa), state.cullIsa == isa)) {
+                        state.cullIsa = isa;
+                    }
+                    ImGui::SameLine();
+                }
+            }
+            ImGui::Text(
+                "| %u visible in %.1f us on %u threads",
+                state.culledVisible,
+                state.cullUs,
+                state.cullThreads
+            );
+        }
+        ImGui::Checkbox("Transforms", &state.transforms);
+        if (state.transforms) {
+            ImGui::SameLine();
+            ImGui::SliderInt(
+                "Nodes", &state.transformNodes, 1000, 1'000'000, "%d", ImGuiSliderFlags_Logarithmic
+            );
+            ImGui::SliderFloat(
+                "Changed %",
+                &state.transformChangedPercent,
+                0.01f,
+                100.f,
+                "%.2f",
+                ImGuiSliderFlags_Logarithmic
+            );
+            ImGui::SameLine();
+            ImGui::Checkbox("Incremental", &state.transformIncremental);
+            ImGui::Text(
+                "%u recomputed, %u written in %.1f us",
+                state.transformStats.recomputed,
+                state.transformStats.written,
+                state.transformUs
+            );
+        }
+        if (state.texturesAvailable) {
+            ImGui::SliderInt("Stream MiB / frame", &state.textureMiBPerFrame, 1, 32);
+            ImGui::SameLine();
+            if (ImGui::Button("Reload textures")) {
+                state.reloadTextures = true;
+            }
+            float side = 128.f * ImGui::GetStyle().FontScaleDpi;
+            for (const auto& texture : state.textures) {
+                if (texture.uiTexture != 0) {
+                    ImGui::Image(ImTextureRef(texture.uiTexture), ImVec2(side, side));
+                }
+                else {
+                    ImGui::Dummy(ImVec2(side, side));
+                }
+                ImGui::SameLine();
+            }
+            ImGui::BeginGroup();
+            for (const auto& texture : state.textures) {
+                const auto& info = texture.info;
+                ImGui::Text(
+                    "%s %ux%u: from level %u of %u (%u trimmed), first pixel %.1f ms, complete %.1f ms",
+                    texture.name,
+                    info.extent.width,
+                    info.extent.height,
+                    info.residentLevel,
+                    info.levelCount,
+                    info.droppedLevels,
+                    info.firstPixelMs,
+                    info.completeMs
+                );
+            }
+            const auto& stats = state.textureStats;
+            ImGui::Text(
+                "streamed %.1f MiB at %.0f MiB/s, %.1f MiB last frame",
+                stats.uploadedBytes / double(1 << 20),
+                stats.bandwidthMiBs(),
+                stats.lastFrameBytes / double(1 << 20)
+            );
+            ImGui::EndGroup();
+        }
+        if (state.worldAvailable) {
+            ImGui::Checkbox("World streaming", &state.world);
+            if (state.world) {
+                auto& settings = state.worldSettings;
+                const auto& stats = state.worldStats;
+                const auto& cache = stats.cache;
+                ImGui::SameLine();
+                ImGui::SliderFloat("Camera speed", &state.worldSpeed, 0.f, 2000.f, "%.0f /s");
+                // every new value rebuilds the pool, starting over with nothing resident
+                int budgetMiB = static_cast<int>(settings.budgetMiB);
+                if (ImGui::SliderInt("GPU budget", &budgetMiB, 1, 64, "%d MiB")) {
+                    settings.budgetMiB = static_cast<uint32_t>(budgetMiB);
+                }
+                int loadKiB = static_cast<int>(settings.bytesPerFrame >> 10);
+                if (ImGui::SliderInt("Load KiB / frame", &loadKiB, 64, 4096, "%d", ImGuiSliderFlags_Logarithmic)) {
+                    settings.bytesPerFrame = vk::DeviceSize(loadKiB) << 10;
+                }
+                ImGui::SliderFloat("Load radius", &settings.cache.loadRadius, 64.f, 512.f, "%.0f");
+                ImGui::SliderFloat("Lookahead", &settings.cache.lookaheadSeconds, 0.f, 2.f, "%.2f s");
+                ImGui::SliderFloat("View radius", &settings.viewRadius, 32.f, 512.f, "%.0f");
+                char label[48];
+                std::snprintf(label, sizeof(label), "%u / %u chunks", cache.resident, cache.capacity);
+                ImGui::ProgressBar(
+                    cache.capacity > 0 ? static_cast<float>(cache.resident) / cache.capacity : 0.f,
+                    {200.f, 0.f},
+                    label
+                );
+                ImGui::SameLine();
+                ImGui::Text(
+                    "resident %.1f / %.1f MiB | %u loading, %u wanted",
+                    stats.residentBytes / double(1 << 20),
+                    stats.budgetBytes / double(1 << 20),
+                    cache.loading,
+                    cache.wanted
+                );
+                ImGui::Text(
+                    "hit rate %.1f%% (%u / %u this frame) | %u drawn, %u missing | %llu evictions",
+                    cache.hitRate() * 100.0,
+                    cache.frameHits,
+                    cache.frameHits + cache.frameMisses,
+                    stats.drawn,
+                    stats.missing,
+                    static_cast<unsigned long long>(cache.evictions)
+                );
+                ImGui::Text(
+                    "streamed %.1f MiB at %.0f MiB/s, %u chunks last frame, %llu failed reads",
+                    stats.loadedBytes / double(1 << 20),
+                    stats.bandwidthMiBs(),
+                    stats.lastFrameLoads,
+                    static_cast<unsigned long long>(stats.failedReads)
+                );
+            }
+        }
+        ImGui::Text(
+            "frame arena %.1f / %.1f KiB",
+            state.frameArena.used / 1024.0,
+            state.frameArena.capacity / 1024.0
+        );
+        if constexpr (alloc_counter::ENABLED) {
+            ImGui::SameLine();
+            ImGui::Text(
+                "| heap allocations %llu (%llu bytes)",
+                static_cast<unsigned long long>(state.frameAllocations.allocations),
+                static_cast<unsigned long long>(state.frameAllocations.bytes)
+            );
+        }
+        const auto& memory = state.memory;
+        constexpr double MiB = 1 << 20;
+        for (uint32_t i = 0; i < memory.heapCount; i++) {
+            const auto& heap = memory.heaps[i];
+            char label[48];
+            std::snprintf(label, sizeof(label), "%.0f / %.0f MiB", heap.usage / MiB, heap.budget / MiB);
+            ImGui::ProgressBar(static_cast<float>(heap.usageRatio()), {200.f, 0.f}, label);
+            ImGui::SameLine();
+            ImGui::Text("heap %u%s", i, heap.deviceLocal ? " (device local)" : "");
+        }
+        ImGui::Text(
+            "%s, %u allocations:",
+            memory.fromExtension ? "VK_EXT_memory_budget" : "tracked only",
+            memory.allocationCount
+        );
+        for (size_t i = 0; i < MEMORY_CATEGORY_COUNT; i++) {
+            ImGui::SameLine();
+            ImGui::Text(
+                "%s %.1f MiB",
+                toString(static_cast<MemoryCategory>(i)),
+                memory.categoryBytes[i] / MiB
+            );
+        }
+        const auto& targets = state.renderTargetStats;
+        ImGui::Text(
+            "render targets: %u in %u blocks (%u lazy), %.1f MiB aliased / %.1f MiB without, peak %.1f / %.1f MiB",
+            targets.targetCount,
+            targets.blockCount,
+            targets.lazyCount,
+            targets.aliasedBytes / MiB,
+            targets.unaliasedBytes / MiB,
+            targets.peakAliasedBytes / MiB,
+            targets.peakUnaliasedBytes / MiB
+        );
         ImGui::End();
     }
     if (state.showDemoWindow) {
         ImGui::ShowDemoWindow(&(state.showDemoWindow));
     }
-    ImGui::Render();
-    ImDrawData* draw_data = ImGui::GetDrawData();
-    ImGui_ImplVulkan_RenderDrawData(draw_data, *buffer);
-}
-
-vk::Format formatToSrgb(vk::Format format) {
-    switch (format) {
-        case vk::Format::eB8G8R8A8Srgb:
-        case vk::Format::eB8G8R8A8Unorm: {
-            return vk::Format::eB8G8R8A8Srgb;
-        }
-        case vk::Format::eR8G8B8A8Srgb:
-        case vk::Format::eR8G8B8A8Unorm: {
-            return vk::Format::eR8G8B8A8Srgb;
-        }
-        default: {
-            throw std::runtime_error("Format not supported yet.");
+    if (state.uiStress) {
+        // full-screen translucent layers: almost pure UI fragment cost, so the
+        // GPU time above compares the sRGB and UNORM UI paths
+        ImDrawList* drawList = ImGui::GetBackgroundDrawList();
+        ImVec2 size = ImGui::GetIO().DisplaySize;
+        for (int i = 0; i < 64; i++) {
+            drawList->AddRectFilled({0, 0}, size, IM_COL32(255, 160, 64, 4));
         }
     }
+    ImGui::Render();
 }
 
-vk::Format formatToUnorm(vk::Format format) {
-    switch (format) {
-        case vk::Format::eB8G8R8A8Srgb:
-        case vk::Format::eB8G8R8A8Unorm: {
-            return vk::Format::eB8G8R8A8Unorm;
-        }
-        case vk::Format::eR8G8B8A8Srgb:
-        case vk::Format::eR8G8B8A8Unorm: {
-            return vk::Format::eR8G8B8A8Unorm;
-        }
-        default: {
-            throw std::runtime_error("Format not supported yet.");
-        }
-    }
-}
 // TODO: ADD MORE FUNCTION HERE
 }  // namespace
 
+/*
+ * Startup is a task graph: file reads and font rasterization start right away
+ * on workers while the main thread creates the instance and surface, and the
+ * device-level objects are created in parallel once the device exists.
+ */
 void VulkanApp::init() {
-    instance = createInstance(context);
-    debugMessenger = setupDebugMessenger(instance);
-
-    surface = windowApp->createSurface(instance);
-
-    physicalDevice = pickPhysicalDevice(instance);
-
-    {  // creat logic device and queue
-        auto result = createLogicalDeviceAndQueueIndex(physicalDevice, surface);
-        device = std::move(std::get<0>(result));
-        queueFamilyIndex = std::get<1>(result);
-        queue = vk::raii::Queue(device, queueFamilyIndex, 0);
-    }
-
+    TRACE_FUNCTION();
+    // GLFW queries have to happen on the main thread
     Size2D<uint32_t> size = windowApp->getFrameSize();
-    minImageCount = chooseSwapMinImageCount(physicalDevice.getSurfaceCapabilitiesKHR(surface));
-
-    swapChain = createSwapChain(
-        physicalDevice, device, surface, minImageCount, {size.width, size.height}
+    Size2D<int> windowSize = windowApp->getWindowSize();
+    float uiScale = windowApp->getScale();
+    float fontDensity = windowSize.width > 0
+                            ? static_cast<float>(size.width) / windowSize.width
+                            : 1.f;
+    std::vector<char> sceneSpv;
+    std::vector<char> particleComputeSpv;
+    std::vector<char> particleDrawSpv;
+    std::vector<char> spriteSpv;
+    std::vector<char> postSpv;
+    std::vector<char> worldSpv;
+    bool worldFileReady = false;
+
+    // every file startup needs is requested up front in one batch; the tasks
+    // below only wait for their part
+    AsyncIO io;
+    io.init();
+    auto optionalFile = [&](const char* path) {
+        // the optional shaders may not have been compiled yet
+        return std::filesystem::exists(path) ? io.readFile(path) : std::future<std::vector<char>>();
+    };
+    auto sceneFile = io.readFile("shaders/shader.spv");
+    auto particleComputeFile = optionalFile("shaders/particles.spv");
+    auto particleDrawFile = optionalFile("shaders/particle_draw.spv");
+    auto spriteFile = optionalFile("shaders/sprite.spv");
+    auto postFile = optionalFile("shaders/postprocess.spv");
+    auto worldFile = optionalFile("shaders/world.spv");
+    auto imguiVertFile = io.readFile("shaders/imgui/vert.spv");
+    auto imguiFragFile = io.readFile("shaders/imgui/frag.spv");
+    auto fontFile = io.readFile("assets/fonts/IBMPlex/IBMPlexSans-Regular.ttf");
+
+    using Affinity = TaskGraph::Affinity;
+    TaskGraph startup;
+    auto readSceneShader = startup.add("read scene shader", [&]() {
+        sceneSpv = sceneFile.get();
+    });
+    auto readParticleShaders = startup.add("read particle shaders", [&]() {
+        if (particleComputeFile.valid() && particleDrawFile.valid()) {
+            particleComputeSpv = particleComputeFile.get();
+            particleDrawSpv = particleDrawFile.get();
+        }
+    });
+    auto readSpriteShader = startup.add("read sprite shader", [&]() {
+        if (spriteFile.valid()) {
+            spriteSpv = spriteFile.get();
+        }
+    });
+    auto readPostShader = startup.add("read post-processing shader", [&]() {
+        if (postFile.valid()) {
+            postSpv = postFile.get();
+        }
+    });
+    auto readWorldShader = startup.add("read world shader", [&]() {
+        if (worldFile.valid()) {
+            worldSpv = worldFile.get();
+        }
+    });
+    auto readImguiShaders = startup.add("read imgui shaders", [&]() {
+        imguiVertSpv = imguiVertFile.get();
+        imguiFragSpv = imguiFragFile.get();
+    });
+    // nothing else touches the ImGui context until the backend task below
+    auto fontAtlas = startup.add("bake font atlas", [&]() {
+        fontData = fontFile.get();
+        initImguiStyle(uiScale, fontDensity);
+    });
+    auto createInstanceTask = startup.add("instance", [&]() {
+        instance = createInstance(context);
+        debugMessenger = setupDebugMessenger(instance);
+    });
+    auto createSurface = startup.add(
+        "surface",
+        [&]() { surface = windowApp->createSurface(instance); },
+        {createInstanceTask},
+        Affinity::eMain
     );
+    auto createDevice = startup.add(
+        "device",
+        [&]() {
+            std::println("Physical devices:");
+            deviceProfile = selectDeviceProfile(
+                enumerateDeviceProfiles(instance, surface, requiredDeviceExtension),
+                options.device
+            );
+            physicalDevice = deviceProfile.device;
 
-    vertexBuffer = createVertexBuffer(physicalDevice, device);
-    writeVertexBuffer(vertexBuffer);
-
-    graphicsPipeline = createGraphicsPipeline(device, swapChain.surfaceFormat);
-    createFrames(commandPool, frames, device, queueFamilyIndex);
+            auto result = createLogicalDeviceAndQueueIndex(deviceProfile, optionalDeviceExtension);
+            mutableSwapchain = options.mutableSwapchain &&
+                               deviceProfile.hasExtension(vk::KHRSwapchainMutableFormatExtensionName);
+            memoryBudget.init(
+                deviceProfile, deviceProfile.hasExtension(vk::EXTMemoryBudgetExtensionName)
+            );
+            capture.init(deviceProfile, device, memoryBudget);
+            device = std::move(std::get<0>(result));
+            scheduler = QueueScheduler(
+                device,
+                std::get<1>(result),
+                deviceProfile.properties.limits.timestampPeriod,
+                deviceProfile.features.calibratedTimestamps
+            );
+            pacer.init(scheduler, deviceProfile.features.presentWait);
+            renderTargets.init(deviceProfile, device, memoryBudget, scheduler);
+            renderGraph.setTargetPool(renderTargets);
+        },
+        {createSurface}
+    );
+    auto createSwapChainTask = startup.add(
+        "swapchain",
+        [&]() {
+            minImageCount = chooseSwapMinImageCount(physicalDevice.getSurfaceCapabilitiesKHR(surface));
+            swapChain = createSwapChain(
+                physicalDevice,
+                device,
+                surface,
+                minImageCount,
+                {size.width, size.height},
+                mutableSwapchain
+            );
+            sceneColor = chooseSceneColor(deviceProfile, swapChain.surfaceFormat.format);
+        },
+        {createDevice}
+    );
+    auto textureAssets = startup.add("texture assets", [&]() {
+        try {
+            writeTestTextures();
+        }
+        catch (const std::exception& e) {
+            std::println("Failed to write test textures: {}", e.what());
+        }
+    });
+    auto worldAssets = startup.add("world assets", [&]() {
+        try {
+            ChunkStreamer::generate(WORLD_FILE);
+            worldFileReady = true;
+        }
+        catch (const std::exception& e) {
+            std::println("Failed to write the world: {}", e.what());
+        }
+    });
+    // the only scheduler user during startup, so no locking is needed
+    auto createVertexBufferTask = startup.add(
+        "vertex buffer",
+        [&]() { vertexBuffer = createVertexBuffer(deviceProfile, device, memoryBudget, scheduler); },
+        {createDevice}
+    );
+    // after the vertex buffer, they share the transfer command pool
+    auto texturesTask = startup.add(
+        "textures",
+        [&]() {
+            textureStreamer.init(deviceProfile, device, memoryBudget, scheduler, MAX_FRAMES_IN_FLIGHT);
+            try {
+                loadTextures();
+                state.texturesAvailable = true;
+            }
+            catch (const std::runtime_error& e) {
+                std::println("Textures disabled: {}", e.what());
+            }
+        },
+        {createVertexBufferTask, textureAssets}
+    );
+    // decides the format everything drawing the scene is built for
+    auto postProcessTask = startup.add(
+        "post-processing",
+        [&]() {
+            if (postSpv.empty()) {
+                std::println("Post-processing disabled: build shaders/postprocess.spv with shaders/compile.sh");
+                return;
+            }
+            if (!(swapChain.usage & vk::ImageUsageFlagBits::eTransferDst)) {
+                std::println("Post-processing disabled: the swapchain images can't be blitted to");
+                return;
+            }
+            if (!PostProcess::supported(deviceProfile)) {
+                std::println("Post-processing disabled: no subgroup arithmetic in compute shaders");
+                return;
+            }
+            postProcess.init(deviceProfile, device, memoryBudget, MAX_FRAMES_IN_FLIGHT, postSpv);
+            state.postAvailable = true;
+            state.post = postProcess.settings;
+        },
+        {createSwapChainTask, readPostShader}
+    );
+    auto sceneFormat = [&]() {
+        return postProcess.ready() ? PostProcess::HDR_FORMAT : swapChain.surfaceFormat.format;
+    };
+    startup.add(
+        "scene shaders",
+        [&]() {
+            sceneShaders.init(device, deviceProfile.features, sceneSpv, sceneFormat());
+            const auto& stats = sceneShaders.getStats();
+            std::println(
+                "Scene shaders: pipeline {:.2f} ms, shader objects {}",
+                stats.pipelineCreateMs,
+                sceneShaders.supports(SceneShaders::Backend::eShaderObject)
+                    ? std::format("{:.2f} ms", stats.shaderObjectCreateMs)
+                    : "unsupported"
+            );
+            state.shaderObjectsSupported = sceneShaders.supports(SceneShaders::Backend::eShaderObject);
+            state.useShaderObjects = state.shaderObjectsSupported;
+            state.wireframeSupported = sceneShaders.supportsPolygonMode(vk::PolygonMode::eLine);
+        },
+        {postProcessTask, readSceneShader}
+    );
+    startup.add(
+        "particles",
+        [&]() {
+            if (particleComputeSpv.empty()) {
+                std::println("Particles disabled: build shaders/particles.spv with shaders/compile.sh");
+                return;
+            }
+            particles.init(
+                deviceProfile,
+                device,
+                memoryBudget,
+                scheduler,
+                MAX_FRAMES_IN_FLIGHT,
+                particleComputeSpv,
+                particleDrawSpv,
+                sceneFormat()
+            );
+            state.particlesAvailable = true;
+            state.particles = particles.settings;
+        },
+        {postProcessTask, readParticleShaders}
+    );
+    startup.add(
+        "sprites",
+        [&]() {
+            if (spriteSpv.empty()) {
+                std::println("Sprites disabled: build shaders/sprite.spv with shaders/compile.sh");
+                return;
+            }
+            sprites.init(
+                deviceProfile,
+                device,
+                memoryBudget,
+                MAX_FRAMES_IN_FLIGHT,
+                spriteSpv,
+                sceneFormat()
+            );
+            state.spritesAvailable = true;
+        },
+        {postProcessTask, readSpriteShader}
+    );
+    // after the textures, they share the transfer command pool
+    startup.add(
+        "world streaming",
+        [&]() {
+            if (worldSpv.empty()) {
+                std::println("World streaming disabled: build shaders/world.spv with shaders/compile.sh");
+                return;
+            }
+            if (!worldFileReady) {
+                return;
+            }
+            world.init(
+                deviceProfile,
+                device,
+                memoryBudget,
+                scheduler,
+                MAX_FRAMES_IN_FLIGHT,
+                worldSpv,
+                sceneFormat(),
+                WORLD_FILE
+            );
+            state.worldAvailable = true;
+            state.worldSettings = world.settings;
+        },
+        {texturesTask, postProcessTask, readWorldShader, worldAssets}
+    );
+    startup.add(
+        "frames",
+        [&]() {
+            createFrames(commandPool, frames, device, scheduler.family(QueueType::eGraphics));
+            staticScene.init(device, scheduler.family(QueueType::eGraphics), MAX_FRAMES_IN_FLIGHT);
+        },
+        {createDevice}
+    );
+    startup.add(
+        "imgui backend",
+        [&]() { initImgui(); },
+        {createSwapChainTask, readImguiShaders, fontAtlas}
+    );
 
-    initImgui();
+    startup.run();
+    std::print("{}", startup.report());
+    // Cheapest to lose first: idle capture buffers, then world chunks (read
+    // back in when needed), then the finest texture levels (gone for good).
+    // Each only goes as far as the ones before it fell short.
+    memoryBudget.addPressureCallback([this](const MemoryBudget::Pressure& pressure) {
+        vk::DeviceSize captureBytes = capture.trim();
+        vk::DeviceSize worldBytes = 0;
+        vk::DeviceSize textureBytes = 0;
+        if (captureBytes < pressure.bytesOver) {
+            worldBytes = world.trim(pressure.heap, pressure.bytesOver - captureBytes);
+        }
+        if (captureBytes + worldBytes < pressure.bytesOver) {
+            textureBytes = textureStreamer.trim(pressure.heap, pressure.bytesOver - captureBytes - worldBytes);
+        }
+        steadyFrames = 0;
+        std::println(
+            "Memory heap {} at {} of {} MiB, freed {} MiB (capture {}, world {}, textures {})",
+            pressure.heap,
+            pressure.usage >> 20,
+            pressure.budget >> 20,
+            (captureBytes + worldBytes + textureBytes) >> 20,
+            captureBytes >> 20,
+            worldBytes >> 20,
+            textureBytes >> 20
+        );
+    });
+    if (!options.captureDir.empty()) {
+        capture.start(options.captureDir, options.captureFormat, options.frameLimit);
+    }
+    if (options.assertNoAllocations && !alloc_counter::ENABLED) {
+        std::println("--assert-no-alloc has no effect, allocations are only counted in debug builds");
+    }
     state.lastRenderTimestamp = getTimestampMs();
 }
 
-void VulkanApp::initImgui() {
+void VulkanApp::initImguiStyle(float scale, float density) {
     ImGuiIO* imguiIo = &ImGui::GetIO();
     imguiIo->ConfigFlags |= ImGuiConfigFlags_IsSRGB;
     imguiIo->IniFilename = NULL;
 
-    // font
+    // font, fontData was read during startup
     ImFontConfig fontcfg;
+    fontcfg.FontDataOwnedByAtlas = false;
     fontcfg.OversampleH = 2;
     fontcfg.OversampleV = 2;
     fontcfg.PixelSnapH = true;
     fontcfg.PixelSnapV = true;
     fontcfg.RasterizerDensity = 0.86f;
-    imguiIo->Fonts->AddFontFromFileTTF(
-        "assets/fonts/IBMPlex/IBMPlexSans-Regular.ttf",
-        16.f,
+    fontcfg.SizePixels = 16.f;
+    // serve previously rasterized glyphs from disk instead of stb_truetype
+    fontCache.open(fontData, fontcfg);
+    fontcfg.FontLoader = fontCache.loader();
+    ImFont* font = imguiIo->Fonts->AddFontFromMemoryTTF(
+        fontData.data(),
+        static_cast<int>(fontData.size()),
+        fontcfg.SizePixels,
         &fontcfg
     );
 
@@ -741,27 +1610,46 @@ void VulkanApp::initImgui() {
     style->FrameRounding = 5.f;
     style->WindowPadding = {10, 5};
     style->FramePadding = {5, 2};
-    float scale = windowApp->getScale();
 
     if (scale > 1) {
         style->FontScaleDpi = scale;
     }
     ImGui::StyleColorsDark();
 
+    // Glyphs are baked lazily on first use; rasterize ASCII at the size and
+    // density the first frame will ask for so it isn't done on the render path.
+    ImFontBaked* baked = font->GetFontBaked(16.f * style->FontScaleDpi, density);
+    for (ImWchar c = 0x20; c < 0x7F; c++) {
+        baked->FindGlyph(c);
+    }
+    const auto& stats = fontCache.getStats();
+    std::println(
+        "Font atlas: {} glyphs from cache, {} rasterized ({:.2f} ms)",
+        stats.hits,
+        stats.misses,
+        stats.missMs
+    );
+    fontCache.save();
+}
+
+void VulkanApp::initImgui() {
     vk::PipelineRenderingCreateInfoKHR pipelineInfo{
         .colorAttachmentCount = 1,
-        .pColorAttachmentFormats = &swapChain.surfaceFormat.format,
+        .pColorAttachmentFormats = &swapChain.uiFormat,
     };
 
-    auto vert = readFile("shaders/imgui/vert.spv");
+    // Through a UNORM view ImGui's built-in shaders already write what we want.
+    // Otherwise the patched shaders linearize the sRGB-space UI colors so the
+    // sRGB attachment encodes them back.
+    bool patchedShaders = swapChain.uiFormat == swapChain.surfaceFormat.format;
+    std::println("ImGui draws through {} view", patchedShaders ? "the sRGB" : "a UNORM");
     vk::ShaderModuleCreateInfo vertInfo{
-        .codeSize = getVectorSize(vert),
-        .pCode = reinterpret_cast<uint32_t*>(vert.data())
+        .codeSize = getVectorSize(imguiVertSpv),
+        .pCode = reinterpret_cast<uint32_t*>(imguiVertSpv.data())
     };
-    auto frag = readFile("shaders/imgui/frag.spv");
     vk::ShaderModuleCreateInfo fragInfo{
-        .codeSize = getVectorSize(frag),
-        .pCode = reinterpret_cast<uint32_t*>(frag.data())
+        .codeSize = getVectorSize(imguiFragSpv),
+        .pCode = reinterpret_cast<uint32_t*>(imguiFragSpv.data())
     };
 
     ImGui_ImplVulkan_InitInfo initInfo{
@@ -769,8 +1657,8 @@ void VulkanApp::initImgui() {
         .Instance = *instance,
         .PhysicalDevice = *physicalDevice,
         .Device = *device,
-        .QueueFamily = queueFamilyIndex,
-        .Queue = *queue,
+        .QueueFamily = scheduler.family(QueueType::eGraphics),
+        .Queue = *scheduler.queue(QueueType::eGraphics),
         .DescriptorPoolSize = 1 << 4,
         .MinImageCount = minImageCount,
         .ImageCount = static_cast<uint32_t>(swapChain.images.size()),
@@ -778,9 +1666,12 @@ void VulkanApp::initImgui() {
             .PipelineRenderingCreateInfo = *pipelineInfo,
         },
         .UseDynamicRendering = true,
-        .CustomShaderVertCreateInfo = vertInfo,
-        .CustomShaderFragCreateInfo = fragInfo
     };
+    // a zero sType selects the backend's built-in shaders
+    if (patchedShaders) {
+        initInfo.CustomShaderVertCreateInfo = vertInfo;
+        initInfo.CustomShaderFragCreateInfo = fragInfo;
+    }
 
     const static auto s_instance = &instance;
     ImGui_ImplVulkan_LoadFunctions(
@@ -796,39 +1687,293 @@ void VulkanApp::initImgui() {
 };
 
 void VulkanApp::recreateSwapChain() {
+    TRACE_FUNCTION();
+    // the surface queries and the new swap chain's image list allocate; the
+    // frames after it still rebuild extent-sized targets, so warm up again
+    alloc_counter::Exempt exempt;
+    steadyFrames = 0;
     Size2D<uint32_t> size = windowApp->getFrameSize();
     device.waitIdle();
     swapChain.reset();
+    pacer.reset();
     minImageCount = chooseSwapMinImageCount(physicalDevice.getSurfaceCapabilitiesKHR(surface));
     swapChain = createSwapChain(
-        physicalDevice, device, surface, minImageCount, {size.width, size.height}
+        physicalDevice,
+        device,
+        surface,
+        minImageCount,
+        {size.width, size.height},
+        mutableSwapchain
     );
+    sceneColor = chooseSceneColor(deviceProfile, swapChain.surfaceFormat.format);
+}
+
+/*
+ * Animate a share of the synthetic scene graph and write the world transforms
+ * into a host array. The scene shader draws a fixed triangle, so nothing on
+ * the GPU would read a per-instance buffer; this only measures the update.
+ */
+void VulkanApp::updateTransforms(float seconds) {
+    TRACE_FUNCTION();
+    auto count = static_cast<uint32_t>(std::max(state.transformNodes, 1));
+    if (transforms.nodeCount() != count) {
+        buildTransformTree(transforms, count);
+        instanceTransforms.resize(count);
+        instanceTarget = {.instances = instanceTransforms.data()};
+        animatedNode = 0;
+        steadyFrames = 0;
+    }
+
+    // rotate nodes spread over the tree, a different set every frame
+    constexpr uint64_t STRIDE = 7'368'787;
+    auto changed = static_cast<uint32_t>(count * state.transformChangedPercent / 100.f);
+    float angle = seconds * (2.f * std::numbers::pi_v<float> / 10.f);
+    glm::quat rotation(std::cos(0.5f * angle), 0.f, std::sin(0.5f * angle), 0.f);
+    for (uint32_t i = 0; i < changed; i++) {
+        transforms.setRotation(animatedNode, rotation);
+        animatedNode = static_cast<uint32_t>((animatedNode + STRIDE) % count);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    state.transformStats = state.transformIncremental ? transforms.update(instanceTarget)
+                                                      : transforms.updateAll(instanceTarget);
+    state.transformUs = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - start
+    ).count();
+}
+
+VulkanApp::UiTexture::UiTexture(UiTexture&& other) noexcept
+    : set(std::exchange(other.set, VK_NULL_HANDLE)) {}
+
+VulkanApp::UiTexture& VulkanApp::UiTexture::operator=(UiTexture&& other) noexcept {
+    if (this != &other) {
+        this->~UiTexture();
+        set = std::exchange(other.set, VK_NULL_HANDLE);
+    }
+    return *this;
+}
+
+VulkanApp::UiTexture::~UiTexture() {
+    if (set != VK_NULL_HANDLE) {
+        ImGui_ImplVulkan_RemoveTexture(set);
+    }
+}
+
+void VulkanApp::loadTextures() {
+    textureHandles[0] = textureStreamer.load(STREAMED_TEXTURE);
+    textureHandles[1] = textureStreamer.load(BASE_TEXTURE);
+}
+
+/*
+ * Stream this frame's share of texture data and point the UI at the newest
+ * views. Replaced ImGui descriptors are retired until the frames that drew
+ * with them are done; the UI of this frame isn't built yet.
+ */
+void VulkanApp::updateTextures() {
+    uint64_t lastSubmit = scheduler.submittedValue(QueueType::eGraphics);
+    if (state.reloadTextures) {
+        state.reloadTextures = false;
+        for (auto& texture : uiTextures) {
+            scheduler.retire(QueueType::eGraphics, lastSubmit, std::move(texture));
+        }
+        textureStreamer.clear();
+        loadTextures();
+        for (auto& texture : state.textures) {
+            texture.info = {};
+            texture.uiTexture = 0;
+        }
+    }
+    textureStreamer.settings.bytesPerFrame = vk::DeviceSize(state.textureMiBPerFrame) << 20;
+    textureStreamer.beginFrame(frameIndex);
+    for (size_t i = 0; i < textureHandles.size(); i++) {
+        const auto& info = textureStreamer.info(textureHandles[i]);
+        auto& shown = state.textures[i];
+        if (info.version != shown.info.version) {
+            if (uiTextures[i].set != VK_NULL_HANDLE) {
+                scheduler.retire(QueueType::eGraphics, lastSubmit, std::move(uiTextures[i]));
+            }
+            uiTextures[i] = UiTexture(ImGui_ImplVulkan_AddTexture(
+                textureStreamer.getSampler(), info.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+            ));
+            shown.uiTexture = (ImTextureID)uiTextures[i].set;
+        }
+        shown.info = info;
+        // slot 0 is the renderer's white texture
+        sprites.setTexture(static_cast<uint16_t>(i + 1), info.view);
+    }
+    state.textureStats = textureStreamer.getStats();
+    if (state.textureStats.streaming > 0) {
+        // new views and descriptors while levels arrive
+        steadyFrames = 0;
+    }
+}
+
+// Move the camera along its path and stream the chunks around it.
+void VulkanApp::updateWorld() {
+    state.worldDistance = std::fmod(
+        state.worldDistance + state.worldSpeed * state.frameTime / 1000.f, WORLD_PATH_PERIOD
+    );
+    vk::DeviceSize budgetBytes = state.worldStats.budgetBytes;
+    world.settings = state.worldSettings;
+    world.beginFrame(frameIndex, worldCamera(state.worldDistance, state.worldSpeed));
+    state.worldStats = world.getStats();
+    if (state.worldStats.lastFrameLoads > 0 || state.worldStats.budgetBytes != budgetBytes) {
+        // read requests are allocated, and a new budget means a new pool
+        steadyFrames = 0;
+    }
+}
+
+/*
+ * The scene without CPU culling: `staticCopies` repetitions of the triangle
+ * (or of the state switch stress sequence). Recorded into a cached secondary
+ * buffer unless caching is off, so everything it reads belongs in
+ * StaticSceneKey.
+ */
+void VulkanApp::recordStaticScene(const vk::raii::CommandBuffer& cmd, vk::Extent2D extent) {
+    cmd.bindVertexBuffers(0, *vertexBuffer.buffer, {0});
+    uint32_t draws = state.stateStress ? STATE_STRESS_DRAWS : 1;
+    uint32_t copies = staticSceneKey.copies;
+    if (!state.stateStress) {
+        sceneShaders.bind(cmd, state.raster, extent);
+    }
+    for (uint32_t copy = 0; copy < copies; copy++) {
+        for (uint32_t i = 0; i < draws; i++) {
+            if (state.stateStress) {
+                sceneShaders.bind(cmd, stressRasterState(i), extent);
+            }
+            cmd.draw(3, 1, 0, 0);
+        }
+    }
+}
+
+/*
+ * CPU culling and the sprite scene for one frame. Only touches cullObjects,
+ * culler and simulatedSprites, so it can run on the simulation thread while
+ * the render thread submits and presents the frame before.
+ */
+VulkanApp::SimulationOutput VulkanApp::simulate(const SimulationInput& input) {
+    TRACE_FUNCTION();
+    auto start = std::chrono::steady_clock::now();
+    SimulationOutput output{.input = input};
+    if (input.cull) {
+        if (cullObjects.size() != input.cullObjectCount) {
+            scatterCullObjects(cullObjects, input.cullObjectCount);
+            output.reallocated = true;
+        }
+        culler.setIsa(input.cullIsa);
+        auto cullStart = std::chrono::steady_clock::now();
+        Frustum frustum = orbitFrustum(input.seconds, input.cullExtent);
+        output.visibleObjects = culler.cull(frustum, cullObjects);
+        output.cullUs = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - cullStart
+        ).count();
+        output.cullThreads = culler.threadCount();
+    }
+    simulatedSprites.clear();
+    if (input.sprites) {
+        fillSpriteScene(simulatedSprites, input.spriteCount, input.seconds, input.spriteExtent);
+    }
+    output.simulateUs = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - start
+    ).count();
+    return output;
+}
+
+// The result computed ahead if it was for this work, else simulate() now.
+VulkanApp::SimulationOutput VulkanApp::collectSimulation(const SimulationInput& input) {
+    TRACE_FUNCTION();
+    auto start = std::chrono::steady_clock::now();
+    SimulationOutput output;
+    bool collected = simulation.pending() > 0;
+    bool ahead = false;
+    while (simulation.pending() > 0) {
+        output = simulation.collect();
+        ahead = output.input.sameWork(input);
+    }
+    state.simulationWaitUs = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - start
+    ).count();
+    if (!ahead) {
+        // settings or sizes changed since the guess
+        state.simulationMisses += collected;
+        output = simulate(input);
+    }
+    state.simulationAhead = ahead;
+    state.simulateUs = output.simulateUs;
+    return output;
 }
 
 void VulkanApp::drawFrame() {
+    TRACE_FUNCTION();
     if (windowApp->isMinimized()) {
         this->framebufferResized = true;
+        steadyFrames = 0;
         std::println("Minimized, skip rendering");
         return;
     }
+    // last frame's transient data is dead once we get here
+    state.frameArena = frameArena.stats();
+    frameArena.reset();
     uint64_t timeNow = getTimestampMs();
     state.frameTime = timeNow - state.lastRenderTimestamp;
     state.lastRenderTimestamp = timeNow;
+    TRACE_COUNTER("frame time ms", state.frameTime);
     // Note: inFlightFences, presentCompleteSemaphores, and commandBuffers
     // are indexed by frameIndex, while renderFinishedSemaphores is indexed by imageIndex
     auto& frame = frames[frameIndex];
 
-    vk::Result fenceResult = device.waitForFences(
-        *frame.fences, vk::True, UINT64_MAX
-    );
+    vk::Result fenceResult;
+    {
+        TRACE_ZONE("wait frame fence");
+        fenceResult = device.waitForFences(*frame.fences, vk::True, UINT64_MAX);
+    }
     if (fenceResult != vk::Result::eSuccess) {
         throw std::runtime_error("failed to wait for fence!");
     }
     device.resetFences(*frame.fences);
+    scheduler.poll();
+    state.queueOverlap = scheduler.overlapStats();
+    // the graphics timed scope brackets the whole frame's command buffer
+    state.resolution.update(scheduler.lastScopeMs(QueueType::eGraphics));
+    capture.poll(scheduler.completedValue(QueueType::eGraphics));
+    memoryBudget.setUiBytes(imguiTextureBytes());
+    memoryBudget.update();
+    state.memory = memoryBudget.stats();
+    particles.settings = state.particles;
+    particles.beginFrame(frameIndex, state.frameTime / 1000.f);
+    if (particles.getStats().capacity != state.particleStats.capacity) {
+        // new particle buffers and descriptors
+        steadyFrames = 0;
+    }
+    state.particles = particles.settings;
+    state.particleStats = particles.getStats();
+    if (state.texturesAvailable) {
+        updateTextures();
+    }
+    if (state.world && world.ready()) {
+        updateWorld();
+    }
+    sprites.beginFrame(frameIndex);
+    postProcess.settings = state.post;
+    postProcess.beginFrame(frameIndex, state.frameTime / 1000.f);
+    state.post = postProcess.settings;
+    state.postStats = postProcess.getStats();
+
+    // everything above doesn't depend on input; in low-latency mode input is
+    // sampled only after waiting for the previous present and the deadline
+    pacer.settings = state.pacing;
+    pacer.beginFrame(swapChain.swapChain, scheduler.lastScopeMs(QueueType::eGraphics));
+    windowApp->lateEventPolling = state.pacing.lowLatency;
+    if (state.pacing.lowLatency) {
+        windowApp->pollEvents();
+    }
 
-    auto [result, imageIndex] = swapChain.swapChain.acquireNextImage(
-        UINT64_MAX, *frame.presentComplete, nullptr
-    );
+    auto [result, imageIndex] = [&]() {
+        TRACE_ZONE("acquireNextImage");
+        return swapChain.swapChain.acquireNextImage(
+            UINT64_MAX, *frame.presentComplete, nullptr
+        );
+    }();
 
     if (result == vk::Result::eErrorOutOfDateKHR) {
         recreateSwapChain();
@@ -841,93 +1986,332 @@ void VulkanApp::drawFrame() {
 
     auto& image = swapChain.images[imageIndex];
     frame.cmdBuffer.reset();
-    auto width = static_cast<float>(swapChain.extent.width);
-    auto height = static_cast<float>(swapChain.extent.height);
+
+    state.windowEvents = windowApp->getPolledEvents();
+    buildImgui(state, *windowApp);
+    if (state.requestScreenshot || state.toggleRecording || state.dumpRenderGraph || capture.active()) {
+        // starting a capture, encoding frames and writing files all allocate
+        steadyFrames = 0;
+    }
+    if (state.requestScreenshot) {
+        capture.start("captures/screenshots", FrameCapture::Format::ePng, 1);
+    }
+    if (state.toggleRecording) {
+        if (capture.active()) {
+            capture.stop();
+        }
+        else {
+            capture.start("captures/recording", FrameCapture::Format::eY4m);
+        }
+    }
+
+    sceneShaders.setBackend(
+        state.useShaderObjects ? SceneShaders::Backend::eShaderObject : SceneShaders::Backend::ePipeline
+    );
+    state.sceneShaders = sceneShaders.getStats();
+
+    if (state.transforms) {
+        updateTransforms((timeNow % 60'000) / 1000.f);
+    }
+
+    // declare this frame's passes
+    renderGraph.reset(&frameArena);
+    if (state.texturesAvailable) {
+        textureStreamer.addPasses(renderGraph);
+    }
+    auto target = renderGraph.importImage(
+        "swapchain",
+        {
+            .image = image.image,
+            .view = image.imageView,
+            .format = swapChain.surfaceFormat.format,
+            .extent = swapChain.extent
+        },
+        // contents are discarded; the acquire semaphore is waited on at this stage
+        {.stages = vk::PipelineStageFlagBits2::eColorAttachmentOutput}
+    );
+    auto vertices = renderGraph.importBuffer("triangle vertices", *vertexBuffer.buffer);
+
+    // with dynamic resolution the scene goes to the corner of a full-size
+    // transient target and is upscaled, otherwise it renders to the swapchain
+    // image directly; with post-processing it always goes to an HDR target
+    // and post-processing does the upscaling
+    bool post = postProcess.ready();
+    bool upscale = !post && state.resolution.settings.enabled && sceneColor.format != vk::Format::eUndefined &&
+                   (swapChain.usage & vk::ImageUsageFlagBits::eTransferDst);
+    vk::Extent2D renderExtent = upscale || (post && state.resolution.settings.enabled)
+                                    ? state.resolution.renderExtent(swapChain.extent)
+                                    : swapChain.extent;
+    state.renderExtent = renderExtent;
+    vk::Format sceneFormat = post      ? PostProcess::HDR_FORMAT
+                             : upscale ? sceneColor.format
+                                       : swapChain.surfaceFormat.format;
+    StaticSceneKey sceneKey{
+        .backend = sceneShaders.backend(),
+        .raster = state.raster,
+        .stateStress = state.stateStress,
+        .copies = static_cast<uint32_t>(std::max(state.staticCopies, 1)),
+        .extent = renderExtent,
+        .format = sceneFormat
+    };
+    if (sceneKey != staticSceneKey) {
+        staticSceneKey = sceneKey;
+        staticScene.invalidate();
+    }
+    auto scene = target;
+    if (post) {
+        scene = renderGraph.createImage(
+            "hdr scene",
+            {
+                .format = PostProcess::HDR_FORMAT,
+                .extent = swapChain.extent,
+                .usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled |
+                         vk::ImageUsageFlagBits::eTransferSrc
+            }
+        );
+    }
+    else if (upscale) {
+        scene = renderGraph.createImage(
+            "scene color",
+            {
+                .format = sceneColor.format,
+                .extent = swapChain.extent,
+                .usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc
+            }
+        );
+    }
+
+    SimulationInput simulationInput{
+        .seconds = (timeNow % 60'000) / 1000.f,
+        .cull = state.cpuCulling,
+        .cullObjectCount = static_cast<uint32_t>(std::max(state.cullObjectCount, 0)),
+        .cullIsa = state.cullIsa,
+        .cullExtent = swapChain.extent,
+        .sprites = state.sprites && sprites.ready(),
+        .spriteCount = static_cast<uint32_t>(std::max(state.spriteCount, 1)),
+        .spriteExtent = renderExtent
+    };
+    SimulationOutput simulated = collectSimulation(simulationInput);
+    if (simulated.reallocated) {
+        steadyFrames = 0;
+    }
+    std::span<const uint32_t> visibleObjects = simulated.visibleObjects;
+    if (state.cpuCulling) {
+        state.cullUs = simulated.cullUs;
+        state.culledVisible = static_cast<uint32_t>(visibleObjects.size());
+        state.cullThreads = simulated.cullThreads;
+    }
+
+    renderGraph
+        .addPass(
+            "triangle",
+            [this, scene, sceneFormat, renderExtent, visibleObjects](const vk::raii::CommandBuffer& cmd) {
+                auto start = std::chrono::steady_clock::now();
+                vk::ClearValue clearColor = {state.clearColor.srgbToLinear()};
+                // culled draws change every frame, everything else is static
+                bool cached = state.cacheStaticScene && !state.cpuCulling;
+                beginColorRendering(
+                    cmd,
+                    renderGraph.image(scene).view,
+                    renderExtent,
+                    vk::AttachmentLoadOp::eClear,
+                    clearColor,
+                    cached ? vk::RenderingFlagBits::eContentsSecondaryCommandBuffers : vk::RenderingFlags{}
+                );
+                if (state.cpuCulling) {
+                    // one draw per visible object, the instance index carries the object index
+                    cmd.bindVertexBuffers(0, *vertexBuffer.buffer, {0});
+                    sceneShaders.bind(cmd, state.raster, renderExtent);
+                    size_t draws = std::min<size_t>(visibleObjects.size(), CULLED_DRAW_LIMIT);
+                    for (uint32_t object : visibleObjects.first(draws)) {
+                        cmd.draw(3, 1, 0, object);
+                    }
+                }
+                else if (cached) {
+                    cmd.executeCommands(staticScene.get(
+                        frameIndex,
+                        sceneFormat,
+                        [this, renderExtent](const vk::raii::CommandBuffer& secondary) {
+                            recordStaticScene(secondary, renderExtent);
+                        }
+                    ));
+                }
+                else {
+                    recordStaticScene(cmd, renderExtent);
+                }
+                cmd.endRendering();
+                state.sceneRecordUs = std::chrono::duration<double, std::micro>(
+                    std::chrono::steady_clock::now() - start
+                ).count();
+            }
+        )
+        .use(scene, ResourceUsage::eColorAttachmentWrite)
+        .use(vertices, ResourceUsage::eVertexBuffer);
+    bool drawWorld = state.world && world.ready();
+    if (drawWorld) {
+        world.addPass(renderGraph, scene, renderExtent);
+        state.worldStats = world.getStats();
+    }
+    if (particles.settings.enabled) {
+        particles.addPasses(renderGraph, scene, renderExtent);
+    }
+    if (state.sprites && sprites.ready()) {
+        sprites.batch.simd = state.spriteSimd;
+        // beginFrame() emptied the batch, it goes back to be refilled
+        sprites.batch.swapSprites(simulatedSprites);
+        sprites.addPass(renderGraph, scene, renderExtent);
+    }
+    if (sprites.getStats().capacity != state.spriteStats.capacity ||
+        sprites.getStats().batch.spriteCount != state.spriteStats.batch.spriteCount) {
+        // the batch or the frame's vertex and index buffers grew
+        steadyFrames = 0;
+    }
+    state.spriteStats = sprites.getStats();
+
+    if (post) {
+        postProcess.addPasses(renderGraph, scene, renderExtent, target, swapChain.extent);
+    }
+    if (upscale) {
+        renderGraph
+            .addPass(
+                "upscale",
+                [this, &image, scene, renderExtent](const vk::raii::CommandBuffer& cmd) {
+                    auto corner = [](vk::Extent2D extent) {
+                        return vk::Offset3D{
+                            static_cast<int32_t>(extent.width), static_cast<int32_t>(extent.height), 1
+                        };
+                    };
+                    vk::ImageBlit2 region{
+                        .srcSubresource = {vk::ImageAspectFlagBits::eColor, 0, 0, 1},
+                        .srcOffsets = std::array{vk::Offset3D{0, 0, 0}, corner(renderExtent)},
+                        .dstSubresource = {vk::ImageAspectFlagBits::eColor, 0, 0, 1},
+                        .dstOffsets = std::array{vk::Offset3D{0, 0, 0}, corner(swapChain.extent)}
+                    };
+                    cmd.blitImage2({
+                        .srcImage = renderGraph.image(scene).image,
+                        .srcImageLayout = vk::ImageLayout::eTransferSrcOptimal,
+                        .dstImage = image.image,
+                        .dstImageLayout = vk::ImageLayout::eTransferDstOptimal,
+                        .regionCount = 1,
+                        .pRegions = &region,
+                        .filter = sceneColor.filter
+                    });
+                }
+            )
+            .use(scene, ResourceUsage::eTransferSrc)
+            .use(target, ResourceUsage::eTransferDst);
+    }
+
+    renderGraph
+        .addPass(
+            "imgui",
+            [this, &image](const vk::raii::CommandBuffer& cmd) {
+                beginColorRendering(
+                    cmd, image.uiView(), swapChain.extent, vk::AttachmentLoadOp::eLoad
+                );
+                ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), *cmd);
+                cmd.endRendering();
+            }
+        )
+        .use(target, ResourceUsage::eColorAttachmentReadWrite);
+
+    // copy the final image (UI included) out for FrameCapture
+    bool canCapture = static_cast<bool>(swapChain.usage & vk::ImageUsageFlagBits::eTransferSrc);
+    FrameCapture::Slot* captureSlot =
+        canCapture ? capture.acquire(swapChain.extent, swapChain.surfaceFormat.format) : nullptr;
+    if (captureSlot != nullptr) {
+        auto readback = renderGraph.importBuffer("capture readback", *captureSlot->buffer);
+        renderGraph
+            .addPass(
+                "capture",
+                [this, &image, captureSlot](const vk::raii::CommandBuffer& cmd) {
+                    capture.recordCopy(cmd, *captureSlot, image.image);
+                }
+            )
+            .use(target, ResourceUsage::eTransferSrc)
+            .use(readback, ResourceUsage::eTransferDst);
+        renderGraph.exportResource(readback, ResourceUsage::eHostRead);
+    }
+    state.recording = capture.active();
+    state.captureStats = capture.stats();
+
+    renderGraph.exportResource(target, ResourceUsage::ePresent);
+    renderGraph.compile();
+
+    if (state.dumpRenderGraph) {
+        state.dumpRenderGraph = false;
+        std::print("{}", renderGraph.dump());
+        std::ofstream("render_graph.dot") << renderGraph.toDot();
+        std::println("Render graph written to render_graph.dot");
+    }
 
     // record commandBuffer
     {
+        TRACE_ZONE("record commands");
         frame.cmdBuffer.begin({});
-        // Before starting rendering, transition the swapchain image to
-        // COLOR_ATTACHMENT_OPTIMAL
-        transitionImageLayout(
-            image.image,
-            frame.cmdBuffer,
-            vk::ImageLayout::eUndefined,
-            vk::ImageLayout::eColorAttachmentOptimal,
-            {},  // srcAccessMask (no need to wait for previous operations)
-            vk::AccessFlagBits2::eColorAttachmentWrite,
-            vk::PipelineStageFlagBits2::eColorAttachmentOutput,
-            vk::PipelineStageFlagBits2::eColorAttachmentOutput
-        );
-        vk::ClearValue clearColor = {state.clearColor.srgbToLinear()};
-        vk::RenderingAttachmentInfo attachmentInfo = vk::RenderingAttachmentInfo{
-            .imageView = image.imageView,
-            .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
-            .loadOp = vk::AttachmentLoadOp::eClear,
-            .storeOp = vk::AttachmentStoreOp::eStore,
-            .clearValue = clearColor
-        };
-        vk::RenderingInfo renderingInfo = {
-            .renderArea = {
-                .offset = {0, 0},
-                .extent = swapChain.extent
-            },
-            .layerCount = 1,
-            .colorAttachmentCount = 1,
-            .pColorAttachments = &attachmentInfo
-        };
-        frame.cmdBuffer.beginRendering(renderingInfo);
-        frame.cmdBuffer.bindPipeline(
-            vk::PipelineBindPoint::eGraphics,
-            *graphicsPipeline
-        );
-        frame.cmdBuffer.setViewport(
-            0, vk::Viewport(0.0f, 0.0f, width, height, 0.0f, 1.0f)
-        );
-        frame.cmdBuffer.setScissor(
-            0, vk::Rect2D(vk::Offset2D(0, 0), swapChain.extent)
-        );
-        frame.cmdBuffer.bindVertexBuffers(0, *vertexBuffer.buffer, {0});
-        frame.cmdBuffer.draw(3, 1, 0, 0);
-        drawImgui(frame.cmdBuffer, state);
-        frame.cmdBuffer.endRendering();
-        // After rendering, transition the swapchain image to PRESENT_SRC
-        transitionImageLayout(
-            image.image,
-            frame.cmdBuffer,
-            vk::ImageLayout::eColorAttachmentOptimal,
-            vk::ImageLayout::ePresentSrcKHR,
-            vk::AccessFlagBits2::eColorAttachmentWrite,
-            {},
-            vk::PipelineStageFlagBits2::eColorAttachmentOutput,
-            vk::PipelineStageFlagBits2::eBottomOfPipe
-        );
+        uint32_t timedScope = scheduler.beginTimedScope(QueueType::eGraphics, frame.cmdBuffer);
+        scheduler.recordPendingAcquires(QueueType::eGraphics, frame.cmdBuffer);
+        renderGraph.execute(frame.cmdBuffer);
+        scheduler.endTimedScope(QueueType::eGraphics, frame.cmdBuffer, timedScope);
         frame.cmdBuffer.end();
     }
+    // nothing recorded refers to the culling results or sprites any more:
+    // start on the next frame's, guessing it has the same settings and sizes
+    // and comes one frame time later
+    if (state.pipelinedSimulation && (simulationInput.cull || simulationInput.sprites)) {
+        SimulationInput next = simulationInput;
+        next.seconds = ((timeNow + static_cast<uint64_t>(state.frameTime)) % 60'000) / 1000.f;
+        simulation.submit(next);
+    }
+    if (sceneShaders.getStats().pipelineCount != state.sceneShaders.pipelineCount) {
+        // a state permutation was compiled during recording
+        steadyFrames = 0;
+    }
+    state.staticSceneStats = staticScene.getStats();
+    if (renderTargets.getStats().rebuildCount != state.renderTargetStats.rebuildCount) {
+        // the frame asked for different transient images
+        steadyFrames = 0;
+    }
+    state.renderTargetStats = renderTargets.getStats();
 
-    vk::PipelineStageFlags waitDestinationStageMask(
-        vk::PipelineStageFlagBits::eColorAttachmentOutput
-    );
-    const vk::SubmitInfo submitInfo{
-        .waitSemaphoreCount = 1,
-        .pWaitSemaphores = &*frame.presentComplete,
-        .pWaitDstStageMask = &waitDestinationStageMask,
-        .commandBufferCount = 1,
-        .pCommandBuffers = &*frame.cmdBuffer,
-        .signalSemaphoreCount = 1,
-        .pSignalSemaphores = &*image.renderComplete,
+    const vk::SemaphoreSubmitInfo acquireWait{
+        .semaphore = *frame.presentComplete,
+        .stageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput
+    };
+    const vk::SemaphoreSubmitInfo renderSignal{
+        .semaphore = *image.renderComplete,
+        .stageMask = vk::PipelineStageFlagBits2::eAllCommands
     };
-    queue.submit(submitInfo, *frame.fences);
+    vk::CommandBuffer cmdHandle = *frame.cmdBuffer;
+    uint64_t submitValue = scheduler.submit({
+        .queue = QueueType::eGraphics,
+        .commandBuffers = {&cmdHandle, 1},
+        .extraWaits = {&acquireWait, 1},
+        .extraSignals = {&renderSignal, 1},
+        .fence = *frame.fences
+    });
+    capture.submitted(captureSlot, submitValue);
+    if (drawWorld) {
+        world.submitted(submitValue);
+    }
+    uint64_t presentId = pacer.submitted(windowApp->getLastPollTime());
+    state.pacingStats = pacer.getStats();
+    if (options.frameLimit > 0 && ++framesRendered >= options.frameLimit) {
+        windowApp->requestClose();
+    }
 
     try {
+        const vk::PresentIdKHR presentIdInfo{.swapchainCount = 1, .pPresentIds = &presentId};
         const vk::PresentInfoKHR presentInfoKHR{
+            .pNext = presentId != 0 ? &presentIdInfo : nullptr,
             .waitSemaphoreCount = 1,
             .pWaitSemaphores = &*image.renderComplete,
             .swapchainCount = 1,
             .pSwapchains = &(*swapChain.swapChain),
             .pImageIndices = &imageIndex
         };
-        result = queue.presentKHR(presentInfoKHR);
+        TRACE_ZONE("present");
+        result = scheduler.queue(QueueType::eGraphics).presentKHR(presentInfoKHR);
         if (result == vk::Result::eSuboptimalKHR || framebufferResized) {
             framebufferResized = false;
             recreateSwapChain();
@@ -950,17 +2334,47 @@ void VulkanApp::drawFrame() {
     frameIndex %= MAX_FRAMES_IN_FLIGHT;
 }
 
-VulkanApp::VulkanApp(std::unique_ptr<WindowApp>&& window)
-    : windowApp(std::move(window)) {
+VulkanApp::VulkanApp(std::unique_ptr<WindowApp>&& window, Options options)
+    : windowApp(std::move(window)), options(std::move(options)) {
     init();
 }
 
+/*
+ * After a warm-up (containers reaching their steady capacity, the frame arena
+ * growing to its peak) a frame without resizes, captures or other events
+ * must not touch the heap. recreateSwapChain() is exempt outright, so a
+ * resize never counts against the frame that handles it.
+ */
+void VulkanApp::checkFrameAllocations(alloc_counter::Counts frame) {
+    constexpr uint32_t WARMUP_FRAMES = 120;
+    state.frameAllocations = frame;
+    TRACE_COUNTER("heap allocations", frame.allocations);
+    if (++steadyFrames <= WARMUP_FRAMES || frame.allocations == 0 || !options.assertNoAllocations) {
+        return;
+    }
+    throw std::runtime_error(std::format(
+        "steady-state frame made {} heap allocations ({} bytes)",
+        frame.allocations,
+        frame.bytes
+    ));
+}
+
 void VulkanApp::run() {
     windowApp->cleanupCallBack =
         [this]() { this->device.waitIdle(); };
     windowApp->resizeCallBack =
         [this](int, int) { this->framebufferResized = true; };
-    windowApp->drawFrameCallBack =
-        [this]() { this->drawFrame(); };
+    windowApp->drawFrameCallBack = [this]() {
+        auto before = alloc_counter::threadCounts();
+        this->drawFrame();
+        checkFrameAllocations(alloc_counter::threadCounts() - before);
+    };
+    simulation.start("simulation", [this](const SimulationInput& input) { return simulate(input); });
+    // drawFrame() runs on the render thread, this one handles window events
     windowApp->run();
+    simulation.stop();
+    // the device is idle now, hand the last captured frames to the writer
+    capture.poll(scheduler.completedValue(QueueType::eGraphics));
+    // keep glyphs baked at runtime (other sizes / DPI scales) for next launch
+    fontCache.save();
 }
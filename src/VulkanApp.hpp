@@ -5,6 +5,8 @@
 #include <array>
 #include <cstdint>
 #include <memory>
+#include <span>
+#include <string>
 #include <vector>
 
 // vulkan-hpp headers
@@ -12,6 +14,28 @@
 #include <vulkan/vulkan_raii.hpp>
 #include <vulkan/vulkan_structs.hpp>
 
+#include "AllocationCounter.hpp"
+#include "ChunkStreamer.hpp"
+#include "CommandCache.hpp"
+#include "DeviceProfile.hpp"
+#include "DynamicResolution.hpp"
+#include "FrameArena.hpp"
+#include "FrameCapture.hpp"
+#include "FramePacer.hpp"
+#include "FontCache.hpp"
+#include "FrustumCulling.hpp"
+#include "MemoryBudget.hpp"
+#include "ParticleSystem.hpp"
+#include "PipelineThread.hpp"
+#include "PostProcess.hpp"
+#include "QueueScheduler.hpp"
+#include "RenderGraph.hpp"
+#include "RenderTargetPool.hpp"
+#include "SceneShaders.hpp"
+#include "SpriteBatch.hpp"
+#include "SpriteRenderer.hpp"
+#include "TextureStreamer.hpp"
+#include "TransformHierarchy.hpp"
 #include "WindowApp.hpp"
 #include "utils.hpp"
 
@@ -29,21 +53,52 @@ inline const std::vector<const char*> requiredDeviceExtension = {
     vk::KHRCreateRenderpass2ExtensionName,
     vk::KHRDynamicRenderingExtensionName
 };
+// enabled when available, see createLogicalDeviceAndQueueIndex()
+inline const std::vector<const char*> optionalDeviceExtension = {
+    vk::KHRSwapchainMutableFormatExtensionName,
+    vk::EXTMemoryBudgetExtensionName,
+    vk::EXTShaderObjectExtensionName,
+    vk::KHRPresentIdExtensionName,
+    vk::KHRPresentWaitExtensionName,
+    vk::EXTCalibratedTimestampsExtensionName
+};
 
 class WindowApp;
 
 class VulkanApp {
 public:
+    struct Options {
+        // device index or name substring, see selectDeviceProfile()
+        std::string device;
+        // draw the UI through a UNORM view of the sRGB swapchain when supported
+        bool mutableSwapchain = true;
+        // no window system: GLFW's null platform plus VK_EXT_headless_surface
+        bool headless = false;
+        // exit after this many frames, 0 runs until the window closes
+        uint32_t frameLimit = 0;
+        // capture from the first frame (frameLimit frames, or until exit)
+        std::string captureDir;
+        FrameCapture::Format captureFormat = FrameCapture::Format::ePng;
+        // throw if a steady-state frame allocates (needs the debug allocation counter)
+        bool assertNoAllocations = false;
+    };
     struct SurfaceImages {
         vk::Image image;
         vk::raii::ImageView imageView = nullptr;
-        // vk::raii::ImageView imageViewNorm;
+        // UNORM view of a mutable-format swapchain image, null otherwise
+        vk::raii::ImageView imageViewNorm = nullptr;
         vk::raii::Semaphore renderComplete = nullptr;
+
+        vk::ImageView uiView() const {
+            return imageViewNorm != nullptr ? *imageViewNorm : *imageView;
+        }
     };
     struct SwapChain {
         vk::raii::SwapchainKHR swapChain = nullptr;
         vk::SurfaceFormatKHR surfaceFormat;
         vk::Extent2D extent;
+        vk::ImageUsageFlags usage;
+        vk::Format uiFormat;  // format of SurfaceImages::uiView()
         std::vector<SurfaceImages> images;
         void reset() {
             swapChain = nullptr;
@@ -51,50 +106,230 @@ public:
             images.clear();
         }
     };
+    // pooled offscreen target the scene renders into before being upscaled
+    struct SceneColor {
+        vk::Format format = vk::Format::eUndefined;  // eUndefined: can't be blitted
+        vk::Filter filter = vk::Filter::eLinear;     // for the upscaling blit
+    };
     struct SimpleBuffer {
         vk::raii::Buffer buffer = nullptr;
-        vk::raii::DeviceMemory memory = nullptr;
+        DeviceAllocation memory = nullptr;
     };
     struct Frame {
         vk::raii::CommandBuffer cmdBuffer = nullptr;
         vk::raii::Semaphore presentComplete = nullptr;
         vk::raii::Fence fences = nullptr;
     };
+    // ImGui descriptor of a streamed texture, removed from the backend when destroyed
+    struct UiTexture {
+        VkDescriptorSet set = VK_NULL_HANDLE;
+
+        UiTexture() = default;
+        explicit UiTexture(VkDescriptorSet set) : set(set) {}
+        UiTexture(UiTexture&& other) noexcept;
+        UiTexture& operator=(UiTexture&& other) noexcept;
+        ~UiTexture();
+        DISABLE_COPY(UiTexture)
+    };
+    // what the cached static scene commands were recorded for
+    struct StaticSceneKey {
+        SceneShaders::Backend backend = SceneShaders::Backend::ePipeline;
+        RasterState raster;
+        bool stateStress = false;
+        uint32_t copies = 0;
+        vk::Extent2D extent;
+        vk::Format format = vk::Format::eUndefined;
+
+        bool operator==(const StaticSceneKey&) const = default;
+    };
+    // the frame's CPU work that doesn't touch Vulkan, see simulate()
+    struct SimulationInput {
+        float seconds = 0;
+        bool cull = false;
+        uint32_t cullObjectCount = 0;
+        FrustumCuller::Isa cullIsa = FrustumCuller::Isa::eScalar;
+        vk::Extent2D cullExtent;
+        bool sprites = false;
+        uint32_t spriteCount = 0;
+        vk::Extent2D spriteExtent;
+
+        bool operator==(const SimulationInput&) const = default;
+        // the same work apart from the time
+        bool sameWork(const SimulationInput& other) const {
+            SimulationInput retimed = *this;
+            retimed.seconds = other.seconds;
+            return retimed == other;
+        }
+    };
+    struct SimulationOutput {
+        SimulationInput input;
+        // into the culler, valid until the next simulate()
+        std::span<const uint32_t> visibleObjects;
+        double cullUs = 0;
+        uint32_t cullThreads = 0;
+        bool reallocated = false;  // new cull objects were scattered
+        double simulateUs = 0;
+    };
+    struct StreamedTexture {
+        const char* name;
+        TextureStreamer::TextureInfo info;
+        uint64_t uiTexture = 0;  // ImTextureID, 0 until the first level is in
+    };
     struct AppState {
         RGBAColor clearColor{0.45f, 0.53f, 0.65f,1.f};
         bool showDemoWindow = false;
+        bool dumpRenderGraph = false;
+        bool uiStress = false;
+        bool requestScreenshot = false;
+        bool toggleRecording = false;
+        bool recording = false;
+        FrameCapture::Stats captureStats;
         uint64_t lastRenderTimestamp;
         float frameTime;
+        QueueScheduler::OverlapStats queueOverlap;
+        FramePacer::Settings pacing;
+        FramePacer::Stats pacingStats;
+        DynamicResolution resolution;
+        vk::Extent2D renderExtent;
+        MemoryBudget::Stats memory;
+        RasterState raster;
+        bool shaderObjectsSupported = false;
+        bool useShaderObjects = false;
+        bool wireframeSupported = false;
+        bool stateStress = false;
+        double sceneRecordUs = 0;
+        bool cacheStaticScene = true;
+        int staticCopies = 1;
+        CommandCache::Stats staticSceneStats;
+        RenderTargetPool::Stats renderTargetStats;
+        SceneShaders::Stats sceneShaders;
+        alloc_counter::Counts frameAllocations;
+        FrameArena::Stats frameArena;
+        bool particlesAvailable = false;
+        ParticleSystem::Settings particles;
+        ParticleSystem::Stats particleStats;
+        bool spritesAvailable = false;
+        bool sprites = false;
+        int spriteCount = 100000;
+        bool spriteSimd = SpriteBatch::simdAvailable();
+        SpriteRenderer::Stats spriteStats;
+        bool postAvailable = false;
+        PostProcess::Settings post;
+        PostProcess::Stats postStats;
+        bool cpuCulling = false;
+        int cullObjectCount = 100000;
+        FrustumCuller::Isa cullIsa = FrustumCuller::bestIsa();
+        uint32_t cullThreads = 0;
+        uint32_t culledVisible = 0;
+        double cullUs = 0;
+        bool pipelinedSimulation = true;
+        bool simulationAhead = false;  // this frame used the result computed during the last one
+        uint64_t simulationMisses = 0;
+        double simulateUs = 0;
+        double simulationWaitUs = 0;
+        uint32_t windowEvents = 0;
+        bool transforms = false;
+        int transformNodes = 100000;
+        float transformChangedPercent = 1.f;
+        bool transformIncremental = true;
+        TransformHierarchy::UpdateStats transformStats;
+        double transformUs = 0;
+        bool texturesAvailable = false;
+        bool reloadTextures = false;
+        int textureMiBPerFrame = 8;
+        TextureStreamer::Stats textureStats;
+        std::array<StreamedTexture, 2> textures{{{"streamed mips"}, {"generated mips"}}};
+        bool worldAvailable = false;
+        bool world = false;
+        ChunkStreamer::Settings worldSettings;
+        ChunkStreamer::Stats worldStats;
+        float worldSpeed = 300.f;  // camera, world units per second
+        float worldDistance = 0;   // travelled along the camera path
     };
 
 private:
     std::unique_ptr<WindowApp> windowApp;
+    Options options;
     vk::raii::Context context;
     vk::raii::Instance instance = nullptr;
     vk::raii::DebugUtilsMessengerEXT debugMessenger = nullptr;
     vk::raii::SurfaceKHR surface = nullptr;
     uint32_t minImageCount;
+    bool mutableSwapchain = false;
+    DeviceProfile deviceProfile;
     vk::raii::PhysicalDevice physicalDevice = nullptr;
     vk::raii::Device device = nullptr;
-    uint32_t queueFamilyIndex = ~0;
-    vk::raii::Queue queue = nullptr;
-    vk::raii::Pipeline graphicsPipeline = nullptr;
+    // before everything that allocates through it
+    MemoryBudget memoryBudget;
+    QueueScheduler scheduler;
+    FrameCapture capture;
+    FramePacer pacer;
+    SceneShaders sceneShaders;
+    ParticleSystem particles;
+    SpriteRenderer sprites;
+    // when ready the scene renders in HDR and reaches the swapchain through it
+    PostProcess postProcess;
     vk::raii::CommandPool commandPool = nullptr;
     std::array<Frame, MAX_FRAMES_IN_FLIGHT> frames;
+    // the scene draws without CPU culling, re-recorded when the key changes
+    CommandCache staticScene;
+    StaticSceneKey staticSceneKey;
     SwapChain swapChain;
+    SceneColor sceneColor;
+    // transient images of the render graph
+    RenderTargetPool renderTargets;
     uint32_t frameIndex = 0;
+    uint64_t framesRendered = 0;
+    // frames since the last resize or other event that legitimately allocates
+    uint32_t steadyFrames = 0;
+    // transient CPU memory for the frame being recorded
+    FrameArena frameArena;
+    RenderGraph renderGraph;
 
     SimpleBuffer vertexBuffer;
     AppState state;
+    // synthetic objects for the CPU culling path
+    SphereBounds cullObjects;
+    FrustumCuller culler;
+    // filled by simulate(), swapped into the sprite renderer's batch
+    SpriteBatch simulatedSprites;
+    // runs simulate() for the next frame while this one is submitted and
+    // presented; after everything it touches so it stops first
+    PipelineThread<SimulationInput, SimulationOutput> simulation;
+    // synthetic scene graph and its world transforms; nothing draws them yet
+    TransformHierarchy transforms;
+    std::vector<InstanceTransform> instanceTransforms;
+    TransformHierarchy::Target instanceTarget;
+    uint32_t animatedNode = 0;
+    TextureStreamer textureStreamer;
+    std::array<TextureStreamer::Handle, 2> textureHandles{};
+    std::array<UiTexture, 2> uiTextures;
+    // terrain chunks streamed from disk around a camera flying over them
+    ChunkStreamer world;
+
+    // must outlive the ImGui backend / font atlas
+    std::vector<char> imguiVertSpv;
+    std::vector<char> imguiFragSpv;
+    std::vector<char> fontData;
+    FontCache fontCache;
 
     bool framebufferResized = false;
     void init();
+    void initImguiStyle(float scale, float density);
     void initImgui();
     void recreateSwapChain();
     void drawFrame();
+    void recordStaticScene(const vk::raii::CommandBuffer& cmd, vk::Extent2D extent);
+    void updateTransforms(float seconds);
+    SimulationOutput simulate(const SimulationInput& input);
+    SimulationOutput collectSimulation(const SimulationInput& input);
+    void loadTextures();
+    void updateTextures();
+    void updateWorld();
+    void checkFrameAllocations(alloc_counter::Counts frame);
 
 public:
-    explicit VulkanApp(std::unique_ptr<WindowApp>&& window);
+    VulkanApp(std::unique_ptr<WindowApp>&& window, Options options);
     void run();
 
     DISABLE_COPY(VulkanApp)
@@ -1,9 +1,14 @@
 #include "WindowApp.hpp"
 
 // std c++
+#include <algorithm>
 #include <cassert>
+#include <cfloat>
+#include <chrono>
+#include <exception>
 #include <functional>
 #include <print>
+#include <thread>
 
 // vulkan
 #include <stdexcept>
@@ -15,18 +20,59 @@
 
 // imgui
 #include <backends/imgui_impl_glfw.h>
+#include <imgui.h>
 
-void WindowApp::resizeCallBackHelper(GLFWwindow* window, int width, int height) {
+// project
+#include "Trace.hpp"
+
+// defined (not static) in imgui_impl_glfw.cpp but left out of its header
+ImGuiKey ImGui_ImplGlfw_KeyToImGuiKey(int keycode, int scancode);
+
+namespace {
+
+static_assert(ImGuiMouseCursor_COUNT <= 16);
+
+// GLFW reports the modifier state from before the event for the modifier
+// keys themselves; the ImGui backend asks glfwGetKey instead, which only
+// works on the main thread
+void addModifierEvents(ImGuiIO& io, int key, int action, int mods) {
+    bool pressed = action == GLFW_PRESS;
+    auto modifier = [&](int bit, int left, int right) {
+        return key == left || key == right ? pressed : (mods & bit) != 0;
+    };
+    io.AddKeyEvent(ImGuiMod_Ctrl, modifier(GLFW_MOD_CONTROL, GLFW_KEY_LEFT_CONTROL, GLFW_KEY_RIGHT_CONTROL));
+    io.AddKeyEvent(ImGuiMod_Shift, modifier(GLFW_MOD_SHIFT, GLFW_KEY_LEFT_SHIFT, GLFW_KEY_RIGHT_SHIFT));
+    io.AddKeyEvent(ImGuiMod_Alt, modifier(GLFW_MOD_ALT, GLFW_KEY_LEFT_ALT, GLFW_KEY_RIGHT_ALT));
+    io.AddKeyEvent(ImGuiMod_Super, modifier(GLFW_MOD_SUPER, GLFW_KEY_LEFT_SUPER, GLFW_KEY_RIGHT_SUPER));
+}
+
+}  // namespace
+
+WindowApp& WindowApp::self(GLFWwindow* window) {
     auto windowPtr = glfwGetWindowUserPointer(window);
     assert(windowPtr != nullptr);
     WindowApp* self = reinterpret_cast<WindowApp*>(windowPtr);
     assert(window == self->window.get());
-    std::println("Resized: {}x{}", width, height);
-    self->resizeCallBack(width, height);
+    return *self;
 }
 
-WindowApp::WindowApp(int width, int height, std::string_view tittle) {
-    glfwInit();
+void WindowApp::stateCallBack(GLFWwindow* window) {
+    WindowApp& app = self(window);
+    app.push({.type = WindowEvent::Type::eState, .state = app.queryState()});
+}
+
+WindowApp::WindowApp(int width, int height, std::string_view tittle, bool headless) : headless(headless) {
+    if (headless) {
+#ifdef GLFW_PLATFORM_NULL
+        // the null platform creates surfaces through VK_EXT_headless_surface
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#else
+        throw std::runtime_error("headless mode needs GLFW 3.4 or newer");
+#endif
+    }
+    if (!glfwInit()) {
+        throw std::runtime_error("failed to initialize GLFW!");
+    }
 
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
     glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
@@ -41,51 +87,302 @@ WindowApp::WindowApp(int width, int height, std::string_view tittle) {
     ));
     void* selfPtr = this;
     glfwSetWindowUserPointer((GLFWwindow*)window.get(), selfPtr);
-    glfwSetFramebufferSizeCallback(
-        window.get(),
-        &resizeCallBackHelper
-    );
 
-    auto fbSize = getFrameSize();
+    // every callback runs on the main thread and only queues the event
+    glfwSetFramebufferSizeCallback(window.get(), [](GLFWwindow* w, int, int) { stateCallBack(w); });
+    glfwSetWindowSizeCallback(window.get(), [](GLFWwindow* w, int, int) { stateCallBack(w); });
+    glfwSetWindowContentScaleCallback(window.get(), [](GLFWwindow* w, float, float) { stateCallBack(w); });
+    glfwSetWindowIconifyCallback(window.get(), [](GLFWwindow* w, int) { stateCallBack(w); });
+    glfwSetKeyCallback(window.get(), [](GLFWwindow* w, int key, int scancode, int action, int mods) {
+        self(w).push({
+            .type = WindowEvent::Type::eKey, .key = key, .scancode = scancode, .action = action, .mods = mods
+        });
+    });
+    glfwSetCharCallback(window.get(), [](GLFWwindow* w, unsigned int codepoint) {
+        self(w).push({.type = WindowEvent::Type::eChar, .codepoint = codepoint});
+    });
+    glfwSetMouseButtonCallback(window.get(), [](GLFWwindow* w, int button, int action, int mods) {
+        self(w).push({.type = WindowEvent::Type::eMouseButton, .key = button, .action = action, .mods = mods});
+    });
+    glfwSetCursorPosCallback(window.get(), [](GLFWwindow* w, double x, double y) {
+        self(w).push({.type = WindowEvent::Type::eCursorPos, .x = x, .y = y});
+    });
+    glfwSetScrollCallback(window.get(), [](GLFWwindow* w, double x, double y) {
+        self(w).push({.type = WindowEvent::Type::eScroll, .x = x, .y = y});
+    });
+    glfwSetWindowFocusCallback(window.get(), [](GLFWwindow* w, int focused) {
+        self(w).push({.type = WindowEvent::Type::eFocus, .action = focused});
+    });
+    glfwSetCursorEnterCallback(window.get(), [](GLFWwindow* w, int entered) {
+        self(w).push({.type = WindowEvent::Type::eCursorEnter, .action = entered});
+    });
+
+    state = queryState();
     std::println(
         "Created a GLFW window; Size:{} x {}; Framebuffer Size: {}x{}",
         width,
         height,
-        fbSize.width,
-        fbSize.height
+        state.frameSize.width,
+        state.frameSize.height
     );
 
+    cursors[ImGuiMouseCursor_Arrow] = glfwCreateStandardCursor(GLFW_ARROW_CURSOR);
+    cursors[ImGuiMouseCursor_TextInput] = glfwCreateStandardCursor(GLFW_IBEAM_CURSOR);
+    cursors[ImGuiMouseCursor_ResizeNS] = glfwCreateStandardCursor(GLFW_VRESIZE_CURSOR);
+    cursors[ImGuiMouseCursor_ResizeEW] = glfwCreateStandardCursor(GLFW_HRESIZE_CURSOR);
+    cursors[ImGuiMouseCursor_Hand] = glfwCreateStandardCursor(GLFW_HAND_CURSOR);
+#ifdef GLFW_RESIZE_ALL_CURSOR
+    cursors[ImGuiMouseCursor_ResizeAll] = glfwCreateStandardCursor(GLFW_RESIZE_ALL_CURSOR);
+    cursors[ImGuiMouseCursor_ResizeNESW] = glfwCreateStandardCursor(GLFW_RESIZE_NESW_CURSOR);
+    cursors[ImGuiMouseCursor_ResizeNWSE] = glfwCreateStandardCursor(GLFW_RESIZE_NWSE_CURSOR);
+    cursors[ImGuiMouseCursor_NotAllowed] = glfwCreateStandardCursor(GLFW_NOT_ALLOWED_CURSOR);
+#endif
+
     ImGui::CreateContext();
-    if (!ImGui_ImplGlfw_InitForVulkan(window.get(), true)) {
+    // no backend callbacks: they'd feed ImGui from the main thread
+    if (!ImGui_ImplGlfw_InitForVulkan(window.get(), false)) {
         throw std::runtime_error("Failed to init IMGUI for GLFW");
     }
+    ImGuiPlatformIO& platformIo = ImGui::GetPlatformIO();
+    platformIo.Platform_ClipboardUserData = this;
+    platformIo.Platform_SetClipboardTextFn = [](ImGuiContext*, const char* text) {
+        auto app = static_cast<WindowApp*>(ImGui::GetPlatformIO().Platform_ClipboardUserData);
+        app->clipboard = text;
+        app->request({.type = WindowRequest::Type::eClipboard, .text = text});
+    };
+    platformIo.Platform_GetClipboardTextFn = [](ImGuiContext*) {
+        auto app = static_cast<WindowApp*>(ImGui::GetPlatformIO().Platform_ClipboardUserData);
+        return app->clipboard.c_str();
+    };
+}
+
+WindowApp::~WindowApp() {
+    for (GLFWcursor* cursor : cursors) {
+        if (cursor != nullptr) {
+            glfwDestroyCursor(cursor);
+        }
+    }
+}
+
+WindowApp::WindowState WindowApp::queryState() const {
+    WindowState current;
+    glfwGetFramebufferSize(window.get(), &current.frameSize.width, &current.frameSize.height);
+    glfwGetWindowSize(window.get(), &current.windowSize.width, &current.windowSize.height);
+    float xscale, yscale;
+    glfwGetWindowContentScale(window.get(), &xscale, &yscale);
+    current.scale = xscale / 2 + yscale / 2;
+    current.minimized = glfwGetWindowAttrib(window.get(), GLFW_ICONIFIED);
+    return current;
+}
+
+void WindowApp::push(const WindowEvent& event) {
+    // keep the order: nothing jumps ahead of what's already waiting
+    if (!overflow.empty() || !events.tryPush(event)) {
+        overflow.push_back(event);
+    }
+}
+
+void WindowApp::applyRequests() {
+    WindowRequest request;
+    while (requests.tryPop(request)) {
+        switch (request.type) {
+        case WindowRequest::Type::eCursor:
+            if (request.cursor == ImGuiMouseCursor_None) {
+                glfwSetInputMode(window.get(), GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
+            }
+            else {
+                glfwSetInputMode(window.get(), GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+                GLFWcursor* cursor = cursors[request.cursor];
+                glfwSetCursor(window.get(), cursor != nullptr ? cursor : cursors[ImGuiMouseCursor_Arrow]);
+            }
+            break;
+        case WindowRequest::Type::eClipboard:
+            glfwSetClipboardString(window.get(), request.text.c_str());
+            break;
+        }
+    }
 }
 
 void WindowApp::run() {
-    while (!glfwWindowShouldClose(window.get())) {
-        glfwPollEvents();
-        drawFrameCallBack();
+    std::exception_ptr error;
+    std::thread renderThread([&] {
+        try {
+            renderLoop();
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+        renderDone = true;
+        glfwPostEmptyEvent();
+    });
+
+    bool closeSent = false;
+    while (!renderDone) {
+        if (!overflow.empty()) {
+            // come back soon to retry, the render thread drains every frame
+            glfwWaitEventsTimeout(0.001);
+        }
+        else if (headless) {
+            // the null platform doesn't block
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            glfwPollEvents();
+        }
+        else {
+            glfwWaitEvents();
+        }
+        applyRequests();
+        if (!closeSent && glfwWindowShouldClose(window.get())) {
+            push({.type = WindowEvent::Type::eClose});
+            closeSent = true;
+        }
+        while (!overflow.empty() && events.tryPush(overflow.front())) {
+            overflow.pop_front();
+        }
+    }
+    renderThread.join();
+    if (error) {
+        std::rethrow_exception(error);
     }
-    cleanupCallBack();
     // glfwTerminate();
     // call terminal will cause segfault on linux when cleanup swapchain?!
 }
 
-Size2D<int> WindowApp::getWindowSize() {
-    int width, height;
-    glfwGetWindowSize(window.get(), &width, &height);
-    return {width, height};
-};
+void WindowApp::renderLoop() {
+    TRACE_THREAD_NAME("render");
+    while (!closing) {
+        TRACE_FRAME_MARK();
+        uint64_t polls = pollCount;
+        if (!lateEventPolling) {
+            pollEvents();
+        }
+        drawFrameCallBack();
+        if (pollCount == polls) {
+            pollEvents();
+        }
+        if (state.minimized && !closing) {
+            // nothing to draw until the window comes back
+            waitEvents();
+        }
+        TRACE_COLLECT();
+    }
+    cleanupCallBack();
+}
+
+void WindowApp::apply(const WindowEvent& event) {
+    ImGuiIO& io = ImGui::GetIO();
+    switch (event.type) {
+    case WindowEvent::Type::eKey:
+        if (event.action == GLFW_PRESS || event.action == GLFW_RELEASE) {
+            addModifierEvents(io, event.key, event.action, event.mods);
+            ImGuiKey key = ImGui_ImplGlfw_KeyToImGuiKey(event.key, event.scancode);
+            io.AddKeyEvent(key, event.action == GLFW_PRESS);
+            io.SetKeyEventNativeData(key, event.key, event.scancode);
+        }
+        break;
+    case WindowEvent::Type::eChar:
+        io.AddInputCharacter(event.codepoint);
+        break;
+    case WindowEvent::Type::eMouseButton:
+        addModifierEvents(io, GLFW_KEY_UNKNOWN, event.action, event.mods);
+        if (event.key >= 0 && event.key < ImGuiMouseButton_COUNT) {
+            io.AddMouseButtonEvent(event.key, event.action == GLFW_PRESS);
+        }
+        break;
+    case WindowEvent::Type::eCursorPos:
+        io.AddMousePosEvent(static_cast<float>(event.x), static_cast<float>(event.y));
+        break;
+    case WindowEvent::Type::eScroll:
+        io.AddMouseWheelEvent(static_cast<float>(event.x), static_cast<float>(event.y));
+        break;
+    case WindowEvent::Type::eFocus:
+        io.AddFocusEvent(event.action != 0);
+        break;
+    case WindowEvent::Type::eCursorEnter:
+        if (event.action == 0) {
+            io.AddMousePosEvent(-FLT_MAX, -FLT_MAX);
+        }
+        break;
+    case WindowEvent::Type::eState: {
+        bool resized = event.state.frameSize.width != state.frameSize.width ||
+                       event.state.frameSize.height != state.frameSize.height;
+        state = event.state;
+        if (resized) {
+            std::println("Resized: {}x{}", state.frameSize.width, state.frameSize.height);
+            resizeCallBack(state.frameSize.width, state.frameSize.height);
+        }
+        break;
+    }
+    case WindowEvent::Type::eClose:
+        closing = true;
+        break;
+    }
+}
+
+void WindowApp::pollEvents() {
+    TRACE_ZONE("window events");
+    WindowEvent event;
+    uint32_t count = 0;
+    while (events.tryPop(event)) {
+        apply(event);
+        count++;
+    }
+    polledEvents = count;
+    lastPoll = std::chrono::steady_clock::now();
+    pollCount++;
+}
+
+void WindowApp::waitEvents() {
+    TRACE_ZONE("wait window events");
+    events.wait();
+}
+
+void WindowApp::request(WindowRequest&& request) {
+    // dropped when full: the main thread is stuck and the next change will do
+    if (requests.tryPush(std::move(request))) {
+        glfwPostEmptyEvent();
+    }
+}
+
+void WindowApp::newImguiFrame() {
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2(static_cast<float>(state.windowSize.width), static_cast<float>(state.windowSize.height));
+    if (state.windowSize.width > 0 && state.windowSize.height > 0) {
+        io.DisplayFramebufferScale = ImVec2(
+            static_cast<float>(state.frameSize.width) / state.windowSize.width,
+            static_cast<float>(state.frameSize.height) / state.windowSize.height
+        );
+    }
+    auto now = std::chrono::steady_clock::now();
+    io.DeltaTime = lastImguiFrame.time_since_epoch().count() == 0
+                       ? 1.f / 60.f
+                       : std::max(std::chrono::duration<float>(now - lastImguiFrame).count(), 1e-6f);
+    lastImguiFrame = now;
+
+    // like the backend: the cursor ImGui asked for during the last frame
+    if (io.ConfigFlags & ImGuiConfigFlags_NoMouseCursorChange) {
+        return;
+    }
+    int cursor = io.MouseDrawCursor ? ImGuiMouseCursor_None : ImGui::GetMouseCursor();
+    if (cursor != imguiCursor) {
+        imguiCursor = cursor;
+        request({.type = WindowRequest::Type::eCursor, .cursor = cursor});
+    }
+}
+
+Size2D<int> WindowApp::getWindowSize() const {
+    return state.windowSize;
+}
 
 Size2D<int> WindowApp::getFrameSize() const {
-    int width, height;
-    glfwGetFramebufferSize(window.get(), &width, &height);
-    return {width, height};
+    return state.frameSize;
+}
+
+void WindowApp::requestClose() {
+    closing = true;
 }
 
 bool WindowApp::isMinimized() const {
-    int iconified = glfwGetWindowAttrib(window.get(), GLFW_ICONIFIED);
-    return iconified;
+    return state.minimized;
 }
 
 vk::raii::SurfaceKHR WindowApp::createSurface(const vk::raii::Instance& instance) {
@@ -99,7 +396,5 @@ vk::raii::SurfaceKHR WindowApp::createSurface(const vk::raii::Instance& instance
 }
 
 float WindowApp::getScale() const {
-    float xscale, yscale;
-    glfwGetWindowContentScale(window.get(), &xscale, &yscale);
-    return xscale / 2 + yscale / 2;
-};
+    return state.scale;
+}
@@ -4,9 +4,16 @@
 // c++ std
 #include <GLFW/glfw3.h>
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
 #include <functional>
+#include <string>
 #include <string_view>
 
+#include "SpscQueue.hpp"
 #include "utils.hpp"
 
 // forward declaration to avoid including heavy headers
@@ -16,14 +23,98 @@ class SurfaceKHR;
 class Instance;
 }  // namespace vk::raii
 
+/*
+ * The GLFW window, split over two threads. run() is called on the main
+ * thread, which GLFW requires for event processing: it starts a render
+ * thread for the callbacks and then only waits for window events. Input and
+ * window state changes reach the render thread through a lock-free SPSC
+ * queue, so a slow frame never stalls the OS event loop (window dragging,
+ * resizing) and event handling never stalls a frame.
+ *
+ * Everything else here (the callbacks, pollEvents(), the size getters,
+ * newImguiFrame()) belongs to the render thread. The size getters return the
+ * state from the last pollEvents(); the few things that must happen on the
+ * main thread (cursor shape, clipboard) are sent back through a second queue.
+ *
+ *     WindowApp window(800, 600, "app");
+ *     window.drawFrameCallBack = [&] { ...; window.newImguiFrame(); ... };
+ *     window.run();  // returns after requestClose() or the window is closed
+ */
 class WindowApp {
 private:
+    struct WindowState {
+        Size2D<int> frameSize{};
+        Size2D<int> windowSize{};
+        float scale = 1.f;
+        bool minimized = false;
+    };
+    // main -> render
+    struct WindowEvent {
+        enum class Type : uint8_t {
+            eKey,
+            eChar,
+            eMouseButton,
+            eCursorPos,
+            eScroll,
+            eFocus,
+            eCursorEnter,
+            eState,
+            eClose,
+        };
+        Type type = Type::eClose;
+        int key = 0;  // key, or mouse button
+        int scancode = 0;
+        int action = 0;  // GLFW_PRESS / GLFW_RELEASE, or 1 when focused / entered
+        int mods = 0;
+        uint32_t codepoint = 0;
+        double x = 0;  // cursor position, scroll offset
+        double y = 0;
+        WindowState state;
+    };
+    // render -> main
+    struct WindowRequest {
+        enum class Type : uint8_t {
+            eCursor,
+            eClipboard,
+        };
+        Type type = Type::eCursor;
+        int cursor = 0;  // ImGuiMouseCursor
+        std::string text;
+    };
+
     // unique_ptr make WindowApp moveable but not copyable
     GLFWwindowWrapper window;
-    static void resizeCallBackHelper(GLFWwindow* window, int width, int height);
+    bool headless = false;
+
+    // main thread
+    SpscQueue<WindowEvent, 1024> events;
+    std::deque<WindowEvent> overflow;  // events the render thread hasn't made room for yet
+    std::array<GLFWcursor*, 16> cursors{};
+    std::atomic<bool> renderDone = false;
+
+    // render thread
+    SpscQueue<WindowRequest, 64> requests;
+    WindowState state;
+    bool closing = false;
+    uint64_t pollCount = 0;
+    uint32_t polledEvents = 0;
+    std::chrono::steady_clock::time_point lastPoll;
+    std::chrono::steady_clock::time_point lastImguiFrame;
+    int imguiCursor = -1;
+    std::string clipboard;  // what this app copied last; the OS clipboard isn't read
+
+    static WindowApp& self(GLFWwindow* window);
+    static void stateCallBack(GLFWwindow* window);
+    WindowState queryState() const;
+    void push(const WindowEvent& event);
+    void applyRequests();
+    void apply(const WindowEvent& event);
+    void request(WindowRequest&& request);
+    void renderLoop();
 
 public:
-    explicit WindowApp(int width, int height, std::string_view tittle);
+    explicit WindowApp(int width, int height, std::string_view tittle, bool headless = false);
+    ~WindowApp();
 
     WindowApp(const WindowApp&) = delete;
     WindowApp& operator=(const WindowApp&) = delete;
@@ -33,10 +124,30 @@ public:
     std::function<void(int width, int height)> resizeCallBack;
     std::function<void()> drawFrameCallBack;
     std::function<void()> cleanupCallBack;
+    // When set, drawFrameCallBack polls events itself (as late as it can);
+    // the render loop only polls after a frame that returned without doing so.
+    bool lateEventPolling = false;
+    // Main thread: runs the render loop on its own thread until it ends, and
+    // rethrows what it threw.
     void run();
-    Size2D<int> getWindowSize();
+    // Hands the queued window events to ImGui and the size getters.
+    void pollEvents();
+    // Blocks until there is an event to poll.
+    void waitEvents();
+    std::chrono::steady_clock::time_point getLastPollTime() const {
+        return lastPoll;
+    }
+    // events handled by the last pollEvents()
+    uint32_t getPolledEvents() const {
+        return polledEvents;
+    }
+    // In place of ImGui_ImplGlfw_NewFrame(), which must run on the main thread.
+    void newImguiFrame();
+    Size2D<int> getWindowSize() const;
     Size2D<int> getFrameSize() const;
     bool isMinimized() const;
+    // End run() after the current frame.
+    void requestClose();
     vk::raii::SurfaceKHR createSurface(const vk::raii::Instance& instance);
     float getScale() const;
 };
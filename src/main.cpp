@@ -1,6 +1,10 @@
 #include <memory>
 #include <print>
+#include <string>
+#include <string_view>
+#include <utility>
 
+#include "Trace.hpp"
 #include "VulkanApp.hpp"
 #include "WindowApp.hpp"
 
@@ -8,10 +12,52 @@ constexpr uint32_t WIDTH = 800;
 constexpr uint32_t HEIGHT = 600;
 const char* TITTLE = "Learn Vulkan";
 
-int main() {
+VulkanApp::Options parseOptions(int argc, char** argv) {
+    VulkanApp::Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg.starts_with("--device=")) {
+            options.device = arg.substr(std::string_view("--device=").size());
+        }
+        else if (arg == "--device" && i + 1 < argc) {
+            options.device = argv[++i];
+        }
+        else if (arg == "--no-mutable-format") {
+            options.mutableSwapchain = false;
+        }
+        else if (arg == "--headless") {
+            options.headless = true;
+        }
+        else if (arg.starts_with("--frames=")) {
+            options.frameLimit = std::stoul(std::string(arg.substr(std::string_view("--frames=").size())));
+        }
+        else if (arg.starts_with("--capture=")) {
+            options.captureDir = arg.substr(std::string_view("--capture=").size());
+        }
+        else if (arg == "--capture-format=y4m") {
+            options.captureFormat = FrameCapture::Format::eY4m;
+        }
+        else if (arg == "--capture-format=png") {
+            options.captureFormat = FrameCapture::Format::ePng;
+        }
+        else if (arg == "--assert-no-alloc") {
+            options.assertNoAllocations = true;
+        }
+        else {
+            std::println(stderr, "Unknown argument: {}", arg);
+        }
+    }
+    return options;
+}
+
+int main(int argc, char** argv) {
+    TRACE_THREAD_NAME("main");
     try {
+        VulkanApp::Options options = parseOptions(argc, argv);
+        bool headless = options.headless;
         VulkanApp app(
-            std::make_unique<WindowApp>(WIDTH, HEIGHT, TITTLE)
+            std::make_unique<WindowApp>(WIDTH, HEIGHT, TITTLE, headless),
+            std::move(options)
         );
         app.run();
     }
@@ -86,6 +86,86 @@ inline uint64_t getTimestampMs() {
     return duration.count();
 }
 
+/*
+ * Fixed-capacity FIFO. Unlike std::deque it never allocates after
+ * construction, for bookkeeping that is pushed and popped every frame.
+ */
+template <class T, size_t N>
+class RingBuffer {
+private:
+    std::array<T, N> items{};
+    size_t head = 0;
+    size_t count = 0;
+
+    template <class Ring, class Value>
+    class Iterator {
+    private:
+        Ring* ring;
+        size_t index;
+
+    public:
+        Iterator(Ring* ring, size_t index) : ring(ring), index(index) {}
+        Value& operator*() const {
+            return (*ring)[index];
+        }
+        Iterator& operator++() {
+            index++;
+            return *this;
+        }
+        bool operator!=(const Iterator& other) const {
+            return index != other.index;
+        }
+    };
+
+public:
+    size_t size() const {
+        return count;
+    }
+    bool empty() const {
+        return count == 0;
+    }
+    bool full() const {
+        return count == N;
+    }
+    T& operator[](size_t i) {
+        return items[(head + i) % N];
+    }
+    const T& operator[](size_t i) const {
+        return items[(head + i) % N];
+    }
+    T& front() {
+        return (*this)[0];
+    }
+    const T& back() const {
+        return (*this)[count - 1];
+    }
+    // Drops the oldest element when full.
+    void push_back(const T& value) {
+        if (full()) {
+            pop_front();
+        }
+        items[(head + count) % N] = value;
+        count++;
+    }
+    void pop_front() {
+        head = (head + 1) % N;
+        count--;
+    }
+
+    auto begin() {
+        return Iterator<RingBuffer, T>(this, 0);
+    }
+    auto end() {
+        return Iterator<RingBuffer, T>(this, count);
+    }
+    auto begin() const {
+        return Iterator<const RingBuffer, const T>(this, 0);
+    }
+    auto end() const {
+        return Iterator<const RingBuffer, const T>(this, count);
+    }
+};
+
 template <class T>
 inline size_t getVectorSize(const std::vector<T>& vec) {
     return vec.size() * sizeof(T);
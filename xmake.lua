@@ -3,6 +3,13 @@ add_rules("mode.debug", "mode.release")
 add_requires("glfw")
 add_requires("glm", "vulkan-hpp", {system = false})
 
+option("trace", function()
+    set_default(false)
+    set_showmenu(true)
+    set_description("Enable TRACE_* instrumentation and Chrome trace export")
+    add_defines("LEARN_VULKAN_TRACE")
+end)
+
 includes("third_party/")
 
 target("learn_vulkan", function()
@@ -11,6 +18,39 @@ target("learn_vulkan", function()
     add_files("src/**.cpp")
     add_packages("glfw", "glm", "vulkan-hpp")
     add_deps("imgui_vulkan_glfw")
+    add_options("trace")
+    if is_mode("debug") then
+        -- replaces global operator new, see src/AllocationCounter.hpp
+        add_defines("LEARN_VULKAN_COUNT_ALLOCATIONS")
+    end
+    add_defines("GLFW_INCLUDE_VULKAN")
+    add_defines("VK_NO_PROTOTYPES")
+    add_defines("VULKAN_HPP_NO_CONSTRUCTORS")
+    add_defines("VULKAN_HPP_DISPATCH_LOADER_DYNAMIC=1")
+end)
+
+-- CPU micro and GPU macro benchmarks (the GPU cases pick lavapipe), run with
+--   xmake run learn_vulkan_bench [filter] [--json=out.json] [--compare=baseline.json] [--threshold=10]
+-- from the repository root
+target("learn_vulkan_bench", function()
+    set_kind("binary")
+    set_languages("c17", "c++23")
+    add_files(
+        "bench/**.cpp",
+        "src/AsyncIO.cpp",
+        "src/ChunkCache.cpp",
+        "src/CommandCache.cpp",
+        "src/DeviceProfile.cpp",
+        "src/FrameArena.cpp",
+        "src/FrustumCulling.cpp",
+        "src/SceneShaders.cpp",
+        "src/SpriteBatch.cpp",
+        "src/Trace.cpp",
+        "src/TransformHierarchy.cpp"
+    )
+    add_packages("glfw", "glm", "vulkan-hpp")
+    add_includedirs("src")
+    add_defines("LEARN_VULKAN_TRACE")
     add_defines("GLFW_INCLUDE_VULKAN")
     add_defines("VK_NO_PROTOTYPES")
     add_defines("VULKAN_HPP_NO_CONSTRUCTORS")